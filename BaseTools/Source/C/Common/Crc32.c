@@ -1,7 +1,7 @@
 /** @file
 CalcuateCrc32 routine.
 
-Copyright (c) 2004 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2004 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials                          
 are licensed and made available under the terms and conditions of the BSD License         
 which accompanies this distribution.  The full text of the license may be found at        
@@ -274,6 +274,48 @@ UINT32  mCrcTable[256] = {
   0x2D02EF8D
 };
 
+//
+// mCrcSliceTable[N - 1] gives the CRC contribution of a byte followed by N
+// zero bytes, so that 8 bytes can be processed per step (slicing-by-8).
+//
+STATIC UINT32   mCrcSliceTable[7][256];
+STATIC BOOLEAN  mCrcSliceTableReady = FALSE;
+
+STATIC
+VOID
+InitializeCrcSliceTable (
+  VOID
+  )
+/*++
+
+Routine Description:
+
+  Build the slicing-by-8 tables from mCrcTable.
+
+Arguments:
+
+  None
+
+Returns:
+
+  None
+
+--*/
+{
+  UINTN   Slice;
+  UINTN   Index;
+  UINT32  Value;
+
+  for (Slice = 0; Slice < 7; Slice++) {
+    for (Index = 0; Index < 256; Index++) {
+      Value = (Slice == 0) ? mCrcTable[Index] : mCrcSliceTable[Slice - 1][Index];
+      mCrcSliceTable[Slice][Index] = (Value >> 8) ^ mCrcTable[Value & 0xff];
+    }
+  }
+
+  mCrcSliceTableReady = TRUE;
+}
+
 EFI_STATUS
 CalculateCrc32 (
   IN  UINT8                             *Data,
@@ -301,16 +343,44 @@ Returns:
 --*/
 {
   UINT32  Crc;
-  UINTN   Index;
+  UINT32  Low;
+  UINT32  High;
   UINT8   *Ptr;
 
   if ((DataSize == 0) || (Data == NULL) || (CrcOut == NULL)) {
     return EFI_INVALID_PARAMETER;
   }
 
+  if (!mCrcSliceTableReady) {
+    InitializeCrcSliceTable ();
+  }
+
   Crc = 0xffffffff;
-  for (Index = 0, Ptr = Data; Index < DataSize; Index++, Ptr++) {
+  Ptr = Data;
+
+  //
+  // The words are assembled byte by byte so that the result does not depend
+  // on the host byte order or alignment requirements.
+  //
+  while (DataSize >= 8) {
+    Low  = Crc ^ ((UINT32) Ptr[0] | ((UINT32) Ptr[1] << 8) | ((UINT32) Ptr[2] << 16) | ((UINT32) Ptr[3] << 24));
+    High = (UINT32) Ptr[4] | ((UINT32) Ptr[5] << 8) | ((UINT32) Ptr[6] << 16) | ((UINT32) Ptr[7] << 24);
+    Crc  = mCrcSliceTable[6][Low & 0xff] ^
+           mCrcSliceTable[5][(Low >> 8) & 0xff] ^
+           mCrcSliceTable[4][(Low >> 16) & 0xff] ^
+           mCrcSliceTable[3][Low >> 24] ^
+           mCrcSliceTable[2][High & 0xff] ^
+           mCrcSliceTable[1][(High >> 8) & 0xff] ^
+           mCrcSliceTable[0][(High >> 16) & 0xff] ^
+           mCrcTable[High >> 24];
+    Ptr      += 8;
+    DataSize -= 8;
+  }
+
+  while (DataSize > 0) {
     Crc = (Crc >> 8) ^ mCrcTable[(UINT8) Crc ^ *Ptr];
+    Ptr++;
+    DataSize--;
   }
 
   *CrcOut = Crc ^ 0xffffffff;
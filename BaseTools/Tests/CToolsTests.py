@@ -19,8 +19,10 @@ import os
 import sys
 import unittest
 
+import GenCrc32
 import TianoCompress
 modules = (
+    GenCrc32,
     TianoCompress,
     )
 
@@ -0,0 +1,82 @@
+## @file
+# Unit tests for GenCrc32 utility
+#
+#  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution.  The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+
+##
+# Import Modules
+#
+import binascii
+import os
+import random
+import struct
+import sys
+import unittest
+
+import TestTools
+
+class Tests(TestTools.BaseToolsTest):
+
+    def setUp(self):
+        TestTools.BaseToolsTest.setUp(self)
+        self.toolName = 'GenCrc32'
+
+    def testHelp(self):
+        result = self.RunTool('--help', logFile='help')
+        #self.DisplayFile('help')
+        self.assertTrue(result == 0)
+
+    def crcTestCycle(self, data):
+        self.WriteTmpFile('input', data)
+        result = self.RunTool(
+            '-e',
+            '-o', self.GetTmpFilePath('output1'),
+            self.GetTmpFilePath('input')
+            )
+        self.assertTrue(result == 0)
+        encoded = self.ReadTmpFile('output1')
+        crc = struct.unpack('<I', encoded[:4])[0]
+        expected = binascii.crc32(data) & 0xffffffff
+        if crc != expected:
+            print
+            print 'GenCrc32 returned 0x%08x, expected 0x%08x' % (crc, expected)
+            self.DisplayBinaryData('original data', data)
+        self.assertTrue(crc == expected)
+        self.assertTrue(encoded[4:] == data)
+        result = self.RunTool(
+            '-d',
+            '-o', self.GetTmpFilePath('output2'),
+            self.GetTmpFilePath('output1')
+            )
+        self.assertTrue(result == 0)
+        self.assertTrue(self.ReadTmpFile('output2') == data)
+
+    def testShortDataCycles(self):
+        #
+        # Cover every length around the 8-byte step of the slicing-by-8 loop
+        #
+        for length in range(1, 33):
+            data = self.GetRandomString(length)
+            self.crcTestCycle(data)
+            self.CleanUpTmpDir()
+
+    def testRandomDataCycles(self):
+        for i in range(8):
+            data = self.GetRandomString(1024, 65536)
+            self.crcTestCycle(data)
+            self.CleanUpTmpDir()
+
+TheTestSuite = TestTools.MakeTheTestSuite(locals())
+
+if __name__ == '__main__':
+    allTests = TheTestSuite()
+    unittest.TextTestRunner().run(allTests)
@@ -1,7 +1,7 @@
 /** @file
   Application for Cryptographic Primitives Validation.
 
-Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -14,6 +14,56 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "Cryptest.h"
 
+/**
+  Check whether the throughput measurement is requested on the command line,
+  by a "-b" or "-benchmark" option in the load options of the application.
+
+  @param  ImageHandle  The image handle of the UEFI Application.
+
+  @retval TRUE         The throughput measurement is requested.
+  @retval FALSE        The throughput measurement is not requested.
+
+**/
+BOOLEAN
+IsBenchmarkRequested (
+  IN     EFI_HANDLE                 ImageHandle
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+  CHAR16                     *Options;
+  UINTN                      Length;
+  UINTN                      Index;
+  UINTN                      Start;
+
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **) &LoadedImage);
+  if (EFI_ERROR (Status) || (LoadedImage->LoadOptions == NULL)) {
+    return FALSE;
+  }
+
+  //
+  // The load options hold the command line, the options are separated by spaces.
+  //
+  Options = (CHAR16 *) LoadedImage->LoadOptions;
+  Length  = LoadedImage->LoadOptionsSize / sizeof (CHAR16);
+  Index   = 0;
+  while (Index < Length && Options[Index] != L'\0') {
+    while (Index < Length && Options[Index] == L' ') {
+      Index++;
+    }
+    Start = Index;
+    while (Index < Length && Options[Index] != L' ' && Options[Index] != L'\0') {
+      Index++;
+    }
+    if (((Index - Start == 2) && (CompareMem (&Options[Start], L"-b", 2 * sizeof (CHAR16)) == 0)) ||
+        ((Index - Start == 10) && (CompareMem (&Options[Start], L"-benchmark", 10 * sizeof (CHAR16)) == 0))) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 /**
   Entry Point of Cryptographic Validation Utility.
 
@@ -88,5 +138,18 @@ CryptestMain (
     return Status;
   }
 
+  //
+  // The throughput measurement takes a while, only run it on request.
+  //
+  if (!IsBenchmarkRequested (ImageHandle)) {
+    Print (L"\nRun with -b to measure the cryptosystem throughput.\n");
+    return EFI_SUCCESS;
+  }
+
+  Status = BenchmarkCryptThroughput ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   return EFI_SUCCESS;
 }
\ No newline at end of file
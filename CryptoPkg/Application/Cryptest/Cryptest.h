@@ -1,7 +1,7 @@
 /** @file
   Application for Cryptographic Primitives Validation.
 
-Copyright (c) 2009 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -16,12 +16,15 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define __CRYPTEST_H__
 
 #include <Uefi.h>
+#include <Protocol/LoadedImage.h>
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
 #include <Library/BaseCryptLib.h>
 
 /**
@@ -144,4 +147,17 @@ ValidateCryptPrng (
   VOID
   );
 
+/**
+  Measure the throughput of the UEFI-OpenSSL digest, AES-CBC and RSA interfaces.
+
+  @retval  EFI_SUCCESS           The measurement completed.
+  @retval  EFI_OUT_OF_RESOURCES  Failed to allocate the test buffers.
+  @retval  EFI_ABORTED           A primitive failed.
+
+**/
+EFI_STATUS
+BenchmarkCryptThroughput (
+  VOID
+  );
+
 #endif
\ No newline at end of file
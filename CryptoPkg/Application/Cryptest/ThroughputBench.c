@@ -0,0 +1,415 @@
+/** @file
+  Throughput measurement of the UEFI-OpenSSL digest, cipher and RSA primitives.
+
+  The numbers are meant to compare OpensslLib builds, or platforms, with
+  each other. They need a TimerLib instance that measures real time.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "Cryptest.h"
+
+//
+// Each digest and cipher processes BENCH_DATA_SIZE * BENCH_DATA_LOOPS bytes (16MB).
+//
+#define BENCH_DATA_SIZE     SIZE_64KB
+#define BENCH_DATA_LOOPS    256
+
+//
+// Multi-hash comparison: one buffer larger than the processor caches, hashed by
+// SHA-1, SHA-256 and SHA-384 either one algorithm after the other or in chunks
+// fed to all three algorithms in turn (as HashLibBaseCryptoRouter does).
+//
+#define BENCH_MULTI_HASH_SIZE    SIZE_16MB
+#define BENCH_MULTI_HASH_CHUNK   SIZE_16KB
+#define BENCH_MULTI_HASH_COUNT   3
+
+//
+// Number of RSA-2048 signing and verification operations.
+//
+#define BENCH_RSA_BITS      2048
+#define BENCH_RSA_LOOPS     16
+
+typedef
+UINTN
+(EFIAPI *BENCH_HASH_GET_CONTEXT_SIZE) (
+  VOID
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *BENCH_HASH_INIT) (
+  OUT  VOID  *HashContext
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *BENCH_HASH_UPDATE) (
+  IN OUT  VOID        *HashContext,
+  IN      CONST VOID  *Data,
+  IN      UINTN       DataSize
+  );
+
+typedef
+BOOLEAN
+(EFIAPI *BENCH_HASH_FINAL) (
+  IN OUT  VOID   *HashContext,
+  OUT     UINT8  *HashValue
+  );
+
+typedef struct {
+  CHAR16                       *Name;
+  BENCH_HASH_GET_CONTEXT_SIZE  GetContextSize;
+  BENCH_HASH_INIT              Init;
+  BENCH_HASH_UPDATE            Update;
+  BENCH_HASH_FINAL             Final;
+} BENCH_HASH_ALGORITHM;
+
+GLOBAL_REMOVE_IF_UNREFERENCED BENCH_HASH_ALGORITHM mBenchHash[] = {
+  { L"SHA-1       ", Sha1GetContextSize,   Sha1Init,   Sha1Update,   Sha1Final   },
+  { L"SHA-256     ", Sha256GetContextSize, Sha256Init, Sha256Update, Sha256Final },
+  { L"SHA-384     ", Sha384GetContextSize, Sha384Init, Sha384Update, Sha384Final },
+  { L"SHA-512     ", Sha512GetContextSize, Sha512Init, Sha512Update, Sha512Final }
+};
+
+/**
+  Return the time elapsed since the performance counter value Start was sampled.
+
+  @param[in]  Start  The performance counter value sampled at the beginning.
+
+  @return The elapsed time in nanoseconds.
+
+**/
+UINT64
+BenchElapsedTime (
+  IN UINT64  Start
+  )
+{
+  UINT64  End;
+  UINT64  CounterStart;
+  UINT64  CounterEnd;
+
+  End = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterStart > CounterEnd) {
+    //
+    // The performance counter counts down.
+    //
+    return GetTimeInNanoSecond (Start - End);
+  }
+
+  return GetTimeInNanoSecond (End - Start);
+}
+
+/**
+  Print the throughput of one primitive.
+
+  @param[in]  Name         The name of the primitive.
+  @param[in]  Bytes        The number of bytes processed.
+  @param[in]  Nanoseconds  The time spent in nanoseconds.
+
+**/
+VOID
+BenchPrintThroughput (
+  IN CHAR16  *Name,
+  IN UINT64  Bytes,
+  IN UINT64  Nanoseconds
+  )
+{
+  if (Nanoseconds == 0) {
+    Print (L"- %s: no performance counter\n", Name);
+    return;
+  }
+
+  //
+  // KB/s = Bytes * 10^9 / 1024 / Nanoseconds, kept within 64 bits for up to 16GB.
+  //
+  Print (
+    L"- %s: %8ld KB/s\n",
+    Name,
+    DivU64x64Remainder (MultU64x32 (Bytes, 1000000000 / SIZE_1KB), Nanoseconds, NULL)
+    );
+}
+
+/**
+  Compare hashing one large buffer with several algorithms sequentially against
+  streaming it in cache-sized chunks through all the algorithms.
+
+  @retval  EFI_SUCCESS           The measurement completed.
+  @retval  EFI_OUT_OF_RESOURCES  Failed to allocate the test buffers.
+  @retval  EFI_ABORTED           A primitive failed.
+
+**/
+EFI_STATUS
+BenchmarkMultiHash (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Data;
+  VOID        *Context[BENCH_MULTI_HASH_COUNT];
+  UINT8       Digest[SHA512_DIGEST_SIZE];
+  UINTN       Index;
+  UINTN       Offset;
+  UINTN       ChunkSize;
+  UINT64      Start;
+  UINT64      Elapsed;
+
+  Status = EFI_ABORTED;
+  ZeroMem (Context, sizeof (Context));
+  Data = AllocatePool (BENCH_MULTI_HASH_SIZE);
+  if (Data == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  RandomBytes (Data, BENCH_MULTI_HASH_SIZE);
+
+  for (Index = 0; Index < BENCH_MULTI_HASH_COUNT; Index++) {
+    Context[Index] = AllocatePool (mBenchHash[Index].GetContextSize ());
+    if (Context[Index] == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+  }
+
+  //
+  // Each algorithm reads the whole buffer on its own.
+  //
+  Start = GetPerformanceCounter ();
+  for (Index = 0; Index < BENCH_MULTI_HASH_COUNT; Index++) {
+    if (!mBenchHash[Index].Init (Context[Index]) ||
+        !mBenchHash[Index].Update (Context[Index], Data, BENCH_MULTI_HASH_SIZE) ||
+        !mBenchHash[Index].Final (Context[Index], Digest)) {
+      goto Exit;
+    }
+  }
+  Elapsed = BenchElapsedTime (Start);
+  BenchPrintThroughput (L"SHA1+256+384 sequential ", BENCH_MULTI_HASH_SIZE, Elapsed);
+
+  //
+  // Every chunk goes through all the algorithms while it is cached.
+  //
+  Start = GetPerformanceCounter ();
+  for (Index = 0; Index < BENCH_MULTI_HASH_COUNT; Index++) {
+    if (!mBenchHash[Index].Init (Context[Index])) {
+      goto Exit;
+    }
+  }
+  for (Offset = 0; Offset < BENCH_MULTI_HASH_SIZE; Offset += ChunkSize) {
+    ChunkSize = MIN (BENCH_MULTI_HASH_SIZE - Offset, BENCH_MULTI_HASH_CHUNK);
+    for (Index = 0; Index < BENCH_MULTI_HASH_COUNT; Index++) {
+      if (!mBenchHash[Index].Update (Context[Index], Data + Offset, ChunkSize)) {
+        goto Exit;
+      }
+    }
+  }
+  for (Index = 0; Index < BENCH_MULTI_HASH_COUNT; Index++) {
+    if (!mBenchHash[Index].Final (Context[Index], Digest)) {
+      goto Exit;
+    }
+  }
+  Elapsed = BenchElapsedTime (Start);
+  BenchPrintThroughput (L"SHA1+256+384 interleaved", BENCH_MULTI_HASH_SIZE, Elapsed);
+
+  Status = EFI_SUCCESS;
+
+Exit:
+  for (Index = 0; Index < BENCH_MULTI_HASH_COUNT; Index++) {
+    if (Context[Index] != NULL) {
+      FreePool (Context[Index]);
+    }
+  }
+  FreePool (Data);
+
+  return Status;
+}
+
+/**
+  Measure the throughput of the UEFI-OpenSSL digest, AES-CBC and RSA interfaces.
+
+  @retval  EFI_SUCCESS           The measurement completed.
+  @retval  EFI_OUT_OF_RESOURCES  Failed to allocate the test buffers.
+  @retval  EFI_ABORTED           A primitive failed.
+
+**/
+EFI_STATUS
+BenchmarkCryptThroughput (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Data;
+  UINT8       *Output;
+  VOID        *Context;
+  VOID        *RsaContext;
+  UINT8       Digest[SHA512_DIGEST_SIZE];
+  UINT8       Key[32];
+  UINT8       Ivec[16];
+  UINT8       *Signature;
+  UINTN       SigSize;
+  UINTN       Index;
+  UINTN       Loop;
+  UINT64      Start;
+  UINT64      Elapsed;
+
+  Print (L"\nUEFI-OpenSSL Cryptosystem Throughput: \n");
+  Print (L"-------------------------------------------- \n");
+
+  Status     = EFI_ABORTED;
+  Context    = NULL;
+  RsaContext = NULL;
+  Signature  = NULL;
+  Data       = AllocatePool (BENCH_DATA_SIZE);
+  Output     = AllocatePool (BENCH_DATA_SIZE);
+  if (Data == NULL || Output == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  RandomBytes (Data, BENCH_DATA_SIZE);
+  RandomBytes (Key, sizeof (Key));
+  RandomBytes (Ivec, sizeof (Ivec));
+
+  //
+  // Message digests.
+  //
+  for (Index = 0; Index < sizeof (mBenchHash) / sizeof (BENCH_HASH_ALGORITHM); Index++) {
+    Context = AllocatePool (mBenchHash[Index].GetContextSize ());
+    if (Context == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+
+    Start = GetPerformanceCounter ();
+    if (!mBenchHash[Index].Init (Context)) {
+      goto Exit;
+    }
+    for (Loop = 0; Loop < BENCH_DATA_LOOPS; Loop++) {
+      if (!mBenchHash[Index].Update (Context, Data, BENCH_DATA_SIZE)) {
+        goto Exit;
+      }
+    }
+    if (!mBenchHash[Index].Final (Context, Digest)) {
+      goto Exit;
+    }
+    Elapsed = BenchElapsedTime (Start);
+
+    BenchPrintThroughput (mBenchHash[Index].Name, MultU64x32 (BENCH_DATA_SIZE, BENCH_DATA_LOOPS), Elapsed);
+
+    FreePool (Context);
+    Context = NULL;
+  }
+
+  Status = BenchmarkMultiHash ();
+  if (EFI_ERROR (Status)) {
+    goto Exit;
+  }
+  Status = EFI_ABORTED;
+
+  //
+  // AES-CBC encryption with 128-bit and 256-bit keys.
+  //
+  Context = AllocatePool (AesGetContextSize ());
+  if (Context == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  for (Index = 128; Index <= 256; Index += 128) {
+    if (!AesInit (Context, Key, Index)) {
+      goto Exit;
+    }
+
+    Start = GetPerformanceCounter ();
+    for (Loop = 0; Loop < BENCH_DATA_LOOPS; Loop++) {
+      if (!AesCbcEncrypt (Context, Data, BENCH_DATA_SIZE, Ivec, Output)) {
+        goto Exit;
+      }
+    }
+    Elapsed = BenchElapsedTime (Start);
+
+    BenchPrintThroughput (
+      (Index == 128) ? L"AES-128-CBC " : L"AES-256-CBC ",
+      MultU64x32 (BENCH_DATA_SIZE, BENCH_DATA_LOOPS),
+      Elapsed
+      );
+  }
+
+  FreePool (Context);
+  Context = NULL;
+
+  //
+  // RSA-2048 PKCS#1 v1.5 signing and verification of a SHA-256 digest.
+  //
+  RsaContext = RsaNew ();
+  if (RsaContext == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  if (!RsaGenerateKey (RsaContext, BENCH_RSA_BITS, NULL, 0)) {
+    goto Exit;
+  }
+
+  SigSize   = BENCH_RSA_BITS / 8;
+  Signature = AllocatePool (SigSize);
+  if (Signature == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  //
+  // Any 32 bytes do as the SHA-256 digest to sign; reuse the leading bytes of the
+  // last digest computed above.
+  //
+
+  Start = GetPerformanceCounter ();
+  for (Loop = 0; Loop < BENCH_RSA_LOOPS; Loop++) {
+    SigSize = BENCH_RSA_BITS / 8;
+    if (!RsaPkcs1Sign (RsaContext, Digest, SHA256_DIGEST_SIZE, Signature, &SigSize)) {
+      goto Exit;
+    }
+  }
+  Elapsed = BenchElapsedTime (Start);
+  Print (L"- RSA-2048 Sign  : %8ld us/op\n", DivU64x32 (Elapsed, BENCH_RSA_LOOPS * 1000));
+
+  Start = GetPerformanceCounter ();
+  for (Loop = 0; Loop < BENCH_RSA_LOOPS; Loop++) {
+    if (!RsaPkcs1Verify (RsaContext, Digest, SHA256_DIGEST_SIZE, Signature, SigSize)) {
+      goto Exit;
+    }
+  }
+  Elapsed = BenchElapsedTime (Start);
+  Print (L"- RSA-2048 Verify: %8ld us/op\n", DivU64x32 (Elapsed, BENCH_RSA_LOOPS * 1000));
+
+  Status = EFI_SUCCESS;
+
+Exit:
+  if (EFI_ERROR (Status)) {
+    Print (L"[Fail]\n");
+  }
+  if (Context != NULL) {
+    FreePool (Context);
+  }
+  if (RsaContext != NULL) {
+    RsaFree (RsaContext);
+  }
+  if (Signature != NULL) {
+    FreePool (Signature);
+  }
+  if (Data != NULL) {
+    FreePool (Data);
+  }
+  if (Output != NULL) {
+    FreePool (Output);
+  }
+
+  return Status;
+}
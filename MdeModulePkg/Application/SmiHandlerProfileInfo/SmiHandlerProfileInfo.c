@@ -0,0 +1,269 @@
+/** @file
+  Shell application to dump the SMI handler profile.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/DebugLib.h>
+
+#include <Protocol/SmmCommunication.h>
+
+#include <Guid/SmiHandlerProfile.h>
+#include <Guid/PiSmmCommunicationRegionTable.h>
+
+/**
+  Dump the SMI handler profile data.
+
+  @param[in] ProfileBuffer      The SMI handler profile data.
+  @param[in] ProfileSize        The size of the SMI handler profile data.
+
+**/
+VOID
+DumpSmiHandlerProfile (
+  IN VOID   *ProfileBuffer,
+  IN UINTN  ProfileSize
+  )
+{
+  SMI_HANDLER_PROFILE_CONTEXT  *Context;
+  SMI_HANDLER_PROFILE_HANDLER  *HandlerInfo;
+  UINT8                        *ProfileEnd;
+  UINT32                       Index;
+  UINT64                       AverageTime;
+
+  if (ProfileSize < sizeof (SMI_HANDLER_PROFILE_CONTEXT)) {
+    return;
+  }
+  Context = (SMI_HANDLER_PROFILE_CONTEXT *) ProfileBuffer;
+  if (Context->Signature != SMI_HANDLER_PROFILE_CONTEXT_SIGNATURE) {
+    return;
+  }
+  ProfileEnd = (UINT8 *) ProfileBuffer + ProfileSize;
+
+  Print (L"HandlerCount - 0x%x\n", Context->HandlerCount);
+  Print (L"HandlerType                           Handler            CallCount    TotalTime(us)  AverageTime(us)  MaxTime(us)\n");
+
+  HandlerInfo = (SMI_HANDLER_PROFILE_HANDLER *) ((UINT8 *) Context + Context->Length);
+  for (Index = 0; Index < Context->HandlerCount; Index++) {
+    if ((UINT8 *) HandlerInfo + sizeof (SMI_HANDLER_PROFILE_HANDLER) > ProfileEnd ||
+        HandlerInfo->Signature != SMI_HANDLER_PROFILE_HANDLER_SIGNATURE) {
+      break;
+    }
+    AverageTime = 0;
+    if (HandlerInfo->CallCount != 0) {
+      AverageTime = DivU64x64Remainder (HandlerInfo->TotalTime, HandlerInfo->CallCount, NULL);
+    }
+    if (IsZeroGuid (&HandlerInfo->HandlerType)) {
+      Print (L"Root                                  ");
+    } else {
+      Print (L"%g  ", &HandlerInfo->HandlerType);
+    }
+    Print (
+      L"0x%016lx 0x%010lx %14ld %16ld %12ld\n",
+      HandlerInfo->Handler,
+      HandlerInfo->CallCount,
+      DivU64x32 (HandlerInfo->TotalTime, 1000),
+      DivU64x32 (AverageTime, 1000),
+      DivU64x32 (HandlerInfo->MaxTime, 1000)
+      );
+    HandlerInfo = (SMI_HANDLER_PROFILE_HANDLER *) ((UINT8 *) HandlerInfo + HandlerInfo->Length);
+  }
+}
+
+/**
+  Get and dump the SMI handler profile data.
+
+  @return EFI_SUCCESS   Get the SMI handler profile data successfully.
+  @return other         Fail to get the SMI handler profile data.
+
+**/
+EFI_STATUS
+GetSmiHandlerProfileData (
+  VOID
+  )
+{
+  EFI_STATUS                                        Status;
+  UINTN                                             CommSize;
+  UINT8                                             *CommBuffer;
+  EFI_SMM_COMMUNICATE_HEADER                        *CommHeader;
+  SMI_HANDLER_PROFILE_PARAMETER_GET_INFO            *CommGetInfo;
+  SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET  *CommGetData;
+  UINTN                                             ProfileSize;
+  VOID                                              *ProfileBuffer;
+  EFI_SMM_COMMUNICATION_PROTOCOL                    *SmmCommunication;
+  UINTN                                             MinimalSizeNeeded;
+  EDKII_PI_SMM_COMMUNICATION_REGION_TABLE           *PiSmmCommunicationRegionTable;
+  UINT32                                            Index;
+  EFI_MEMORY_DESCRIPTOR                             *Entry;
+  VOID                                              *Buffer;
+  UINTN                                             Size;
+  UINTN                                             Offset;
+
+  ProfileBuffer = NULL;
+
+  Status = gBS->LocateProtocol (&gEfiSmmCommunicationProtocolGuid, NULL, (VOID **) &SmmCommunication);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerProfile: Locate SmmCommunication protocol - %r\n", Status));
+    return Status;
+  }
+
+  MinimalSizeNeeded = sizeof (EFI_GUID) +
+                      sizeof (UINTN) +
+                      MAX (sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_INFO),
+                           sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET));
+  MinimalSizeNeeded += MAX (sizeof (SMI_HANDLER_PROFILE_CONTEXT),
+                            sizeof (SMI_HANDLER_PROFILE_HANDLER));
+
+  Status = EfiGetSystemConfigurationTable (
+             &gEdkiiPiSmmCommunicationRegionTableGuid,
+             (VOID **) &PiSmmCommunicationRegionTable
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerProfile: Get PiSmmCommunicationRegionTable - %r\n", Status));
+    return Status;
+  }
+  ASSERT (PiSmmCommunicationRegionTable != NULL);
+  Entry = (EFI_MEMORY_DESCRIPTOR *) (PiSmmCommunicationRegionTable + 1);
+  Size = 0;
+  for (Index = 0; Index < PiSmmCommunicationRegionTable->NumberOfEntries; Index++) {
+    if (Entry->Type == EfiConventionalMemory) {
+      Size = EFI_PAGES_TO_SIZE ((UINTN) Entry->NumberOfPages);
+      if (Size >= MinimalSizeNeeded) {
+        break;
+      }
+    }
+    Entry = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) Entry + PiSmmCommunicationRegionTable->DescriptorSize);
+  }
+  ASSERT (Index < PiSmmCommunicationRegionTable->NumberOfEntries);
+  CommBuffer = (UINT8 *) (UINTN) Entry->PhysicalStart;
+
+  //
+  // Get Size
+  //
+  CommHeader = (EFI_SMM_COMMUNICATE_HEADER *) &CommBuffer[0];
+  CopyMem (&CommHeader->HeaderGuid, &gEdkiiSmiHandlerProfileGuid, sizeof (gEdkiiSmiHandlerProfileGuid));
+  CommHeader->MessageLength = sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_INFO);
+
+  CommGetInfo = (SMI_HANDLER_PROFILE_PARAMETER_GET_INFO *) &CommBuffer[OFFSET_OF (EFI_SMM_COMMUNICATE_HEADER, Data)];
+  CommGetInfo->Header.Command      = SMI_HANDLER_PROFILE_COMMAND_GET_INFO;
+  CommGetInfo->Header.DataLength   = sizeof (*CommGetInfo);
+  CommGetInfo->Header.ReturnStatus = (UINT64)-1;
+  CommGetInfo->DataSize            = 0;
+
+  CommSize = sizeof (EFI_GUID) + sizeof (UINTN) + CommHeader->MessageLength;
+  Status = SmmCommunication->Communicate (SmmCommunication, CommBuffer, &CommSize);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerProfile: SmmCommunication - %r\n", Status));
+    return Status;
+  }
+
+  if (CommGetInfo->Header.ReturnStatus != 0) {
+    Print (L"SmiHandlerProfile: GetInfo - 0x%0x\n", CommGetInfo->Header.ReturnStatus);
+    return EFI_SUCCESS;
+  }
+
+  ProfileSize = (UINTN) CommGetInfo->DataSize;
+
+  //
+  // Get Data
+  //
+  ProfileBuffer = AllocateZeroPool (ProfileSize);
+  if (ProfileBuffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    Print (L"SmiHandlerProfile: AllocateZeroPool (0x%x) for profile buffer - %r\n", ProfileSize, Status);
+    return Status;
+  }
+
+  CommHeader = (EFI_SMM_COMMUNICATE_HEADER *) &CommBuffer[0];
+  CopyMem (&CommHeader->HeaderGuid, &gEdkiiSmiHandlerProfileGuid, sizeof (gEdkiiSmiHandlerProfileGuid));
+  CommHeader->MessageLength = sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET);
+
+  CommGetData = (SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET *) &CommBuffer[OFFSET_OF (EFI_SMM_COMMUNICATE_HEADER, Data)];
+  CommGetData->Header.Command      = SMI_HANDLER_PROFILE_COMMAND_GET_DATA_BY_OFFSET;
+  CommGetData->Header.DataLength   = sizeof (*CommGetData);
+  CommGetData->Header.ReturnStatus = (UINT64)-1;
+
+  CommSize = sizeof (EFI_GUID) + sizeof (UINTN) + CommHeader->MessageLength;
+  Buffer = (UINT8 *) CommHeader + CommSize;
+  Size -= CommSize;
+
+  CommGetData->DataBuffer = (PHYSICAL_ADDRESS) (UINTN) Buffer;
+  CommGetData->DataOffset = 0;
+  while (CommGetData->DataOffset < ProfileSize) {
+    Offset = (UINTN) CommGetData->DataOffset;
+    if (Size <= (ProfileSize - CommGetData->DataOffset)) {
+      CommGetData->DataSize = (UINT64) Size;
+    } else {
+      CommGetData->DataSize = (UINT64) (ProfileSize - CommGetData->DataOffset);
+    }
+    Status = SmmCommunication->Communicate (SmmCommunication, CommBuffer, &CommSize);
+    ASSERT_EFI_ERROR (Status);
+
+    if (CommGetData->Header.ReturnStatus != 0) {
+      Status = EFI_SUCCESS;
+      Print (L"SmiHandlerProfile: GetData - 0x%x\n", CommGetData->Header.ReturnStatus);
+      goto Done;
+    }
+    if (CommGetData->DataSize == 0) {
+      //
+      // Handlers were unregistered since the size was returned
+      //
+      ProfileSize = Offset;
+      break;
+    }
+    CopyMem ((UINT8 *) ProfileBuffer + Offset, (VOID *) (UINTN) CommGetData->DataBuffer, (UINTN) CommGetData->DataSize);
+  }
+
+  Print (L"SmiHandlerProfileSize - 0x%x\n", ProfileSize);
+  Print (L"======= SmiHandlerProfile begin =======\n");
+  DumpSmiHandlerProfile (ProfileBuffer, ProfileSize);
+  Print (L"======= SmiHandlerProfile end =======\n\n\n");
+
+Done:
+  FreePool (ProfileBuffer);
+
+  return Status;
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval other             Some error occurs when executing this entry point.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE         ImageHandle,
+  IN EFI_SYSTEM_TABLE   *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+
+  Status = GetSmiHandlerProfileData ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "GetSmiHandlerProfileData - %r\n", Status));
+  }
+
+  return EFI_SUCCESS;
+}
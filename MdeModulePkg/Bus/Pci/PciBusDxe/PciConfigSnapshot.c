@@ -0,0 +1,233 @@
+/** @file
+  PCI configuration space snapshot for PCI Bus module.
+
+  While the devices are enumerated, their capabilities and headers are parsed
+  with many small configuration space reads, each of them a root bridge IO
+  protocol call and a configuration transaction. The snapshot reads the whole
+  configuration space of a function with one protocol call instead, and serves
+  the later reads through the PCI IO protocol from memory.
+
+  A write to the configuration space of a function drops its whole snapshot,
+  because the write may change other registers too: setting ARI Capable
+  Hierarchy changes First VF Offset and VF Stride of the SR-IOV capability,
+  and a transition from D3hot to D0 may reset the function. The later reads
+  go to the device.
+  The snapshots only live while the bus numbers are final and no driver uses
+  the devices, between PciConfigSnapshotBegin() and PciConfigSnapshotEnd().
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "PciBus.h"
+
+#define PCI_CONFIG_SNAPSHOT_DWORDS  (PCI_EXP_MAX_CONFIG_OFFSET / sizeof (UINT32))
+
+struct _PCI_CONFIG_SNAPSHOT {
+  LIST_ENTRY     Link;
+  PCI_IO_DEVICE  *PciIoDevice;
+  //
+  // Bit N is set when Data[N] holds the value of the DWORD at offset N * 4.
+  //
+  UINT32         Valid[PCI_CONFIG_SNAPSHOT_DWORDS / 32];
+  UINT32         Data[PCI_CONFIG_SNAPSHOT_DWORDS];
+};
+
+BOOLEAN     mPciConfigSnapshotActive = FALSE;
+LIST_ENTRY  mPciConfigSnapshotList   = INITIALIZE_LIST_HEAD_VARIABLE (mPciConfigSnapshotList);
+
+/**
+  Start taking configuration space snapshots of the PCI devices created from
+  now on, if PcdPciBusConfigSnapshot is TRUE.
+
+  The bus numbers of the PCI-PCI bridges must not change until
+  PciConfigSnapshotEnd() is called.
+
+**/
+VOID
+PciConfigSnapshotBegin (
+  VOID
+  )
+{
+  mPciConfigSnapshotActive = FeaturePcdGet (PcdPciBusConfigSnapshot);
+}
+
+/**
+  Stop taking configuration space snapshots, and free all of them.
+
+**/
+VOID
+PciConfigSnapshotEnd (
+  VOID
+  )
+{
+  PCI_CONFIG_SNAPSHOT  *Snapshot;
+
+  mPciConfigSnapshotActive = FALSE;
+
+  while (!IsListEmpty (&mPciConfigSnapshotList)) {
+    Snapshot = BASE_CR (GetFirstNode (&mPciConfigSnapshotList), PCI_CONFIG_SNAPSHOT, Link);
+    PciConfigSnapshotFree (Snapshot->PciIoDevice);
+  }
+}
+
+/**
+  Read a range of DWORDs of the configuration space into the snapshot.
+
+  @param PciIoDevice  PCI device instance.
+  @param Index        The index of the first DWORD.
+  @param Count        The number of DWORDs.
+
+**/
+VOID
+PciConfigSnapshotReadDwords (
+  IN OUT PCI_IO_DEVICE  *PciIoDevice,
+  IN     UINTN          Index,
+  IN     UINTN          Count
+  )
+{
+  EFI_STATUS           Status;
+  PCI_CONFIG_SNAPSHOT  *Snapshot;
+  UINT64               Address;
+
+  Snapshot = PciIoDevice->ConfigSnapshot;
+  Address  = EFI_PCI_ADDRESS (PciIoDevice->BusNumber, PciIoDevice->DeviceNumber, PciIoDevice->FunctionNumber, 0);
+  if (Index * sizeof (UINT32) < PCI_MAX_CONFIG_OFFSET) {
+    Address |= Index * sizeof (UINT32);
+  } else {
+    Address |= LShiftU64 (Index * sizeof (UINT32), 32);
+  }
+
+  Status = PciIoDevice->PciRootBridgeIo->Pci.Read (
+                                              PciIoDevice->PciRootBridgeIo,
+                                              EfiPciWidthUint32,
+                                              Address,
+                                              Count,
+                                              &Snapshot->Data[Index]
+                                              );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  for (; Count > 0; Index++, Count--) {
+    Snapshot->Valid[Index / 32] |= 1u << (Index % 32);
+  }
+}
+
+/**
+  Take the configuration space snapshot of a PCI device.
+
+  The first call reads the 256 bytes PCI configuration space. Once the device
+  is known to be a PCI Express device, the next call reads the extended
+  configuration space.
+
+  @param PciIoDevice  PCI device instance.
+
+**/
+VOID
+PciConfigSnapshotTake (
+  IN OUT PCI_IO_DEVICE  *PciIoDevice
+  )
+{
+  PCI_CONFIG_SNAPSHOT  *Snapshot;
+  UINTN                ExtendedIndex;
+
+  if (!mPciConfigSnapshotActive) {
+    return;
+  }
+
+  Snapshot = PciIoDevice->ConfigSnapshot;
+  if (Snapshot == NULL) {
+    Snapshot = AllocateZeroPool (sizeof (PCI_CONFIG_SNAPSHOT));
+    if (Snapshot == NULL) {
+      return;
+    }
+    Snapshot->PciIoDevice       = PciIoDevice;
+    PciIoDevice->ConfigSnapshot = Snapshot;
+    InsertTailList (&mPciConfigSnapshotList, &Snapshot->Link);
+
+    PciConfigSnapshotReadDwords (PciIoDevice, 0, PCI_MAX_CONFIG_OFFSET / sizeof (UINT32));
+  }
+
+  //
+  // The root bridge rejects the extended configuration space access when it
+  // does not support it, the extended registers are then read from the device.
+  //
+  ExtendedIndex = PCI_MAX_CONFIG_OFFSET / sizeof (UINT32);
+  if (PciIoDevice->IsPciExp && (Snapshot->Valid[ExtendedIndex / 32] & BIT0) == 0) {
+    PciConfigSnapshotReadDwords (
+      PciIoDevice,
+      ExtendedIndex,
+      (PCI_EXP_MAX_CONFIG_OFFSET - PCI_MAX_CONFIG_OFFSET) / sizeof (UINT32)
+      );
+  }
+}
+
+/**
+  Read PCI configuration space registers from the snapshot of a PCI device.
+
+  @param PciIoDevice  PCI device instance.
+  @param Offset       The offset within the PCI configuration space.
+  @param Length       The number of bytes to read.
+  @param Buffer       The destination buffer.
+
+  @retval TRUE   The registers are read from the snapshot.
+  @retval FALSE  The snapshot does not hold all the registers, they must be
+                 read from the device.
+
+**/
+BOOLEAN
+PciConfigSnapshotRead (
+  IN  PCI_IO_DEVICE  *PciIoDevice,
+  IN  UINT32         Offset,
+  IN  UINTN          Length,
+  OUT VOID           *Buffer
+  )
+{
+  PCI_CONFIG_SNAPSHOT  *Snapshot;
+  UINTN                Index;
+
+  Snapshot = PciIoDevice->ConfigSnapshot;
+  if (Snapshot == NULL || Length == 0 || Offset + Length > PCI_EXP_MAX_CONFIG_OFFSET) {
+    return FALSE;
+  }
+
+  for (Index = Offset / sizeof (UINT32); Index <= (Offset + Length - 1) / sizeof (UINT32); Index++) {
+    if ((Snapshot->Valid[Index / 32] & (1u << (Index % 32))) == 0) {
+      return FALSE;
+    }
+  }
+
+  CopyMem (Buffer, (UINT8 *) Snapshot->Data + Offset, Length);
+  return TRUE;
+}
+
+/**
+  Free the configuration space snapshot of a PCI device.
+
+  It is called before the configuration space of the device is written, the
+  later reads go to the device.
+
+  @param PciIoDevice  PCI device instance.
+
+**/
+VOID
+PciConfigSnapshotFree (
+  IN OUT PCI_IO_DEVICE  *PciIoDevice
+  )
+{
+  if (PciIoDevice->ConfigSnapshot == NULL) {
+    return;
+  }
+
+  RemoveEntryList (&PciIoDevice->ConfigSnapshot->Link);
+  FreePool (PciIoDevice->ConfigSnapshot);
+  PciIoDevice->ConfigSnapshot = NULL;
+}
@@ -0,0 +1,90 @@
+/** @file
+  PCI configuration space snapshot declaration for PCI Bus module.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _EFI_PCI_CONFIG_SNAPSHOT_H_
+#define _EFI_PCI_CONFIG_SNAPSHOT_H_
+
+/**
+  Start taking configuration space snapshots of the PCI devices created from
+  now on, if PcdPciBusConfigSnapshot is TRUE.
+
+  The bus numbers of the PCI-PCI bridges must not change until
+  PciConfigSnapshotEnd() is called.
+
+**/
+VOID
+PciConfigSnapshotBegin (
+  VOID
+  );
+
+/**
+  Stop taking configuration space snapshots, and free all of them.
+
+**/
+VOID
+PciConfigSnapshotEnd (
+  VOID
+  );
+
+/**
+  Take the configuration space snapshot of a PCI device.
+
+  The first call reads the 256 bytes PCI configuration space. Once the device
+  is known to be a PCI Express device, the next call reads the extended
+  configuration space.
+
+  @param PciIoDevice  PCI device instance.
+
+**/
+VOID
+PciConfigSnapshotTake (
+  IN OUT PCI_IO_DEVICE  *PciIoDevice
+  );
+
+/**
+  Read PCI configuration space registers from the snapshot of a PCI device.
+
+  @param PciIoDevice  PCI device instance.
+  @param Offset       The offset within the PCI configuration space.
+  @param Length       The number of bytes to read.
+  @param Buffer       The destination buffer.
+
+  @retval TRUE   The registers are read from the snapshot.
+  @retval FALSE  The snapshot does not hold all the registers, they must be
+                 read from the device.
+
+**/
+BOOLEAN
+PciConfigSnapshotRead (
+  IN  PCI_IO_DEVICE  *PciIoDevice,
+  IN  UINT32         Offset,
+  IN  UINTN          Length,
+  OUT VOID           *Buffer
+  );
+
+/**
+  Free the configuration space snapshot of a PCI device.
+
+  It is called before the configuration space of the device is written, the
+  later reads go to the device.
+
+  @param PciIoDevice  PCI device instance.
+
+**/
+VOID
+PciConfigSnapshotFree (
+  IN OUT PCI_IO_DEVICE  *PciIoDevice
+  );
+
+#endif
@@ -1,7 +1,7 @@
 /** @file
   Supporting functions implementaion for PCI devices management.
 
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -105,6 +105,8 @@ FreePciDevice (
     FreePool (PciIoDevice->DevicePath);
   }
 
+  PciConfigSnapshotFree (PciIoDevice);
+
   FreePool (PciIoDevice);
 }
 
@@ -1,7 +1,7 @@
 /** @file
   PCI eunmeration implementation on entire PCI bus system for PCI Bus module.
 
-Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2015 Hewlett Packard Enterprise Development LP<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
@@ -93,6 +93,13 @@ PciEnumerator (
   //
   Status = PciHostBridgeEnumerator (PciResAlloc);
 
+  //
+  // The probe result and the configuration space snapshots are only valid
+  // until the bus numbers change, e.g. on hot plug
+  //
+  PciProbeFreeCache ();
+  PciConfigSnapshotEnd ();
+
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -1,7 +1,7 @@
 /** @file
   PCI emumeration support functions implementation for PCI Bus module.
 
-Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2015 Hewlett Packard Enterprise Development LP<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
@@ -42,6 +42,13 @@ PciDevicePresent (
   UINT64      Address;
   EFI_STATUS  Status;
 
+  //
+  // Skip the functions that the parallel probe already found absent
+  //
+  if (PciProbeIsFunctionAbsent (PciRootBridgeIo, Bus, Device, Func)) {
+    return EFI_NOT_FOUND;
+  }
+
   //
   // Create PCI address map in terms of Bus, Device and Func
   //
@@ -2136,6 +2143,11 @@ CreatePciIoDevice (
   InitializePciLoadFile2 (PciIoDevice);
   PciIo = &PciIoDevice->PciIo;
 
+  //
+  // Read the configuration space at once, the capabilities are parsed from it
+  //
+  PciConfigSnapshotTake (PciIoDevice);
+
   //
   // Create a device path for this PCI device and store it into its private data
   //
@@ -2156,6 +2168,7 @@ CreatePciIoDevice (
              );
   if (!EFI_ERROR (Status)) {
     PciIoDevice->IsPciExp = TRUE;
+    PciConfigSnapshotTake (PciIoDevice);
   }
 
   if (PcdGetBool (PcdAriSupport)) {
@@ -2426,6 +2439,12 @@ PciEnumeratorLight (
     return Status;
   }
 
+  //
+  // The bus numbers are already assigned, probe all the buses in parallel
+  //
+  PciProbeRootBridges (&PciRootBridgeIo, 1);
+  PciConfigSnapshotBegin ();
+
   while (PciGetBusRange (&Descriptors, &MinBus, &MaxBus, NULL) == EFI_SUCCESS) {
 
     //
@@ -2480,6 +2499,9 @@ PciEnumeratorLight (
     Descriptors++;
   }
 
+  PciProbeFreeCache ();
+  PciConfigSnapshotEnd ();
+
   return EFI_SUCCESS;
 }
 
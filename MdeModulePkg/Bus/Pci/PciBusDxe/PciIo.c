@@ -1,7 +1,7 @@
 /** @file
   EFI PCI IO protocol functions implementation for PCI Bus module.
 
-Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -748,6 +748,14 @@ PciIoConfigRead (
     }
   }    
 
+  //
+  // Read from the configuration space snapshot taken during the enumeration if possible
+  //
+  if (Width < EfiPciIoWidthFifoUint8 &&
+      PciConfigSnapshotRead (PciIoDevice, Offset, Count * (UINTN) (1 << (Width & 0x03)), Buffer)) {
+    return EFI_SUCCESS;
+  }
+
   Status = PciIoDevice->PciRootBridgeIo->Pci.Read (
                                                PciIoDevice->PciRootBridgeIo,
                                                (EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH) Width,
@@ -816,7 +824,12 @@ PciIoConfigWrite (
       Width = (EFI_PCI_IO_PROTOCOL_WIDTH) (Width & (~0x03));
     }
   }  
-  
+
+  //
+  // The write may change other registers too, drop the configuration space snapshot
+  //
+  PciConfigSnapshotFree (PciIoDevice);
+
   Status = PciIoDevice->PciRootBridgeIo->Pci.Write (
                                               PciIoDevice->PciRootBridgeIo,
                                               (EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH) Width,
@@ -1,7 +1,7 @@
 /** @file
   Internal library implementation for PCI Bus module.
 
-Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2015 Hewlett Packard Enterprise Development LP<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
@@ -1574,6 +1574,13 @@ PciHostBridgeEnumerator (
     NotifyPhase (PciResAlloc, EfiPciHostBridgeEndBusAllocation);
   }
 
+  //
+  // The bus numbers are final now, probe the buses of all the root bridges
+  // in parallel before collecting the device information
+  //
+  PciProbeHostBridge (PciResAlloc);
+  PciConfigSnapshotBegin ();
+
   //
   // Notify the resource allocation phase is to start
   //
@@ -1,7 +1,7 @@
 /** @file
   PCI Rom supporting funtions implementation for PCI Bus module.
 
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -272,6 +272,8 @@ GetOpRomInfo (
   AllOnes = 0xfffffffe;
   Address = EFI_PCI_ADDRESS (Bus, Device, Function, RomBarIndex);
 
+  PciConfigSnapshotFree (PciIoDevice);
+
   Status = PciRootBridgeIo->Pci.Write (
                                   PciRootBridgeIo,
                                   EfiPciWidthUint32,
@@ -0,0 +1,523 @@
+/** @file
+  Parallel probe of the PCI functions present on the root bridges.
+
+  Reading the Vendor ID of an absent function can take a long time to complete
+  with a master abort, and the enumerator reads it for every device number of
+  every bus. Once the bus numbers are assigned, the buses are independent, so
+  they are probed on the APs and the result is cached for PciDevicePresent().
+
+  The probe only reads the configuration space through the root bridge IO
+  protocol. The platform must only set PcdPciBusParallelProbe when those
+  accesses can be issued concurrently, e.g. with PCI Express memory mapped
+  configuration space, and not with the 0xCF8/0xCFC mechanism.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "PciBus.h"
+
+#define PCI_PROBE_FUNCTION_NUM  ((PCI_MAX_DEVICE + 1) * (PCI_MAX_FUNC + 1))
+
+typedef struct {
+  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  *PciRootBridgeIo;
+  UINT8                            Bus;
+  //
+  // Bitmaps indexed by (Device << 3) | Func. The functions that are not
+  // probed, e.g. the functions 1-7 of a single function device, are unknown.
+  //
+  UINT32                           Probed[PCI_PROBE_FUNCTION_NUM / 32];
+  UINT32                           Present[PCI_PROBE_FUNCTION_NUM / 32];
+  UINT64                           Ticks;
+} PCI_PROBE_BUS;
+
+typedef struct {
+  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  *PciRootBridgeIo;
+  PCI_PROBE_BUS                    *Bus[PCI_MAX_BUS + 1];
+} PCI_PROBE_ROOT_BRIDGE;
+
+PCI_PROBE_ROOT_BRIDGE  *mPciProbeRootBridges     = NULL;
+UINTN                  mPciProbeRootBridgeCount  = 0;
+PCI_PROBE_BUS          *mPciProbeBuses           = NULL;
+UINTN                  mPciProbeBusCount         = 0;
+UINT32                 mPciProbeNextBus;
+UINT32                 mPciProbeProcessors;
+
+/**
+  Return the number of performance counter ticks elapsed since StartTicks.
+
+  @param StartTicks  The performance counter value at the start.
+
+  @return The elapsed ticks.
+
+**/
+UINT64
+PciProbeElapsedTicks (
+  IN UINT64  StartTicks
+  )
+{
+  UINT64  EndTicks;
+  UINT64  CounterStart;
+  UINT64  CounterEnd;
+
+  EndTicks = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterEnd < CounterStart) {
+    return StartTicks - EndTicks;
+  }
+  return EndTicks - StartTicks;
+}
+
+/**
+  Probe the functions present on a bus.
+
+  The probe follows PciPciDeviceInfoCollector(): the functions 1-7 are only
+  probed when function 0 is a multi-function device.
+
+  @param ProbeBus  The bus to probe.
+
+**/
+VOID
+PciProbeBus (
+  IN OUT PCI_PROBE_BUS  *ProbeBus
+  )
+{
+  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  *PciRootBridgeIo;
+  EFI_STATUS                       Status;
+  UINT64                           StartTicks;
+  UINT8                            Device;
+  UINT8                            Func;
+  UINTN                            Index;
+  UINT32                           Id;
+  UINT8                            HeaderType;
+
+  StartTicks      = GetPerformanceCounter ();
+  PciRootBridgeIo = ProbeBus->PciRootBridgeIo;
+
+  for (Device = 0; Device <= PCI_MAX_DEVICE; Device++) {
+    for (Func = 0; Func <= PCI_MAX_FUNC; Func++) {
+      Index = ((UINTN) Device << 3) | Func;
+      ProbeBus->Probed[Index / 32] |= 1u << (Index % 32);
+
+      Status = PciRootBridgeIo->Pci.Read (
+                                      PciRootBridgeIo,
+                                      EfiPciWidthUint32,
+                                      EFI_PCI_ADDRESS (ProbeBus->Bus, Device, Func, 0),
+                                      1,
+                                      &Id
+                                      );
+      if (EFI_ERROR (Status) || (Id & 0xffff) == 0xffff) {
+        if (Func == 0) {
+          break;
+        }
+        continue;
+      }
+      ProbeBus->Present[Index / 32] |= 1u << (Index % 32);
+
+      if (Func == 0) {
+        Status = PciRootBridgeIo->Pci.Read (
+                                        PciRootBridgeIo,
+                                        EfiPciWidthUint8,
+                                        EFI_PCI_ADDRESS (ProbeBus->Bus, Device, Func, PCI_HEADER_TYPE_OFFSET),
+                                        1,
+                                        &HeaderType
+                                        );
+        if (EFI_ERROR (Status) || (HeaderType & HEADER_TYPE_MULTI_FUNCTION) == 0) {
+          break;
+        }
+      }
+    }
+  }
+
+  ProbeBus->Ticks = PciProbeElapsedTicks (StartTicks);
+}
+
+/**
+  Probe the buses until none is left.
+
+  Runs on every processor taking part in the probe. It must not call any UEFI
+  service.
+
+  @param Buffer  Not used.
+
+**/
+VOID
+EFIAPI
+PciProbeWorker (
+  IN OUT VOID  *Buffer
+  )
+{
+  UINTN    Index;
+  BOOLEAN  Counted;
+
+  Counted = FALSE;
+  for (;;) {
+    Index = (UINTN) InterlockedIncrement (&mPciProbeNextBus) - 1;
+    if (Index >= mPciProbeBusCount) {
+      break;
+    }
+    if (!Counted) {
+      InterlockedIncrement (&mPciProbeProcessors);
+      Counted = TRUE;
+    }
+    PciProbeBus (&mPciProbeBuses[Index]);
+  }
+}
+
+/**
+  Run PciProbeWorker() on the BSP and on the enabled APs, and return once
+  every bus is probed.
+
+  The APs are started in non-blocking mode, so the BSP probes buses at the
+  same time. The MP services detect the AP completion from a TPL_NOTIFY timer
+  event, so at TPL_NOTIFY or above the APs are started in blocking mode, and
+  the BSP only probes the buses they left.
+
+**/
+VOID
+PciProbeRunAllProcessors (
+  VOID
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpService;
+  EFI_EVENT                 WaitEvent;
+  EFI_TPL                   OldTpl;
+
+  WaitEvent = NULL;
+  Status    = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &MpService);
+  if (!EFI_ERROR (Status)) {
+    OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    gBS->RestoreTPL (OldTpl);
+    if (OldTpl < TPL_NOTIFY) {
+      Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &WaitEvent);
+      if (EFI_ERROR (Status)) {
+        WaitEvent = NULL;
+      }
+    }
+
+    Status = MpService->StartupAllAPs (
+                          MpService,
+                          PciProbeWorker,
+                          FALSE,
+                          WaitEvent,
+                          0,
+                          NULL,
+                          NULL
+                          );
+    if (Status == EFI_UNSUPPORTED && WaitEvent != NULL) {
+      //
+      // The non-blocking mode is not available after ReadyToBoot.
+      //
+      gBS->CloseEvent (WaitEvent);
+      WaitEvent = NULL;
+      Status = MpService->StartupAllAPs (
+                            MpService,
+                            PciProbeWorker,
+                            FALSE,
+                            NULL,
+                            0,
+                            NULL,
+                            NULL
+                            );
+    }
+  }
+
+  //
+  // The BSP probes buses until none is left, all of them when the APs could
+  // not be started.
+  //
+  PciProbeWorker (NULL);
+
+  if (WaitEvent != NULL) {
+    if (!EFI_ERROR (Status)) {
+      while (gBS->CheckEvent (WaitEvent) == EFI_NOT_READY) {
+        CpuPause ();
+      }
+    }
+    gBS->CloseEvent (WaitEvent);
+  }
+}
+
+/**
+  Print the probe time of each root bridge.
+
+  @param Processors  The number of processors that probed the buses.
+  @param Ticks       The wall time of the probe.
+
+**/
+VOID
+PciProbeReport (
+  IN UINTN   Processors,
+  IN UINT64  Ticks
+  )
+{
+  UINTN          RootBridgeIndex;
+  UINTN          Bus;
+  UINTN          Index;
+  UINTN          BusCount;
+  UINTN          FunctionCount;
+  UINT64         RootBridgeTicks;
+  UINTN          MinBus;
+  UINTN          MaxBus;
+  PCI_PROBE_BUS  *ProbeBus;
+
+  DEBUG ((
+    EFI_D_INFO,
+    "PciBus: Probed %d buses of %d root bridges on %d processors in %ld us\n",
+    mPciProbeBusCount,
+    mPciProbeRootBridgeCount,
+    Processors,
+    DivU64x32 (GetTimeInNanoSecond (Ticks), 1000)
+    ));
+
+  for (RootBridgeIndex = 0; RootBridgeIndex < mPciProbeRootBridgeCount; RootBridgeIndex++) {
+    if (mPciProbeRootBridges[RootBridgeIndex].PciRootBridgeIo == NULL) {
+      continue;
+    }
+    BusCount        = 0;
+    FunctionCount   = 0;
+    RootBridgeTicks = 0;
+    MinBus          = PCI_MAX_BUS;
+    MaxBus          = 0;
+    for (Bus = 0; Bus <= PCI_MAX_BUS; Bus++) {
+      ProbeBus = mPciProbeRootBridges[RootBridgeIndex].Bus[Bus];
+      if (ProbeBus == NULL) {
+        continue;
+      }
+      MinBus = MIN (MinBus, Bus);
+      MaxBus = MAX (MaxBus, Bus);
+      BusCount++;
+      RootBridgeTicks += ProbeBus->Ticks;
+      for (Index = 0; Index < PCI_PROBE_FUNCTION_NUM; Index++) {
+        if ((ProbeBus->Present[Index / 32] & (1u << (Index % 32))) != 0) {
+          FunctionCount++;
+        }
+      }
+    }
+    if (BusCount == 0) {
+      continue;
+    }
+    DEBUG ((
+      EFI_D_INFO,
+      "  Segment %04x buses %02x-%02x: %d buses, %d functions present, %ld us\n",
+      mPciProbeRootBridges[RootBridgeIndex].PciRootBridgeIo->SegmentNumber,
+      MinBus,
+      MaxBus,
+      BusCount,
+      FunctionCount,
+      DivU64x32 (GetTimeInNanoSecond (RootBridgeTicks), 1000)
+      ));
+  }
+}
+
+/**
+  Probe the functions present on the decoded buses of the root bridges, and
+  cache the result for PciDevicePresent().
+
+  The buses are distributed to the BSP and the APs when PcdPciBusParallelProbe
+  is TRUE and the MP Services protocol is available, otherwise they are probed
+  by the BSP.
+  The bus numbers of the PCI-PCI bridges must not change until
+  PciProbeFreeCache() is called.
+
+  @param PciRootBridgeIo  Array of the root bridge IO protocol instances.
+  @param Count            Number of entries in PciRootBridgeIo.
+
+**/
+VOID
+PciProbeRootBridges (
+  IN EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  **PciRootBridgeIo,
+  IN UINTN                            Count
+  )
+{
+  EFI_STATUS                         Status;
+  EFI_ACPI_ADDRESS_SPACE_DESCRIPTOR  *Descriptors;
+  UINTN                              Index;
+  UINTN                              Pass;
+  UINT16                             MinBus;
+  UINT16                             MaxBus;
+  UINT16                             Bus;
+  UINTN                              BusCount;
+  UINT64                             StartTicks;
+
+  if (!FeaturePcdGet (PcdPciBusParallelProbe) || Count == 0) {
+    return;
+  }
+
+  PciProbeFreeCache ();
+
+  mPciProbeRootBridges = AllocateZeroPool (Count * sizeof (PCI_PROBE_ROOT_BRIDGE));
+  if (mPciProbeRootBridges == NULL) {
+    return;
+  }
+
+  //
+  // Count the decoded buses in the first pass, and fill them in the second
+  // one. The first pass may count a bus several times if the descriptors of a
+  // root bridge overlap.
+  //
+  BusCount = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    if (Pass == 1) {
+      if (BusCount == 0) {
+        PciProbeFreeCache ();
+        return;
+      }
+      mPciProbeBuses = AllocateZeroPool (BusCount * sizeof (PCI_PROBE_BUS));
+      if (mPciProbeBuses == NULL) {
+        PciProbeFreeCache ();
+        return;
+      }
+    }
+
+    BusCount = 0;
+    for (Index = 0; Index < Count; Index++) {
+      Status = PciRootBridgeIo[Index]->Configuration (PciRootBridgeIo[Index], (VOID **) &Descriptors);
+      if (EFI_ERROR (Status)) {
+        continue;
+      }
+      mPciProbeRootBridges[Index].PciRootBridgeIo = PciRootBridgeIo[Index];
+
+      while (PciGetBusRange (&Descriptors, &MinBus, &MaxBus, NULL) == EFI_SUCCESS) {
+        for (Bus = MinBus; Bus <= MIN (MaxBus, PCI_MAX_BUS); Bus++) {
+          if (Pass == 0) {
+            BusCount++;
+          } else if (mPciProbeRootBridges[Index].Bus[Bus] == NULL) {
+            mPciProbeBuses[BusCount].PciRootBridgeIo = PciRootBridgeIo[Index];
+            mPciProbeBuses[BusCount].Bus             = (UINT8) Bus;
+            mPciProbeRootBridges[Index].Bus[Bus]     = &mPciProbeBuses[BusCount];
+            BusCount++;
+          }
+        }
+        Descriptors++;
+      }
+    }
+  }
+  mPciProbeRootBridgeCount = Count;
+  mPciProbeBusCount        = BusCount;
+  mPciProbeNextBus         = 0;
+  mPciProbeProcessors      = 0;
+
+  StartTicks = GetPerformanceCounter ();
+  PciProbeRunAllProcessors ();
+  PciProbeReport (mPciProbeProcessors, PciProbeElapsedTicks (StartTicks));
+}
+
+/**
+  Probe the functions present on all the root bridges of a host bridge.
+
+  @param PciResAlloc  Pointer to protocol instance of EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL.
+
+**/
+VOID
+PciProbeHostBridge (
+  IN EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL  *PciResAlloc
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_HANDLE                       RootBridgeHandle;
+  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  **PciRootBridgeIo;
+  UINTN                            Count;
+
+  if (!FeaturePcdGet (PcdPciBusParallelProbe)) {
+    return;
+  }
+
+  Count = 0;
+  RootBridgeHandle = NULL;
+  while (PciResAlloc->GetNextRootBridge (PciResAlloc, &RootBridgeHandle) == EFI_SUCCESS) {
+    Count++;
+  }
+
+  PciRootBridgeIo = AllocateZeroPool (Count * sizeof (EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *));
+  if (PciRootBridgeIo == NULL) {
+    return;
+  }
+
+  Count = 0;
+  RootBridgeHandle = NULL;
+  while (PciResAlloc->GetNextRootBridge (PciResAlloc, &RootBridgeHandle) == EFI_SUCCESS) {
+    Status = gBS->HandleProtocol (
+                    RootBridgeHandle,
+                    &gEfiPciRootBridgeIoProtocolGuid,
+                    (VOID **) &PciRootBridgeIo[Count]
+                    );
+    if (!EFI_ERROR (Status)) {
+      Count++;
+    }
+  }
+
+  PciProbeRootBridges (PciRootBridgeIo, Count);
+  FreePool (PciRootBridgeIo);
+}
+
+/**
+  Check whether the parallel probe found a PCI function absent.
+
+  @param PciRootBridgeIo   Pointer to instance of EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL.
+  @param Bus               PCI bus NO.
+  @param Device            PCI device NO.
+  @param Func              PCI Func NO.
+
+  @retval TRUE   The function was probed and is not present.
+  @retval FALSE  The function is present or was not probed.
+
+**/
+BOOLEAN
+PciProbeIsFunctionAbsent (
+  IN EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  *PciRootBridgeIo,
+  IN UINT8                            Bus,
+  IN UINT8                            Device,
+  IN UINT8                            Func
+  )
+{
+  UINTN          RootBridgeIndex;
+  UINTN          Index;
+  PCI_PROBE_BUS  *ProbeBus;
+
+  for (RootBridgeIndex = 0; RootBridgeIndex < mPciProbeRootBridgeCount; RootBridgeIndex++) {
+    if (mPciProbeRootBridges[RootBridgeIndex].PciRootBridgeIo != PciRootBridgeIo) {
+      continue;
+    }
+    ProbeBus = mPciProbeRootBridges[RootBridgeIndex].Bus[Bus];
+    if (ProbeBus == NULL || Device > PCI_MAX_DEVICE || Func > PCI_MAX_FUNC) {
+      return FALSE;
+    }
+    Index = ((UINTN) Device << 3) | Func;
+    return (BOOLEAN) ((ProbeBus->Probed[Index / 32] & (1u << (Index % 32))) != 0 &&
+                      (ProbeBus->Present[Index / 32] & (1u << (Index % 32))) == 0);
+  }
+
+  return FALSE;
+}
+
+/**
+  Free the cached probe result.
+
+  Must be called before the bus numbers of the PCI-PCI bridges change.
+
+**/
+VOID
+PciProbeFreeCache (
+  VOID
+  )
+{
+  if (mPciProbeRootBridges != NULL) {
+    FreePool (mPciProbeRootBridges);
+    mPciProbeRootBridges = NULL;
+  }
+  if (mPciProbeBuses != NULL) {
+    FreePool (mPciProbeBuses);
+    mPciProbeBuses = NULL;
+  }
+  mPciProbeRootBridgeCount = 0;
+  mPciProbeBusCount        = 0;
+}
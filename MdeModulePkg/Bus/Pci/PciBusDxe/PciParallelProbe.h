@@ -0,0 +1,80 @@
+/** @file
+  Parallel PCI function probe declaration for PCI Bus module.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _EFI_PCI_PARALLEL_PROBE_H_
+#define _EFI_PCI_PARALLEL_PROBE_H_
+
+/**
+  Probe the functions present on the decoded buses of the root bridges, and
+  cache the result for PciDevicePresent().
+
+  The buses are distributed to the BSP and the APs when PcdPciBusParallelProbe
+  is TRUE and the MP Services protocol is available, otherwise they are probed
+  by the BSP.
+  The bus numbers of the PCI-PCI bridges must not change until
+  PciProbeFreeCache() is called.
+
+  @param PciRootBridgeIo  Array of the root bridge IO protocol instances.
+  @param Count            Number of entries in PciRootBridgeIo.
+
+**/
+VOID
+PciProbeRootBridges (
+  IN EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  **PciRootBridgeIo,
+  IN UINTN                            Count
+  );
+
+/**
+  Probe the functions present on all the root bridges of a host bridge.
+
+  @param PciResAlloc  Pointer to protocol instance of EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL.
+
+**/
+VOID
+PciProbeHostBridge (
+  IN EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL  *PciResAlloc
+  );
+
+/**
+  Check whether the parallel probe found a PCI function absent.
+
+  @param PciRootBridgeIo   Pointer to instance of EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL.
+  @param Bus               PCI bus NO.
+  @param Device            PCI device NO.
+  @param Func              PCI Func NO.
+
+  @retval TRUE   The function was probed and is not present.
+  @retval FALSE  The function is present or was not probed.
+
+**/
+BOOLEAN
+PciProbeIsFunctionAbsent (
+  IN EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL  *PciRootBridgeIo,
+  IN UINT8                            Bus,
+  IN UINT8                            Device,
+  IN UINT8                            Func
+  );
+
+/**
+  Free the cached probe result.
+
+  Must be called before the bus numbers of the PCI-PCI bridges change.
+
+**/
+VOID
+PciProbeFreeCache (
+  VOID
+  );
+
+#endif
@@ -2,7 +2,7 @@
 
   PCI Root Bridge Io Protocol code.
 
-Copyright (c) 1999 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 1999 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -951,6 +951,15 @@ RootBridgeIoPciAccess (
               PciAddress.ExtendedRegister
               );
 
+  //
+  // Read a block of DWORDs, e.g. the whole configuration space of a function,
+  // with a single PciSegmentLib call. It issues the same DWORD accesses.
+  //
+  if (Read && Width == EfiPciWidthUint32) {
+    PciSegmentReadBuffer (Address, Count * sizeof (UINT32), Buffer);
+    return EFI_SUCCESS;
+  }
+
   //
   // Select loop based on the width of the transfer
   //
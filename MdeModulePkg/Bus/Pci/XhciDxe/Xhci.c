@@ -1,7 +1,7 @@
 /** @file
   The XHCI controller driver.
 
-Copyright (c) 2011 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -2237,6 +2237,14 @@ XhcDriverBindingStop (
     gBS->CloseEvent (Xhc->ExitBootServiceEvent);
   }
 
+  DEBUG ((
+    EFI_D_INFO,
+    "XhcDriverBindingStop: event ring polls %ld, drains %ld, events %ld\n",
+    Xhc->EventRingPolls,
+    Xhc->EventRingDrains,
+    Xhc->EventRingEvents
+    ));
+
   XhcHaltHC (Xhc, XHC_GENERIC_TIMEOUT);
   XhcClearBiosOwnership (Xhc);
   XhciDelAllAsyncIntTransfers (Xhc);
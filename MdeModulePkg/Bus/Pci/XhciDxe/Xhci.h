@@ -2,7 +2,7 @@
 
   Provides some data structure definitions used by the XHCI host controller driver.
 
-Copyright (c) 2011 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -31,6 +31,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/ReportStatusCodeLib.h>
+#include <Library/PcdLib.h>
 
 #include <IndustryStandard/Pci.h>
 
@@ -258,6 +259,14 @@ struct _USB_XHCI_INSTANCE {
   USB_DEV_CONTEXT           UsbDevContext[256];
 
   BOOLEAN                   Support64BitDma; // Whether 64 bit DMA may be used with this device
+
+  //
+  // Event ring statistics: the number of polls, the number of polls that
+  // found new events, and the number of events consumed.
+  //
+  UINT64                    EventRingPolls;
+  UINT64                    EventRingDrains;
+  UINT64                    EventRingEvents;
 };
 
 
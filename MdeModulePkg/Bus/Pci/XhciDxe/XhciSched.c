@@ -2,7 +2,7 @@
 
   XHCI transfer scheduling routines.
 
-Copyright (c) 2011 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -379,10 +379,12 @@ XhcCreateTransferTrb (
       TrbNum   = 0;
       TrbStart = (TRB *)(UINTN)EPRing->RingEnqueue;
       while (TotalLen < Urb->DataLen) {
-        if ((TotalLen + 0x10000) >= Urb->DataLen) {
+        //
+        // The data buffer of a Normal TRB must not span a 64KB boundary.
+        //
+        Len = 0x10000 - (((UINTN) Urb->DataPhy + TotalLen) & 0xFFFF);
+        if ((TotalLen + Len) >= Urb->DataLen) {
           Len = Urb->DataLen - TotalLen;
-        } else {
-          Len = 0x10000;
         }
         TrbStart = (TRB *)(UINTN)EPRing->RingEnqueue;
         TrbStart->TrbNormal.TRBPtrLo  = XHC_LOW_32BIT((UINT8 *) Urb->DataPhy + TotalLen);
@@ -414,10 +416,12 @@ XhcCreateTransferTrb (
       TrbNum   = 0;
       TrbStart = (TRB *)(UINTN)EPRing->RingEnqueue;
       while (TotalLen < Urb->DataLen) {
-        if ((TotalLen + 0x10000) >= Urb->DataLen) {
+        //
+        // The data buffer of a Normal TRB must not span a 64KB boundary.
+        //
+        Len = 0x10000 - (((UINTN) Urb->DataPhy + TotalLen) & 0xFFFF);
+        if ((TotalLen + Len) >= Urb->DataLen) {
           Len = Urb->DataLen - TotalLen;
-        } else {
-          Len = 0x10000;
         }
         TrbStart = (TRB *)(UINTN)EPRing->RingEnqueue;
         TrbStart->TrbNormal.TRBPtrLo  = XHC_LOW_32BIT((UINT8 *) Urb->DataPhy + TotalLen);
@@ -621,6 +625,12 @@ XhcInitSched (
   //
   CreateEventRing (Xhc, &Xhc->EventRing);
   DEBUG ((EFI_D_INFO, "XhcInitSched:XHC_EVENTRING=0x%x\n", Xhc->EventRing.EventRingSeg0));
+
+  //
+  // Program the interrupt moderation interval of the primary interrupter, it
+  // limits the rate of the interrupts asserted for the event ring.
+  //
+  XhcWriteRuntimeReg (Xhc, XHC_IMOD_OFFSET, PcdGet16 (PcdXhciInterruptModerationInterval) & XHC_IMODI_MASK);
 }
 
 /**
@@ -1056,24 +1066,28 @@ IsTransferRingTrb (
 }
 
 /**
-  Check the URB's execution result and update the URB's
-  result accordingly.
+  Traverse the event ring once and dispatch all the new events.
 
-  @param  Xhc             The XHCI Instance.
-  @param  Urb             The URB to check result.
+  The events are dispatched to the URB being checked and to the asynchronous
+  interrupt transfers at once, so that the completed asynchronous transfers are
+  handled in time and not flushed by the newer events. The event ring dequeue
+  pointer register is only updated when new events are consumed.
 
-  @return Whether the result of URB transfer is finialized.
+  @param  Xhc             The XHCI Instance.
+  @param  Urb             The URB being checked, or NULL when only the
+                          asynchronous interrupt transfers are checked.
 
 **/
-BOOLEAN
-XhcCheckUrbResult (
+VOID
+XhcProcessEventRing (
   IN  USB_XHCI_INSTANCE   *Xhc,
-  IN  URB                 *Urb
+  IN  URB                 *Urb      OPTIONAL
   )
 {
   EVT_TRB_TRANSFER        *EvtTrb;
   TRB_TEMPLATE            *TRBPtr;
   UINTN                   Index;
+  UINTN                   EventCount;
   UINT8                   TRBType;
   EFI_STATUS              Status;
   URB                     *AsyncUrb;
@@ -1083,21 +1097,11 @@ XhcCheckUrbResult (
   UINT32                  Low;
   EFI_PHYSICAL_ADDRESS    PhyAddr;
 
-  ASSERT ((Xhc != NULL) && (Urb != NULL));
+  EvtTrb     = NULL;
+  AsyncUrb   = NULL;
+  EventCount = 0;
 
-  Status   = EFI_SUCCESS;
-  AsyncUrb = NULL;
-
-  if (Urb->Finished) {
-    goto EXIT;
-  }
-
-  EvtTrb = NULL;
-
-  if (XhcIsHalt (Xhc) || XhcIsSysError (Xhc)) {
-    Urb->Result |= EFI_USB_ERR_SYSTEM;
-    goto EXIT;
-  }
+  Xhc->EventRingPolls++;
 
   //
   // Traverse the event ring to find out all new events from the previous check.
@@ -1107,10 +1111,11 @@ XhcCheckUrbResult (
     Status = XhcCheckNewEvent (Xhc, &Xhc->EventRing, ((TRB_TEMPLATE **)&EvtTrb));
     if (Status == EFI_NOT_READY) {
       //
-      // All new events are handled, return directly.
+      // All new events are handled.
       //
-      goto EXIT;
+      break;
     }
+    EventCount++;
 
     //
     // Only handle COMMAND_COMPLETETION_EVENT and TRANSFER_EVENT.
@@ -1128,41 +1133,46 @@ XhcCheckUrbResult (
     //
     // Update the status of Urb according to the finished event regardless of whether
     // the urb is current checked one or in the XHCI's async transfer list.
-    // This way is used to avoid that those completed async transfer events don't get
-    // handled in time and are flushed by newer coming events.
     //
-    if (IsTransferRingTrb (TRBPtr, Urb)) {
+    if ((Urb != NULL) && IsTransferRingTrb (TRBPtr, Urb)) {
       CheckedUrb = Urb;
     } else if (IsAsyncIntTrb (Xhc, TRBPtr, &AsyncUrb)) {    
       CheckedUrb = AsyncUrb;
     } else {
       continue;
     }
+
+    //
+    // The result of a finished URB is final, e.g. after an error.
+    //
+    if (CheckedUrb->Finished) {
+      continue;
+    }
   
     switch (EvtTrb->Completecode) {
       case TRB_COMPLETION_STALL_ERROR:
         CheckedUrb->Result  |= EFI_USB_ERR_STALL;
         CheckedUrb->Finished = TRUE;
         DEBUG ((EFI_D_ERROR, "XhcCheckUrbResult: STALL_ERROR! Completecode = %x\n",EvtTrb->Completecode));
-        goto EXIT;
+        continue;
 
       case TRB_COMPLETION_BABBLE_ERROR:
         CheckedUrb->Result  |= EFI_USB_ERR_BABBLE;
         CheckedUrb->Finished = TRUE;
         DEBUG ((EFI_D_ERROR, "XhcCheckUrbResult: BABBLE_ERROR! Completecode = %x\n",EvtTrb->Completecode));
-        goto EXIT;
+        continue;
 
       case TRB_COMPLETION_DATA_BUFFER_ERROR:
         CheckedUrb->Result  |= EFI_USB_ERR_BUFFER;
         CheckedUrb->Finished = TRUE;
         DEBUG ((EFI_D_ERROR, "XhcCheckUrbResult: ERR_BUFFER! Completecode = %x\n",EvtTrb->Completecode));
-        goto EXIT;
+        continue;
 
       case TRB_COMPLETION_USB_TRANSACTION_ERROR:
         CheckedUrb->Result  |= EFI_USB_ERR_TIMEOUT;
         CheckedUrb->Finished = TRUE;
         DEBUG ((EFI_D_ERROR, "XhcCheckUrbResult: TRANSACTION_ERROR! Completecode = %x\n",EvtTrb->Completecode));
-        goto EXIT;
+        continue;
 
       case TRB_COMPLETION_SHORT_PACKET:
       case TRB_COMPLETION_SUCCESS:
@@ -1183,7 +1193,7 @@ XhcCheckUrbResult (
         DEBUG ((EFI_D_ERROR, "Transfer Default Error Occur! Completecode = 0x%x!\n",EvtTrb->Completecode));
         CheckedUrb->Result  |= EFI_USB_ERR_TIMEOUT;
         CheckedUrb->Finished = TRUE;
-        goto EXIT;
+        continue;
     }
 
     //
@@ -1203,7 +1213,15 @@ XhcCheckUrbResult (
     }
   }
 
-EXIT:
+  //
+  // Nothing to acknowledge, save the register accesses of an idle poll.
+  //
+  if (EventCount == 0) {
+    return;
+  }
+
+  Xhc->EventRingDrains++;
+  Xhc->EventRingEvents += EventCount;
 
   //
   // Advance event ring to last available entry
@@ -1225,6 +1243,36 @@ EXIT:
     XhcWriteRuntimeReg (Xhc, XHC_ERDP_OFFSET, XHC_LOW_32BIT (PhyAddr) | BIT3);
     XhcWriteRuntimeReg (Xhc, XHC_ERDP_OFFSET + 4, XHC_HIGH_32BIT (PhyAddr));
   }
+}
+
+/**
+  Check the URB's execution result and update the URB's
+  result accordingly.
+
+  @param  Xhc             The XHCI Instance.
+  @param  Urb             The URB to check result.
+
+  @return Whether the result of URB transfer is finialized.
+
+**/
+BOOLEAN
+XhcCheckUrbResult (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  URB                 *Urb
+  )
+{
+  ASSERT ((Xhc != NULL) && (Urb != NULL));
+
+  if (Urb->Finished) {
+    return TRUE;
+  }
+
+  if (XhcIsHalt (Xhc) || XhcIsSysError (Xhc)) {
+    Urb->Result |= EFI_USB_ERR_SYSTEM;
+    return FALSE;
+  }
+
+  XhcProcessEventRing (Xhc, Urb);
 
   return Urb->Finished;
 }
@@ -1467,11 +1515,26 @@ XhcMonitorAsyncRequests (
   UINT8                   SlotId;
   EFI_STATUS              Status;
   EFI_TPL                 OldTpl;
+  BOOLEAN                 Halted;
 
   OldTpl = gBS->RaiseTPL (XHC_TPL);
 
   Xhc    = (USB_XHCI_INSTANCE*) Context;
 
+  if (IsListEmpty (&Xhc->AsyncIntTransfers)) {
+    gBS->RestoreTPL (OldTpl);
+    return;
+  }
+
+  //
+  // Dispatch the new events to all the asynchronous transfers in one pass
+  // instead of traversing the event ring for each of them.
+  //
+  Halted = (BOOLEAN) (XhcIsHalt (Xhc) || XhcIsSysError (Xhc));
+  if (!Halted) {
+    XhcProcessEventRing (Xhc, NULL);
+  }
+
   EFI_LIST_FOR_EACH_SAFE (Entry, Next, &Xhc->AsyncIntTransfers) {
     Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
 
@@ -1483,12 +1546,13 @@ XhcMonitorAsyncRequests (
       continue;
     }
 
+    if (Halted && !Urb->Finished) {
+      Urb->Result |= EFI_USB_ERR_SYSTEM;
+    }
+
     //
-    // Check the result of URB execution. If it is still
-    // active, check the next one.
+    // If the URB is still active, check the next one.
     //
-    XhcCheckUrbResult (Xhc, Urb);
-
     if (!Urb->Finished) {
       continue;
     }
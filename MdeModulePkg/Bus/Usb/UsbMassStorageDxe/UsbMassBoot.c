@@ -2,7 +2,7 @@
   Implementation of the command set of USB Mass Storage Specification
   for Bootability, Revision 1.0.
 
-Copyright (c) 2007 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -770,6 +770,35 @@ ON_ERROR:
 }
 
 
+/**
+  Get the maximum number of blocks carried by one read or write command.
+
+  @param  UsbMass                The USB mass storage device
+
+  @return The maximum number of blocks per command.
+
+**/
+UINT16
+UsbBootMaxTransferBlocks (
+  IN USB_MASS_DEVICE        *UsbMass
+  )
+{
+  UINTN                     MaxBlocks;
+
+  if (!UsbMass->LargeTransfer || (UsbMass->BlockIoMedia.BlockSize == 0)) {
+    return USB_BOOT_IO_BLOCKS;
+  }
+
+  MaxBlocks = USB_BOOT_LARGE_IO_SIZE / UsbMass->BlockIoMedia.BlockSize;
+  MaxBlocks = MAX (MaxBlocks, USB_BOOT_IO_BLOCKS);
+
+  //
+  // READ10/WRITE10 only have 16 bit transfer length.
+  //
+  return (UINT16) MIN (MaxBlocks, MAX_UINT16);
+}
+
+
 /**
   Read some blocks from the device.
 
@@ -793,11 +822,13 @@ UsbBootReadBlocks (
   USB_BOOT_READ10_CMD       ReadCmd;
   EFI_STATUS                Status;
   UINT16                    Count;
+  UINT16                    CountMax;
   UINT32                    BlockSize;
   UINT32                    ByteSize;
   UINT32                    Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
+  CountMax  = UsbBootMaxTransferBlocks (UsbMass);
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
@@ -806,7 +837,7 @@ UsbBootReadBlocks (
     // on the device. We must split the total block because the READ10
     // command only has 16 bit transfer length (in the unit of block).
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
+    Count     = (UINT16)((TotalBlock < CountMax) ? TotalBlock : CountMax);
     ByteSize  = (UINT32)Count * BlockSize;
 
     //
@@ -869,11 +900,13 @@ UsbBootWriteBlocks (
   USB_BOOT_WRITE10_CMD  WriteCmd;
   EFI_STATUS            Status;
   UINT16                Count;
+  UINT16                CountMax;
   UINT32                BlockSize;
   UINT32                ByteSize;
   UINT32                Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
+  CountMax  = UsbBootMaxTransferBlocks (UsbMass);
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
@@ -882,7 +915,7 @@ UsbBootWriteBlocks (
     // on the device. We must split the total block because the WRITE10
     // command only has 16 bit transfer length (in the unit of block).
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
+    Count     = (UINT16)((TotalBlock < CountMax) ? TotalBlock : CountMax);
     ByteSize  = (UINT32)Count * BlockSize;
 
     //
@@ -945,18 +978,20 @@ UsbBootReadBlocks16 (
   UINT8                     ReadCmd[16];
   EFI_STATUS                Status;
   UINT16                    Count;
+  UINT16                    CountMax;
   UINT32                    BlockSize;
   UINT32                    ByteSize;
   UINT32                    Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
+  CountMax  = UsbBootMaxTransferBlocks (UsbMass);
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
     //
     // Split the total blocks into smaller pieces.
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
+    Count     = (UINT16)((TotalBlock < CountMax) ? TotalBlock : CountMax);
     ByteSize  = (UINT32)Count * BlockSize;
 
     //
@@ -1019,18 +1054,20 @@ UsbBootWriteBlocks16 (
   UINT8                 WriteCmd[16];
   EFI_STATUS            Status;
   UINT16                Count;
+  UINT16                CountMax;
   UINT32                BlockSize;
   UINT32                ByteSize;
   UINT32                Timeout;
 
   BlockSize = UsbMass->BlockIoMedia.BlockSize;
+  CountMax  = UsbBootMaxTransferBlocks (UsbMass);
   Status    = EFI_SUCCESS;
 
   while (TotalBlock > 0) {
     //
     // Split the total blocks into smaller pieces.
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
+    Count     = (UINT16)((TotalBlock < CountMax) ? TotalBlock : CountMax);
     ByteSize  = (UINT32)Count * BlockSize;
 
     //
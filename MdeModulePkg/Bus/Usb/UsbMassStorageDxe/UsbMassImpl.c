@@ -1,7 +1,7 @@
 /** @file
   USB Mass Storage Driver that manages USB Mass Storage Device and produces Block I/O Protocol.
 
-Copyright (c) 2007 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2007 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -330,6 +330,41 @@ UsbMassFlushBlocks (
   return EFI_SUCCESS;
 }
 
+/**
+  Check whether the device may move up to USB_BOOT_LARGE_IO_SIZE bytes
+  in one command.
+
+  BOT devices operating at SuperSpeed are known to handle large transfers,
+  others are limited to USB_BOOT_IO_BLOCKS blocks.
+
+  @param  UsbIo                  The USB I/O Protocol instance of the device.
+  @param  Transport              The transport protocol of the device.
+
+  @retval TRUE                   Large transfers can be used.
+  @retval FALSE                  Large transfers can't be used.
+
+**/
+BOOLEAN
+UsbMassIsLargeTransferCapable (
+  IN EFI_USB_IO_PROTOCOL      *UsbIo,
+  IN USB_MASS_TRANSPORT       *Transport
+  )
+{
+  EFI_USB_DEVICE_DESCRIPTOR   DevDesc;
+  EFI_STATUS                  Status;
+
+  if (Transport->Protocol != USB_MASS_STORE_BOT) {
+    return FALSE;
+  }
+
+  Status = UsbIo->UsbGetDeviceDescriptor (UsbIo, &DevDesc);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (DevDesc.BcdUSB >= 0x0300);
+}
+
 /**
   Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
 
@@ -487,11 +522,25 @@ UsbMassInitMultiLun (
   ASSERT (MaxLun > 0);
   ReturnStatus = EFI_NOT_FOUND;
 
+  //
+  // USB I/O Protocol has been opened by driver in USBMassDriverBindingStart().
+  //
+  Status = gBS->OpenProtocol (
+                  Controller,
+                  &gEfiUsbIoProtocolGuid,
+                  (VOID **) &UsbIo,
+                  This->DriverBindingHandle,
+                  Controller,
+                  EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                  );
+  if (EFI_ERROR (Status)) {
+    return ReturnStatus;
+  }
+
   for (Index = 0; Index <= MaxLun; Index++) { 
 
     DEBUG ((EFI_D_INFO, "UsbMassInitMultiLun: Start to initialize No.%d logic unit\n", Index));
     
-    UsbIo   = NULL;
     UsbMass = AllocateZeroPool (sizeof (USB_MASS_DEVICE));
     ASSERT (UsbMass != NULL);
       
@@ -506,6 +555,7 @@ UsbMassInitMultiLun (
     UsbMass->Transport            = Transport;
     UsbMass->Context              = Context;
     UsbMass->Lun                  = Index;
+    UsbMass->LargeTransfer        = UsbMassIsLargeTransferCapable (UsbIo, Transport);
     
     //
     // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
@@ -646,6 +696,7 @@ UsbMassInitNonLun (
   UsbMass->OpticalStorage       = FALSE;
   UsbMass->Transport            = Transport;
   UsbMass->Context              = Context;
+  UsbMass->LargeTransfer        = UsbMassIsLargeTransferCapable (UsbIo, Transport);
   
   //
   // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
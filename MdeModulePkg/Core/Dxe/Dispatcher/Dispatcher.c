@@ -411,6 +411,31 @@ CoreEmptyCallbackFunction (
   return;
 }
 
+/**
+  Wait for the work that drivers have handed to the APs through the EDKII AP
+  Task Protocol. The completion handlers of that work run on the BSP and may
+  install protocols that satisfy more DEPEXes.
+
+  @retval TRUE    Some AP tasks were still outstanding and have now completed.
+  @retval FALSE   There was no outstanding AP task.
+
+**/
+BOOLEAN
+CoreWaitForApTasks (
+  VOID
+  )
+{
+  EFI_STATUS              Status;
+  EDKII_AP_TASK_PROTOCOL  *ApTask;
+
+  Status = CoreLocateProtocol (&gEdkiiApTaskProtocolGuid, NULL, (VOID **) &ApTask);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (ApTask->WaitAll (ApTask) != 0);
+}
+
 /**
   This is the main Dispatcher for DXE and it exits when there are no more
   drivers to run. Drain the mScheduledQueue and load and start a PE
@@ -594,6 +619,14 @@ CoreDispatcher (
         }
       }
     }
+
+    //
+    // Before giving up, let the drivers' AP tasks finish, as their completion
+    // may satisfy more DEPEXes.
+    //
+    if (!ReadyToRun && CoreWaitForApTasks ()) {
+      ReadyToRun = TRUE;
+    }
   } while (ReadyToRun);
 
   //
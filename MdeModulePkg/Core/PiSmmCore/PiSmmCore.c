@@ -1,7 +1,7 @@
 /** @file
   SMM Core Main Entry Point
 
-  Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available 
   under the terms and conditions of the BSD License which accompanies this 
   distribution.  The full text of the license may be found at        
@@ -634,6 +634,8 @@ SmmMain (
   RegisterSmramProfileHandler ();
   SmramProfileInstallProtocol ();
 
+  RegisterSmiHandlerProfileHandler ();
+
   SmmCoreInstallLoadedImage ();
 
   return EFI_SUCCESS;
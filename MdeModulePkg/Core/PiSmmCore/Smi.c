@@ -1,7 +1,7 @@
 /** @file
   SMI management.
 
-  Copyright (c) 2009 - 2013, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials are licensed and made available 
   under the terms and conditions of the BSD License which accompanies this 
   distribution.  The full text of the license may be found at        
@@ -23,6 +23,7 @@
  typedef struct {
   UINTN       Signature;
   LIST_ENTRY  AllEntries;  // All entries
+  LIST_ENTRY  HashLink;    // Link on the hash bucket of HandlerType
 
   EFI_GUID    HandlerType; // Type of interrupt
   LIST_ENTRY  SmiHandlers; // All handlers
@@ -35,10 +36,67 @@
   LIST_ENTRY                    Link;        // Link on SMI_ENTRY.SmiHandlers
   EFI_SMM_HANDLER_ENTRY_POINT2  Handler;     // The smm handler's entry point
   SMI_ENTRY                     *SmiEntry;
+  BOOLEAN                       ToRemove;    // Unregistered while SmiManage() is running
+  UINT64                        CallCount;   // Number of calls, for SMI handler profile
+  UINT64                        TotalTicks;  // Execution time, for SMI handler profile
+  UINT64                        MaxTicks;
 } SMI_HANDLER;
 
+//
+// Number of buckets of the SMI entry hash table, must be a power of 2.
+//
+#define SMI_ENTRY_HASH_SIZE  64
+
 LIST_ENTRY  mRootSmiHandlerList = INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiHandlerList);
 LIST_ENTRY  mSmiEntryList       = INITIALIZE_LIST_HEAD_VARIABLE (mSmiEntryList);
+LIST_ENTRY  mSmiEntryHashTable[SMI_ENTRY_HASH_SIZE];
+
+//
+// The handlers unregistered while SmiManage() is running are only removed
+// when the outermost SmiManage() returns.
+//
+UINTN       mSmiManageCallingDepth = 0;
+BOOLEAN     mSmiHandlerToRemove    = FALSE;
+
+BOOLEAN     mSmiHandlerProfileEnable = FALSE;
+BOOLEAN     mSmiHandlerProfileCountDown;
+UINT64      mSmiHandlerProfileCounterCycle;
+
+/**
+  Get the hash bucket of a handler type in the SMI entry hash table.
+
+  @param  HandlerType            The type of the interrupt
+
+  @return The list head of the hash bucket.
+
+**/
+LIST_ENTRY *
+SmiEntryHashBucket (
+  IN CONST EFI_GUID  *HandlerType
+  )
+{
+  UINTN   Index;
+  UINT32  Hash;
+
+  //
+  // The hash table cannot be initialized statically, and SMI handlers may be
+  // registered before any initialization code of this file runs.
+  //
+  if (mSmiEntryHashTable[0].ForwardLink == NULL) {
+    for (Index = 0; Index < SMI_ENTRY_HASH_SIZE; Index++) {
+      InitializeListHead (&mSmiEntryHashTable[Index]);
+    }
+  }
+
+  Hash = ReadUnaligned32 ((CONST UINT32 *) HandlerType) ^
+         ReadUnaligned32 ((CONST UINT32 *) HandlerType + 1) ^
+         ReadUnaligned32 ((CONST UINT32 *) HandlerType + 2) ^
+         ReadUnaligned32 ((CONST UINT32 *) HandlerType + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return &mSmiEntryHashTable[Hash & (SMI_ENTRY_HASH_SIZE - 1)];
+}
 
 /**
   Finds the SMI entry for the requested handler type.
@@ -56,19 +114,21 @@ SmmCoreFindSmiEntry (
   IN BOOLEAN   Create
   )
 {
+  LIST_ENTRY  *Bucket;
   LIST_ENTRY  *Link;
   SMI_ENTRY   *Item;
   SMI_ENTRY   *SmiEntry;
 
   //
-  // Search the SMI entry list for the matching GUID
+  // Search the hash bucket of the SMI entry for the matching GUID
   //
   SmiEntry = NULL;
-  for (Link = mSmiEntryList.ForwardLink;
-       Link != &mSmiEntryList;
+  Bucket = SmiEntryHashBucket (HandlerType);
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink) {
 
-    Item = CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    Item = CR (Link, SMI_ENTRY, HashLink, SMI_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->HandlerType, HandlerType)) {
       //
       // This is the SMI entry
@@ -93,14 +153,107 @@ SmmCoreFindSmiEntry (
       InitializeListHead (&SmiEntry->SmiHandlers);
 
       //
-      // Add it to SMI entry list
+      // Add it to SMI entry list and to its hash bucket
       //
       InsertTailList (&mSmiEntryList, &SmiEntry->AllEntries);
+      InsertTailList (Bucket, &SmiEntry->HashLink);
     }
   }
   return SmiEntry;
 }
 
+/**
+  Remove an SMI handler, and its SMI entry if it has no more handlers.
+
+  @param  SmiHandler             The SMI handler to remove.
+
+**/
+VOID
+SmiHandlerRemove (
+  IN SMI_HANDLER  *SmiHandler
+  )
+{
+  SMI_ENTRY  *SmiEntry;
+
+  SmiEntry = SmiHandler->SmiEntry;
+
+  RemoveEntryList (&SmiHandler->Link);
+  FreePool (SmiHandler);
+
+  if (SmiEntry == NULL) {
+    //
+    // This is root SMI handler
+    //
+    return;
+  }
+
+  if (IsListEmpty (&SmiEntry->SmiHandlers)) {
+    //
+    // No handler registered for this interrupt now, remove the SMI_ENTRY
+    //
+    RemoveEntryList (&SmiEntry->AllEntries);
+    RemoveEntryList (&SmiEntry->HashLink);
+
+    FreePool (SmiEntry);
+  }
+}
+
+/**
+  Remove the SMI handlers in a list that were unregistered while SmiManage()
+  was running.
+
+  @param  Head                   The SMI handler list.
+
+**/
+VOID
+SmiHandlerRemovePending (
+  IN LIST_ENTRY  *Head
+  )
+{
+  LIST_ENTRY   *Link;
+  SMI_HANDLER  *SmiHandler;
+
+  Link = Head->ForwardLink;
+  while (Link != Head) {
+    SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+    Link = Link->ForwardLink;
+    if (SmiHandler->ToRemove) {
+      SmiHandlerRemove (SmiHandler);
+    }
+  }
+}
+
+/**
+  Get the number of performance counter ticks elapsed between two counter values.
+
+  @param  StartTicks             The performance counter value at the start.
+  @param  EndTicks               The performance counter value at the end.
+
+  @return The number of elapsed ticks.
+
+**/
+UINT64
+SmiHandlerProfileElapsedTicks (
+  IN UINT64  StartTicks,
+  IN UINT64  EndTicks
+  )
+{
+  UINT64   Delta;
+  BOOLEAN  RollOver;
+
+  if (mSmiHandlerProfileCountDown) {
+    Delta    = StartTicks - EndTicks;
+    RollOver = (BOOLEAN) (EndTicks > StartTicks);
+  } else {
+    Delta    = EndTicks - StartTicks;
+    RollOver = (BOOLEAN) (EndTicks < StartTicks);
+  }
+  if (RollOver) {
+    Delta += mSmiHandlerProfileCounterCycle;
+  }
+  return Delta;
+}
+
 /**
   Manage SMI of a particular type.
 
@@ -126,13 +279,19 @@ SmiManage (
 {
   LIST_ENTRY   *Link;
   LIST_ENTRY   *Head;
+  LIST_ENTRY   *EntryLink;
   SMI_ENTRY    *SmiEntry;
   SMI_HANDLER  *SmiHandler;
   BOOLEAN      SuccessReturn;
+  BOOLEAN      WillReturn;
   EFI_STATUS   Status;
-  
+  UINT64       StartTicks;
+  UINT64       Ticks;
+
   Status = EFI_NOT_FOUND;
   SuccessReturn = FALSE;
+  WillReturn = FALSE;
+  StartTicks = 0;
   if (HandlerType == NULL) {
     //
     // Root SMI handler
@@ -154,9 +313,22 @@ SmiManage (
     Head = &SmiEntry->SmiHandlers;
   }
 
+  mSmiManageCallingDepth++;
+
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
 
+    if (SmiHandler->ToRemove) {
+      //
+      // This handler has been unregistered
+      //
+      continue;
+    }
+
+    if (mSmiHandlerProfileEnable) {
+      StartTicks = GetPerformanceCounter ();
+    }
+
     Status = SmiHandler->Handler (
                (EFI_HANDLE) SmiHandler,
                Context,
@@ -164,6 +336,16 @@ SmiManage (
                CommBufferSize
                );
 
+    if (mSmiHandlerProfileEnable) {
+      //
+      // The handler is still allocated even if it unregistered itself
+      //
+      Ticks = SmiHandlerProfileElapsedTicks (StartTicks, GetPerformanceCounter ());
+      SmiHandler->CallCount++;
+      SmiHandler->TotalTicks += Ticks;
+      SmiHandler->MaxTicks    = MAX (SmiHandler->MaxTicks, Ticks);
+    }
+
     switch (Status) {
     case EFI_INTERRUPT_PENDING:
       //
@@ -171,7 +353,7 @@ SmiManage (
       // no additional handlers will be processed and EFI_INTERRUPT_PENDING will be returned.
       //
       if (HandlerType != NULL) {
-        return EFI_INTERRUPT_PENDING;
+        WillReturn = TRUE;
       }
       break;
 
@@ -182,7 +364,7 @@ SmiManage (
       // additional handlers will be processed.
       //
       if (HandlerType != NULL) {
-        return EFI_SUCCESS;
+        WillReturn = TRUE;
       }
       SuccessReturn = TRUE;
       break;
@@ -209,12 +391,31 @@ SmiManage (
       ASSERT (FALSE);
       break;
     }
+
+    if (WillReturn) {
+      break;
+    }
   }
 
-  if (SuccessReturn) {
+  if (SuccessReturn && !WillReturn) {
     Status = EFI_SUCCESS;
   }
 
+  mSmiManageCallingDepth--;
+  if (mSmiManageCallingDepth == 0 && mSmiHandlerToRemove) {
+    //
+    // Remove the handlers unregistered during this SMI
+    //
+    mSmiHandlerToRemove = FALSE;
+    SmiHandlerRemovePending (&mRootSmiHandlerList);
+    EntryLink = mSmiEntryList.ForwardLink;
+    while (EntryLink != &mSmiEntryList) {
+      SmiEntry  = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      EntryLink = EntryLink->ForwardLink;
+      SmiHandlerRemovePending (&SmiEntry->SmiHandlers);
+    }
+  }
+
   return Status;
 }
 
@@ -295,7 +496,6 @@ SmiHandlerUnRegister (
   )
 {
   SMI_HANDLER  *SmiHandler;
-  SMI_ENTRY    *SmiEntry;
 
   SmiHandler = (SMI_HANDLER *) DispatchHandle;
 
@@ -303,30 +503,352 @@ SmiHandlerUnRegister (
     return EFI_INVALID_PARAMETER;
   }
 
-  if (SmiHandler->Signature != SMI_HANDLER_SIGNATURE) {
+  if (SmiHandler->Signature != SMI_HANDLER_SIGNATURE || SmiHandler->ToRemove) {
     return EFI_INVALID_PARAMETER;
   }
 
-  SmiEntry = SmiHandler->SmiEntry;
-
-  RemoveEntryList (&SmiHandler->Link);
-  FreePool (SmiHandler);
-
-  if (SmiEntry == NULL) {
+  if (mSmiManageCallingDepth > 0) {
     //
-    // This is root SMI handler
+    // SmiManage() may be walking the list of this handler, or running it.
+    // Remove it when the outermost SmiManage() returns.
     //
+    SmiHandler->ToRemove = TRUE;
+    mSmiHandlerToRemove  = TRUE;
     return EFI_SUCCESS;
   }
 
-  if (IsListEmpty (&SmiEntry->SmiHandlers)) {
+  SmiHandlerRemove (SmiHandler);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the number of SMI handlers recorded in the SMI handler profile.
+
+  @return The number of SMI handlers.
+
+**/
+UINTN
+SmiHandlerProfileGetHandlerCount (
+  VOID
+  )
+{
+  LIST_ENTRY   *EntryLink;
+  LIST_ENTRY   *Link;
+  LIST_ENTRY   *Head;
+  SMI_ENTRY    *SmiEntry;
+  SMI_HANDLER  *SmiHandler;
+  UINTN        Count;
+
+  Count = 0;
+  EntryLink = &mSmiEntryList;
+  do {
+    if (EntryLink == &mSmiEntryList) {
+      Head = &mRootSmiHandlerList;
+    } else {
+      SmiEntry = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      Head = &SmiEntry->SmiHandlers;
+    }
+    for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+      SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+      if (!SmiHandler->ToRemove) {
+        Count++;
+      }
+    }
+    EntryLink = EntryLink->ForwardLink;
+  } while (EntryLink != &mSmiEntryList);
+
+  return Count;
+}
+
+/**
+  Copy the part of a profile record that falls in the requested data range.
+
+  @param  Record                 The profile record.
+  @param  RecordSize             The size of the profile record.
+  @param  RecordOffset           On input, the offset of the record in the profile data.
+                                 On output, the offset of the next record.
+  @param  DataBuffer             The buffer receiving the requested data range.
+  @param  DataSize               The size of the requested data range.
+  @param  DataOffset             The offset of the requested data range.
+
+**/
+VOID
+SmiHandlerProfileCopyRecord (
+  IN     VOID    *Record,
+  IN     UINTN   RecordSize,
+  IN OUT UINT64  *RecordOffset,
+  OUT    UINT8   *DataBuffer,
+  IN     UINT64  DataSize,
+  IN     UINT64  DataOffset
+  )
+{
+  UINT64  Start;
+  UINT64  End;
+
+  Start = MAX (*RecordOffset, DataOffset);
+  End   = MIN (*RecordOffset + RecordSize, DataOffset + DataSize);
+  if (Start < End) {
+    CopyMem (
+      DataBuffer + (UINTN) (Start - DataOffset),
+      (UINT8 *) Record + (UINTN) (Start - *RecordOffset),
+      (UINTN) (End - Start)
+      );
+  }
+  *RecordOffset += RecordSize;
+}
+
+/**
+  Copy SMI handler profile data.
+
+  @param  DataBuffer             The buffer to hold the profile data.
+  @param  DataSize               On input, profile buffer size.
+                                 On output, actual profile data size copied.
+  @param  DataOffset             On input, profile buffer offset to copy.
+                                 On output, next time profile buffer offset to copy.
+
+**/
+VOID
+SmiHandlerProfileCopyData (
+  OUT    VOID    *DataBuffer,
+  IN OUT UINT64  *DataSize,
+  IN OUT UINT64  *DataOffset
+  )
+{
+  SMI_HANDLER_PROFILE_CONTEXT  Context;
+  SMI_HANDLER_PROFILE_HANDLER  HandlerInfo;
+  LIST_ENTRY                   *EntryLink;
+  LIST_ENTRY                   *Link;
+  LIST_ENTRY                   *Head;
+  SMI_ENTRY                    *SmiEntry;
+  SMI_HANDLER                  *SmiHandler;
+  UINT64                       RecordOffset;
+
+  ZeroMem (&Context, sizeof (Context));
+  Context.Signature    = SMI_HANDLER_PROFILE_CONTEXT_SIGNATURE;
+  Context.Length       = sizeof (Context);
+  Context.Revision     = SMI_HANDLER_PROFILE_CONTEXT_REVISION;
+  Context.HandlerCount = (UINT32) SmiHandlerProfileGetHandlerCount ();
+
+  RecordOffset = 0;
+  SmiHandlerProfileCopyRecord (&Context, sizeof (Context), &RecordOffset, DataBuffer, *DataSize, *DataOffset);
+
+  EntryLink = &mSmiEntryList;
+  do {
+    if (EntryLink == &mSmiEntryList) {
+      SmiEntry = NULL;
+      Head = &mRootSmiHandlerList;
+    } else {
+      SmiEntry = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      Head = &SmiEntry->SmiHandlers;
+    }
+    for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+      SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+      if (SmiHandler->ToRemove) {
+        continue;
+      }
+
+      ZeroMem (&HandlerInfo, sizeof (HandlerInfo));
+      HandlerInfo.Signature = SMI_HANDLER_PROFILE_HANDLER_SIGNATURE;
+      HandlerInfo.Length    = sizeof (HandlerInfo);
+      HandlerInfo.Revision  = SMI_HANDLER_PROFILE_HANDLER_REVISION;
+      if (SmiEntry != NULL) {
+        CopyGuid (&HandlerInfo.HandlerType, &SmiEntry->HandlerType);
+      }
+      HandlerInfo.Handler   = (PHYSICAL_ADDRESS) (UINTN) SmiHandler->Handler;
+      HandlerInfo.CallCount = SmiHandler->CallCount;
+      HandlerInfo.TotalTime = GetTimeInNanoSecond (SmiHandler->TotalTicks);
+      HandlerInfo.MaxTime   = GetTimeInNanoSecond (SmiHandler->MaxTicks);
+      SmiHandlerProfileCopyRecord (&HandlerInfo, sizeof (HandlerInfo), &RecordOffset, DataBuffer, *DataSize, *DataOffset);
+    }
+    EntryLink = EntryLink->ForwardLink;
+  } while (EntryLink != &mSmiEntryList);
+
+  //
+  // RecordOffset is now the total size of the profile data
+  //
+  if (*DataOffset >= RecordOffset) {
+    *DataSize = 0;
+  } else {
+    *DataSize = MIN (*DataSize, RecordOffset - *DataOffset);
+  }
+  *DataOffset += *DataSize;
+}
+
+/**
+  Reset the SMI handler profile data.
+
+**/
+VOID
+SmiHandlerProfileReset (
+  VOID
+  )
+{
+  LIST_ENTRY   *EntryLink;
+  LIST_ENTRY   *Link;
+  LIST_ENTRY   *Head;
+  SMI_ENTRY    *SmiEntry;
+  SMI_HANDLER  *SmiHandler;
+
+  EntryLink = &mSmiEntryList;
+  do {
+    if (EntryLink == &mSmiEntryList) {
+      Head = &mRootSmiHandlerList;
+    } else {
+      SmiEntry = CR (EntryLink, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+      Head = &SmiEntry->SmiHandlers;
+    }
+    for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+      SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+      SmiHandler->CallCount  = 0;
+      SmiHandler->TotalTicks = 0;
+      SmiHandler->MaxTicks   = 0;
+    }
+    EntryLink = EntryLink->ForwardLink;
+  } while (EntryLink != &mSmiEntryList);
+}
+
+/**
+  Dispatch function for the SMI handler profile.
+
+  Caution: This function may receive untrusted input.
+  Communicate buffer and buffer size are external input, so this function will do basic validation.
+
+  @param DispatchHandle  The unique handle assigned to this handler by SmiHandlerRegister().
+  @param Context         Points to an optional handler context which was specified when the
+                         handler was registered.
+  @param CommBuffer      A pointer to a collection of data in memory that will
+                         be conveyed from a non-SMM environment into an SMM environment.
+  @param CommBufferSize  The size of the CommBuffer.
+
+  @retval EFI_SUCCESS Command is handled successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+SmiHandlerProfileHandler (
+  IN EFI_HANDLE  DispatchHandle,
+  IN CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID    *CommBuffer      OPTIONAL,
+  IN OUT UINTN   *CommBufferSize  OPTIONAL
+  )
+{
+  SMI_HANDLER_PROFILE_PARAMETER_HEADER              *ParameterHeader;
+  SMI_HANDLER_PROFILE_PARAMETER_GET_INFO            *ParameterGetInfo;
+  SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET  *ParameterGetData;
+  SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET  GetData;
+  UINTN                                             TempCommBufferSize;
+  UINT64                                            DataSize;
+  UINT64                                            DataOffset;
+
+  //
+  // If input is invalid, stop processing this SMI
+  //
+  if (CommBuffer == NULL || CommBufferSize == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  TempCommBufferSize = *CommBufferSize;
+
+  if (TempCommBufferSize < sizeof (SMI_HANDLER_PROFILE_PARAMETER_HEADER)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerProfileHandler: SMM communication buffer size invalid!\n"));
+    return EFI_SUCCESS;
+  }
+
+  if (!SmmIsBufferOutsideSmmValid ((UINTN) CommBuffer, TempCommBufferSize)) {
+    DEBUG ((EFI_D_ERROR, "SmiHandlerProfileHandler: SMM communication buffer in SMRAM or overflow!\n"));
+    return EFI_SUCCESS;
+  }
+
+  ParameterHeader = (SMI_HANDLER_PROFILE_PARAMETER_HEADER *) ((UINTN) CommBuffer);
+  ParameterHeader->ReturnStatus = (UINT64)-1;
+
+  switch (ParameterHeader->Command) {
+  case SMI_HANDLER_PROFILE_COMMAND_GET_INFO:
+    if (TempCommBufferSize != sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_INFO)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerProfileHandler: SMM communication buffer size invalid!\n"));
+      return EFI_SUCCESS;
+    }
+    ParameterGetInfo = (SMI_HANDLER_PROFILE_PARAMETER_GET_INFO *) (UINTN) CommBuffer;
+    ParameterGetInfo->DataSize = sizeof (SMI_HANDLER_PROFILE_CONTEXT) +
+                                 SmiHandlerProfileGetHandlerCount () * sizeof (SMI_HANDLER_PROFILE_HANDLER);
+    ParameterGetInfo->Header.ReturnStatus = 0;
+    break;
+
+  case SMI_HANDLER_PROFILE_COMMAND_GET_DATA_BY_OFFSET:
+    if (TempCommBufferSize != sizeof (SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerProfileHandler: SMM communication buffer size invalid!\n"));
+      return EFI_SUCCESS;
+    }
+    ParameterGetData = (SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET *) (UINTN) CommBuffer;
+    CopyMem (&GetData, ParameterGetData, sizeof (GetData));
+
     //
-    // No handler registered for this interrupt now, remove the SMI_ENTRY
+    // Sanity check
     //
-    RemoveEntryList (&SmiEntry->AllEntries);
+    if (!SmmIsBufferOutsideSmmValid ((UINTN) GetData.DataBuffer, (UINTN) GetData.DataSize)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerProfileHandler: DataBuffer in SMRAM or overflow!\n"));
+      ParameterGetData->Header.ReturnStatus = (UINT64) (INT64) (INTN) EFI_ACCESS_DENIED;
+      break;
+    }
 
-    FreePool (SmiEntry);
+    DataSize   = GetData.DataSize;
+    DataOffset = GetData.DataOffset;
+    SmiHandlerProfileCopyData ((VOID *) (UINTN) GetData.DataBuffer, &DataSize, &DataOffset);
+    ParameterGetData->DataSize   = DataSize;
+    ParameterGetData->DataOffset = DataOffset;
+    ParameterGetData->Header.ReturnStatus = 0;
+    break;
+
+  case SMI_HANDLER_PROFILE_COMMAND_RESET:
+    if (TempCommBufferSize != sizeof (SMI_HANDLER_PROFILE_PARAMETER_HEADER)) {
+      DEBUG ((EFI_D_ERROR, "SmiHandlerProfileHandler: SMM communication buffer size invalid!\n"));
+      return EFI_SUCCESS;
+    }
+    SmiHandlerProfileReset ();
+    ParameterHeader->ReturnStatus = 0;
+    break;
+
+  default:
+    break;
   }
 
   return EFI_SUCCESS;
 }
+
+/**
+  Register SMI handler profile handler.
+
+**/
+VOID
+RegisterSmiHandlerProfileHandler (
+  VOID
+  )
+{
+  EFI_STATUS    Status;
+  EFI_HANDLE    DispatchHandle;
+  UINT64        StartValue;
+  UINT64        EndValue;
+
+  if ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & BIT0) == 0) {
+    return;
+  }
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue < StartValue) {
+    mSmiHandlerProfileCountDown    = TRUE;
+    mSmiHandlerProfileCounterCycle = StartValue - EndValue + 1;
+  } else {
+    mSmiHandlerProfileCountDown    = FALSE;
+    mSmiHandlerProfileCounterCycle = EndValue - StartValue + 1;
+  }
+
+  Status = SmiHandlerRegister (
+             SmiHandlerProfileHandler,
+             &gEdkiiSmiHandlerProfileGuid,
+             &DispatchHandle
+             );
+  ASSERT_EFI_ERROR (Status);
+
+  mSmiHandlerProfileEnable = TRUE;
+}
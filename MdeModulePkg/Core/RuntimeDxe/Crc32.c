@@ -7,7 +7,11 @@
   EFI Runtime Services Table are converted from physical address to
   virtual addresses.  This requires that the 32-bit CRC be recomputed.
 
-Copyright (c) 2006 - 2008, Intel Corporation. All rights reserved.<BR>
+  The CRC is computed 8 bytes at a time with the slicing-by-8 tables. On X64
+  processors that support PCLMULQDQ, the 16-byte aligned middle of large
+  buffers is folded with carry-less multiplication instead.
+
+Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -19,9 +23,72 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
 
-#include <Uefi.h>
+#include "Runtime.h"
+
+//
+// Buffers shorter than this are not worth aligning for PCLMULQDQ.
+//
+#define CRC32_PCLMUL_MIN_SIZE  256
+
+//
+// mCrcTable[0] is the classic byte-at-a-time table. mCrcTable[N] gives the
+// CRC contribution of a byte followed by N zero bytes.
+//
+UINT32   mCrcTable[8][256];
+BOOLEAN  mCrc32PclmulSupported = FALSE;
+
+/**
+  Update a running CRC32 value with the slicing-by-8 tables.
+
+  @param  Crc                   The running CRC32 value.
+  @param  Data                  The target data.
+  @param  DataSize              The target data size.
+
+  @return                       The updated running CRC32 value.
+
+**/
+UINT32
+RuntimeDriverCrc32Slice8 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        DataSize
+  )
+{
+  UINT32  Low;
+  UINT32  High;
+
+  //
+  // Align the buffer so that the 32-bit loads below are naturally aligned.
+  //
+  while (DataSize > 0 && ((UINTN) Data & 3) != 0) {
+    Crc = (Crc >> 8) ^ mCrcTable[0][(UINT8) Crc ^ *Data];
+    Data++;
+    DataSize--;
+  }
+
+  while (DataSize >= 8) {
+    Low  = *(CONST UINT32 *) Data ^ Crc;
+    High = *(CONST UINT32 *) (Data + 4);
+    Crc  = mCrcTable[7][Low & 0xff] ^
+           mCrcTable[6][(Low >> 8) & 0xff] ^
+           mCrcTable[5][(Low >> 16) & 0xff] ^
+           mCrcTable[4][Low >> 24] ^
+           mCrcTable[3][High & 0xff] ^
+           mCrcTable[2][(High >> 8) & 0xff] ^
+           mCrcTable[1][(High >> 16) & 0xff] ^
+           mCrcTable[0][High >> 24];
+    Data     += 8;
+    DataSize -= 8;
+  }
+
+  while (DataSize > 0) {
+    Crc = (Crc >> 8) ^ mCrcTable[0][(UINT8) Crc ^ *Data];
+    Data++;
+    DataSize--;
+  }
 
-UINT32  mCrcTable[256];
+  return Crc;
+}
 
 /**
   Calculate CRC32 for target data.
@@ -44,17 +111,33 @@ RuntimeDriverCalculateCrc32 (
   )
 {
   UINT32  Crc;
-  UINTN   Index;
   UINT8   *Ptr;
+#if defined (MDE_CPU_X64)
+  UINTN   Size;
+#endif
 
   if (Data == NULL || DataSize == 0 || CrcOut == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
   Crc = 0xffffffff;
-  for (Index = 0, Ptr = Data; Index < DataSize; Index++, Ptr++) {
-    Crc = (Crc >> 8) ^ mCrcTable[(UINT8) Crc ^ *Ptr];
+  Ptr = Data;
+
+#if defined (MDE_CPU_X64)
+  if (mCrc32PclmulSupported && DataSize >= CRC32_PCLMUL_MIN_SIZE) {
+    Size      = (0 - (UINTN) Ptr) & 15;
+    Crc       = RuntimeDriverCrc32Slice8 (Crc, Ptr, Size);
+    Ptr      += Size;
+    DataSize -= Size;
+
+    Size      = DataSize & ~((UINTN) 15);
+    Crc       = InternalCrc32Pclmul (Crc, Ptr, Size);
+    Ptr      += Size;
+    DataSize -= Size;
   }
+#endif
+
+  Crc = RuntimeDriverCrc32Slice8 (Crc, Ptr, DataSize);
 
   *CrcOut = Crc ^ 0xffffffff;
   return EFI_SUCCESS;
@@ -99,6 +182,9 @@ RuntimeDriverInitializeCrc32Table (
   UINTN   TableEntry;
   UINTN   Index;
   UINT32  Value;
+#if defined (MDE_CPU_X64)
+  UINT32  RegEcx;
+#endif
 
   for (TableEntry = 0; TableEntry < 256; TableEntry++) {
     Value = ReverseBits ((UINT32) TableEntry);
@@ -110,6 +196,21 @@ RuntimeDriverInitializeCrc32Table (
       }
     }
 
-    mCrcTable[TableEntry] = ReverseBits (Value);
+    mCrcTable[0][TableEntry] = ReverseBits (Value);
+  }
+
+  for (Index = 1; Index < 8; Index++) {
+    for (TableEntry = 0; TableEntry < 256; TableEntry++) {
+      Value = mCrcTable[Index - 1][TableEntry];
+      mCrcTable[Index][TableEntry] = (Value >> 8) ^ mCrcTable[0][Value & 0xff];
+    }
   }
+
+#if defined (MDE_CPU_X64)
+  //
+  // CPUID.01H:ECX.PCLMULQDQ[bit 1]
+  //
+  AsmCpuid (1, NULL, NULL, &RegEcx, NULL);
+  mCrc32PclmulSupported = (BOOLEAN) ((RegEcx & BIT1) != 0);
+#endif
 }
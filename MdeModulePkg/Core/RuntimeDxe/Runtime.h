@@ -112,6 +112,24 @@ RuntimeDriverInitializeCrc32Table (
   VOID
   );
 
+/**
+  Update a running CRC32 value using carry-less multiplication.
+
+  @param  Crc            The running CRC32 value.
+  @param  Data           The target data, 16-byte aligned.
+  @param  Length         The target data size, a multiple of 16 and at least 64.
+
+  @return                The updated running CRC32 value.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Pclmul (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  );
+
 /**
   Install Runtime AP. This code includes the EfiRuntimeLib, but it only
   functions at RT in physical mode.
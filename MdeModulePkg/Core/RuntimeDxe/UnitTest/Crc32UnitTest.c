@@ -0,0 +1,289 @@
+/** @file
+  Host differential test of the CRC32 of the Runtime driver.
+
+  Crc32.c and the X64 PCLMULQDQ routine are built with the host tools. Every
+  test case compares RuntimeDriverCalculateCrc32() with a bitwise CRC32, with
+  the slicing-by-8 code alone and, when the host supports it, with PCLMULQDQ
+  enabled. The buffers cover every length up to 4KB, on both sides of the
+  size from which PCLMULQDQ is used, at every start alignment within 64
+  bytes, and random lengths up to 1MB. They are placed against an
+  inaccessible guard page, so that a routine reading past the end of a
+  buffer faults. RuntimeDriverCrc32Slice8() and InternalCrc32Pclmul() are
+  also checked on their own, with random running CRC values.
+
+  Usage: Crc32UnitTest [RandomTestCaseCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cpuid.h>
+#include <sys/mman.h>
+#undef NULL
+
+#include "../Runtime.h"
+
+#define PAGE_SIZE          SIZE_4KB
+#define DATA_SIZE          SIZE_1MB
+#define MAX_OFFSET         64
+#define MAX_ORDERED_LENGTH SIZE_4KB
+
+extern BOOLEAN  mCrc32PclmulSupported;
+
+UINT32
+RuntimeDriverCrc32Slice8 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        DataSize
+  );
+
+//
+// The data area, followed by an inaccessible page
+//
+UINT8    *mData;
+BOOLEAN  mPclmulSupported;
+UINT64   mRandomState;
+UINTN    mFailures;
+
+/**
+  Report the CPUID of the host, which RuntimeDriverInitializeCrc32Table()
+  checks for PCLMULQDQ.
+**/
+UINT32
+EFIAPI
+AsmCpuid (
+  IN      UINT32                    Index,
+  OUT     UINT32                    *RegisterEax,  OPTIONAL
+  OUT     UINT32                    *RegisterEbx,  OPTIONAL
+  OUT     UINT32                    *RegisterEcx,  OPTIONAL
+  OUT     UINT32                    *RegisterEdx   OPTIONAL
+  )
+{
+  unsigned int  Eax;
+  unsigned int  Ebx;
+  unsigned int  Ecx;
+  unsigned int  Edx;
+
+  __cpuid (Index, Eax, Ebx, Ecx, Edx);
+  if (RegisterEax != NULL) {
+    *RegisterEax = Eax;
+  }
+  if (RegisterEbx != NULL) {
+    *RegisterEbx = Ebx;
+  }
+  if (RegisterEcx != NULL) {
+    *RegisterEcx = Ecx;
+  }
+  if (RegisterEdx != NULL) {
+    *RegisterEdx = Edx;
+  }
+  return Index;
+}
+
+/**
+  Return a pseudo random number, xorshift64*.
+**/
+UINT64
+Random (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState >> 12;
+  mRandomState ^= mRandomState << 25;
+  mRandomState ^= mRandomState >> 27;
+  return mRandomState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+  Update a running CRC32 value a bit at a time, with the reflected
+  polynomial 0xEDB88320.
+**/
+UINT32
+ReferenceCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Data,
+  IN UINTN        DataSize
+  )
+{
+  UINTN  Bit;
+
+  while (DataSize-- > 0) {
+    Crc ^= *Data++;
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = (Crc >> 1) ^ ((Crc & 1) ? 0xEDB88320 : 0);
+    }
+  }
+  return Crc;
+}
+
+/**
+  Check RuntimeDriverCalculateCrc32() for a buffer with every code path that
+  the host can run.
+**/
+VOID
+CheckCrc32 (
+  IN UINT8   *Data,
+  IN UINTN   DataSize,
+  IN UINT32  Expected
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Crc;
+  UINTN       Pclmul;
+
+  for (Pclmul = 0; Pclmul <= (UINTN) mPclmulSupported; Pclmul++) {
+    mCrc32PclmulSupported = (BOOLEAN) Pclmul;
+    Crc    = 0;
+    Status = RuntimeDriverCalculateCrc32 (Data, DataSize, &Crc);
+    if ((DataSize == 0) ? (Status != EFI_INVALID_PARAMETER) : (EFI_ERROR (Status) || (Crc != Expected))) {
+      if (mFailures++ < 10) {
+        printf (
+          "PCLMULQDQ %s, offset %u, length %u: status 0x%x, 0x%08x, expected 0x%08x\n",
+          Pclmul ? "on" : "off",
+          (unsigned) ((UINTN) Data & (PAGE_SIZE - 1)),
+          (unsigned) DataSize,
+          (unsigned) Status,
+          Crc,
+          Expected
+          );
+      }
+    }
+  }
+}
+
+/**
+  Check a routine that updates a running CRC32 value.
+**/
+VOID
+CheckUpdate (
+  IN CONST CHAR8  *Name,
+  IN UINT32       Crc,
+  IN UINT8        *Data,
+  IN UINTN        DataSize
+  )
+{
+  UINT32  Result;
+  UINT32  Expected;
+
+  Expected = ReferenceCrc32 (Crc, Data, DataSize);
+  if (Name[0] == 'P') {
+    Result = InternalCrc32Pclmul (Crc, Data, DataSize);
+  } else {
+    Result = RuntimeDriverCrc32Slice8 (Crc, Data, DataSize);
+  }
+  if (Result != Expected) {
+    if (mFailures++ < 10) {
+      printf (
+        "%s, CRC 0x%08x, offset %u, length %u: 0x%08x, expected 0x%08x\n",
+        Name,
+        Crc,
+        (unsigned) ((UINTN) Data & (PAGE_SIZE - 1)),
+        (unsigned) DataSize,
+        Result,
+        Expected
+        );
+    }
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINTN   Cases;
+  UINTN   Index;
+  UINTN   Len;
+  UINTN   Offset;
+  UINT32  Crc;
+  UINT8   *Area;
+
+  Cases        = (argc > 1) ? strtoul (argv[1], NULL, 0) : 2000;
+  mRandomState = (argc > 2) ? strtoull (argv[2], NULL, 0) : 1;
+  if (mRandomState == 0) {
+    mRandomState = 1;
+  }
+
+  Area = mmap (NULL, DATA_SIZE + PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (Area == MAP_FAILED || mprotect (Area + DATA_SIZE, PAGE_SIZE, PROT_NONE) != 0) {
+    printf ("Failed to allocate the test buffers\n");
+    return 1;
+  }
+  mData = Area;
+  for (Index = 0; Index < DATA_SIZE / sizeof (UINT64); Index++) {
+    ((UINT64 *) mData)[Index] = Random ();
+  }
+
+  RuntimeDriverInitializeCrc32Table ();
+  mPclmulSupported = mCrc32PclmulSupported;
+  printf ("PCLMULQDQ %s\n", mPclmulSupported ? "tested" : "not supported by the host, not tested");
+
+  //
+  // Every length up to 4KB at every start alignment, the CRC of each length
+  // is the one of the previous length updated with one more byte
+  //
+  for (Offset = 0; Offset < MAX_OFFSET; Offset++) {
+    Crc = 0xffffffff;
+    for (Len = 0; Len <= MAX_ORDERED_LENGTH; Len++) {
+      CheckCrc32 (mData + Offset, Len, Crc ^ 0xffffffff);
+      Crc = ReferenceCrc32 (Crc, mData + Offset + Len, 1);
+    }
+  }
+
+  //
+  // Every length up to 4KB at every start alignment within 16 bytes,
+  // ending at the guard page
+  //
+  for (Len = 0; Len <= MAX_ORDERED_LENGTH; Len++) {
+    for (Offset = 0; Offset < 16; Offset++) {
+      CheckCrc32 (
+        mData + DATA_SIZE - Len - Offset,
+        Len,
+        ReferenceCrc32 (0xffffffff, mData + DATA_SIZE - Len - Offset, Len) ^ 0xffffffff
+        );
+    }
+  }
+
+  //
+  // Random lengths up to the whole area and random offsets, ending at the
+  // guard page
+  //
+  for (Index = 0; Index < Cases; Index++) {
+    Len    = (UINTN) (Random () % ((Index % 2 == 0) ? SIZE_64KB : (DATA_SIZE - MAX_OFFSET)));
+    Offset = (UINTN) (Random () % MAX_OFFSET);
+    CheckCrc32 (
+      mData + DATA_SIZE - Len - Offset,
+      Len,
+      ReferenceCrc32 (0xffffffff, mData + DATA_SIZE - Len - Offset, Len) ^ 0xffffffff
+      );
+  }
+
+  //
+  // The update routines with random running CRC values. InternalCrc32Pclmul()
+  // takes 16-byte aligned buffers of a multiple of 16 bytes, at least 64.
+  //
+  for (Index = 0; Index < Cases; Index++) {
+    Len    = (UINTN) (Random () % (MAX_ORDERED_LENGTH + 1));
+    Offset = (UINTN) (Random () % MAX_OFFSET);
+    CheckUpdate ("Slice8", (UINT32) Random (), mData + DATA_SIZE - Len - Offset, Len);
+
+    if (mPclmulSupported) {
+      Len = 64 + 16 * (UINTN) (Random () % ((MAX_ORDERED_LENGTH - 64) / 16 + 1));
+      CheckUpdate ("PCLMULQDQ", (UINT32) Random (), mData + DATA_SIZE - Len - 16 * (Offset / 16), Len);
+    }
+  }
+
+  printf ("RuntimeDriverCalculateCrc32: %u random test cases, %u failures\n", (unsigned) Cases, (unsigned) mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+/** @file
+  SMI handler profile data structure and communication interface.
+
+  When PcdSmiHandlerProfilePropertyMask enables it, the SMM Core counts the
+  calls of every SMI handler and measures their execution time. The profile can
+  be retrieved from outside SMM through the SMM communication buffer.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _SMI_HANDLER_PROFILE_H_
+#define _SMI_HANDLER_PROFILE_H_
+
+//
+// SMI handler profile data layout
+//
+// +----------------------------------+
+// | SMI_HANDLER_PROFILE_CONTEXT      |
+// +----------------------------------+
+// | SMI_HANDLER_PROFILE_HANDLER(1)   |
+// +----------------------------------+
+// | SMI_HANDLER_PROFILE_HANDLER(n)   |
+// +----------------------------------+
+//
+
+#define SMI_HANDLER_PROFILE_CONTEXT_SIGNATURE SIGNATURE_32 ('S','H','P','C')
+#define SMI_HANDLER_PROFILE_CONTEXT_REVISION 0x0001
+
+typedef struct {
+  UINT32                            Signature;
+  UINT16                            Length;
+  UINT16                            Revision;
+  //
+  // Number of SMI_HANDLER_PROFILE_HANDLER structures following the context.
+  //
+  UINT32                            HandlerCount;
+  UINT32                            Reserved;
+} SMI_HANDLER_PROFILE_CONTEXT;
+
+#define SMI_HANDLER_PROFILE_HANDLER_SIGNATURE SIGNATURE_32 ('S','H','P','H')
+#define SMI_HANDLER_PROFILE_HANDLER_REVISION 0x0001
+
+typedef struct {
+  UINT32                            Signature;
+  UINT16                            Length;
+  UINT16                            Revision;
+  //
+  // The handler type, or zero GUID for root SMI handlers.
+  //
+  EFI_GUID                          HandlerType;
+  //
+  // The entry point of the handler.
+  //
+  PHYSICAL_ADDRESS                  Handler;
+  UINT64                            CallCount;
+  //
+  // Total and maximum execution time of the handler, in nanoseconds.
+  //
+  UINT64                            TotalTime;
+  UINT64                            MaxTime;
+} SMI_HANDLER_PROFILE_HANDLER;
+
+//
+// SMI handler profile command
+//
+#define SMI_HANDLER_PROFILE_COMMAND_GET_INFO            0x1
+#define SMI_HANDLER_PROFILE_COMMAND_GET_DATA_BY_OFFSET  0x2
+#define SMI_HANDLER_PROFILE_COMMAND_RESET               0x3
+
+typedef struct {
+  UINT32                            Command;
+  UINT32                            DataLength;
+  UINT64                            ReturnStatus;
+} SMI_HANDLER_PROFILE_PARAMETER_HEADER;
+
+typedef struct {
+  SMI_HANDLER_PROFILE_PARAMETER_HEADER  Header;
+  UINT64                                DataSize;
+} SMI_HANDLER_PROFILE_PARAMETER_GET_INFO;
+
+typedef struct {
+  SMI_HANDLER_PROFILE_PARAMETER_HEADER  Header;
+  //
+  // On input, data buffer size.
+  // On output, actual data size copied.
+  //
+  UINT64                                DataSize;
+  PHYSICAL_ADDRESS                      DataBuffer;
+  //
+  // On input, data offset to copy.
+  // On output, next time data offset to copy.
+  //
+  UINT64                                DataOffset;
+} SMI_HANDLER_PROFILE_PARAMETER_GET_DATA_BY_OFFSET;
+
+#define EDKII_SMI_HANDLER_PROFILE_GUID { \
+  0xbc7957e1, 0x07dd, 0x43fa, { 0x9c, 0x7f, 0x13, 0x8a, 0x35, 0xaa, 0x2b, 0xa4 } \
+}
+
+extern EFI_GUID gEdkiiSmiHandlerProfileGuid;
+
+#endif
@@ -0,0 +1,46 @@
+/** @file
+  Provides services to clear large memory ranges, for example when the OS sets
+  MOR_CLEAR_MEMORY_BIT in the MemoryOverwriteRequestControl variable.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __MEMORY_CLEAR_LIB_H__
+#define __MEMORY_CLEAR_LIB_H__
+
+/**
+  Fill a physical memory range with zeros.
+
+  The range is split into chunks that are cleared by all the enabled processors
+  in parallel when MP services are available, otherwise by the BSP only. The
+  chunks are cleared with ZeroMem(), so a platform gets non-temporal stores by
+  linking this library with a BaseMemoryLib instance using them, for example
+  BaseMemoryLibSse2.
+
+  The caller must ensure the range is accessible by all processors and does not
+  contain any code or data in use, including the stacks of the processors.
+
+  @param[in]  BaseAddress       Start address of the memory range.
+  @param[in]  Length            Length in bytes of the memory range.
+
+  @retval EFI_SUCCESS           The memory range is cleared.
+  @retval EFI_INVALID_PARAMETER BaseAddress + Length overflows.
+  @retval EFI_UNSUPPORTED       The memory range is not addressable by the processor
+                                in the current execution mode.
+**/
+EFI_STATUS
+EFIAPI
+MemoryClear (
+  IN EFI_PHYSICAL_ADDRESS           BaseAddress,
+  IN UINT64                         Length
+  );
+
+#endif
@@ -0,0 +1,189 @@
+/** @file
+  Provides services to run many small tasks on all the enabled processors.
+
+  Every processor owns a deque of tasks: new tasks are pushed to and popped
+  from the bottom of the deque of the submitting processor, and idle
+  processors steal from the top of the other deques. Tasks may submit more
+  tasks and wait for them, so divide-and-conquer algorithms (decompression,
+  hashing, memory test and clear) can share the same pool. The BSP runs tasks
+  alongside the APs.
+
+  Task procedures run on the APs and must follow the EFI_AP_PROCEDURE rules:
+  they must not call any UEFI, DXE or PEI service.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __MP_TASK_POOL_LIB_H__
+#define __MP_TASK_POOL_LIB_H__
+
+#include <Pi/PiMultiPhase.h>
+
+///
+/// Opaque task pool handle.
+///
+typedef struct _MP_TASK_POOL MP_TASK_POOL;
+
+///
+/// Handle of a submitted task, used to wait for its completion.
+///
+typedef UINTN MP_TASK_FUTURE;
+
+/**
+  The procedure run by MpTaskPoolParallelFor() for each sub-range.
+
+  @param[in]  Begin       The first index of the sub-range.
+  @param[in]  End         The index following the last index of the sub-range.
+  @param[in]  Context     The context passed to MpTaskPoolParallelFor().
+
+**/
+typedef
+VOID
+(EFIAPI *MP_TASK_RANGE_PROCEDURE)(
+  IN UINTN  Begin,
+  IN UINTN  End,
+  IN VOID   *Context
+  );
+
+/**
+  Create a task pool.
+
+  The pool uses all the processors enabled in the MP services. If the MP
+  services are not available, the tasks are run by the BSP.
+
+  This function must be called on the BSP.
+
+  @param[in]  MaxTasks    The maximum number of tasks queued or running at the
+                          same time.
+  @param[out] Pool        Returns the new task pool.
+
+  @retval EFI_SUCCESS            The pool is created.
+  @retval EFI_INVALID_PARAMETER  MaxTasks is 0 or larger than MAX_UINT32, or
+                                 Pool is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to create the pool.
+
+**/
+EFI_STATUS
+EFIAPI
+MpTaskPoolCreate (
+  IN  UINTN         MaxTasks,
+  OUT MP_TASK_POOL  **Pool
+  );
+
+/**
+  Destroy a task pool. No task may be queued or running.
+
+  This function must be called on the BSP.
+
+  @param[in]  Pool        The task pool to destroy.
+
+**/
+VOID
+EFIAPI
+MpTaskPoolDestroy (
+  IN MP_TASK_POOL   *Pool
+  );
+
+/**
+  Submit a task to the pool.
+
+  The task is queued on the deque of the calling processor. Tasks submitted by
+  the BSP outside of MpTaskPoolRun() start when MpTaskPoolRun(),
+  MpTaskPoolWait() or MpTaskPoolParallelFor() is called.
+
+  If the pool is full and no future is requested, the task is run by the
+  caller before this function returns.
+
+  @param[in]  Pool              The task pool.
+  @param[in]  Procedure         The procedure to run.
+  @param[in]  ProcedureArgument The parameter passed into Procedure.
+  @param[out] Future            Optional. Returns the handle to pass to
+                                MpTaskPoolWait(). A task with a future keeps
+                                its pool entry until MpTaskPoolWait() is called.
+
+  @retval EFI_SUCCESS            The task is queued, or has been run.
+  @retval EFI_INVALID_PARAMETER  Pool or Procedure is NULL.
+  @retval EFI_OUT_OF_RESOURCES   The pool is full and Future is not NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MpTaskPoolSubmit (
+  IN  MP_TASK_POOL      *Pool,
+  IN  EFI_AP_PROCEDURE  Procedure,
+  IN  VOID              *ProcedureArgument OPTIONAL,
+  OUT MP_TASK_FUTURE    *Future OPTIONAL
+  );
+
+/**
+  Wait until a task has completed, and release its future.
+
+  The caller runs queued tasks while it waits. On the BSP outside of
+  MpTaskPoolRun(), this runs the pool until it is empty.
+
+  @param[in]  Pool        The task pool.
+  @param[in]  Future      The future returned by MpTaskPoolSubmit().
+
+**/
+VOID
+EFIAPI
+MpTaskPoolWait (
+  IN MP_TASK_POOL   *Pool,
+  IN MP_TASK_FUTURE Future
+  );
+
+/**
+  Run all the queued tasks, and the tasks they submit, on the BSP and on all
+  the enabled APs, and return once the pool is empty.
+
+  This function must be called on the BSP, outside of a task.
+
+  @param[in]  Pool        The task pool.
+
+**/
+VOID
+EFIAPI
+MpTaskPoolRun (
+  IN MP_TASK_POOL   *Pool
+  );
+
+/**
+  Run Procedure over the index range [Begin, End) split in sub-ranges of
+  Grain indexes, on all the enabled processors, and return once every
+  sub-range has been processed.
+
+  May be called on the BSP outside of MpTaskPoolRun(), or from a task.
+
+  @param[in]  Pool        The task pool.
+  @param[in]  Begin       The first index.
+  @param[in]  End         The index following the last index.
+  @param[in]  Grain       The number of indexes per sub-range. 0 lets the
+                          library choose.
+  @param[in]  Procedure   The procedure to run for each sub-range.
+  @param[in]  Context     The context passed into Procedure.
+
+  @return The number of processors that processed at least one sub-range. A
+          processor that picks up sub-ranges of this loop again while it
+          waits in a nested parallel for loop may be counted more than once.
+
+**/
+UINTN
+EFIAPI
+MpTaskPoolParallelFor (
+  IN MP_TASK_POOL             *Pool,
+  IN UINTN                    Begin,
+  IN UINTN                    End,
+  IN UINTN                    Grain,
+  IN MP_TASK_RANGE_PROCEDURE  Procedure,
+  IN VOID                     *Context OPTIONAL
+  );
+
+#endif
@@ -0,0 +1,92 @@
+/** @file
+  The AP Task Protocol lets DXE drivers run slow, self-contained parts of their
+  initialization (link training, spin-up waits, firmware downloads) on the
+  application processors while the DXE dispatcher keeps loading other drivers
+  on the BSP.
+
+  A task procedure runs on an AP and therefore must not call any UEFI or DXE
+  service, and must only touch memory and devices it owns. Everything that
+  needs boot services is done in the notification function of the completion
+  event, which always runs on the BSP. Drivers opt in simply by consuming this
+  protocol; the DXE dispatcher waits for all submitted tasks to finish before
+  it concludes that no more drivers can be dispatched.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under
+the terms and conditions of the BSD License that accompanies this distribution.
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __AP_TASK_H__
+#define __AP_TASK_H__
+
+#include <Pi/PiMultiPhase.h>
+
+//
+// GUID for EDKII AP Task Protocol
+//
+#define EDKII_AP_TASK_PROTOCOL_GUID \
+  { 0x1d1f178f, 0xa497, 0x4b64, { 0x95, 0xf7, 0x33, 0xab, 0xb0, 0xd0, 0x0b, 0x11 } }
+
+typedef struct _EDKII_AP_TASK_PROTOCOL EDKII_AP_TASK_PROTOCOL;
+
+/**
+  Queue a task to run on the next idle AP.
+
+  If no AP is available at all, the task is run on the BSP before this
+  function returns. In both cases CompletionEvent is signaled on the BSP once
+  Procedure has returned.
+
+  @param This              The pointer to this protocol instance.
+  @param Name              A short description of the task, used for the
+                           per-CPU timeline report. It is copied.
+  @param Procedure         The AP-safe procedure to run.
+  @param ProcedureArgument The parameter passed into Procedure.
+  @param CompletionEvent   The event to signal on the BSP when Procedure has
+                           returned. Optional.
+
+  @retval EFI_SUCCESS            The task was queued or has completed.
+  @retval EFI_INVALID_PARAMETER  Name or Procedure is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to queue the task.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_AP_TASK_SUBMIT)(
+  IN EDKII_AP_TASK_PROTOCOL  *This,
+  IN CONST CHAR8             *Name,
+  IN EFI_AP_PROCEDURE        Procedure,
+  IN VOID                    *ProcedureArgument OPTIONAL,
+  IN EFI_EVENT               CompletionEvent OPTIONAL
+  );
+
+/**
+  Wait until every submitted task has completed and its completion event has
+  been signaled.
+
+  This function must be called on the BSP below TPL_CALLBACK.
+
+  @param This              The pointer to this protocol instance.
+
+  @return The number of tasks that were still queued or running on entry.
+
+**/
+typedef
+UINTN
+(EFIAPI *EDKII_AP_TASK_WAIT_ALL)(
+  IN EDKII_AP_TASK_PROTOCOL  *This
+  );
+
+struct _EDKII_AP_TASK_PROTOCOL {
+  EDKII_AP_TASK_SUBMIT    Submit;
+  EDKII_AP_TASK_WAIT_ALL  WaitAll;
+};
+
+extern EFI_GUID gEdkiiApTaskProtocolGuid;
+
+#endif
@@ -1641,9 +1641,84 @@ NetbufQueFlush (
 }
 
 
+#if defined (MDE_CPU_X64)
+//
+// Buffers shorter than these are summed by the portable code, or by SSE2
+// instead of AVX2.
+//
+#define NET_CHECKSUM_SSE2_MIN_SIZE  64
+#define NET_CHECKSUM_AVX2_MIN_SIZE  256
+
+#define NET_CHECKSUM_SIMD_UNKNOWN   0
+#define NET_CHECKSUM_SIMD_NONE      1
+#define NET_CHECKSUM_SIMD_SSE2      2
+#define NET_CHECKSUM_SIMD_AVX2      3
+
+//
+// The widest instruction set NetblockChecksum() may use, found on first use.
+//
+UINT8  mNetChecksumSimd = NET_CHECKSUM_SIMD_UNKNOWN;
+
+/**
+  Sum the 16-bit words of a buffer with SSE2.
+
+  @param[in]   Bulk                  Pointer to the data.
+  @param[in]   Length                Length of the data, a non-zero multiple of 32.
+
+  @return    The sum of the 16-bit words, not folded.
+
+**/
+UINT64
+EFIAPI
+InternalNetChecksumSse2 (
+  IN CONST UINT8            *Bulk,
+  IN UINTN                  Length
+  );
+
+/**
+  Sum the 16-bit words of a buffer with AVX2.
+
+  @param[in]   Bulk                  Pointer to the data.
+  @param[in]   Length                Length of the data, a non-zero multiple of 64.
+
+  @return    The sum of the 16-bit words, not folded.
+
+**/
+UINT64
+EFIAPI
+InternalNetChecksumAvx2 (
+  IN CONST UINT8            *Bulk,
+  IN UINTN                  Length
+  );
+
+/**
+  Check whether the processor supports AVX2 and the YMM state is enabled.
+
+  @retval TRUE     AVX2 instructions can be executed.
+  @retval FALSE    AVX2 instructions cannot be executed.
+
+**/
+BOOLEAN
+EFIAPI
+InternalNetIsAvx2Supported (
+  VOID
+  );
+#endif
+
 /**
   Compute the checksum for a bulk of data.
 
+  The ones'-complement sum is accumulated 32 bits at a time into a 64-bit
+  accumulator and folded once at the end. Since 2^16 is congruent to 1 modulo
+  0xFFFF, summing aligned 32-bit words gives the same folded result as summing
+  16-bit words. A leading odd byte is handled by summing the byte-swapped
+  stream and swapping the final result back (RFC 1071, section 2(B)).
+
+  On X64, the bulk of a large buffer is summed with SSE2, or with AVX2 when
+  the processor supports it and interrupts are enabled. Interrupt handlers
+  only save the legacy SSE state, so code running with interrupts disabled
+  may have interrupted an AVX loop and must leave the YMM registers alone.
+
   @param[in]   Bulk                  Pointer to the data.
   @param[in]   Len                   Length of the data, in bytes.
 
@@ -1657,14 +1732,78 @@ NetblockChecksum (
   IN UINT32                 Len
   )
 {
-  register UINT32           Sum;
+  UINT64                    Sum;
+  BOOLEAN                   Swapped;
+#if defined (MDE_CPU_X64)
+  UINT32                    Size;
+#endif
+
+  Sum     = 0;
+  Swapped = FALSE;
+
+  //
+  // Align the data to a 16-bit boundary. The first byte lands in the high
+  // half of a 16-bit word of the shifted stream, so the result gets swapped.
+  //
+  if ((((UINTN) Bulk & 0x01) != 0) && (Len > 0)) {
+    Sum     = (UINT64) (*Bulk) << 8;
+    Swapped = TRUE;
+    Bulk   += 1;
+    Len    -= 1;
+  }
+
+#if defined (MDE_CPU_X64)
+  if (Len >= NET_CHECKSUM_SSE2_MIN_SIZE) {
+    if (mNetChecksumSimd == NET_CHECKSUM_SIMD_UNKNOWN) {
+      mNetChecksumSimd = InternalNetIsAvx2Supported () ? NET_CHECKSUM_SIMD_AVX2 : NET_CHECKSUM_SIMD_SSE2;
+    }
 
-  Sum = 0;
+    Size = 0;
+    if ((mNetChecksumSimd == NET_CHECKSUM_SIMD_AVX2) && (Len >= NET_CHECKSUM_AVX2_MIN_SIZE) &&
+        GetInterruptState ()) {
+      Size = Len & ~((UINT32) 0x3F);
+      Sum += InternalNetChecksumAvx2 (Bulk, Size);
+    } else if (mNetChecksumSimd != NET_CHECKSUM_SIMD_NONE) {
+      Size = Len & ~((UINT32) 0x1F);
+      Sum += InternalNetChecksumSse2 (Bulk, Size);
+    }
+    Bulk += Size;
+    Len  -= Size;
+  }
+#endif
 
-  while (Len > 1) {
-    Sum += *(UINT16 *) Bulk;
+  //
+  // Align the data to a 32-bit boundary.
+  //
+  if ((((UINTN) Bulk & 0x02) != 0) && (Len > 1)) {
+    Sum  += *(UINT16 *) Bulk;
     Bulk += 2;
-    Len -= 2;
+    Len  -= 2;
+  }
+
+  //
+  // Main loop, 16 bytes per iteration. A UINT64 can absorb 2^32 additions of
+  // UINT32 values without overflowing, which is more than Len allows.
+  //
+  while (Len >= 16) {
+    Sum  += ((UINT32 *) Bulk)[0];
+    Sum  += ((UINT32 *) Bulk)[1];
+    Sum  += ((UINT32 *) Bulk)[2];
+    Sum  += ((UINT32 *) Bulk)[3];
+    Bulk += 16;
+    Len  -= 16;
+  }
+
+  while (Len >= 4) {
+    Sum  += *(UINT32 *) Bulk;
+    Bulk += 4;
+    Len  -= 4;
+  }
+
+  if (Len > 1) {
+    Sum  += *(UINT16 *) Bulk;
+    Bulk += 2;
+    Len  -= 2;
   }
 
   //
@@ -1675,11 +1814,14 @@ NetblockChecksum (
   }
 
   //
-  // Fold 32-bit sum to 16 bits
+  // Fold 64-bit sum to 16 bits
   //
   while ((Sum >> 16) != 0) {
     Sum = (Sum & 0xffff) + (Sum >> 16);
+  }
 
+  if (Swapped) {
+    return SwapBytes16 ((UINT16) Sum);
   }
 
   return (UINT16) Sum;
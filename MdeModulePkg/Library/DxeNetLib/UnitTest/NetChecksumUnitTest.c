@@ -0,0 +1,239 @@
+/** @file
+  Host differential test of NetblockChecksum() of DxeNetLib.
+
+  NetBuffer.c and the X64 SSE2 and AVX2 routines are built with the host tools.
+  Every test case compares NetblockChecksum() with a byte-by-byte reference
+  implementation of the RFC 1071 sum, with the portable code, the SSE2 routine
+  and, when the host supports it, the AVX2 routine forced in turn. The buffers
+  cover every length up to 4KB at every start offset within 64 bytes, random
+  lengths up to 256KB, and buffers of 0xFF bytes of up to 4MB that carry on
+  every addition. They are placed against an inaccessible guard page, so that
+  a routine reading past the end of a buffer faults.
+
+  Usage: NetChecksumUnitTest [RandomTestCaseCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#undef NULL
+
+#include <Uefi.h>
+#include <Library/NetLib.h>
+
+#define PAGE_SIZE          SIZE_4KB
+#define DATA_SIZE          SIZE_4MB
+#define MAX_OFFSET         64
+#define MAX_ORDERED_LENGTH SIZE_4KB
+#define MAX_RANDOM_LENGTH  SIZE_256KB
+
+#define NET_CHECKSUM_SIMD_NONE      1
+#define NET_CHECKSUM_SIMD_SSE2      2
+#define NET_CHECKSUM_SIMD_AVX2      3
+
+extern UINT8  mNetChecksumSimd;
+
+BOOLEAN
+EFIAPI
+InternalNetIsAvx2Supported (
+  VOID
+  );
+
+//
+// The data area, followed by an inaccessible page
+//
+UINT8    *mData;
+BOOLEAN  mInterruptState;
+UINT64   mRandomState;
+UINTN    mFailures;
+
+/**
+  Return the interrupt state that the test case simulates. AVX2 is only used
+  with interrupts enabled.
+**/
+BOOLEAN
+EFIAPI
+GetInterruptState (
+  VOID
+  )
+{
+  return mInterruptState;
+}
+
+UINT16
+EFIAPI
+SwapBytes16 (
+  IN      UINT16                    Value
+  )
+{
+  return (UINT16) ((Value << 8) | (Value >> 8));
+}
+
+/**
+  Return a pseudo random number, xorshift64*.
+**/
+UINT64
+Random (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState >> 12;
+  mRandomState ^= mRandomState << 25;
+  mRandomState ^= mRandomState >> 27;
+  return mRandomState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+  The reference ones'-complement sum of RFC 1071, a byte at a time, of the
+  16-bit little endian words of the buffer, as NetblockChecksum() returns it.
+**/
+UINT16
+ReferenceChecksum (
+  IN CONST UINT8  *Bulk,
+  IN UINT32       Len
+  )
+{
+  UINT64  Sum;
+  UINT32  Index;
+
+  Sum = 0;
+  for (Index = 0; Index + 1 < Len; Index += 2) {
+    Sum += Bulk[Index] | (Bulk[Index + 1] << 8);
+  }
+  if ((Len & 1) != 0) {
+    Sum += Bulk[Len - 1];
+  }
+  while ((Sum >> 16) != 0) {
+    Sum = (Sum & 0xffff) + (Sum >> 16);
+  }
+  return (UINT16) Sum;
+}
+
+/**
+  Check NetblockChecksum() for a buffer with every code path that the host
+  can run.
+**/
+VOID
+CheckChecksum (
+  IN UINT8   *Bulk,
+  IN UINT32  Len
+  )
+{
+  static CONST UINT8  Modes[] = { NET_CHECKSUM_SIMD_NONE, NET_CHECKSUM_SIMD_SSE2, NET_CHECKSUM_SIMD_AVX2 };
+  static BOOLEAN      Avx2Checked;
+  static BOOLEAN      Avx2Supported;
+  UINT16              Expected;
+  UINT16              Result;
+  UINTN               Index;
+  UINTN               State;
+
+  if (!Avx2Checked) {
+    Avx2Checked   = TRUE;
+    Avx2Supported = InternalNetIsAvx2Supported ();
+    printf ("AVX2 %s\n", Avx2Supported ? "tested" : "not supported by the host, not tested");
+  }
+
+  Expected = ReferenceChecksum (Bulk, Len);
+  for (Index = 0; Index < sizeof (Modes); Index++) {
+    if (Modes[Index] == NET_CHECKSUM_SIMD_AVX2 && !Avx2Supported) {
+      continue;
+    }
+    for (State = 0; State < 2; State++) {
+      mNetChecksumSimd = Modes[Index];
+      mInterruptState  = (BOOLEAN) State;
+      Result = NetblockChecksum (Bulk, Len);
+      if (Result != Expected) {
+        if (mFailures++ < 10) {
+          printf (
+            "Mode %u, interrupts %s, offset %u, length %u: 0x%04x, expected 0x%04x\n",
+            Modes[Index],
+            State ? "on" : "off",
+            (unsigned) ((UINTN) Bulk & (PAGE_SIZE - 1)),
+            (unsigned) Len,
+            Result,
+            Expected
+            );
+        }
+      }
+    }
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINTN   Cases;
+  UINTN   Index;
+  UINT32  Len;
+  UINT32  Offset;
+  UINT8   *Area;
+
+  Cases        = (argc > 1) ? strtoul (argv[1], NULL, 0) : 2000;
+  mRandomState = (argc > 2) ? strtoull (argv[2], NULL, 0) : 1;
+  if (mRandomState == 0) {
+    mRandomState = 1;
+  }
+
+  Area = mmap (NULL, DATA_SIZE + PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (Area == MAP_FAILED || mprotect (Area + DATA_SIZE, PAGE_SIZE, PROT_NONE) != 0) {
+    printf ("Failed to allocate the test buffers\n");
+    return 1;
+  }
+  mData = Area;
+
+  //
+  // Every length up to 4KB at every offset, ending at the guard page
+  //
+  for (Index = 0; Index < DATA_SIZE / sizeof (UINT64); Index++) {
+    ((UINT64 *) mData)[Index] = Random ();
+  }
+  for (Len = 0; Len <= MAX_ORDERED_LENGTH; Len++) {
+    for (Offset = 0; Offset < MAX_OFFSET; Offset++) {
+      CheckChecksum (mData + DATA_SIZE - Len - Offset, Len);
+    }
+  }
+
+  //
+  // Random lengths and offsets, with random runs of 0xFF and 0x00 bytes so
+  // that the sums carry, or not, over long stretches
+  //
+  for (Index = 0; Index < Cases; Index++) {
+    Len    = (UINT32) (Random () % (MAX_RANDOM_LENGTH + 1));
+    Offset = (UINT32) (Random () % MAX_OFFSET);
+    if (Random () % 4 == 0) {
+      memset (mData + DATA_SIZE - Len - Offset, (Random () % 2 == 0) ? 0xFF : 0x00, Len);
+      mData[DATA_SIZE - Len - Offset + Random () % (Len + 1)] = (UINT8) Random ();
+    }
+    CheckChecksum (mData + DATA_SIZE - Len - Offset, Len);
+  }
+
+  //
+  // Carries on every addition, up to the whole area
+  //
+  memset (mData, 0xFF, DATA_SIZE);
+  for (Len = SIZE_64KB - 3; Len <= DATA_SIZE; Len = Len * 2 + 1) {
+    for (Offset = 0; Offset < 2 && Offset + Len <= DATA_SIZE; Offset++) {
+      CheckChecksum (mData + DATA_SIZE - Len - Offset, Len);
+    }
+  }
+  mData[DATA_SIZE - 1] = 0xFE;
+  CheckChecksum (mData, DATA_SIZE);
+  CheckChecksum (mData + 1, DATA_SIZE - 1);
+
+  printf ("NetblockChecksum: %u random test cases, %u failures\n", (unsigned) Cases, (unsigned) mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
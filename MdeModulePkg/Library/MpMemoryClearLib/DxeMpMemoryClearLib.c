@@ -0,0 +1,97 @@
+/** @file
+  DXE instance of the MP memory clear library, based on EFI_MP_SERVICES_PROTOCOL.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <PiDxe.h>
+
+#include <Protocol/MpService.h>
+
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "MpMemoryClearLibInternal.h"
+
+/**
+  Run MemoryClearWorker() on the BSP and on the enabled APs, and return once
+  every chunk is cleared.
+
+  The APs are started in non-blocking mode, so the BSP clears chunks at the
+  same time. The MP services detect the AP completion from a TPL_NOTIFY timer
+  event, so a caller running at TPL_NOTIFY or above starts the APs in blocking
+  mode instead, and the BSP only clears the chunks the APs left.
+
+  @param[in, out]  Context      The memory clear context.
+**/
+VOID
+MemoryClearRunAllProcessors (
+  IN OUT MEMORY_CLEAR_CONTEXT       *Context
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_MP_SERVICES_PROTOCOL          *MpService;
+  EFI_EVENT                         WaitEvent;
+  EFI_TPL                           OldTpl;
+
+  WaitEvent = NULL;
+  Status    = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &MpService);
+  if (!EFI_ERROR (Status)) {
+    OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    gBS->RestoreTPL (OldTpl);
+    if (OldTpl < TPL_NOTIFY) {
+      Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &WaitEvent);
+      if (EFI_ERROR (Status)) {
+        WaitEvent = NULL;
+      }
+    }
+
+    Status = MpService->StartupAllAPs (
+                          MpService,
+                          MemoryClearWorker,
+                          FALSE,
+                          WaitEvent,
+                          0,
+                          Context,
+                          NULL
+                          );
+    if (Status == EFI_UNSUPPORTED && WaitEvent != NULL) {
+      //
+      // The non-blocking mode is not available after ReadyToBoot.
+      //
+      gBS->CloseEvent (WaitEvent);
+      WaitEvent = NULL;
+      Status = MpService->StartupAllAPs (
+                            MpService,
+                            MemoryClearWorker,
+                            FALSE,
+                            NULL,
+                            0,
+                            Context,
+                            NULL
+                            );
+    }
+  }
+
+  //
+  // The BSP clears chunks until none is left, everything if the APs could not
+  // be started (no MP services, or a single processor system).
+  //
+  MemoryClearWorker (Context);
+
+  if (WaitEvent != NULL) {
+    if (!EFI_ERROR (Status)) {
+      while (gBS->CheckEvent (WaitEvent) == EFI_NOT_READY) {
+        CpuPause ();
+      }
+    }
+    gBS->CloseEvent (WaitEvent);
+  }
+}
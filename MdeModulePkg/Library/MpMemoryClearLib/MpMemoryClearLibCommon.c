@@ -0,0 +1,136 @@
+/** @file
+  Processor independent part of the MP memory clear library.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "MpMemoryClearLibInternal.h"
+
+/**
+  Clear the chunks of a memory range until none is left.
+
+  Runs on every processor taking part in the clear: each processor claims the
+  next chunk atomically, so the range is cleared exactly once.
+
+  @param[in, out]  Buffer       Pointer to the MEMORY_CLEAR_CONTEXT.
+**/
+VOID
+EFIAPI
+MemoryClearWorker (
+  IN OUT VOID                       *Buffer
+  )
+{
+  MEMORY_CLEAR_CONTEXT              *Context;
+  UINT32                            Chunk;
+  EFI_PHYSICAL_ADDRESS              Address;
+  UINT64                            Size;
+  BOOLEAN                           Counted;
+
+  Context = (MEMORY_CLEAR_CONTEXT *) Buffer;
+  Counted = FALSE;
+  while (TRUE) {
+    Chunk = InterlockedIncrement (&Context->NextChunk) - 1;
+    if (Chunk >= Context->ChunkCount) {
+      break;
+    }
+    if (!Counted) {
+      InterlockedIncrement (&Context->Processors);
+      Counted = TRUE;
+    }
+
+    Address = Context->BaseAddress + MultU64x32 (MEMORY_CLEAR_CHUNK_SIZE, Chunk);
+    Size    = MIN (MEMORY_CLEAR_CHUNK_SIZE, Context->BaseAddress + Context->Length - Address);
+    if (Address == 0) {
+      //
+      // ZeroMem() generates an ASSERT() if Buffer parameter is NULL.
+      // Clear byte at 0 and start clear operation at address 1.
+      //
+      *(volatile UINT8 *) (UINTN) 0 = 0;
+      Address++;
+      Size--;
+    }
+    if (Size != 0) {
+      ZeroMem ((VOID *) (UINTN) Address, (UINTN) Size);
+    }
+  }
+}
+
+/**
+  Fill a physical memory range with zeros.
+
+  The range is split into chunks that are cleared by all the enabled processors
+  in parallel when MP services are available, otherwise by the BSP only. The
+  chunks are cleared with ZeroMem(), so a platform gets non-temporal stores by
+  linking this library with a BaseMemoryLib instance using them, for example
+  BaseMemoryLibSse2.
+
+  The caller must ensure the range is accessible by all processors and does not
+  contain any code or data in use, including the stacks of the processors.
+
+  @param[in]  BaseAddress       Start address of the memory range.
+  @param[in]  Length            Length in bytes of the memory range.
+
+  @retval EFI_SUCCESS           The memory range is cleared.
+  @retval EFI_INVALID_PARAMETER BaseAddress + Length overflows.
+  @retval EFI_UNSUPPORTED       The memory range is not addressable by the processor
+                                in the current execution mode.
+**/
+EFI_STATUS
+EFIAPI
+MemoryClear (
+  IN EFI_PHYSICAL_ADDRESS           BaseAddress,
+  IN UINT64                         Length
+  )
+{
+  MEMORY_CLEAR_CONTEXT              Context;
+  UINT64                            StartTicks;
+  UINT64                            EndTicks;
+  UINT64                            ElapsedUs;
+
+  if (Length == 0) {
+    return EFI_SUCCESS;
+  }
+  if (Length - 1 > MAX_UINT64 - BaseAddress) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (BaseAddress + Length - 1 > MAX_ADDRESS) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Context.BaseAddress = BaseAddress;
+  Context.Length      = Length;
+  Context.ChunkCount  = (UINT32) DivU64x32 (Length + MEMORY_CLEAR_CHUNK_SIZE - 1, MEMORY_CLEAR_CHUNK_SIZE);
+  Context.NextChunk   = 0;
+  Context.Processors  = 0;
+
+  StartTicks = GetPerformanceCounter ();
+  MemoryClearRunAllProcessors (&Context);
+  EndTicks   = GetPerformanceCounter ();
+
+  //
+  // A clear shorter than the timer resolution is accounted as 1 us.
+  //
+  ElapsedUs = DivU64x32 (GetTimeInNanoSecond (EndTicks - StartTicks), 1000);
+  if (ElapsedUs == 0) {
+    ElapsedUs = 1;
+  }
+  DEBUG ((
+    DEBUG_INFO,
+    "MemoryClear: 0x%lx - 0x%lx, %d processor(s), %ld us, %ld MB/s\n",
+    BaseAddress,
+    BaseAddress + Length - 1,
+    Context.Processors,
+    ElapsedUs,
+    RShiftU64 (DivU64x64Remainder (MultU64x32 (RShiftU64 (Length, 10), 1000000), ElapsedUs, NULL), 10)
+    ));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,72 @@
+/** @file
+  Internal definitions shared by the PEI and DXE MP memory clear library instances.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _MP_MEMORY_CLEAR_LIB_INTERNAL_H_
+#define _MP_MEMORY_CLEAR_LIB_INTERNAL_H_
+
+#include <PiPei.h>
+
+#include <Library/MemoryClearLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+
+//
+// Unit of work a processor claims at a time. Small enough to balance the load
+// between processors, large enough to keep the claiming overhead negligible.
+//
+#define MEMORY_CLEAR_CHUNK_SIZE  SIZE_64MB
+
+typedef struct {
+  EFI_PHYSICAL_ADDRESS              BaseAddress;
+  UINT64                            Length;
+  UINT32                            ChunkCount;
+  UINT32                            NextChunk;
+  //
+  // Number of processors that cleared at least one chunk.
+  //
+  UINT32                            Processors;
+} MEMORY_CLEAR_CONTEXT;
+
+/**
+  Clear the chunks of a memory range until none is left.
+
+  Runs on every processor taking part in the clear: each processor claims the
+  next chunk atomically, so the range is cleared exactly once.
+
+  @param[in, out]  Buffer       Pointer to the MEMORY_CLEAR_CONTEXT.
+**/
+VOID
+EFIAPI
+MemoryClearWorker (
+  IN OUT VOID                       *Buffer
+  );
+
+/**
+  Run MemoryClearWorker() on the BSP and on the enabled APs, and return once
+  every chunk is cleared.
+
+  Implemented by the PEI and DXE library instances on top of the MP services.
+  When the APs cannot be started, the BSP clears the whole range.
+
+  @param[in, out]  Context      The memory clear context.
+**/
+VOID
+MemoryClearRunAllProcessors (
+  IN OUT MEMORY_CLEAR_CONTEXT       *Context
+  );
+
+#endif
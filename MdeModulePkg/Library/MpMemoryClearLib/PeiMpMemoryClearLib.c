@@ -0,0 +1,58 @@
+/** @file
+  PEI instance of the MP memory clear library, based on EFI_PEI_MP_SERVICES_PPI.
+
+  The PPI is only installed once permanent memory is available, before that the
+  range is cleared by the BSP.
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "MpMemoryClearLibInternal.h"
+
+#include <Ppi/MpServices.h>
+
+#include <Library/PeiServicesLib.h>
+#include <Library/PeiServicesTablePointerLib.h>
+
+/**
+  Run MemoryClearWorker() on the BSP and on the enabled APs, and return once
+  every chunk is cleared.
+
+  StartupAllAPs() of the PPI has no non-blocking mode, so the BSP waits for the
+  APs and then clears the chunks they left, which is the whole range when the
+  APs could not be started.
+
+  @param[in, out]  Context      The memory clear context.
+**/
+VOID
+MemoryClearRunAllProcessors (
+  IN OUT MEMORY_CLEAR_CONTEXT       *Context
+  )
+{
+  EFI_STATUS                        Status;
+  CONST EFI_PEI_SERVICES            **PeiServices;
+  EFI_PEI_MP_SERVICES_PPI           *MpServices;
+
+  Status = PeiServicesLocatePpi (&gEfiPeiMpServicesPpiGuid, 0, NULL, (VOID **) &MpServices);
+  if (!EFI_ERROR (Status)) {
+    PeiServices = GetPeiServicesTablePointer ();
+    MpServices->StartupAllAPs (
+                  PeiServices,
+                  MpServices,
+                  MemoryClearWorker,
+                  FALSE,
+                  0,
+                  Context
+                  );
+  }
+
+  MemoryClearWorker (Context);
+}
@@ -0,0 +1,162 @@
+/** @file
+  DXE instance of the MP task pool library, based on EFI_MP_SERVICES_PROTOCOL.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <PiDxe.h>
+
+#include <Protocol/MpService.h>
+
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "MpTaskPoolLibInternal.h"
+
+/**
+  Locate the MP services and return the processor numbers.
+
+  @param[in, out]  Pool                 The task pool. MpServices is set.
+  @param[out]      NumberOfProcessors   The number of processors, including
+                                        the BSP and the disabled APs.
+  @param[out]      BspNumber            The processor number of the BSP.
+
+  @retval EFI_SUCCESS           The MP services are located.
+  @retval others                The MP services are not available. The tasks
+                                are run by the BSP.
+**/
+EFI_STATUS
+MpTaskPoolLocateMpServices (
+  IN OUT MP_TASK_POOL               *Pool,
+  OUT    UINTN                      *NumberOfProcessors,
+  OUT    UINTN                      *BspNumber
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_MP_SERVICES_PROTOCOL          *MpService;
+  UINTN                             NumberOfEnabledProcessors;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &MpService);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = MpService->GetNumberOfProcessors (MpService, NumberOfProcessors, &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = MpService->WhoAmI (MpService, BspNumber);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Pool->MpServices = MpService;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the processor number of the calling processor.
+
+  WhoAmI() may be called on the APs.
+
+  @param[in]  Pool              The task pool.
+
+  @return The processor number, which indexes Pool->Deques.
+**/
+UINTN
+MpTaskPoolWhoAmI (
+  IN MP_TASK_POOL                   *Pool
+  )
+{
+  EFI_MP_SERVICES_PROTOCOL          *MpService;
+  UINTN                             ProcessorNumber;
+
+  MpService = (EFI_MP_SERVICES_PROTOCOL *) Pool->MpServices;
+  if (EFI_ERROR (MpService->WhoAmI (MpService, &ProcessorNumber))) {
+    return Pool->BspNumber;
+  }
+  return ProcessorNumber;
+}
+
+/**
+  Run Procedure on the BSP and on all the enabled APs, and return once every
+  processor has returned from it.
+
+  The APs are started in non-blocking mode, so the BSP runs Procedure at the
+  same time. The MP services detect the AP completion from a TPL_NOTIFY timer
+  event, so a caller running at TPL_NOTIFY or above starts the APs in blocking
+  mode instead, and the BSP only runs Procedure once the APs are done.
+
+  @param[in]  Pool              The task pool, passed to Procedure.
+  @param[in]  Procedure         The procedure to run.
+**/
+VOID
+MpTaskPoolRunAllProcessors (
+  IN MP_TASK_POOL                   *Pool,
+  IN EFI_AP_PROCEDURE               Procedure
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_MP_SERVICES_PROTOCOL          *MpService;
+  EFI_EVENT                         WaitEvent;
+  EFI_TPL                           OldTpl;
+
+  MpService = (EFI_MP_SERVICES_PROTOCOL *) Pool->MpServices;
+  WaitEvent = NULL;
+  OldTpl    = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (OldTpl);
+  if (OldTpl < TPL_NOTIFY) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &WaitEvent);
+    if (EFI_ERROR (Status)) {
+      WaitEvent = NULL;
+    }
+  }
+
+  Status = MpService->StartupAllAPs (
+                        MpService,
+                        Procedure,
+                        FALSE,
+                        WaitEvent,
+                        0,
+                        Pool,
+                        NULL
+                        );
+  if (Status == EFI_UNSUPPORTED && WaitEvent != NULL) {
+    //
+    // The non-blocking mode is not available after ReadyToBoot.
+    //
+    gBS->CloseEvent (WaitEvent);
+    WaitEvent = NULL;
+    Status = MpService->StartupAllAPs (
+                          MpService,
+                          Procedure,
+                          FALSE,
+                          NULL,
+                          0,
+                          Pool,
+                          NULL
+                          );
+  }
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "MpTaskPool: APs not started - %r\n", Status));
+  }
+
+  Procedure (Pool);
+
+  if (WaitEvent != NULL) {
+    if (!EFI_ERROR (Status)) {
+      while (gBS->CheckEvent (WaitEvent) == EFI_NOT_READY) {
+        CpuPause ();
+      }
+    }
+    gBS->CloseEvent (WaitEvent);
+  }
+}
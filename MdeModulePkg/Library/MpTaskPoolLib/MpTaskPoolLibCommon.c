@@ -0,0 +1,673 @@
+/** @file
+  Processor independent part of the MP task pool library.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "MpTaskPoolLibInternal.h"
+
+typedef struct {
+  MP_TASK_POOL                      *Pool;
+  MP_TASK_RANGE_PROCEDURE           Procedure;
+  VOID                              *Context;
+  UINTN                             Begin;
+  UINTN                             End;
+  UINTN                             Grain;
+  UINT32                            ChunkCount;
+  UINT32                            NextChunk;
+  UINT32                            FinishedHelpers;
+  //
+  // Number of processors that processed at least one sub-range.
+  //
+  UINT32                            Processors;
+} MP_TASK_PARALLEL_FOR;
+
+/**
+  Return the deque owned by the calling processor.
+
+  @param[in]  Pool          The task pool.
+
+  @return The index of the deque.
+**/
+UINTN
+MpTaskPoolCurrentDeque (
+  IN MP_TASK_POOL                   *Pool
+  )
+{
+  UINTN                             ProcessorNumber;
+
+  if (!Pool->RegionActive || Pool->DequeCount == 1) {
+    return Pool->BspNumber;
+  }
+
+  ProcessorNumber = MpTaskPoolWhoAmI (Pool);
+  ASSERT (ProcessorNumber < Pool->DequeCount);
+  return ProcessorNumber;
+}
+
+/**
+  Take a task index from the free stack.
+
+  @param[in]  Pool          The task pool.
+  @param[out] TaskIndex     Returns the task index.
+
+  @retval TRUE              A task index is returned.
+  @retval FALSE             The pool is full.
+**/
+BOOLEAN
+MpTaskPoolAllocateTask (
+  IN  MP_TASK_POOL                  *Pool,
+  OUT UINT32                        *TaskIndex
+  )
+{
+  BOOLEAN                           Found;
+
+  AcquireSpinLock (&Pool->FreeLock);
+  Found = (BOOLEAN) (Pool->FreeCount != 0);
+  if (Found) {
+    *TaskIndex = Pool->FreeStack[--Pool->FreeCount];
+  }
+  ReleaseSpinLock (&Pool->FreeLock);
+  return Found;
+}
+
+/**
+  Return a task index to the free stack.
+
+  @param[in]  Pool          The task pool.
+  @param[in]  TaskIndex     The task index to free.
+**/
+VOID
+MpTaskPoolFreeTask (
+  IN MP_TASK_POOL                   *Pool,
+  IN UINT32                         TaskIndex
+  )
+{
+  AcquireSpinLock (&Pool->FreeLock);
+  ASSERT (Pool->FreeCount < Pool->MaxTasks);
+  Pool->FreeStack[Pool->FreeCount++] = TaskIndex;
+  ReleaseSpinLock (&Pool->FreeLock);
+}
+
+/**
+  Push a task index to the bottom of a deque.
+
+  @param[in]  Pool          The task pool.
+  @param[in]  Deque         The deque.
+  @param[in]  TaskIndex     The task index.
+**/
+VOID
+MpTaskPoolPush (
+  IN MP_TASK_POOL                   *Pool,
+  IN MP_TASK_DEQUE                  *Deque,
+  IN UINT32                         TaskIndex
+  )
+{
+  AcquireSpinLock (&Deque->Lock);
+  ASSERT (Deque->Bottom - Deque->Top < Pool->MaxTasks);
+  Deque->Ring[Deque->Bottom % Pool->MaxTasks] = TaskIndex;
+  Deque->Bottom++;
+  ReleaseSpinLock (&Deque->Lock);
+}
+
+/**
+  Pop a task index from a deque.
+
+  @param[in]  Pool          The task pool.
+  @param[in]  Deque         The deque.
+  @param[in]  Steal         TRUE to take the oldest task from the top, FALSE
+                            to take the newest task from the bottom.
+  @param[out] TaskIndex     Returns the task index.
+
+  @retval TRUE              A task index is returned.
+  @retval FALSE             The deque is empty.
+**/
+BOOLEAN
+MpTaskPoolPop (
+  IN  MP_TASK_POOL                  *Pool,
+  IN  MP_TASK_DEQUE                 *Deque,
+  IN  BOOLEAN                       Steal,
+  OUT UINT32                        *TaskIndex
+  )
+{
+  BOOLEAN                           Found;
+
+  //
+  // Peek without the lock first, so that thieves do not bounce the lock of
+  // empty deques between the processors.
+  //
+  if (*(volatile UINTN *) &Deque->Top == *(volatile UINTN *) &Deque->Bottom) {
+    return FALSE;
+  }
+
+  AcquireSpinLock (&Deque->Lock);
+  Found = (BOOLEAN) (Deque->Top != Deque->Bottom);
+  if (Found) {
+    if (Steal) {
+      *TaskIndex = Deque->Ring[Deque->Top % Pool->MaxTasks];
+      Deque->Top++;
+    } else {
+      Deque->Bottom--;
+      *TaskIndex = Deque->Ring[Deque->Bottom % Pool->MaxTasks];
+    }
+  }
+  ReleaseSpinLock (&Deque->Lock);
+  return Found;
+}
+
+/**
+  Run one task, taken from the own deque first, or stolen from another deque.
+
+  @param[in]  Pool          The task pool.
+  @param[in]  DequeIndex    The deque owned by the calling processor.
+
+  @retval TRUE              A task was run.
+  @retval FALSE             All the deques are empty.
+**/
+BOOLEAN
+MpTaskPoolRunOne (
+  IN MP_TASK_POOL                   *Pool,
+  IN UINTN                          DequeIndex
+  )
+{
+  UINT32                            TaskIndex;
+  UINTN                             Index;
+  UINTN                             Victim;
+  MP_TASK                           *Task;
+
+  if (!MpTaskPoolPop (Pool, &Pool->Deques[DequeIndex], FALSE, &TaskIndex)) {
+    Victim = DequeIndex;
+    for (Index = 1; Index < Pool->DequeCount; Index++) {
+      Victim = (Victim + 1) % Pool->DequeCount;
+      if (MpTaskPoolPop (Pool, &Pool->Deques[Victim], TRUE, &TaskIndex)) {
+        break;
+      }
+    }
+    if (Index >= Pool->DequeCount) {
+      return FALSE;
+    }
+  }
+
+  Task = &Pool->Tasks[TaskIndex];
+  Task->Procedure (Task->Argument);
+
+  if (Task->HasFuture) {
+    //
+    // Make the results of the task visible before the waiter sees Done.
+    //
+    MemoryFence ();
+    Task->Done = TRUE;
+  } else {
+    MpTaskPoolFreeTask (Pool, TaskIndex);
+  }
+  InterlockedDecrement (&Pool->Outstanding);
+  return TRUE;
+}
+
+/**
+  Procedure of the BSP and of the APs in MpTaskPoolRun(): run tasks until the
+  pool is empty.
+
+  @param[in]  Buffer        Pointer to the MP_TASK_POOL.
+**/
+VOID
+EFIAPI
+MpTaskPoolWorker (
+  IN VOID                           *Buffer
+  )
+{
+  MP_TASK_POOL                      *Pool;
+  UINTN                             DequeIndex;
+
+  Pool       = (MP_TASK_POOL *) Buffer;
+  DequeIndex = MpTaskPoolCurrentDeque (Pool);
+  while (*(volatile UINT32 *) &Pool->Outstanding != 0) {
+    if (!MpTaskPoolRunOne (Pool, DequeIndex)) {
+      CpuPause ();
+    }
+  }
+}
+
+/**
+  Create a task pool.
+
+  The pool uses all the processors enabled in the MP services. If the MP
+  services are not available, the tasks are run by the BSP.
+
+  This function must be called on the BSP.
+
+  @param[in]  MaxTasks    The maximum number of tasks queued or running at the
+                          same time.
+  @param[out] Pool        Returns the new task pool.
+
+  @retval EFI_SUCCESS            The pool is created.
+  @retval EFI_INVALID_PARAMETER  MaxTasks is 0 or larger than MAX_UINT32, or
+                                 Pool is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to create the pool.
+
+**/
+EFI_STATUS
+EFIAPI
+MpTaskPoolCreate (
+  IN  UINTN         MaxTasks,
+  OUT MP_TASK_POOL  **Pool
+  )
+{
+  EFI_STATUS                        Status;
+  MP_TASK_POOL                      *NewPool;
+  UINTN                             NumberOfProcessors;
+  UINTN                             BspNumber;
+  UINTN                             Index;
+  UINT32                            *Rings;
+
+  if (MaxTasks == 0 || MaxTasks > MAX_UINT32 || Pool == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NewPool = AllocateZeroPool (sizeof (MP_TASK_POOL));
+  if (NewPool == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = MpTaskPoolLocateMpServices (NewPool, &NumberOfProcessors, &BspNumber);
+  if (EFI_ERROR (Status) || BspNumber >= NumberOfProcessors) {
+    DEBUG ((DEBUG_INFO, "MpTaskPool: MP services not available, tasks run on the BSP\n"));
+    NewPool->MpServices = NULL;
+    NumberOfProcessors  = 1;
+    BspNumber           = 0;
+  }
+
+  NewPool->Signature  = MP_TASK_POOL_SIGNATURE;
+  NewPool->MaxTasks   = MaxTasks;
+  NewPool->DequeCount = NumberOfProcessors;
+  NewPool->BspNumber  = BspNumber;
+  NewPool->Tasks      = AllocateZeroPool (MaxTasks * sizeof (MP_TASK));
+  NewPool->FreeStack  = AllocatePool (MaxTasks * sizeof (UINT32));
+  NewPool->Deques     = AllocateZeroPool (NumberOfProcessors * sizeof (MP_TASK_DEQUE));
+  Rings               = AllocatePool (NumberOfProcessors * MaxTasks * sizeof (UINT32));
+  if (NewPool->Tasks == NULL || NewPool->FreeStack == NULL ||
+      NewPool->Deques == NULL || Rings == NULL) {
+    if (NewPool->Tasks != NULL) {
+      FreePool (NewPool->Tasks);
+    }
+    if (NewPool->FreeStack != NULL) {
+      FreePool (NewPool->FreeStack);
+    }
+    if (NewPool->Deques != NULL) {
+      FreePool (NewPool->Deques);
+    }
+    if (Rings != NULL) {
+      FreePool (Rings);
+    }
+    FreePool (NewPool);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  InitializeSpinLock (&NewPool->FreeLock);
+  for (Index = 0; Index < MaxTasks; Index++) {
+    NewPool->FreeStack[Index] = (UINT32) (MaxTasks - 1 - Index);
+  }
+  NewPool->FreeCount = MaxTasks;
+
+  for (Index = 0; Index < NumberOfProcessors; Index++) {
+    InitializeSpinLock (&NewPool->Deques[Index].Lock);
+    NewPool->Deques[Index].Ring = Rings + Index * MaxTasks;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "MpTaskPool: %d processors, %d tasks\n",
+    (UINT32) NumberOfProcessors,
+    (UINT32) MaxTasks
+    ));
+
+  *Pool = NewPool;
+  return EFI_SUCCESS;
+}
+
+/**
+  Destroy a task pool. No task may be queued or running.
+
+  This function must be called on the BSP.
+
+  @param[in]  Pool        The task pool to destroy.
+
+**/
+VOID
+EFIAPI
+MpTaskPoolDestroy (
+  IN MP_TASK_POOL   *Pool
+  )
+{
+  if (Pool == NULL) {
+    return;
+  }
+
+  ASSERT (Pool->Signature == MP_TASK_POOL_SIGNATURE);
+  ASSERT (Pool->Outstanding == 0);
+  ASSERT (Pool->FreeCount == Pool->MaxTasks);
+
+  //
+  // The rings of all the deques are allocated at once.
+  //
+  FreePool (Pool->Deques[0].Ring);
+  FreePool (Pool->Deques);
+  FreePool (Pool->FreeStack);
+  FreePool (Pool->Tasks);
+  Pool->Signature = 0;
+  FreePool (Pool);
+}
+
+/**
+  Submit a task to the pool.
+
+  The task is queued on the deque of the calling processor. Tasks submitted by
+  the BSP outside of MpTaskPoolRun() start when MpTaskPoolRun(),
+  MpTaskPoolWait() or MpTaskPoolParallelFor() is called.
+
+  If the pool is full and no future is requested, the task is run by the
+  caller before this function returns.
+
+  @param[in]  Pool              The task pool.
+  @param[in]  Procedure         The procedure to run.
+  @param[in]  ProcedureArgument The parameter passed into Procedure.
+  @param[out] Future            Optional. Returns the handle to pass to
+                                MpTaskPoolWait(). A task with a future keeps
+                                its pool entry until MpTaskPoolWait() is called.
+
+  @retval EFI_SUCCESS            The task is queued, or has been run.
+  @retval EFI_INVALID_PARAMETER  Pool or Procedure is NULL.
+  @retval EFI_OUT_OF_RESOURCES   The pool is full and Future is not NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MpTaskPoolSubmit (
+  IN  MP_TASK_POOL      *Pool,
+  IN  EFI_AP_PROCEDURE  Procedure,
+  IN  VOID              *ProcedureArgument OPTIONAL,
+  OUT MP_TASK_FUTURE    *Future OPTIONAL
+  )
+{
+  UINT32                            TaskIndex;
+  MP_TASK                           *Task;
+
+  if (Pool == NULL || Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  ASSERT (Pool->Signature == MP_TASK_POOL_SIGNATURE);
+
+  if (!MpTaskPoolAllocateTask (Pool, &TaskIndex)) {
+    if (Future != NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Procedure (ProcedureArgument);
+    return EFI_SUCCESS;
+  }
+
+  Task            = &Pool->Tasks[TaskIndex];
+  Task->Procedure = Procedure;
+  Task->Argument  = ProcedureArgument;
+  Task->Done      = FALSE;
+  Task->HasFuture = (BOOLEAN) (Future != NULL);
+  if (Future != NULL) {
+    *Future = TaskIndex;
+  }
+
+  InterlockedIncrement (&Pool->Outstanding);
+  MpTaskPoolPush (Pool, &Pool->Deques[MpTaskPoolCurrentDeque (Pool)], TaskIndex);
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait until a task has completed, and release its future.
+
+  The caller runs queued tasks while it waits. On the BSP outside of
+  MpTaskPoolRun(), this runs the pool until it is empty.
+
+  @param[in]  Pool        The task pool.
+  @param[in]  Future      The future returned by MpTaskPoolSubmit().
+
+**/
+VOID
+EFIAPI
+MpTaskPoolWait (
+  IN MP_TASK_POOL   *Pool,
+  IN MP_TASK_FUTURE Future
+  )
+{
+  MP_TASK                           *Task;
+  UINTN                             DequeIndex;
+
+  ASSERT (Pool != NULL && Pool->Signature == MP_TASK_POOL_SIGNATURE);
+  ASSERT (Future < Pool->MaxTasks);
+
+  Task = &Pool->Tasks[Future];
+  ASSERT (Task->HasFuture);
+
+  if (!Task->Done && !Pool->RegionActive) {
+    MpTaskPoolRun (Pool);
+  }
+
+  DequeIndex = MpTaskPoolCurrentDeque (Pool);
+  while (!Task->Done) {
+    if (!MpTaskPoolRunOne (Pool, DequeIndex)) {
+      CpuPause ();
+    }
+  }
+
+  Task->HasFuture = FALSE;
+  MpTaskPoolFreeTask (Pool, (UINT32) Future);
+}
+
+/**
+  Run all the queued tasks, and the tasks they submit, on the BSP and on all
+  the enabled APs, and return once the pool is empty.
+
+  This function must be called on the BSP, outside of a task.
+
+  @param[in]  Pool        The task pool.
+
+**/
+VOID
+EFIAPI
+MpTaskPoolRun (
+  IN MP_TASK_POOL   *Pool
+  )
+{
+  ASSERT (Pool != NULL && Pool->Signature == MP_TASK_POOL_SIGNATURE);
+  ASSERT (!Pool->RegionActive);
+
+  if (*(volatile UINT32 *) &Pool->Outstanding == 0) {
+    return;
+  }
+
+  //
+  // The region stays active until the pool is empty, so that the tasks
+  // waiting for a future or running a parallel for loop on the BSP help
+  // instead of starting another run.
+  //
+  Pool->RegionActive = TRUE;
+  if (Pool->DequeCount > 1) {
+    MpTaskPoolRunAllProcessors (Pool, MpTaskPoolWorker);
+  }
+
+  //
+  // Run what is left on the BSP: everything when the APs could not be
+  // started, nothing otherwise.
+  //
+  MpTaskPoolWorker (Pool);
+  Pool->RegionActive = FALSE;
+}
+
+/**
+  Process the sub-ranges of a parallel for loop until none is left.
+
+  @param[in, out]  ParallelFor  The parallel for loop.
+**/
+VOID
+MpTaskPoolRunChunks (
+  IN OUT MP_TASK_PARALLEL_FOR       *ParallelFor
+  )
+{
+  MP_TASK_DEQUE                     *Deque;
+  VOID                              *Previous;
+  UINT32                            Chunk;
+  UINTN                             Begin;
+  UINTN                             End;
+
+  Deque    = &ParallelFor->Pool->Deques[MpTaskPoolCurrentDeque (ParallelFor->Pool)];
+  Previous = Deque->ParallelFor;
+  while (TRUE) {
+    Chunk = InterlockedIncrement (&ParallelFor->NextChunk) - 1;
+    if (Chunk >= ParallelFor->ChunkCount) {
+      break;
+    }
+
+    //
+    // A sub-range may run a nested loop on this processor, which then
+    // restores the loop it was counted in when it returns.
+    //
+    if (Deque->ParallelFor != ParallelFor) {
+      Deque->ParallelFor = ParallelFor;
+      InterlockedIncrement (&ParallelFor->Processors);
+    }
+
+    Begin = ParallelFor->Begin + Chunk * ParallelFor->Grain;
+    End   = ParallelFor->End;
+    if (End - Begin > ParallelFor->Grain) {
+      End = Begin + ParallelFor->Grain;
+    }
+    ParallelFor->Procedure (Begin, End, ParallelFor->Context);
+  }
+  Deque->ParallelFor = Previous;
+}
+
+/**
+  Helper task of a parallel for loop.
+
+  @param[in, out]  Buffer   Pointer to the MP_TASK_PARALLEL_FOR.
+**/
+VOID
+EFIAPI
+MpTaskPoolParallelForHelper (
+  IN OUT VOID                       *Buffer
+  )
+{
+  MP_TASK_PARALLEL_FOR              *ParallelFor;
+
+  ParallelFor = (MP_TASK_PARALLEL_FOR *) Buffer;
+  MpTaskPoolRunChunks (ParallelFor);
+  InterlockedIncrement (&ParallelFor->FinishedHelpers);
+}
+
+/**
+  Run Procedure over the index range [Begin, End) split in sub-ranges of
+  Grain indexes, on all the enabled processors, and return once every
+  sub-range has been processed.
+
+  May be called on the BSP outside of MpTaskPoolRun(), or from a task.
+
+  @param[in]  Pool        The task pool.
+  @param[in]  Begin       The first index.
+  @param[in]  End         The index following the last index.
+  @param[in]  Grain       The number of indexes per sub-range. 0 lets the
+                          library choose.
+  @param[in]  Procedure   The procedure to run for each sub-range.
+  @param[in]  Context     The context passed into Procedure.
+
+  @return The number of processors that processed at least one sub-range. A
+          processor that picks up sub-ranges of this loop again while it
+          waits in a nested parallel for loop may be counted more than once.
+
+**/
+UINTN
+EFIAPI
+MpTaskPoolParallelFor (
+  IN MP_TASK_POOL             *Pool,
+  IN UINTN                    Begin,
+  IN UINTN                    End,
+  IN UINTN                    Grain,
+  IN MP_TASK_RANGE_PROCEDURE  Procedure,
+  IN VOID                     *Context OPTIONAL
+  )
+{
+  MP_TASK_PARALLEL_FOR              ParallelFor;
+  UINTN                             Count;
+  UINTN                             ChunkCount;
+  UINT32                            Helpers;
+  UINT32                            Index;
+  UINTN                             DequeIndex;
+
+  ASSERT (Pool != NULL && Pool->Signature == MP_TASK_POOL_SIGNATURE);
+  ASSERT (Procedure != NULL);
+
+  if (End <= Begin) {
+    return 0;
+  }
+
+  Count = End - Begin;
+  if (Grain == 0) {
+    //
+    // A few sub-ranges per processor balance the load without making the
+    // claiming overhead visible.
+    //
+    Grain = Count / (Pool->DequeCount * 4);
+    if (Grain == 0) {
+      Grain = 1;
+    }
+  }
+  ChunkCount = (Count - 1) / Grain + 1;
+  if (ChunkCount > MAX_UINT32 - 1) {
+    Grain      = Count / (MAX_UINT32 - 1) + 1;
+    ChunkCount = (Count - 1) / Grain + 1;
+  }
+
+  ParallelFor.Pool            = Pool;
+  ParallelFor.Procedure       = Procedure;
+  ParallelFor.Context         = Context;
+  ParallelFor.Begin           = Begin;
+  ParallelFor.End             = End;
+  ParallelFor.Grain           = Grain;
+  ParallelFor.ChunkCount      = (UINT32) ChunkCount;
+  ParallelFor.NextChunk       = 0;
+  ParallelFor.FinishedHelpers = 0;
+  ParallelFor.Processors      = 0;
+
+  if (ChunkCount == 1 || Pool->DequeCount == 1) {
+    MpTaskPoolRunChunks (&ParallelFor);
+    return ParallelFor.Processors;
+  }
+
+  //
+  // One helper per other processor. A helper that finds no sub-range left
+  // returns at once, but every helper must have returned before the context
+  // on the stack goes away.
+  //
+  Helpers = (UINT32) MIN (Pool->DequeCount - 1, ChunkCount - 1);
+  for (Index = 0; Index < Helpers; Index++) {
+    MpTaskPoolSubmit (Pool, MpTaskPoolParallelForHelper, &ParallelFor, NULL);
+  }
+
+  if (!Pool->RegionActive) {
+    MpTaskPoolRun (Pool);
+  }
+
+  MpTaskPoolRunChunks (&ParallelFor);
+  DequeIndex = MpTaskPoolCurrentDeque (Pool);
+  while (*(volatile UINT32 *) &ParallelFor.FinishedHelpers != Helpers) {
+    if (!MpTaskPoolRunOne (Pool, DequeIndex)) {
+      CpuPause ();
+    }
+  }
+
+  return ParallelFor.Processors;
+}
@@ -0,0 +1,138 @@
+/** @file
+  Internal definitions of the MP task pool library.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _MP_TASK_POOL_LIB_INTERNAL_H_
+#define _MP_TASK_POOL_LIB_INTERNAL_H_
+
+#include <PiPei.h>
+
+#include <Library/MpTaskPoolLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#define MP_TASK_POOL_SIGNATURE  SIGNATURE_32 ('M', 'P', 'T', 'P')
+
+typedef struct {
+  EFI_AP_PROCEDURE                  Procedure;
+  VOID                              *Argument;
+  volatile BOOLEAN                  Done;
+  BOOLEAN                           HasFuture;
+} MP_TASK;
+
+//
+// Tasks are pushed to and popped from Bottom by the owner, and stolen from Top
+// by the other processors. Top and Bottom only grow; the ring holds the task
+// indexes modulo the pool capacity, which can never overflow since a task
+// index is in at most one deque at a time.
+//
+typedef struct {
+  SPIN_LOCK                         Lock;
+  UINTN                             Top;
+  UINTN                             Bottom;
+  UINT32                            *Ring;
+  //
+  // The parallel for loop the owner last counted itself in, so that a
+  // processor running several helpers of the same loop is counted once.
+  //
+  VOID                              *ParallelFor;
+} MP_TASK_DEQUE;
+
+struct _MP_TASK_POOL {
+  UINT32                            Signature;
+  UINTN                             MaxTasks;
+  MP_TASK                           *Tasks;
+  //
+  // Stack of the free task indexes.
+  //
+  SPIN_LOCK                         FreeLock;
+  UINT32                            *FreeStack;
+  UINTN                             FreeCount;
+  //
+  // One deque per processor, indexed by the processor number of the MP
+  // services.
+  //
+  UINTN                             DequeCount;
+  MP_TASK_DEQUE                     *Deques;
+  UINTN                             BspNumber;
+  //
+  // Number of tasks queued or running.
+  //
+  UINT32                            Outstanding;
+  //
+  // TRUE while MpTaskPoolRun() runs the tasks, the processors then find their
+  // deque with MpTaskPoolWhoAmI().
+  //
+  volatile BOOLEAN                  RegionActive;
+  //
+  // Phase specific MP services.
+  //
+  VOID                              *MpServices;
+  VOID                              *PeiServices;
+};
+
+/**
+  Locate the MP services and return the processor numbers.
+
+  Implemented by the PEI and DXE library instances.
+
+  @param[in, out]  Pool                 The task pool. The MP services are set.
+  @param[out]      NumberOfProcessors   The number of processors, including
+                                        the BSP and the disabled APs.
+  @param[out]      BspNumber            The processor number of the BSP.
+
+  @retval EFI_SUCCESS           The MP services are located.
+  @retval others                The MP services are not available. The tasks
+                                are run by the BSP.
+**/
+EFI_STATUS
+MpTaskPoolLocateMpServices (
+  IN OUT MP_TASK_POOL               *Pool,
+  OUT    UINTN                      *NumberOfProcessors,
+  OUT    UINTN                      *BspNumber
+  );
+
+/**
+  Return the processor number of the calling processor.
+
+  Implemented by the PEI and DXE library instances. Called on the BSP and on
+  the APs while they run tasks.
+
+  @param[in]  Pool              The task pool.
+
+  @return The processor number, which indexes Pool->Deques.
+**/
+UINTN
+MpTaskPoolWhoAmI (
+  IN MP_TASK_POOL                   *Pool
+  );
+
+/**
+  Run Procedure on the BSP and on all the enabled APs, and return once every
+  processor has returned from it.
+
+  Implemented by the PEI and DXE library instances. When the APs cannot be
+  started, Procedure only runs on the BSP.
+
+  @param[in]  Pool              The task pool, passed to Procedure.
+  @param[in]  Procedure         The procedure to run.
+**/
+VOID
+MpTaskPoolRunAllProcessors (
+  IN MP_TASK_POOL                   *Pool,
+  IN EFI_AP_PROCEDURE               Procedure
+  );
+
+#endif
@@ -0,0 +1,135 @@
+/** @file
+  PEI instance of the MP task pool library, based on EFI_PEI_MP_SERVICES_PPI.
+
+  The PPI is only installed once permanent memory is available, before that the
+  tasks are run by the BSP.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "MpTaskPoolLibInternal.h"
+
+#include <Ppi/MpServices.h>
+
+#include <Library/PeiServicesLib.h>
+#include <Library/PeiServicesTablePointerLib.h>
+
+/**
+  Locate the MP services and return the processor numbers.
+
+  @param[in, out]  Pool                 The task pool. MpServices and
+                                        PeiServices are set.
+  @param[out]      NumberOfProcessors   The number of processors, including
+                                        the BSP and the disabled APs.
+  @param[out]      BspNumber            The processor number of the BSP.
+
+  @retval EFI_SUCCESS           The MP services are located.
+  @retval others                The MP services are not available. The tasks
+                                are run by the BSP.
+**/
+EFI_STATUS
+MpTaskPoolLocateMpServices (
+  IN OUT MP_TASK_POOL               *Pool,
+  OUT    UINTN                      *NumberOfProcessors,
+  OUT    UINTN                      *BspNumber
+  )
+{
+  EFI_STATUS                        Status;
+  CONST EFI_PEI_SERVICES            **PeiServices;
+  EFI_PEI_MP_SERVICES_PPI           *MpServices;
+  UINTN                             NumberOfEnabledProcessors;
+
+  Status = PeiServicesLocatePpi (&gEfiPeiMpServicesPpiGuid, 0, NULL, (VOID **) &MpServices);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  PeiServices = GetPeiServicesTablePointer ();
+  Status = MpServices->GetNumberOfProcessors (
+                         PeiServices,
+                         MpServices,
+                         NumberOfProcessors,
+                         &NumberOfEnabledProcessors
+                         );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = MpServices->WhoAmI (PeiServices, MpServices, BspNumber);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Pool->MpServices  = MpServices;
+  Pool->PeiServices = (VOID *) PeiServices;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the processor number of the calling processor.
+
+  WhoAmI() may be called on the APs. The PEI services pointer is the one read
+  by the BSP, since the APs cannot read it themselves.
+
+  @param[in]  Pool              The task pool.
+
+  @return The processor number, which indexes Pool->Deques.
+**/
+UINTN
+MpTaskPoolWhoAmI (
+  IN MP_TASK_POOL                   *Pool
+  )
+{
+  EFI_PEI_MP_SERVICES_PPI           *MpServices;
+  UINTN                             ProcessorNumber;
+
+  MpServices = (EFI_PEI_MP_SERVICES_PPI *) Pool->MpServices;
+  if (EFI_ERROR (MpServices->WhoAmI (Pool->PeiServices, MpServices, &ProcessorNumber))) {
+    return Pool->BspNumber;
+  }
+  return ProcessorNumber;
+}
+
+/**
+  Run Procedure on the BSP and on all the enabled APs, and return once every
+  processor has returned from it.
+
+  StartupAllAPs() of the PPI has no non-blocking mode, so the BSP waits for the
+  APs, then runs Procedure to finish any task left, which is every task when
+  the APs could not be started.
+
+  @param[in]  Pool              The task pool, passed to Procedure.
+  @param[in]  Procedure         The procedure to run.
+**/
+VOID
+MpTaskPoolRunAllProcessors (
+  IN MP_TASK_POOL                   *Pool,
+  IN EFI_AP_PROCEDURE               Procedure
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_PEI_MP_SERVICES_PPI           *MpServices;
+
+  MpServices = (EFI_PEI_MP_SERVICES_PPI *) Pool->MpServices;
+  Status = MpServices->StartupAllAPs (
+                         Pool->PeiServices,
+                         MpServices,
+                         Procedure,
+                         FALSE,
+                         0,
+                         Pool
+                         );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "MpTaskPool: APs not started - %r\n", Status));
+  }
+
+  Procedure (Pool);
+}
@@ -0,0 +1,593 @@
+/** @file
+  Host unit test of the MP task pool library.
+
+  MpTaskPoolLibCommon.c is built with the host tools. The MP services are
+  emulated with threads: every AP is a thread that runs the procedure of
+  MpTaskPoolRunAllProcessors(), and the BSP runs it too, either at the same
+  time as the APs (as the DXE instance does), after them (as the PEI
+  instance does), or alone (the APs could not be started). Every test case
+  picks a number of processors, a BSP processor number, one of these modes
+  and a pool size at random, then runs one of these workloads:
+
+  - a divide-and-conquer sum, where every task submits a sub-task with a
+    future, computes the other half itself and waits for the future;
+  - parallel for loops with random ranges and grains, some of them running
+    nested parallel for loops;
+  - a flood of tasks without futures, more than the pool holds, some of them
+    submitting more tasks from the APs.
+
+  Every index and task must be processed exactly once, the parallel for
+  loops must report the processors that ran them, the tasks queued by the
+  BSP must be stolen by the APs, and the pool must be empty and its memory
+  released afterwards. A lost task leaves the processors spinning, so the
+  test is ended by SIGALRM after one minute.
+
+  Usage: MpTaskPoolUnitTest [TestCaseCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#undef NULL
+
+#include "../MpTaskPoolLibInternal.h"
+
+#define MAX_PROCESSORS  8
+#define MAX_INDEXES     4096
+#define LEAF_SIZE       16
+
+typedef enum {
+  ModeNonBlocking,
+  ModeBlocking,
+  ModeApsNotStarted,
+  ModeNoMpServices,
+  ModeMax
+} MP_MODE;
+
+typedef struct {
+  UINTN   Begin;
+  UINTN   End;
+  UINT64  Sum;
+} SUM_TASK;
+
+typedef struct {
+  BOOLEAN  Nested;
+  UINT32   ProcessorMask;
+} LOOP_CONTEXT;
+
+typedef struct {
+  MP_TASK_POOL  *Pool;
+  UINTN           ProcessorNumber;
+  UINTN           Delay;
+} AP_THREAD;
+
+MP_MODE         mMode;
+UINTN           mNumberOfProcessors;
+UINTN           mBspNumber;
+UINTN           mApDelay;
+MP_TASK_POOL    *mPool;
+UINT32          mCounts[MAX_INDEXES];
+UINT32          mTasksRun;
+UINT32          mTasksOnBsp;
+UINT32          mTasksToSubmit;
+UINT32          mTasksResubmitted;
+UINT64          mRandomState;
+INTN            mAllocations;
+UINTN           mFailures;
+UINTN           mDummyMpServices;
+
+__thread UINTN  mProcessorNumber;
+
+//
+// The library functions that the task pool uses
+//
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  __atomic_add_fetch (&mAllocations, 1, __ATOMIC_SEQ_CST);
+  return malloc (AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  __atomic_add_fetch (&mAllocations, 1, __ATOMIC_SEQ_CST);
+  return calloc (1, AllocationSize);
+}
+
+VOID
+EFIAPI
+FreePool (
+  IN VOID   *Buffer
+  )
+{
+  __atomic_sub_fetch (&mAllocations, 1, __ATOMIC_SEQ_CST);
+  free (Buffer);
+}
+
+SPIN_LOCK *
+EFIAPI
+InitializeSpinLock (
+  OUT SPIN_LOCK  *SpinLock
+  )
+{
+  __atomic_store_n (SpinLock, 0, __ATOMIC_RELEASE);
+  return SpinLock;
+}
+
+SPIN_LOCK *
+EFIAPI
+AcquireSpinLock (
+  IN OUT SPIN_LOCK  *SpinLock
+  )
+{
+  while (__atomic_exchange_n (SpinLock, 1, __ATOMIC_ACQUIRE) != 0) {
+    sched_yield ();
+  }
+  return SpinLock;
+}
+
+SPIN_LOCK *
+EFIAPI
+ReleaseSpinLock (
+  IN OUT SPIN_LOCK  *SpinLock
+  )
+{
+  __atomic_store_n (SpinLock, 0, __ATOMIC_RELEASE);
+  return SpinLock;
+}
+
+UINT32
+EFIAPI
+InterlockedIncrement (
+  IN UINT32  *Value
+  )
+{
+  return __atomic_add_fetch (Value, 1, __ATOMIC_SEQ_CST);
+}
+
+UINT32
+EFIAPI
+InterlockedDecrement (
+  IN UINT32  *Value
+  )
+{
+  return __atomic_sub_fetch (Value, 1, __ATOMIC_SEQ_CST);
+}
+
+VOID
+EFIAPI
+MemoryFence (
+  VOID
+  )
+{
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+VOID
+EFIAPI
+CpuPause (
+  VOID
+  )
+{
+  sched_yield ();
+}
+
+//
+// The emulated MP services
+//
+EFI_STATUS
+MpTaskPoolLocateMpServices (
+  IN OUT MP_TASK_POOL               *Pool,
+  OUT    UINTN                      *NumberOfProcessors,
+  OUT    UINTN                      *BspNumber
+  )
+{
+  if (mMode == ModeNoMpServices) {
+    return EFI_NOT_FOUND;
+  }
+  Pool->MpServices    = &mDummyMpServices;
+  *NumberOfProcessors = mNumberOfProcessors;
+  *BspNumber          = mBspNumber;
+  return EFI_SUCCESS;
+}
+
+UINTN
+MpTaskPoolWhoAmI (
+  IN MP_TASK_POOL                   *Pool
+  )
+{
+  return mProcessorNumber;
+}
+
+VOID
+EFIAPI
+MpTaskPoolWorker (
+  IN VOID                           *Buffer
+  );
+
+VOID *
+ApThread (
+  VOID  *Buffer
+  )
+{
+  AP_THREAD  *Ap;
+  UINTN      Index;
+
+  Ap               = (AP_THREAD *) Buffer;
+  mProcessorNumber = Ap->ProcessorNumber;
+  for (Index = 0; Index < Ap->Delay; Index++) {
+    sched_yield ();
+  }
+  MpTaskPoolWorker (Ap->Pool);
+  return NULL;
+}
+
+VOID
+MpTaskPoolRunAllProcessors (
+  IN MP_TASK_POOL                   *Pool,
+  IN EFI_AP_PROCEDURE               Procedure
+  )
+{
+  AP_THREAD  Aps[MAX_PROCESSORS];
+  pthread_t  Threads[MAX_PROCESSORS];
+  UINTN      Index;
+
+  if (Procedure != MpTaskPoolWorker) {
+    mFailures++;
+    printf ("Unexpected procedure\n");
+    return;
+  }
+
+  if (mMode == ModeApsNotStarted) {
+    Procedure (Pool);
+    return;
+  }
+
+  for (Index = 0; Index < mNumberOfProcessors; Index++) {
+    if (Index != mBspNumber) {
+      Aps[Index].Pool            = Pool;
+      Aps[Index].ProcessorNumber = Index;
+      Aps[Index].Delay           = mApDelay * Index;
+      pthread_create (&Threads[Index], NULL, ApThread, &Aps[Index]);
+    }
+  }
+  if (mMode == ModeNonBlocking) {
+    Procedure (Pool);
+  }
+  for (Index = 0; Index < mNumberOfProcessors; Index++) {
+    if (Index != mBspNumber) {
+      pthread_join (Threads[Index], NULL);
+    }
+  }
+  if (mMode == ModeBlocking) {
+    Procedure (Pool);
+  }
+}
+
+/**
+  Return a pseudo random number, xorshift64*. Only used on the BSP.
+**/
+UINT64
+Random (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState >> 12;
+  mRandomState ^= mRandomState << 25;
+  mRandomState ^= mRandomState >> 27;
+  return mRandomState * 0x2545F4914F6CDD1DULL;
+}
+
+VOID
+Fail (
+  IN CONST CHAR8  *Message,
+  IN UINTN        Value,
+  IN UINTN        Expected
+  )
+{
+  if (mFailures++ < 10) {
+    printf (
+      "%s: %lu, expected %lu (mode %d, %lu processors, BSP %lu, %lu tasks)\n",
+      Message,
+      (unsigned long) Value,
+      (unsigned long) Expected,
+      mMode,
+      (unsigned long) mNumberOfProcessors,
+      (unsigned long) mBspNumber,
+      (unsigned long) ((mPool != NULL) ? mPool->MaxTasks : 0)
+      );
+  }
+}
+
+/**
+  Check that every index of [0, Count) has been processed once.
+**/
+VOID
+CheckCounts (
+  IN CONST CHAR8  *Name,
+  IN UINTN        Count
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < MAX_INDEXES; Index++) {
+    if (mCounts[Index] != ((Index < Count) ? 1 : 0)) {
+      Fail (Name, mCounts[Index], (Index < Count) ? 1 : 0);
+      break;
+    }
+  }
+  memset (mCounts, 0, sizeof (mCounts));
+}
+
+/**
+  Sum the indexes of a range, submitting the first half as a task with a
+  future when the range is large.
+**/
+VOID
+EFIAPI
+SumTask (
+  IN VOID  *Buffer
+  )
+{
+  SUM_TASK          *Task;
+  SUM_TASK          Low;
+  SUM_TASK          High;
+  MP_TASK_FUTURE  Future;
+  EFI_STATUS      Status;
+  UINTN           Index;
+
+  Task = (SUM_TASK *) Buffer;
+  if (Task->End - Task->Begin <= LEAF_SIZE) {
+    Task->Sum = 0;
+    for (Index = Task->Begin; Index < Task->End; Index++) {
+      __atomic_add_fetch (&mCounts[Index], 1, __ATOMIC_SEQ_CST);
+      Task->Sum += Index;
+    }
+    return;
+  }
+
+  Low.Begin  = Task->Begin;
+  Low.End    = Task->Begin + (Task->End - Task->Begin) / 2;
+  High.Begin = Low.End;
+  High.End   = Task->End;
+
+  Status = MpTaskPoolSubmit (mPool, SumTask, &Low, &Future);
+  if (EFI_ERROR (Status)) {
+    SumTask (&Low);
+  }
+  SumTask (&High);
+  if (!EFI_ERROR (Status)) {
+    MpTaskPoolWait (mPool, Future);
+  }
+  Task->Sum = Low.Sum + High.Sum;
+}
+
+/**
+  Mark the indexes of a sub-range, and the processor that runs it.
+**/
+VOID
+EFIAPI
+MarkRange (
+  IN UINTN  Begin,
+  IN UINTN  End,
+  IN VOID   *Context
+  )
+{
+  LOOP_CONTEXT    *Loop;
+  LOOP_CONTEXT    Inner;
+  UINTN           Index;
+
+  Loop = (LOOP_CONTEXT *) Context;
+  __atomic_or_fetch (&Loop->ProcessorMask, 1u << mProcessorNumber, __ATOMIC_SEQ_CST);
+
+  if (Loop->Nested && End - Begin > 1) {
+    Inner.Nested        = FALSE;
+    Inner.ProcessorMask = 0;
+    MpTaskPoolParallelFor (mPool, Begin, End, (End - Begin) / 3, MarkRange, &Inner);
+    return;
+  }
+
+  for (Index = Begin; Index < End; Index++) {
+    __atomic_add_fetch (&mCounts[Index], 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+/**
+  Count a task of the flood. A task with an argument submits another one
+  while mTasksToSubmit is not 0.
+**/
+VOID
+EFIAPI
+FloodTask (
+  IN VOID  *Buffer
+  )
+{
+  UINT32  Left;
+
+  __atomic_add_fetch (&mTasksRun, 1, __ATOMIC_SEQ_CST);
+  if (mProcessorNumber == mBspNumber) {
+    __atomic_add_fetch (&mTasksOnBsp, 1, __ATOMIC_SEQ_CST);
+  }
+  if (Buffer == NULL) {
+    return;
+  }
+
+  Left = __atomic_load_n (&mTasksToSubmit, __ATOMIC_SEQ_CST);
+  while (Left != 0) {
+    if (__atomic_compare_exchange_n (&mTasksToSubmit, &Left, Left - 1, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+      __atomic_add_fetch (&mTasksResubmitted, 1, __ATOMIC_SEQ_CST);
+      MpTaskPoolSubmit (mPool, FloodTask, Buffer, NULL);
+      break;
+    }
+  }
+}
+
+/**
+  Check that the pool is empty and idle.
+**/
+VOID
+CheckPool (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  if (mPool->Outstanding != 0) {
+    Fail ("Outstanding tasks", mPool->Outstanding, 0);
+  }
+  if (mPool->FreeCount != mPool->MaxTasks) {
+    Fail ("Free tasks", mPool->FreeCount, mPool->MaxTasks);
+  }
+  if (mPool->RegionActive) {
+    Fail ("Region active", 1, 0);
+  }
+  for (Index = 0; Index < mPool->DequeCount; Index++) {
+    if (mPool->Deques[Index].Top != mPool->Deques[Index].Bottom) {
+      Fail ("Queued tasks", mPool->Deques[Index].Bottom - mPool->Deques[Index].Top, 0);
+    }
+    if (mPool->Deques[Index].ParallelFor != NULL) {
+      Fail ("Parallel for loop left in a deque", Index, 0);
+    }
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINTN           Cases;
+  UINTN           Case;
+  UINTN           Begin;
+  UINTN           End;
+  UINTN           Grain;
+  UINTN           Processors;
+  UINTN           RunBeforeRegion;
+  UINTN           Flood;
+  UINTN           Index;
+  SUM_TASK        Root;
+  LOOP_CONTEXT    Loop;
+  EFI_STATUS      Status;
+  MP_TASK_FUTURE  Future;
+
+  Cases        = (argc > 1) ? strtoul (argv[1], NULL, 0) : 1000;
+  mRandomState = (argc > 2) ? strtoull (argv[2], NULL, 0) : 1;
+  if (mRandomState == 0) {
+    mRandomState = 1;
+  }
+
+  //
+  // A task lost by the pool leaves the processors spinning: let SIGALRM end
+  // the test with a failure instead.
+  //
+  alarm (60);
+
+  for (Case = 0; Case < Cases; Case++) {
+    mMode               = (MP_MODE) (Random () % ModeMax);
+    mNumberOfProcessors = 1 + (UINTN) (Random () % MAX_PROCESSORS);
+    mBspNumber          = (UINTN) (Random () % mNumberOfProcessors);
+    mApDelay            = (UINTN) (Random () % 4);
+    mProcessorNumber    = mBspNumber;
+    if (mMode == ModeNoMpServices) {
+      mProcessorNumber = 0;
+    }
+
+    mPool  = NULL;
+    Status = MpTaskPoolCreate (1 + (UINTN) (Random () % 64), &mPool);
+    if (EFI_ERROR (Status)) {
+      Fail ("MpTaskPoolCreate", Status, EFI_SUCCESS);
+      break;
+    }
+
+    switch (Case % 3) {
+    case 0:
+      Root.Begin = 0;
+      Root.End   = (UINTN) (Random () % MAX_INDEXES);
+      Status     = MpTaskPoolSubmit (mPool, SumTask, &Root, &Future);
+      if (EFI_ERROR (Status)) {
+        Fail ("MpTaskPoolSubmit", Status, EFI_SUCCESS);
+        break;
+      }
+      MpTaskPoolWait (mPool, Future);
+      if (Root.Sum != (UINT64) Root.End * (Root.End - 1) / 2) {
+        Fail ("Sum", (UINTN) Root.Sum, (UINTN) ((UINT64) Root.End * (Root.End - 1) / 2));
+      }
+      CheckCounts ("Sum task count", Root.End);
+      break;
+
+    case 1:
+      Begin              = (UINTN) (Random () % MAX_INDEXES);
+      End                = Begin + (UINTN) (Random () % (MAX_INDEXES - Begin + 1));
+      Grain              = (Random () % 2 == 0) ? 0 : 1 + (UINTN) (Random () % 256);
+      Loop.Nested        = (BOOLEAN) (Random () % 4 == 0);
+      Loop.ProcessorMask = 0;
+      Processors = MpTaskPoolParallelFor (mPool, Begin, End, Grain, MarkRange, &Loop);
+      if (!Loop.Nested && Processors != (UINTN) __builtin_popcount (Loop.ProcessorMask)) {
+        Fail ("Processors of the parallel for loop", Processors, __builtin_popcount (Loop.ProcessorMask));
+      }
+      if (Begin == End && Processors != 0) {
+        Fail ("Processors of an empty parallel for loop", Processors, 0);
+      }
+      for (Index = 0; Index < Begin; Index++) {
+        mCounts[Index] = 1;
+      }
+      CheckCounts ("Parallel for count", End);
+      break;
+
+    case 2:
+      Flood             = (UINTN) (Random () % (3 * mPool->MaxTasks + 1));
+      mTasksToSubmit    = (UINT32) (Random () % (3 * mPool->MaxTasks + 1));
+      mTasksResubmitted = 0;
+      mTasksRun         = 0;
+      mTasksOnBsp       = 0;
+      for (Index = 0; Index < Flood; Index++) {
+        MpTaskPoolSubmit (mPool, FloodTask, (Index % 2 == 0) ? &mTasksToSubmit : NULL, NULL);
+      }
+      RunBeforeRegion = mTasksRun;
+      MpTaskPoolRun (mPool);
+      if (mTasksRun != Flood + mTasksResubmitted) {
+        Fail ("Flood tasks", mTasksRun, Flood + mTasksResubmitted);
+      }
+      //
+      // In blocking mode, the APs run before the BSP: every task queued by the
+      // BSP must have been stolen from its deque.
+      //
+      if (mMode == ModeBlocking && mNumberOfProcessors > 1 && mTasksOnBsp != RunBeforeRegion) {
+        Fail ("Tasks run on the BSP", mTasksOnBsp, RunBeforeRegion);
+      }
+      break;
+    }
+
+    CheckPool ();
+    MpTaskPoolDestroy (mPool);
+    mPool = NULL;
+    if (mAllocations != 0) {
+      Fail ("Allocations left", mAllocations, 0);
+      mAllocations = 0;
+    }
+  }
+
+  printf ("MpTaskPool: %u test cases, %u failures\n", (unsigned) Cases, (unsigned) mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
@@ -25,6 +25,8 @@ LIST_ENTRY          *mCurrentLink;
 NONTESTED_MEMORY_RANGE  *mCurrentRange;
 UINT64                  mTestedSystemMemory;
 UINT64                  mNonTestedSystemMemory;
+UINT64                  mCurrentRangeTestTime;
+UINT32                  mCurrentRangeProcessors;
 
 UINT32                  GenericMemoryTestMonoPattern[GENERIC_CACHELINE_SIZE / 4] = {
   0x5a5a5a5a,
@@ -335,6 +337,53 @@ WriteMemory (
   return EFI_SUCCESS;
 }
 
+/**
+  Report an uncorrectable memory error found by the software memory test.
+
+  @param[in] Address  The address of the miscompare.
+
+  @retval EFI_DEVICE_ERROR      The error is reported.
+  @retval EFI_OUT_OF_RESOURCES  No enough memory to report the error.
+
+**/
+EFI_STATUS
+ReportMemoryError (
+  IN  EFI_PHYSICAL_ADDRESS         Address
+  )
+{
+  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
+
+  //
+  // Report uncorrectable errors
+  //
+  ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
+  if (ExtendedErrorData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ExtendedErrorData->DataHeader.HeaderSize  = (UINT16) sizeof (EFI_STATUS_CODE_DATA);
+  ExtendedErrorData->DataHeader.Size        = (UINT16) (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
+  ExtendedErrorData->Granularity            = EFI_MEMORY_ERROR_DEVICE;
+  ExtendedErrorData->Operation              = EFI_MEMORY_OPERATION_READ;
+  ExtendedErrorData->Syndrome               = 0x0;
+  ExtendedErrorData->Address                = Address;
+  ExtendedErrorData->Resolution             = 0x40;
+
+  REPORT_STATUS_CODE_EX (
+      EFI_ERROR_CODE,
+      EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
+      0,
+      &gEfiGenericMemTestProtocolGuid,
+      NULL,
+      (UINT8 *) ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
+      ExtendedErrorData->DataHeader.Size
+      );
+
+  FreePool (ExtendedErrorData);
+
+  return EFI_DEVICE_ERROR;
+}
+
 /**
   Verify the range of physical memory which covered by memory test pattern.
 
@@ -358,10 +407,8 @@ VerifyMemory (
 {
   EFI_PHYSICAL_ADDRESS            Address;
   INTN                            ErrorFound;
-  EFI_MEMORY_EXTENDED_ERROR_DATA  *ExtendedErrorData;
 
   Address           = Start;
-  ExtendedErrorData = NULL;
 
   //
   // Add 4G memory address check for IA32 platform
@@ -383,37 +430,213 @@ VerifyMemory (
                   Private->MonoTestSize
                   );
     if (ErrorFound != 0) {
-      //
-      // Report uncorrectable errors
-      //
-      ExtendedErrorData = AllocateZeroPool (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA));
-      if (ExtendedErrorData == NULL) {
-        return EFI_OUT_OF_RESOURCES;
-      }
+      return ReportMemoryError (Address);
+    }
 
-      ExtendedErrorData->DataHeader.HeaderSize  = (UINT16) sizeof (EFI_STATUS_CODE_DATA);
-      ExtendedErrorData->DataHeader.Size        = (UINT16) (sizeof (EFI_MEMORY_EXTENDED_ERROR_DATA) - sizeof (EFI_STATUS_CODE_DATA));
-      ExtendedErrorData->Granularity            = EFI_MEMORY_ERROR_DEVICE;
-      ExtendedErrorData->Operation              = EFI_MEMORY_OPERATION_READ;
-      ExtendedErrorData->Syndrome               = 0x0;
-      ExtendedErrorData->Address                = Address;
-      ExtendedErrorData->Resolution             = 0x40;
+    Address += Private->CoverageSpan;
+  }
 
-      REPORT_STATUS_CODE_EX (
-          EFI_ERROR_CODE,
-          EFI_COMPUTING_UNIT_MEMORY | EFI_CU_MEMORY_EC_UNCORRECTABLE,
-          0,
-          &gEfiGenericMemTestProtocolGuid,
-          NULL,
-          (UINT8 *) ExtendedErrorData + sizeof (EFI_STATUS_CODE_DATA),
-          ExtendedErrorData->DataHeader.Size
-          ); 
+  return EFI_SUCCESS;
+}
+
+/**
+  Write the memory test pattern into one chunk of physical memory, and flush
+  the written lines out of the data cache of the executing processor.
+
+  This function runs on the APs, so it must not use any UEFI service.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The chunk's start address.
+  @param[in] Size     The chunk's size.
+
+**/
+VOID
+WriteMemoryChunk (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Address;
 
-      return EFI_DEVICE_ERROR;
+  Address = Start;
+
+  if ((Private->CoverageSpan == Private->MonoTestSize) && (Private->MonoPatternBlock != NULL)) {
+    while (Address + TEST_PATTERN_BLOCK_SIZE <= Start + Size) {
+      CopyMem ((VOID *) (UINTN) Address, Private->MonoPatternBlock, TEST_PATTERN_BLOCK_SIZE);
+      Address += TEST_PATTERN_BLOCK_SIZE;
     }
+    WriteBackInvalidateDataCacheRange ((VOID *) (UINTN) Start, (UINTN) (Address - Start));
+  }
 
+  while (Address < (Start + Size)) {
+    CopyMem ((VOID *) (UINTN) Address, Private->MonoPattern, Private->MonoTestSize);
+    WriteBackInvalidateDataCacheRange ((VOID *) (UINTN) Address, Private->MonoTestSize);
     Address += Private->CoverageSpan;
   }
+}
+
+/**
+  Verify one chunk of physical memory which covered by memory test pattern.
+
+  This function runs on the APs, so it must not use any UEFI service.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The chunk's start address.
+  @param[in] Size     The chunk's size.
+
+  @return The address of the first miscompare, or MAX_UINT64 if none is found.
+
+**/
+EFI_PHYSICAL_ADDRESS
+VerifyMemoryChunk (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Address;
+
+  Address = Start;
+
+  //
+  // Compare block by block, then locate the miscompare (if any) in the
+  // failing block with the per span compare below.
+  //
+  if ((Private->CoverageSpan == Private->MonoTestSize) && (Private->MonoPatternBlock != NULL)) {
+    while (Address + TEST_PATTERN_BLOCK_SIZE <= Start + Size) {
+      if (CompareMem ((VOID *) (UINTN) Address, Private->MonoPatternBlock, TEST_PATTERN_BLOCK_SIZE) != 0) {
+        break;
+      }
+      Address += TEST_PATTERN_BLOCK_SIZE;
+    }
+  }
+
+  while (Address < (Start + Size)) {
+    if (CompareMemWithoutCheckArgument (
+          (VOID *) (UINTN) Address,
+          Private->MonoPattern,
+          Private->MonoTestSize
+          ) != 0) {
+      return Address;
+    }
+    Address += Private->CoverageSpan;
+  }
+
+  return MAX_UINT64;
+}
+
+/**
+  Test the chunks [BeginChunk, EndChunk) of a memory range, unless an error
+  has been found.
+
+  Runs on every processor taking part in the test.
+
+  @param[in]      BeginChunk  The first chunk to test.
+  @param[in]      EndChunk    The chunk following the last chunk to test.
+  @param[in, out] Buffer      Pointer to the MP_MEMORY_TEST_CONTEXT.
+
+**/
+VOID
+EFIAPI
+MpRangeTestChunks (
+  IN     UINTN                     BeginChunk,
+  IN     UINTN                     EndChunk,
+  IN OUT VOID                      *Buffer
+  )
+{
+  MP_MEMORY_TEST_CONTEXT  *Context;
+  UINTN                   Chunk;
+  EFI_PHYSICAL_ADDRESS    Start;
+  UINT64                  Size;
+  EFI_PHYSICAL_ADDRESS    ErrorAddress;
+
+  Context = (MP_MEMORY_TEST_CONTEXT *) Buffer;
+  for (Chunk = BeginChunk; Chunk < EndChunk; Chunk++) {
+    if (*(volatile UINT64 *) &Context->ErrorAddress != MAX_UINT64) {
+      break;
+    }
+
+    Start = Context->Start + MultU64x32 (Context->ChunkSize, (UINT32) Chunk);
+    Size  = MIN (Context->ChunkSize, Context->Start + Context->Size - Start);
+    WriteMemoryChunk (Context->Private, Start, Size);
+    ErrorAddress = VerifyMemoryChunk (Context->Private, Start, Size);
+    if (ErrorAddress != MAX_UINT64) {
+      InterlockedCompareExchange64 (&Context->ErrorAddress, MAX_UINT64, ErrorAddress);
+    }
+  }
+}
+
+/**
+  Write, flush and verify a range of physical memory on all the enabled processors.
+
+  The range is split into chunks of at least TEST_CHUNK_SIZE bytes that the
+  BSP and the APs test through the task pool. Without MP services the BSP
+  tests the whole range.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+  @param[out] Processors  The number of processors that tested the range.
+
+  @retval EFI_SUCCESS           Successful test the range of memory, no errors' location found.
+  @retval EFI_DEVICE_ERROR      The range of memory have errors contained.
+  @retval EFI_OUT_OF_RESOURCES  The error could not be reported.
+
+**/
+EFI_STATUS
+MpRangeTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size,
+  OUT UINT32                       *Processors
+  )
+{
+  MP_MEMORY_TEST_CONTEXT  Context;
+  UINT64                  ChunkSize;
+  UINTN                   ChunkCount;
+
+  *Processors = 0;
+
+  //
+  // Add 4G memory address check for IA32 platform
+  // NOTE: Without page table, there is no way to use memory above 4G.
+  //
+  if (Start + Size > MAX_ADDRESS) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // A chunk must hold a whole number of coverage spans, so that the same
+  // addresses are tested as when the range is tested in one go.
+  //
+  ChunkSize  = MAX (TEST_CHUNK_SIZE, Private->CoverageSpan);
+  ChunkSize -= ChunkSize % Private->CoverageSpan;
+
+  Context.Private      = Private;
+  Context.Start        = Start;
+  Context.Size         = Size;
+  Context.ChunkSize    = (UINT32) ChunkSize;
+  Context.ErrorAddress = MAX_UINT64;
+  ChunkCount           = (UINTN) DivU64x32 (Size + ChunkSize - 1, (UINT32) ChunkSize);
+
+  if (Private->TaskPool != NULL) {
+    *Processors = (UINT32) MpTaskPoolParallelFor (
+                             Private->TaskPool,
+                             0,
+                             ChunkCount,
+                             1,
+                             MpRangeTestChunks,
+                             &Context
+                             );
+  } else {
+    MpRangeTestChunks (0, ChunkCount, &Context);
+    *Processors = 1;
+  }
+
+  if (Context.ErrorAddress != MAX_UINT64) {
+    return ReportMemoryError (Context.ErrorAddress);
+  }
 
   return EFI_SUCCESS;
 }
@@ -440,6 +663,10 @@ InitializeMemoryTest (
   EFI_STATUS                  Status;
   GENERIC_MEMORY_TEST_PRIVATE *Private;
   EFI_CPU_ARCH_PROTOCOL       *Cpu;
+  EFI_MP_SERVICES_PROTOCOL    *MpService;
+  UINTN                       NumberOfProcessors;
+  UINTN                       NumberOfEnabledProcessors;
+  UINTN                       Offset;
 
   Private             = GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS (This);
   *RequireSoftECCInit = FALSE;
@@ -474,6 +701,48 @@ InitializeMemoryTest (
   if (!EFI_ERROR (Status)) {
     Private->Cpu = Cpu;
   }
+
+  //
+  // Create a task pool to test memory on all the processors. Each block
+  // reported to the BDS holds one TEST_BLOCK_SIZE per processor, and is split
+  // into TEST_CHUNK_SIZE chunks to balance the load.
+  //
+  Status = gBS->LocateProtocol (
+                  &gEfiMpServiceProtocolGuid,
+                  NULL,
+                  (VOID **) &MpService
+                  );
+  if (!EFI_ERROR (Status)) {
+    Status = MpService->GetNumberOfProcessors (
+                          MpService,
+                          &NumberOfProcessors,
+                          &NumberOfEnabledProcessors
+                          );
+    if (!EFI_ERROR (Status) && (NumberOfEnabledProcessors > 1)) {
+      if (Private->TaskPool == NULL) {
+        MpTaskPoolCreate (NumberOfProcessors, &Private->TaskPool);
+      }
+      if (Private->TaskPool != NULL) {
+        Private->BdsBlockSize = MultU64x32 (TEST_BLOCK_SIZE, (UINT32) NumberOfEnabledProcessors);
+      }
+    }
+  }
+
+  //
+  // Repeat the test pattern over one block for the contiguous memory test
+  //
+  if (Private->MonoPatternBlock == NULL) {
+    Private->MonoPatternBlock = AllocatePool (TEST_PATTERN_BLOCK_SIZE);
+  }
+  if ((Private->MonoPatternBlock != NULL) && (TEST_PATTERN_BLOCK_SIZE % Private->MonoTestSize == 0)) {
+    for (Offset = 0; Offset < TEST_PATTERN_BLOCK_SIZE; Offset += Private->MonoTestSize) {
+      CopyMem ((UINT8 *) Private->MonoPatternBlock + Offset, Private->MonoPattern, Private->MonoTestSize);
+    }
+  } else if (Private->MonoPatternBlock != NULL) {
+    FreePool (Private->MonoPatternBlock);
+    Private->MonoPatternBlock = NULL;
+  }
+
   //
   // Create the CoverageSpan of the memory test base on the coverage level
   //
@@ -510,6 +779,8 @@ InitializeMemoryTest (
   mCurrentLink        = Private->NonTestedMemRanList.ForwardLink;
   mCurrentRange       = NONTESTED_MEMORY_RANGE_FROM_LINK (mCurrentLink);
   mCurrentAddress     = mCurrentRange->StartAddress;
+  mCurrentRangeTestTime = 0;
+  mCurrentRangeProcessors = 0;
 
   return EFI_SUCCESS;
 }
@@ -543,6 +814,9 @@ GenPerformMemoryTest (
   GENERIC_MEMORY_TEST_PRIVATE     *Private;
   EFI_MEMORY_RANGE_EXTENDED_DATA  *RangeData;
   UINT64                          BlockBoundary;
+  UINT64                          StartTicks;
+  UINT32                          Processors;
+  UINT64                          ElapsedUs;
 
   Private       = GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS (This);
   *ErrorOut     = FALSE;
@@ -585,14 +859,16 @@ GenPerformMemoryTest (
           (UINT8 *) RangeData + sizeof (EFI_STATUS_CODE_DATA),
           RangeData->DataHeader.Size
           );
+      FreePool (RangeData);
 
       //
       // The software memory test (R/W/V) perform here. It will detect the
       // memory mis-compare error.
       //
-      WriteMemory (Private, mCurrentAddress, BlockBoundary);
-
-      Status = VerifyMemory (Private, mCurrentAddress, BlockBoundary);
+      StartTicks = GetPerformanceCounter ();
+      Status = MpRangeTest (Private, mCurrentAddress, BlockBoundary, &Processors);
+      mCurrentRangeTestTime += GetTimeInNanoSecond (GetPerformanceCounter () - StartTicks);
+      mCurrentRangeProcessors = MAX (mCurrentRangeProcessors, Processors);
       if (EFI_ERROR (Status)) {
         //
         // If perform here, means there is mis-compare error, and no agent can
@@ -620,6 +896,30 @@ GenPerformMemoryTest (
 
     return EFI_SUCCESS;
   }
+  //
+  // Report the throughput of the memory range just tested
+  //
+  if (!TestAbort && Private->CoverLevel != IGNORE) {
+    //
+    // A range tested faster than the timer resolution is accounted as 1 us
+    //
+    ElapsedUs = DivU64x32 (mCurrentRangeTestTime, 1000);
+    if (ElapsedUs == 0) {
+      ElapsedUs = 1;
+    }
+    DEBUG ((
+      DEBUG_INFO,
+      "GenericMemoryTest: 0x%lx - 0x%lx tested on up to %d processor(s) in %ld us (%ld MB/s)\n",
+      mCurrentRange->StartAddress,
+      mCurrentRange->StartAddress + mCurrentRange->Length - 1,
+      mCurrentRangeProcessors,
+      ElapsedUs,
+      RShiftU64 (DivU64x64Remainder (MultU64x32 (RShiftU64 (mCurrentRange->Length, 10), 1000000), ElapsedUs, NULL), 10)
+      ));
+  }
+  mCurrentRangeTestTime   = 0;
+  mCurrentRangeProcessors = 0;
+
   //
   // Change to next non tested memory range
   //
@@ -674,6 +974,16 @@ GenMemoryTestFinished (
   //
   DestroyLinkList (Private);
 
+  if (Private->MonoPatternBlock != NULL) {
+    FreePool (Private->MonoPatternBlock);
+    Private->MonoPatternBlock = NULL;
+  }
+
+  if (Private->TaskPool != NULL) {
+    MpTaskPoolDestroy (Private->TaskPool);
+    Private->TaskPool = NULL;
+  }
+
   return EFI_SUCCESS;
 }
 
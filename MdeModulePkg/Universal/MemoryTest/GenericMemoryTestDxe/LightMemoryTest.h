@@ -20,6 +20,7 @@
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Protocol/GenericMemoryTest.h>
 #include <Protocol/Cpu.h>
+#include <Protocol/MpService.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -30,6 +31,10 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/CacheMaintenanceLib.h>
+#include <Library/MpTaskPoolLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
 
 //
 // Some global define
@@ -50,6 +55,19 @@
 #define QUICK_SPAN_SIZE   (TEST_BLOCK_SIZE >> 2)
 #define SPARSE_SPAN_SIZE  (TEST_BLOCK_SIZE >> 4)
 
+//
+// When the whole memory is covered (EXTENSIVE), the pattern is written and
+// verified by blocks of this size, so the work is done by the optimized
+// CopyMem() and CompareMem() of the BaseMemoryLib instance.
+//
+#define TEST_PATTERN_BLOCK_SIZE  SIZE_4KB
+
+//
+// Unit of work a processor claims at a time when a block is tested on all
+// the processors, so that the faster processors test more chunks.
+//
+#define TEST_CHUNK_SIZE  SIZE_2MB
+
 //
 // This structure records every nontested memory range parsed through GCD
 // service.
@@ -117,6 +135,16 @@ typedef struct {
   //
   LIST_ENTRY                    NonTestedMemRanList;
 
+  //
+  // Task pool used to test memory on all the processors
+  //
+  MP_TASK_POOL                      *TaskPool;
+
+  //
+  // the memory test pattern repeated over TEST_PATTERN_BLOCK_SIZE bytes
+  //
+  VOID                              *MonoPatternBlock;
+
 } GENERIC_MEMORY_TEST_PRIVATE;
 
 #define GENERIC_MEMORY_TEST_PRIVATE_FROM_THIS(a) \
@@ -127,6 +155,18 @@ typedef struct {
   EFI_GENERIC_MEMORY_TEST_PRIVATE_SIGNATURE \
   )
 
+//
+// A range tested in parallel: the processors test ChunkSize chunks, and
+// record the first miscompare address they find.
+//
+typedef struct {
+  GENERIC_MEMORY_TEST_PRIVATE       *Private;
+  EFI_PHYSICAL_ADDRESS              Start;
+  UINT64                            Size;
+  UINT32                            ChunkSize;
+  UINT64                            ErrorAddress;
+} MP_MEMORY_TEST_CONTEXT;
+
 //
 // Function Prototypes
 //
@@ -241,6 +281,31 @@ VerifyMemory (
   IN  UINT64                       Size
   );
 
+/**
+  Write, flush and verify a range of physical memory on all the enabled processors.
+
+  The range is split into chunks of at least TEST_CHUNK_SIZE bytes that the
+  BSP and the APs test through the task pool. Without MP services the BSP
+  tests the whole range.
+
+  @param[in] Private  Point to generic memory test driver's private data.
+  @param[in] Start    The memory range's start address.
+  @param[in] Size     The memory range's size.
+  @param[out] Processors  The number of processors that tested the range.
+
+  @retval EFI_SUCCESS           Successful test the range of memory, no errors' location found.
+  @retval EFI_DEVICE_ERROR      The range of memory have errors contained.
+  @retval EFI_OUT_OF_RESOURCES  The error could not be reported.
+
+**/
+EFI_STATUS
+MpRangeTest (
+  IN  GENERIC_MEMORY_TEST_PRIVATE  *Private,
+  IN  EFI_PHYSICAL_ADDRESS         Start,
+  IN  UINT64                       Size,
+  OUT UINT32                       *Processors
+  );
+
 /**
   Test a range of the memory directly .
 
@@ -56,11 +56,16 @@ Ip4CreateAssembleEntry (
   Assemble->Id       = Id;
   Assemble->Protocol = Protocol;
   Assemble->TotalLen = 0;
-  Assemble->CurLen   = 0;
   Assemble->Head     = NULL;
   Assemble->Info     = NULL;
   Assemble->Life     = IP4_FRAGMENT_LIFE;
 
+  Assemble->Index         = NULL;
+  Assemble->IndexCount    = 0;
+  Assemble->IndexSize     = 0;
+  Assemble->ReceivedUnits = 0;
+  ZeroMem (Assemble->Received, sizeof (Assemble->Received));
+
   return Assemble;
 }
 
@@ -87,6 +92,10 @@ Ip4FreeAssembleEntry (
     NetbufFree (Fragment);
   }
 
+  if (Assemble->Index != NULL) {
+    FreePool (Assemble->Index);
+  }
+
   FreePool (Assemble);
 }
 
@@ -163,7 +172,7 @@ Ip4TrimPacket (
   ASSERT (Info->Start + Info->Length == Info->End);
   ASSERT ((Info->Start < End) && (Start < Info->End));
 
-   if (Info->Start < Start) {
+  if (Info->Start < Start) {
     Len = Start - Info->Start;
 
     NetbufTrim (Packet, (UINT32) Len, NET_BUF_HEAD);
@@ -172,7 +181,7 @@ Ip4TrimPacket (
   }
 
   if (End < Info->End) {
-    Len = End - Info->End;
+    Len = Info->End - End;
 
     NetbufTrim (Packet, (UINT32) Len, NET_BUF_TAIL);
     Info->End     = End;
@@ -181,6 +190,195 @@ Ip4TrimPacket (
 }
 
 
+/**
+  Check whether all the data in [Start, End) of the packet has been received.
+
+  @param  Assemble               The assemble entry of the packet.
+  @param  Start                  The sequence of the first byte.
+  @param  End                    One beyond the sequence of the last byte.
+
+  @retval TRUE                   All the data has been received.
+  @retval FALSE                  Some of the data hasn't been received.
+
+**/
+BOOLEAN
+Ip4FragmentReceived (
+  IN IP4_ASSEMBLE_ENTRY     *Assemble,
+  IN INTN                   Start,
+  IN INTN                   End
+  )
+{
+  UINTN                     Unit;
+
+  for (Unit = Start / IP4_FRAGMENT_UNIT; Unit < IP4_FRAGMENT_UNITS (End); Unit++) {
+    if ((Assemble->Received[Unit / 32] & (1U << (Unit % 32))) == 0) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/**
+  Insert the fragment into the assemble entry of its packet. The fragment
+  is trimmed to the data not received yet, and the fragments that it
+  covers completely are removed. All the fragments but the last one start
+  and end at 8 byte unit boundaries, so the bitmap of the units received
+  tells exactly what data the fragments hold.
+
+  @param  Assemble               The assemble entry of the packet.
+  @param  Packet                 The fragment to insert. Some of its data
+                                 must not have been received yet.
+
+  @retval EFI_SUCCESS            The fragment is inserted.
+  @retval EFI_OUT_OF_RESOURCES   Failed to grow the fragment index.
+  @retval EFI_INVALID_PARAMETER  All the data of the fragment has been
+                                 received already.
+
+**/
+EFI_STATUS
+Ip4InsertFragment (
+  IN OUT IP4_ASSEMBLE_ENTRY     *Assemble,
+  IN     NET_BUF                *Packet
+  )
+{
+  IP4_CLIP_INFO             *This;
+  IP4_CLIP_INFO             *Node;
+  NET_BUF                   **Index;
+  UINTN                     Low;
+  UINTN                     High;
+  UINTN                     Mid;
+  UINTN                     Unit;
+
+  This = IP4_GET_CLIP_INFO (Packet);
+
+  //
+  // Find the point to insert the packet: before the first
+  // fragment with THIS.Start < CUR.Start. the previous one
+  // has PREV.Start <= THIS.Start < CUR.Start.
+  //
+  Low  = 0;
+  High = Assemble->IndexCount;
+
+  while (Low < High) {
+    Mid = (Low + High) / 2;
+
+    if (IP4_GET_CLIP_INFO (Assemble->Index[Mid])->Start <= This->Start) {
+      Low  = Mid + 1;
+    } else {
+      High = Mid;
+    }
+  }
+
+  //
+  // Check whether the current fragment overlaps with the previous one.
+  // It holds that: PREV.Start <= THIS.Start < THIS.End. Only need to
+  // check whether THIS.Start < PREV.End for overlap. If two fragments
+  // overlaps, trim the overlapped part off THIS fragment.
+  //
+  if (Low > 0) {
+    Node = IP4_GET_CLIP_INFO (Assemble->Index[Low - 1]);
+
+    if (This->Start < Node->End) {
+      if (This->End <= Node->End) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      Ip4TrimPacket (Packet, Node->End, This->End);
+    }
+  }
+
+  //
+  // Check the packets after the insert point. It holds that:
+  // THIS.Start <= NODE.Start < NODE.End. The equality holds
+  // if PREV and NEXT are continuous. THIS fragment may fill
+  // several holes. The fragments in [Low, High) are completely
+  // overlapped by this fragment and will be removed.
+  //
+  High = Low;
+
+  while ((High < Assemble->IndexCount) &&
+         (IP4_GET_CLIP_INFO (Assemble->Index[High])->End <= This->End)) {
+    High++;
+  }
+
+  //
+  // The conditions are: THIS.Start <= NODE.Start, and THIS.End <
+  // NODE.End. Two fragments overlaps if NODE.Start < THIS.End.
+  // If two fragments start at the same offset, drop THIS fragment
+  // because ((THIS.Start == NODE.Start) && (THIS.End < NODE.End)).
+  //
+  if (High < Assemble->IndexCount) {
+    Node = IP4_GET_CLIP_INFO (Assemble->Index[High]);
+
+    if (Node->Start < This->End) {
+      if (This->Start == Node->Start) {
+        return EFI_INVALID_PARAMETER;
+      }
+
+      Ip4TrimPacket (Packet, This->Start, Node->Start);
+    }
+  }
+
+  //
+  // Grow the index before any fragment is removed, so that nothing
+  // has changed if it fails.
+  //
+  if ((Low == High) && (Assemble->IndexCount == Assemble->IndexSize)) {
+    Index = ReallocatePool (
+              Assemble->IndexSize * sizeof (NET_BUF *),
+              (Assemble->IndexSize + IP4_FRAGMENT_INDEX_SIZE) * 2 * sizeof (NET_BUF *),
+              Assemble->Index
+              );
+
+    if (Index == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Assemble->Index     = Index;
+    Assemble->IndexSize = (Assemble->IndexSize + IP4_FRAGMENT_INDEX_SIZE) * 2;
+  }
+
+  //
+  // Remove the fragments completely overlapped by this fragment. Their
+  // data is in this fragment, so the bitmap stays the same.
+  //
+  for (Mid = Low; Mid < High; Mid++) {
+    RemoveEntryList (&Assemble->Index[Mid]->List);
+    NetbufFree (Assemble->Index[Mid]);
+  }
+
+  if (High < Assemble->IndexCount) {
+    NetListInsertBefore (&Assemble->Index[High]->List, &Packet->List);
+  } else {
+    InsertTailList (&Assemble->Fragments, &Packet->List);
+  }
+
+  CopyMem (
+    &Assemble->Index[Low + 1],
+    &Assemble->Index[High],
+    (Assemble->IndexCount - High) * sizeof (NET_BUF *)
+    );
+
+  Assemble->Index[Low]   = Packet;
+  Assemble->IndexCount  += 1 - (High - Low);
+
+  //
+  // Mark the data of the fragment received. It starts at a unit
+  // boundary, and only the last fragment may end inside a unit.
+  //
+  for (Unit = This->Start / IP4_FRAGMENT_UNIT; Unit < IP4_FRAGMENT_UNITS (This->End); Unit++) {
+    if ((Assemble->Received[Unit / 32] & (1U << (Unit % 32))) == 0) {
+      Assemble->Received[Unit / 32] |= 1U << (Unit % 32);
+      Assemble->ReceivedUnits++;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Release all the fragments of the packet. This is the callback for
   the assembled packet's OnFree. It will free the assemble entry,
@@ -222,10 +420,7 @@ Ip4Reassemble (
 {
   IP4_HEAD                  *IpHead;
   IP4_CLIP_INFO             *This;
-  IP4_CLIP_INFO             *Node;
   IP4_ASSEMBLE_ENTRY        *Assemble;
-  LIST_ENTRY                *Head;
-  LIST_ENTRY                *Prev;
   LIST_ENTRY                *Cur;
   NET_BUF                   *Fragment;
   NET_BUF                   *NewPacket;
@@ -274,121 +469,61 @@ Ip4Reassemble (
   ASSERT (Assemble != NULL);
 
   //
-  // Find the point to insert the packet: before the first
-  // fragment with THIS.Start < CUR.Start. the previous one
-  // has PREV.Start <= THIS.Start < CUR.Start.
+  // A fragment can't extend beyond the last fragment of the packet. With
+  // this, and the length of all but the last fragment being in the unit
+  // of 8 bytes, all the fragments start at a unit boundary.
   //
-  Head = &Assemble->Fragments;
-
-  NET_LIST_FOR_EACH (Cur, Head) {
-    Fragment = NET_LIST_USER_STRUCT (Cur, NET_BUF, List);
-
-    if (This->Start < IP4_GET_CLIP_INFO (Fragment)->Start) {
-      break;
+  if (IP4_LAST_FRAGMENT (IpHead->Fragment)) {
+    if ((Assemble->TotalLen != 0) && (This->End != Assemble->TotalLen)) {
+      goto DROP;
     }
-  }
 
-  //
-  // Check whether the current fragment overlaps with the previous one.
-  // It holds that: PREV.Start <= THIS.Start < THIS.End. Only need to
-  // check whether THIS.Start < PREV.End for overlap. If two fragments
-  // overlaps, trim the overlapped part off THIS fragment.
-  //
-  if ((Prev = Cur->BackLink) != Head) {
-    Fragment  = NET_LIST_USER_STRUCT (Prev, NET_BUF, List);
-    Node      = IP4_GET_CLIP_INFO (Fragment);
+    if ((Assemble->IndexCount != 0) &&
+        (IP4_GET_CLIP_INFO (Assemble->Index[Assemble->IndexCount - 1])->End > This->End)) {
+      goto DROP;
+    }
 
-    if (This->Start < Node->End) {
-      if (This->End <= Node->End) {
-        NetbufFree (Packet);
-        return NULL;
-      }
+    Assemble->TotalLen = This->End;
 
-      Ip4TrimPacket (Packet, Node->End, This->End);
-    }
+  } else if ((Assemble->TotalLen != 0) && (This->End > Assemble->TotalLen)) {
+    goto DROP;
   }
 
   //
-  // Insert the fragment into the packet. The fragment may be removed
-  // from the list by the following checks.
-  //
-  NetListInsertBefore (Cur, &Packet->List);
-
-  //
-  // Check the packets after the insert point. It holds that:
-  // THIS.Start <= NODE.Start < NODE.End. The equality holds
-  // if PREV and NEXT are continuous. THIS fragment may fill
-  // several holes. Remove the completely overlapped fragments
+  // Drop the fragment if all its data has been received, otherwise insert
+  // it into the packet. The fragment may have completed the packet even if
+  // it carries no new data, by telling the total length.
   //
-  while (Cur != Head) {
-    Fragment = NET_LIST_USER_STRUCT (Cur, NET_BUF, List);
-    Node     = IP4_GET_CLIP_INFO (Fragment);
-
-    //
-    // Remove fragments completely overlapped by this fragment
-    //
-    if (Node->End <= This->End) {
-      Cur = Cur->ForwardLink;
-
-      RemoveEntryList (&Fragment->List);
-      Assemble->CurLen -= Node->Length;
+  if (Ip4FragmentReceived (Assemble, This->Start, This->End)) {
+    NetbufFree (Packet);
 
-      NetbufFree (Fragment);
-      continue;
+  } else {
+    if (EFI_ERROR (Ip4InsertFragment (Assemble, Packet))) {
+      goto DROP;
     }
 
-    //
-    // The conditions are: THIS.Start <= NODE.Start, and THIS.End <
-    // NODE.End. Two fragments overlaps if NODE.Start < THIS.End.
-    // If two fragments start at the same offset, remove THIS fragment
-    // because ((THIS.Start == NODE.Start) && (THIS.End < NODE.End)).
-    //
-    if (Node->Start < This->End) {
-      if (This->Start == Node->Start) {
-        RemoveEntryList (&Packet->List);
-        goto DROP;
-      }
+    if (This->Start == 0) {
+      //
+      // Once the first fragment is enqueued, it can't be removed
+      // from the fragment list. So, Assemble->Head always point
+      // to valid memory area.
+      //
+      ASSERT (Assemble->Head == NULL);
 
-      Ip4TrimPacket (Packet, This->Start, Node->Start);
+      Assemble->Head  = IpHead;
+      Assemble->Info  = IP4_GET_CLIP_INFO (Packet);
     }
-
-    break;
-  }
-
-  //
-  // Update the assemble info: increase the current length. If it is
-  // the frist fragment, update the packet's IP head and per packet
-  // info. If it is the last fragment, update the total length.
-  //
-  Assemble->CurLen += This->Length;
-
-  if (This->Start == 0) {
-    //
-    // Once the first fragment is enqueued, it can't be removed
-    // from the fragment list. So, Assemble->Head always point
-    // to valid memory area.
-    //
-    ASSERT (Assemble->Head == NULL);
-
-    Assemble->Head  = IpHead;
-    Assemble->Info  = IP4_GET_CLIP_INFO (Packet);
-  }
-
-  //
-  // Don't update the length more than once.
-  //
-  if (IP4_LAST_FRAGMENT (IpHead->Fragment) && (Assemble->TotalLen == 0)) {
-    Assemble->TotalLen = This->End;
   }
 
   //
   // Deliver the whole packet if all the fragments received.
   // All fragments received if:
   //  1. received the last one, so, the total length is know
-  //  2. received all the data. If the last fragment on the
-  //     queue ends at the total length, all data is received.
+  //  2. received all the data, that is, all the units up to the
+  //     total length.
   //
-  if ((Assemble->TotalLen != 0) && (Assemble->CurLen >= Assemble->TotalLen)) {
+  if ((Assemble->TotalLen != 0) &&
+      (Assemble->ReceivedUnits == IP4_FRAGMENT_UNITS (Assemble->TotalLen))) {
 
     RemoveEntryList (&Assemble->Link);
 
@@ -397,7 +532,7 @@ Ip4Reassemble (
     // equals to the packet's total length. Otherwise, the packet
     // is a fake, drop it now.
     //
-    Fragment = NET_LIST_USER_STRUCT (Head->BackLink, NET_BUF, List);
+    Fragment = NET_LIST_USER_STRUCT (Assemble->Fragments.BackLink, NET_BUF, List);
 
     if (IP4_GET_CLIP_INFO (Fragment)->End != Assemble->TotalLen) {
       Ip4FreeAssembleEntry (Assemble);
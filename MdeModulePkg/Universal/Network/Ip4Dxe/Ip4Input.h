@@ -25,6 +25,15 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define IP4_FRAGMENT_LIFE      120
 #define IP4_MAX_PACKET_SIZE    65535
 
+///
+/// Fragment offsets are in units of 8 bytes. The reassembly tracks the data
+/// received in the same units, one bit per unit of the largest packet.
+///
+#define IP4_FRAGMENT_UNIT        8
+#define IP4_FRAGMENT_UNITS(Len)  (((Len) + IP4_FRAGMENT_UNIT - 1) / IP4_FRAGMENT_UNIT)
+#define IP4_FRAGMENT_MAP_SIZE    (IP4_FRAGMENT_UNITS (IP4_MAX_PACKET_SIZE) / 32)
+#define IP4_FRAGMENT_INDEX_SIZE  8
+
 ///
 /// Per packet information for input process. LinkFlag specifies whether
 /// the packet is received as Link layer unicast, multicast or broadcast.
@@ -61,9 +70,19 @@ typedef struct {
   UINT8                     Protocol;
 
   INTN                      TotalLen;
-  INTN                      CurLen;
   LIST_ENTRY                Fragments;  // List of all the fragments of this packet
 
+  //
+  // The fragments in the order of the Fragments list, so that the insert
+  // point of a fragment can be found with a binary search whatever order
+  // the fragments arrive in, and the bitmap of the 8 byte units received.
+  //
+  NET_BUF                   **Index;
+  UINTN                     IndexCount;
+  UINTN                     IndexSize;
+  UINT32                    Received[IP4_FRAGMENT_MAP_SIZE];
+  UINTN                     ReceivedUnits; // Number of bits set in Received
+
   IP4_HEAD                  *Head;      // IP head of the first fragment
   IP4_CLIP_INFO             *Info;      // Per packet info of the first fragment
   INTN                      Life;       // Count down life for the packet.
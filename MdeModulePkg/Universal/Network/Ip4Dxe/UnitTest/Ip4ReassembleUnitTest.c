@@ -0,0 +1,539 @@
+/** @file
+  Host unit test of the IPv4 fragment reassembly of Ip4Dxe.
+
+  Ip4Input.c and the net buffer code of DxeNetLib are built with the host
+  tools. Every test case cuts a packet of random length into fragments,
+  adds duplicates of some of them and fragments that overlap them at random
+  offsets, then feeds all of them to Ip4Reassemble() in ascending,
+  descending or random order. Ip4Reassemble() must deliver the packet with
+  the fragment that completes it, neither earlier nor later, and the packet
+  must hold the original data. Some test cases leave out fragments so that
+  the packet never completes. After every fragment, the fragment index and
+  the bitmap of the data received must match the fragment list. The test
+  also checks that all the memory is released once the packet is freed or
+  the assemble table is cleaned up.
+
+  Usage: Ip4ReassembleUnitTest [TestCaseCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NULL
+
+#include "../Ip4Impl.h"
+
+#define MAX_FRAGMENTS  (IP4_FRAGMENT_UNITS (IP4_MAX_PACKET_SIZE) * 2)
+
+typedef struct {
+  INTN     Start;
+  INTN     End;
+  BOOLEAN  Last;
+} FRAGMENT;
+
+NET_BUF *
+Ip4Reassemble (
+  IN OUT IP4_ASSEMBLE_TABLE     *Table,
+  IN OUT NET_BUF                *Packet
+  );
+
+FRAGMENT            mFragments[MAX_FRAGMENTS];
+IP4_HEAD            mHeads[MAX_FRAGMENTS];
+UINT8               mData[IP4_MAX_PACKET_SIZE];
+UINT8               mReceived[IP4_MAX_PACKET_SIZE];
+IP4_ASSEMBLE_TABLE  mTable;
+UINT64              mRandomState;
+INTN                mAllocations;
+UINTN               mFailures;
+EFI_BOOT_SERVICES   mBootServices;
+EFI_BOOT_SERVICES   *gBS = &mBootServices;
+
+//
+// The library functions that the reassembly uses
+//
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  mAllocations++;
+  return malloc (AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  mAllocations++;
+  return calloc (1, AllocationSize);
+}
+
+VOID *
+EFIAPI
+ReallocatePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  VOID  *NewBuffer;
+
+  NewBuffer = AllocatePool (NewSize);
+  if ((NewBuffer != NULL) && (OldBuffer != NULL)) {
+    memcpy (NewBuffer, OldBuffer, MIN (OldSize, NewSize));
+    FreePool (OldBuffer);
+  }
+  return NewBuffer;
+}
+
+VOID
+EFIAPI
+FreePool (
+  IN VOID   *Buffer
+  )
+{
+  mAllocations--;
+  free (Buffer);
+}
+
+EFI_STATUS
+EFIAPI
+BootServicesFreePool (
+  IN VOID   *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length
+  )
+{
+  return memset (Buffer, 0, Length);
+}
+
+LIST_ENTRY *
+EFIAPI
+InitializeListHead (
+  IN OUT  LIST_ENTRY                *ListHead
+  )
+{
+  ListHead->ForwardLink = ListHead;
+  ListHead->BackLink    = ListHead;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+InsertHeadList (
+  IN OUT  LIST_ENTRY                *ListHead,
+  IN OUT  LIST_ENTRY                *Entry
+  )
+{
+  Entry->ForwardLink = ListHead->ForwardLink;
+  Entry->BackLink    = ListHead;
+  Entry->ForwardLink->BackLink = Entry;
+  ListHead->ForwardLink        = Entry;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+InsertTailList (
+  IN OUT  LIST_ENTRY                *ListHead,
+  IN OUT  LIST_ENTRY                *Entry
+  )
+{
+  Entry->ForwardLink = ListHead;
+  Entry->BackLink    = ListHead->BackLink;
+  Entry->BackLink->ForwardLink = Entry;
+  ListHead->BackLink           = Entry;
+  return ListHead;
+}
+
+LIST_ENTRY *
+EFIAPI
+RemoveEntryList (
+  IN CONST LIST_ENTRY       *Entry
+  )
+{
+  Entry->ForwardLink->BackLink = Entry->BackLink;
+  Entry->BackLink->ForwardLink = Entry->ForwardLink;
+  return Entry->ForwardLink;
+}
+
+BOOLEAN
+EFIAPI
+IsListEmpty (
+  IN      CONST LIST_ENTRY          *ListHead
+  )
+{
+  return (BOOLEAN) (ListHead->ForwardLink == ListHead);
+}
+
+VOID
+EFIAPI
+NetListInsertBefore (
+  IN OUT LIST_ENTRY     *PostEntry,
+  IN OUT LIST_ENTRY     *NewEntry
+  )
+{
+  InsertTailList (PostEntry, NewEntry);
+}
+
+/**
+  Return a pseudo random number, xorshift64*.
+**/
+UINT64
+Random (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState >> 12;
+  mRandomState ^= mRandomState << 25;
+  mRandomState ^= mRandomState >> 27;
+  return mRandomState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+  Add a fragment of the packet of TotalLen bytes that holds [Start, End).
+**/
+VOID
+AddFragment (
+  IN OUT UINTN  *Count,
+  IN     INTN   Start,
+  IN     INTN   End,
+  IN     INTN   TotalLen
+  )
+{
+  mFragments[*Count].Start = Start;
+  mFragments[*Count].End   = End;
+  mFragments[*Count].Last  = (BOOLEAN) (End == TotalLen);
+  (*Count)++;
+}
+
+/**
+  Build the fragment of the packet, as Ip4PreProcessPacket() passes it to
+  Ip4Reassemble().
+**/
+NET_BUF *
+BuildFragment (
+  IN UINTN   Index,
+  IN UINT16  Id
+  )
+{
+  FRAGMENT       *Fragment;
+  NET_BUF        *Packet;
+  IP4_CLIP_INFO  *Info;
+  UINT8          *Data;
+
+  Fragment = &mFragments[Index];
+  Packet   = NetbufAlloc ((UINT32) (Fragment->End - Fragment->Start));
+  Data     = NetbufAllocSpace (Packet, (UINT32) (Fragment->End - Fragment->Start), NET_BUF_TAIL);
+  memcpy (Data, mData + Fragment->Start, Fragment->End - Fragment->Start);
+
+  mHeads[Index].Dst      = 0x0a000001;
+  mHeads[Index].Src      = 0x0a000002;
+  mHeads[Index].Id       = Id;
+  mHeads[Index].Protocol = EFI_IP_PROTO_UDP;
+  mHeads[Index].Fragment = (UINT16) ((Fragment->Start / 8) | (Fragment->Last ? 0 : IP4_HEAD_MF_MASK));
+  Packet->Ip.Ip4         = &mHeads[Index];
+
+  Info         = IP4_GET_CLIP_INFO (Packet);
+  Info->Start  = Fragment->Start;
+  Info->End    = Fragment->End;
+  Info->Length = Fragment->End - Fragment->Start;
+  return Packet;
+}
+
+/**
+  Report a failure of the test case.
+**/
+VOID
+Fail (
+  IN UINTN       Case,
+  IN CONST CHAR8 *Message,
+  IN INTN        TotalLen,
+  IN UINTN       Fed
+  )
+{
+  if (mFailures++ < 10) {
+    printf ("Case %u, length %d, fragment %u: %s\n", (unsigned) Case, (int) TotalLen, (unsigned) Fed, Message);
+  }
+}
+
+/**
+  Check that the fragment index of every assemble entry lists the fragments
+  in the order of the fragment list, that the fragments don't overlap, and
+  that the bitmap of the units received matches the fragments.
+**/
+BOOLEAN
+CheckAssembleTable (
+  VOID
+  )
+{
+  IP4_ASSEMBLE_ENTRY  *Assemble;
+  IP4_CLIP_INFO       *Info;
+  LIST_ENTRY          *Entry;
+  LIST_ENTRY          *Cur;
+  UINTN               Bucket;
+  UINTN               Index;
+  UINTN               Unit;
+  UINTN               Units;
+  UINTN               Bits;
+  INTN                End;
+
+  for (Bucket = 0; Bucket < IP4_ASSEMLE_HASH_SIZE; Bucket++) {
+    NET_LIST_FOR_EACH (Entry, &mTable.Bucket[Bucket]) {
+      Assemble = NET_LIST_USER_STRUCT (Entry, IP4_ASSEMBLE_ENTRY, Link);
+      Index    = 0;
+      Units    = 0;
+      End      = 0;
+
+      NET_LIST_FOR_EACH (Cur, &Assemble->Fragments) {
+        if ((Index >= Assemble->IndexCount) ||
+            (&Assemble->Index[Index]->List != Cur)) {
+          return FALSE;
+        }
+        Info = IP4_GET_CLIP_INFO (Assemble->Index[Index]);
+        if ((Info->Start < End) || (Info->Start % IP4_FRAGMENT_UNIT != 0) ||
+            (Info->End <= Info->Start) || (Info->End - Info->Start != Info->Length) ||
+            (Info->Length != (INTN) Assemble->Index[Index]->TotalSize)) {
+          return FALSE;
+        }
+        Units += IP4_FRAGMENT_UNITS (Info->End) - Info->Start / IP4_FRAGMENT_UNIT;
+        End    = Info->End;
+        Index++;
+      }
+
+      if (Index != Assemble->IndexCount) {
+        return FALSE;
+      }
+      Bits = 0;
+      for (Unit = 0; Unit < IP4_FRAGMENT_UNITS (IP4_MAX_PACKET_SIZE); Unit++) {
+        if ((Assemble->Received[Unit / 32] & (1U << (Unit % 32))) != 0) {
+          Bits++;
+        }
+      }
+      if ((Bits != Units) || (Bits != Assemble->ReceivedUnits)) {
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Run a test case: cut a packet into fragments, then feed them to
+  Ip4Reassemble() in some order.
+**/
+VOID
+RunTestCase (
+  IN UINTN  Case
+  )
+{
+  INTN      TotalLen;
+  INTN      MaxLen;
+  INTN      Start;
+  INTN      End;
+  UINTN     Count;
+  UINTN     Extra;
+  UINTN     Index;
+  UINTN     Swap;
+  UINTN     Order;
+  INTN      Missing;
+  INTN      Offset;
+  BOOLEAN   LastSeen;
+  BOOLEAN   Complete;
+  FRAGMENT  Temp;
+  NET_BUF   *Packet;
+  UINT8     *Copy;
+
+  //
+  // Small packets, packets of a few fragments of ethernet MTU, and up
+  // to the largest packet.
+  //
+  switch (Random () % 3) {
+  case 0:
+    MaxLen = 256;
+    break;
+  case 1:
+    MaxLen = 9000;
+    break;
+  default:
+    MaxLen = IP4_MAX_PACKET_SIZE;
+    break;
+  }
+  TotalLen = 1 + (INTN) (Random () % MaxLen);
+
+  for (Offset = 0; Offset < TotalLen; Offset++) {
+    mData[Offset] = (UINT8) Random ();
+  }
+
+  //
+  // Cut the packet in fragments of random length that is a multiple of 8
+  //
+  Count = 0;
+  for (Start = 0; Start < TotalLen; Start = End) {
+    End = Start + 8 * (1 + (INTN) (Random () % ((Random () % 2 == 0) ? 4 : 185)));
+    AddFragment (&Count, Start, MIN (End, TotalLen), TotalLen);
+  }
+
+  //
+  // Leave out a fragment now and then, the packet never completes
+  //
+  if ((Count > 1) && (Random () % 8 == 0)) {
+    Count--;
+    mFragments[Random () % (Count + 1)] = mFragments[Count];
+  }
+
+  //
+  // Add duplicates of the fragments and fragments that overlap them
+  //
+  Extra = (UINTN) (Random () % (Count + 4));
+  while ((Extra-- > 0) && (Count < MAX_FRAGMENTS)) {
+    if (Random () % 2 == 0) {
+      mFragments[Count] = mFragments[Random () % Count];
+      Count++;
+    } else {
+      Start = 8 * (INTN) (Random () % IP4_FRAGMENT_UNITS (TotalLen));
+      End   = Start + 8 * (1 + (INTN) (Random () % 185));
+      AddFragment (&Count, Start, MIN (End, TotalLen), TotalLen);
+    }
+  }
+
+  //
+  // Ascending, descending or random order
+  //
+  Order = (UINTN) (Random () % 4);
+  for (Index = 0; Index < Count; Index++) {
+    if (Order == 0) {
+      Swap = Index;
+      continue;
+    } else if (Order == 1) {
+      Swap = Count - 1 - Index;
+      if (Swap <= Index) {
+        break;
+      }
+    } else {
+      Swap = Index + (UINTN) (Random () % (Count - Index));
+    }
+    Temp              = mFragments[Index];
+    mFragments[Index] = mFragments[Swap];
+    mFragments[Swap]  = Temp;
+  }
+
+  //
+  // Feed the fragments, the packet completes with the first fragment that
+  // leaves no data missing once the last fragment has been seen.
+  //
+  memset (mReceived, 0, TotalLen);
+  Missing  = TotalLen;
+  LastSeen = FALSE;
+  Complete = FALSE;
+
+  for (Index = 0; Index < Count; Index++) {
+    for (Offset = mFragments[Index].Start; Offset < mFragments[Index].End; Offset++) {
+      if (mReceived[Offset] == 0) {
+        mReceived[Offset] = 1;
+        Missing--;
+      }
+    }
+    LastSeen = (BOOLEAN) (LastSeen || mFragments[Index].Last);
+
+    Packet = Ip4Reassemble (&mTable, BuildFragment (Index, (UINT16) Case));
+    if (!CheckAssembleTable ()) {
+      Fail (Case, "the fragment index or bitmap is inconsistent", TotalLen, Index);
+      break;
+    }
+    if (Packet == NULL) {
+      if (LastSeen && (Missing == 0)) {
+        Fail (Case, "the packet isn't delivered", TotalLen, Index);
+        break;
+      }
+      continue;
+    }
+
+    Complete = TRUE;
+    if (!LastSeen || (Missing != 0)) {
+      Fail (Case, "the packet is delivered before it is complete", TotalLen, Index);
+    } else if (Packet->TotalSize != (UINT32) TotalLen) {
+      Fail (Case, "the packet length is wrong", TotalLen, Index);
+    } else if ((Packet->Ip.Ip4->Fragment & IP4_HEAD_OFFSET_MASK) != 0) {
+      Fail (Case, "the packet doesn't have the head of the first fragment", TotalLen, Index);
+    } else {
+      Copy = malloc (TotalLen);
+      NetbufCopy (Packet, 0, (UINT32) TotalLen, Copy);
+      if (memcmp (Copy, mData, TotalLen) != 0) {
+        Fail (Case, "the packet data is wrong", TotalLen, Index);
+      }
+      free (Copy);
+    }
+    NetbufFree (Packet);
+    break;
+  }
+
+  if (!Complete && LastSeen && (Missing == 0)) {
+    Fail (Case, "the packet never completes", TotalLen, Count);
+  }
+
+  Ip4CleanAssembleTable (&mTable);
+  if (mAllocations != 0) {
+    Fail (Case, "memory is leaked", TotalLen, Count);
+    mAllocations = 0;
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINTN  Cases;
+  UINTN  Case;
+
+  Cases        = (argc > 1) ? strtoul (argv[1], NULL, 0) : 3000;
+  mRandomState = (argc > 2) ? strtoull (argv[2], NULL, 0) : 1;
+  if (mRandomState == 0) {
+    mRandomState = 1;
+  }
+
+  mBootServices.FreePool = BootServicesFreePool;
+  Ip4InitAssembleTable (&mTable);
+  for (Case = 0; Case < Cases; Case++) {
+    RunTestCase (Case);
+  }
+
+  printf ("Ip4Reassemble: %u test cases, %u failures\n", (unsigned) Cases, (unsigned) mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
@@ -82,6 +82,20 @@
 ///
 #define HTTP_HEADER_ACCEPT_RANGES      "Accept-Ranges"
 
+///
+/// Range Request Header
+/// The Range request-header field allows a client to request
+/// one or more sub-ranges of an entity, instead of the entire entity.
+///
+#define HTTP_HEADER_RANGE              "Range"
+
+///
+/// Content-Range Response Header
+/// The Content-Range entity-header is sent with a partial entity-body
+/// to specify where in the full entity-body the partial body should be applied.
+///
+#define HTTP_HEADER_CONTENT_RANGE      "Content-Range"
+
 
 /// 
 /// Accept-Encoding Request Header
@@ -176,6 +190,20 @@
 ///
 #define HTTP_HEADER_HOST              "Host"
 
+///
+/// Connection Header
+///
+/// The Connection general-header field allows the sender to specify options that are
+/// desired for that particular connection. The "close" connection option signals that
+/// the connection will be closed after completion of the response.
+///
+#define HTTP_HEADER_CONNECTION        "Connection"
+
+///
+/// Connection Header Value
+///
+#define HTTP_CONNECTION_CLOSE         "close"
+
 ///
 /// Location Response Header
 /// 
@@ -228,6 +256,13 @@
 ///
 #define HTTP_HEADER_ETAG              "ETag"
 
+///
+/// Last-Modified Response Header
+/// The Last-Modified entity-header field indicates the date and time at
+/// which the origin server believes the variant was last modified.
+///
+#define HTTP_HEADER_LAST_MODIFIED     "Last-Modified"
+
 ///
 /// Custom header field checked by the iLO web server to
 /// specify a client session key.
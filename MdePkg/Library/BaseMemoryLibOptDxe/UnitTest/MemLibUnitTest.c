@@ -0,0 +1,297 @@
+/** @file
+  Host unit test and microbenchmark of the X64 CopyMem, SetMem and ZeroMem
+  routines of BaseMemoryLibOptDxe.
+
+  The test compares the assembly routines with the C library over sizes around
+  the non-temporal threshold, random sizes, random alignments and overlapping
+  copies, and checks that no byte outside the target buffer is written. The
+  benchmark reports the throughput of the routines and of the C library for
+  buffer sizes from 4KB to 32MB.
+
+  Usage: MemLibUnitTest [-b] [TestCaseCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#undef NULL
+
+#include <Base.h>
+
+//
+// The assembly routines follow the Microsoft x64 calling convention, which
+// EFIAPI does not select for a host build.
+//
+#define MS_ABI  __attribute__((ms_abi))
+
+//
+// Must match MEM_NON_TEMPORAL_THRESHOLD of X64/CopyMem.nasm, X64/SetMem.nasm
+// and X64/ZeroMem.nasm
+//
+#define MEM_NON_TEMPORAL_THRESHOLD  0x400000
+
+#define GUARD_SIZE                  64
+//
+// Large enough for the test cases and for the largest benchmark size
+//
+#define BUFFER_SIZE                 (SIZE_32MB + SIZE_4KB)
+#define BENCHMARK_BYTES             (256 * SIZE_1MB)
+
+#define ARRAY_SIZE(Array)           (sizeof (Array) / sizeof ((Array)[0]))
+
+MS_ABI VOID *InternalMemCopyMem (VOID *Destination, CONST VOID *Source, UINTN Count);
+MS_ABI VOID *InternalMemSetMem (VOID *Buffer, UINTN Count, UINT8 Value);
+MS_ABI VOID *InternalMemZeroMem (VOID *Buffer, UINTN Count);
+MS_ABI BOOLEAN InternalMemIsAvxUsable (VOID);
+
+UINT8   *mBuffer;
+UINT8   *mSource;
+UINT8   *mExpected;
+
+CONST UINTN  mEdgeSizes[] = {
+  0, 1, 2, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 255, 256, 4095, 4096, 65537,
+  MEM_NON_TEMPORAL_THRESHOLD - 1,
+  MEM_NON_TEMPORAL_THRESHOLD,
+  MEM_NON_TEMPORAL_THRESHOLD + 1,
+  MEM_NON_TEMPORAL_THRESHOLD + 31,
+  MEM_NON_TEMPORAL_THRESHOLD + 33,
+  MEM_NON_TEMPORAL_THRESHOLD * 2 + 17
+};
+
+/**
+  Return a random size, either one around an edge of the routines or a
+  random one of up to twice the non-temporal threshold.
+**/
+UINTN
+RandomSize (
+  VOID
+  )
+{
+  switch (rand () % 8) {
+  case 0:
+    return mEdgeSizes[rand () % ARRAY_SIZE (mEdgeSizes)];
+  case 1:
+    return (UINTN) rand () % 512;
+  case 2:
+  case 3:
+  case 4:
+  case 5:
+    return (UINTN) rand () % SIZE_64KB;
+  default:
+    return (UINTN) rand () % (MEM_NON_TEMPORAL_THRESHOLD * 2);
+  }
+}
+
+/**
+  Fill a buffer with random bytes.
+**/
+VOID
+RandomFill (
+  OUT UINT8  *Buffer,
+  IN  UINTN  Size
+  )
+{
+  UINTN   Index;
+  UINT32  State;
+
+  State = (UINT32) rand () | 1;
+  for (Index = 0; Index < Size; Index++) {
+    State ^= State << 13;
+    State ^= State >> 17;
+    State ^= State << 5;
+    Buffer[Index] = (UINT8) State;
+  }
+}
+
+/**
+  Run one test case of each routine.
+
+  @retval TRUE   All the routines returned the expected buffer.
+  @retval FALSE  A routine failed. The failure has been printed.
+**/
+BOOLEAN
+RunTestCase (
+  IN UINTN  TestCase
+  )
+{
+  UINTN   Count;
+  UINTN   Span;
+  UINTN   DestinationOffset;
+  UINTN   SourceOffset;
+  UINT8   Value;
+  VOID    *Result;
+
+  Count             = RandomSize ();
+  DestinationOffset = GUARD_SIZE + (UINTN) rand () % 64;
+  SourceOffset      = GUARD_SIZE + (UINTN) rand () % 64;
+  Span              = Count + 3 * GUARD_SIZE;
+
+  //
+  // Copy between distinct buffers
+  //
+  RandomFill (mBuffer, Span);
+  RandomFill (mSource, Span);
+  memcpy (mExpected, mBuffer, Span);
+  memcpy (mExpected + DestinationOffset, mSource + SourceOffset, Count);
+  Result = InternalMemCopyMem (mBuffer + DestinationOffset, mSource + SourceOffset, Count);
+  if (Result != mBuffer + DestinationOffset || memcmp (mBuffer, mExpected, Span) != 0) {
+    printf ("Test case %u: CopyMem (+%u, +%u, 0x%x) failed\n",
+      (unsigned) TestCase, (unsigned) DestinationOffset, (unsigned) SourceOffset, (unsigned) Count);
+    return FALSE;
+  }
+
+  //
+  // Copy within one buffer. The offsets of up to 64 bytes make the source
+  // and destination overlap in both directions.
+  //
+  memcpy (mExpected, mBuffer, Span);
+  memmove (mExpected + DestinationOffset, mExpected + SourceOffset, Count);
+  Result = InternalMemCopyMem (mBuffer + DestinationOffset, mBuffer + SourceOffset, Count);
+  if (Result != mBuffer + DestinationOffset || memcmp (mBuffer, mExpected, Span) != 0) {
+    printf ("Test case %u: overlapping CopyMem (+%u, +%u, 0x%x) failed\n",
+      (unsigned) TestCase, (unsigned) DestinationOffset, (unsigned) SourceOffset, (unsigned) Count);
+    return FALSE;
+  }
+
+  Value = (UINT8) rand ();
+  memcpy (mExpected, mBuffer, Span);
+  memset (mExpected + DestinationOffset, Value, Count);
+  Result = InternalMemSetMem (mBuffer + DestinationOffset, Count, Value);
+  if (Result != mBuffer + DestinationOffset || memcmp (mBuffer, mExpected, Span) != 0) {
+    printf ("Test case %u: SetMem (+%u, 0x%x, 0x%02x) failed\n",
+      (unsigned) TestCase, (unsigned) DestinationOffset, (unsigned) Count, Value);
+    return FALSE;
+  }
+
+  RandomFill (mBuffer, Span);
+  memcpy (mExpected, mBuffer, Span);
+  memset (mExpected + SourceOffset, 0, Count);
+  Result = InternalMemZeroMem (mBuffer + SourceOffset, Count);
+  if (Result != mBuffer + SourceOffset || memcmp (mBuffer, mExpected, Span) != 0) {
+    printf ("Test case %u: ZeroMem (+%u, 0x%x) failed\n",
+      (unsigned) TestCase, (unsigned) SourceOffset, (unsigned) Count);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+  Return a monotonic time stamp in seconds.
+**/
+double
+GetTime (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  clock_gettime (CLOCK_MONOTONIC, &Time);
+  return Time.tv_sec + Time.tv_nsec * 1e-9;
+}
+
+/**
+  Print the throughput of the routines and of the C library, in MB/s.
+**/
+VOID
+RunBenchmark (
+  VOID
+  )
+{
+  CONST UINTN  Sizes[] = { SIZE_4KB, SIZE_64KB, SIZE_1MB, SIZE_4MB, SIZE_32MB };
+  UINTN        SizeIndex;
+  UINTN        Repeat;
+  UINTN        Index;
+  double       Time[7];
+
+  printf ("%10s %12s %12s %12s %12s %12s %12s\n",
+    "Size", "CopyMem", "memcpy", "SetMem", "memset", "ZeroMem", "memset(0)");
+  for (SizeIndex = 0; SizeIndex < ARRAY_SIZE (Sizes); SizeIndex++) {
+    Repeat = BENCHMARK_BYTES / Sizes[SizeIndex];
+
+    Time[0] = GetTime ();
+    for (Index = 0; Index < Repeat; Index++) {
+      InternalMemCopyMem (mBuffer, mSource + 1, Sizes[SizeIndex]);
+    }
+    Time[1] = GetTime ();
+    for (Index = 0; Index < Repeat; Index++) {
+      memcpy (mBuffer, mSource + 1, Sizes[SizeIndex]);
+    }
+    Time[2] = GetTime ();
+    for (Index = 0; Index < Repeat; Index++) {
+      InternalMemSetMem (mBuffer, Sizes[SizeIndex], 0x5A);
+    }
+    Time[3] = GetTime ();
+    for (Index = 0; Index < Repeat; Index++) {
+      memset (mBuffer, 0x5A, Sizes[SizeIndex]);
+    }
+    Time[4] = GetTime ();
+    for (Index = 0; Index < Repeat; Index++) {
+      InternalMemZeroMem (mBuffer, Sizes[SizeIndex]);
+    }
+    Time[5] = GetTime ();
+    for (Index = 0; Index < Repeat; Index++) {
+      memset (mBuffer, 0, Sizes[SizeIndex]);
+    }
+    Time[6] = GetTime ();
+
+    printf ("%10u", (unsigned) Sizes[SizeIndex]);
+    for (Index = 0; Index < 6; Index++) {
+      printf (" %7.0f MB/s", (BENCHMARK_BYTES / SIZE_1MB) / (Time[Index + 1] - Time[Index]));
+    }
+    printf ("\n");
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  BOOLEAN  Benchmark;
+  UINTN    TestCaseCount;
+  UINTN    TestCase;
+  UINTN    Failures;
+
+  Benchmark = (argc > 1 && strcmp (argv[1], "-b") == 0);
+  if (Benchmark) {
+    argc--;
+    argv++;
+  }
+  TestCaseCount = (argc > 1) ? strtoul (argv[1], NULL, 0) : 1000;
+  srand ((argc > 2) ? (unsigned) strtoul (argv[2], NULL, 0) : 1);
+
+  mBuffer   = malloc (BUFFER_SIZE);
+  mSource   = malloc (BUFFER_SIZE);
+  mExpected = malloc (BUFFER_SIZE);
+  if (mBuffer == NULL || mSource == NULL || mExpected == NULL) {
+    return 1;
+  }
+
+  printf ("AVX %s\n", InternalMemIsAvxUsable () ? "usable" : "not usable, the SSE non-temporal path is tested");
+
+  Failures = 0;
+  for (TestCase = 0; TestCase < TestCaseCount; TestCase++) {
+    if (!RunTestCase (TestCase)) {
+      Failures++;
+    }
+  }
+  printf ("BaseMemoryLibOptDxe: %u test cases, %u failed\n", (unsigned) TestCaseCount, (unsigned) Failures);
+
+  if (Benchmark && Failures == 0) {
+    RunBenchmark ();
+  }
+  return (Failures == 0) ? 0 : 1;
+}
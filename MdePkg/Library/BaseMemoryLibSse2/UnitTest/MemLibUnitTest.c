@@ -0,0 +1,348 @@
+/** @file
+  Host differential test of the X64 CompareMem, ScanMem8/16/32/64 and
+  IsZeroBuffer routines of BaseMemoryLibSse2.
+
+  Every test case compares the result of the assembly routines with the C
+  implementation of BaseMemoryLib, for random lengths, random alignments,
+  random match and mismatch positions and overlapping buffers. The buffers are
+  placed against inaccessible guard pages, so that a routine that reads before
+  the start or past the end of a buffer faults.
+
+  BaseMemoryLib compares signed bytes in InternalMemCompareMem(), while all the
+  assembly instances return the difference of the unsigned bytes. The result of
+  CompareMem is therefore checked against BaseMemoryLib for equality, and
+  against the unsigned difference of the first mismatched bytes for its value.
+
+  Usage: MemLibUnitTest [TestCaseCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#undef NULL
+
+#include <Base.h>
+
+//
+// The assembly routines follow the Microsoft x64 calling convention, which
+// EFIAPI does not select for a host build.
+//
+#define MS_ABI  __attribute__((ms_abi))
+
+#define PAGE_SIZE          SIZE_4KB
+#define DATA_SIZE          SIZE_128KB
+
+MS_ABI INTN InternalMemCompareMem (CONST VOID *DestinationBuffer, CONST VOID *SourceBuffer, UINTN Length);
+MS_ABI CONST VOID *InternalMemScanMem8 (CONST VOID *Buffer, UINTN Length, UINT8 Value);
+MS_ABI CONST VOID *InternalMemScanMem16 (CONST VOID *Buffer, UINTN Length, UINT16 Value);
+MS_ABI CONST VOID *InternalMemScanMem32 (CONST VOID *Buffer, UINTN Length, UINT32 Value);
+MS_ABI CONST VOID *InternalMemScanMem64 (CONST VOID *Buffer, UINTN Length, UINT64 Value);
+MS_ABI BOOLEAN InternalMemIsZeroBuffer (CONST VOID *Buffer, UINTN Length);
+
+INTN EFIAPI ReferenceMemCompareMem (CONST VOID *DestinationBuffer, CONST VOID *SourceBuffer, UINTN Length);
+CONST VOID * EFIAPI ReferenceMemScanMem8 (CONST VOID *Buffer, UINTN Length, UINT8 Value);
+CONST VOID * EFIAPI ReferenceMemScanMem16 (CONST VOID *Buffer, UINTN Length, UINT16 Value);
+CONST VOID * EFIAPI ReferenceMemScanMem32 (CONST VOID *Buffer, UINTN Length, UINT32 Value);
+CONST VOID * EFIAPI ReferenceMemScanMem64 (CONST VOID *Buffer, UINTN Length, UINT64 Value);
+BOOLEAN EFIAPI ReferenceMemIsZeroBuffer (CONST VOID *Buffer, UINTN Length);
+
+//
+// Two data areas, each surrounded by inaccessible pages
+//
+UINT8   *mData[2];
+
+/**
+  Satisfy the InternalMemZeroMem() of BaseMemoryLib, which is not tested and
+  would otherwise bring SetMem.c and BaseLib in.
+**/
+VOID *
+EFIAPI
+ReferenceMemSetMem (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT8  Value
+  )
+{
+  return memset (Buffer, Value, Length);
+}
+
+/**
+  Allocate a data area between two inaccessible guard pages.
+**/
+UINT8 *
+AllocateGuardedData (
+  VOID
+  )
+{
+  UINT8  *Pages;
+
+  Pages = mmap (NULL, DATA_SIZE + 2 * PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (Pages == MAP_FAILED) {
+    return NULL;
+  }
+  mprotect (Pages, PAGE_SIZE, PROT_NONE);
+  mprotect (Pages + PAGE_SIZE + DATA_SIZE, PAGE_SIZE, PROT_NONE);
+  return Pages + PAGE_SIZE;
+}
+
+/**
+  Return a random length in bytes, mostly short ones.
+**/
+UINTN
+RandomLength (
+  VOID
+  )
+{
+  switch (rand () % 8) {
+  case 0:
+    return 1 + (UINTN) rand () % SIZE_4KB;
+  case 1:
+    return 1 + (UINTN) rand () % (DATA_SIZE - 2 * 64);
+  default:
+    return 1 + (UINTN) rand () % 80;
+  }
+}
+
+/**
+  Return a random buffer of Length bytes and of the alignment of Width bytes
+  in a data area. It starts at the beginning of the area, after the guard
+  page, or ends at its end, before the other guard page.
+**/
+UINT8 *
+RandomBuffer (
+  IN UINT8  *Data,
+  IN UINTN  Length,
+  IN UINTN  Width
+  )
+{
+  UINTN  Offset;
+
+  Offset = (UINTN) rand () % 64;
+  if (rand () % 2 == 0) {
+    Offset = DATA_SIZE - Length - Offset;
+  }
+  return Data + (Offset & ~(Width - 1));
+}
+
+/**
+  Fill a buffer with bytes of a small range, so that random values and
+  mismatches are found at all positions.
+**/
+VOID
+RandomFill (
+  OUT UINT8  *Buffer,
+  IN  UINTN  Length,
+  IN  UINT8  Mask
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    Buffer[Index] = (UINT8) rand () & Mask;
+  }
+}
+
+/**
+  Check CompareMem with a distinct or an overlapping source buffer.
+**/
+BOOLEAN
+TestCompareMem (
+  IN UINTN  TestCase
+  )
+{
+  UINTN    Length;
+  UINT8    *Destination;
+  UINT8    *Source;
+  UINTN    Index;
+  INTN     Result;
+  INTN     Reference;
+  INTN     Expected;
+
+  Length      = RandomLength ();
+  Destination = RandomBuffer (mData[0], Length, 1);
+  if (rand () % 4 == 0) {
+    //
+    // Overlapping buffers, which are equal when the pattern repeats
+    //
+    Source = Destination + (rand () % 33) - 16;
+    if (Source < mData[0] || Source + Length > mData[0] + DATA_SIZE) {
+      Source = Destination;
+    }
+    RandomFill (mData[0], DATA_SIZE, (rand () % 2 == 0) ? 0 : 0xFF);
+  } else {
+    Source = RandomBuffer (mData[1], Length, 1);
+    RandomFill (Destination, Length, 0xFF);
+    memcpy (Source, Destination, Length);
+    //
+    // Flip a few bits, mostly one of them, anywhere in the buffer, including
+    // the sign bit.
+    //
+    for (Index = (UINTN) rand () % 3; Index > 0; Index--) {
+      Source[(UINTN) rand () % Length] ^= (UINT8) (1 << (rand () % 8));
+    }
+  }
+
+  Expected = 0;
+  for (Index = 0; Index < Length; Index++) {
+    if (Destination[Index] != Source[Index]) {
+      Expected = (INTN) Destination[Index] - (INTN) Source[Index];
+      break;
+    }
+  }
+
+  Result    = InternalMemCompareMem (Destination, Source, Length);
+  Reference = ReferenceMemCompareMem (Destination, Source, Length);
+  if ((Result == 0) != (Reference == 0) || Result != Expected) {
+    printf ("Test case %u: CompareMem (%p, %p, 0x%x) - %d, BaseMemoryLib %d, expected %d\n",
+      (unsigned) TestCase, Destination, Source, (unsigned) Length, (int) Result, (int) Reference, (int) Expected);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+  Check ScanMem8/16/32/64 with the value at a random position, at several
+  positions or nowhere.
+**/
+BOOLEAN
+TestScanMem (
+  IN UINTN  TestCase
+  )
+{
+  UINTN       Width;
+  UINTN       Length;
+  UINT8       *Buffer;
+  UINT64      Value;
+  UINTN       Index;
+  CONST VOID  *Result;
+  CONST VOID  *Reference;
+
+  Width  = (UINTN) 1 << (rand () % 4);
+  Length = (RandomLength () + Width - 1) / Width;
+  Buffer = RandomBuffer (mData[0], Length * Width, Width);
+
+  //
+  // The elements are made of 0 and 1 bytes, the value is any of them or
+  // one that is not in the buffer.
+  //
+  RandomFill (Buffer, Length * Width, 1);
+  Value = 0;
+  switch (rand () % 3) {
+  case 0:
+    memcpy (&Value, Buffer + ((UINTN) rand () % Length) * Width, Width);
+    break;
+  case 1:
+    memset (&Value, 2, Width);
+    memcpy (Buffer + ((UINTN) rand () % Length) * Width, &Value, Width);
+    break;
+  default:
+    memset (&Value, 2, Width);
+    break;
+  }
+  if (rand () % 4 == 0) {
+    //
+    // Long runs of zero, so that the value is often not found in a block
+    //
+    for (Index = 0; Index < Length * Width; Index++) {
+      Buffer[Index] = (rand () % 64 == 0) ? Buffer[Index] : 0;
+    }
+  }
+
+  switch (Width) {
+  case 1:
+    Result    = InternalMemScanMem8 (Buffer, Length, (UINT8) Value);
+    Reference = ReferenceMemScanMem8 (Buffer, Length, (UINT8) Value);
+    break;
+  case 2:
+    Result    = InternalMemScanMem16 (Buffer, Length, (UINT16) Value);
+    Reference = ReferenceMemScanMem16 (Buffer, Length, (UINT16) Value);
+    break;
+  case 4:
+    Result    = InternalMemScanMem32 (Buffer, Length, (UINT32) Value);
+    Reference = ReferenceMemScanMem32 (Buffer, Length, (UINT32) Value);
+    break;
+  default:
+    Result    = InternalMemScanMem64 (Buffer, Length, Value);
+    Reference = ReferenceMemScanMem64 (Buffer, Length, Value);
+    break;
+  }
+
+  if (Result != Reference) {
+    printf ("Test case %u: ScanMem%u (%p, 0x%x, 0x%llx) - %p, expected %p\n",
+      (unsigned) TestCase, (unsigned) Width * 8, Buffer, (unsigned) Length, (unsigned long long) Value, Result, Reference);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+  Check IsZeroBuffer with no, one or more non-zero bytes.
+**/
+BOOLEAN
+TestIsZeroBuffer (
+  IN UINTN  TestCase
+  )
+{
+  UINTN    Length;
+  UINT8    *Buffer;
+  UINTN    Index;
+  BOOLEAN  Result;
+  BOOLEAN  Reference;
+
+  Length = RandomLength ();
+  Buffer = RandomBuffer (mData[0], Length, 1);
+  memset (Buffer, 0, Length);
+  for (Index = (UINTN) rand () % 3; Index > 0; Index--) {
+    Buffer[(rand () % 4 == 0) ? Length - 1 : (UINTN) rand () % Length] = (UINT8) (1 << (rand () % 8));
+  }
+
+  Result    = InternalMemIsZeroBuffer (Buffer, Length);
+  Reference = ReferenceMemIsZeroBuffer (Buffer, Length);
+  if (Result != Reference) {
+    printf ("Test case %u: IsZeroBuffer (%p, 0x%x) - %d, expected %d\n",
+      (unsigned) TestCase, Buffer, (unsigned) Length, Result, Reference);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINTN  TestCaseCount;
+  UINTN  TestCase;
+  UINTN  Failures;
+
+  TestCaseCount = (argc > 1) ? strtoul (argv[1], NULL, 0) : 20000;
+  srand ((argc > 2) ? (unsigned) strtoul (argv[2], NULL, 0) : 1);
+
+  mData[0] = AllocateGuardedData ();
+  mData[1] = AllocateGuardedData ();
+  if (mData[0] == NULL || mData[1] == NULL) {
+    return 1;
+  }
+
+  Failures = 0;
+  for (TestCase = 0; TestCase < TestCaseCount; TestCase++) {
+    if (!TestCompareMem (TestCase) || !TestScanMem (TestCase) || !TestIsZeroBuffer (TestCase)) {
+      Failures++;
+    }
+  }
+
+  printf ("BaseMemoryLibSse2: %u test cases, %u failed\n", (unsigned) TestCaseCount, (unsigned) Failures);
+  return (Failures == 0) ? 0 : 1;
+}
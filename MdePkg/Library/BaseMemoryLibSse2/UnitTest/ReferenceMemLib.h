@@ -0,0 +1,33 @@
+/** @file
+  Renames the internal functions of BaseMemoryLib, so that its C
+  implementation can be linked with the assembly routines of
+  BaseMemoryLibSse2 as the reference of the host unit test.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _REFERENCE_MEM_LIB_H_
+#define _REFERENCE_MEM_LIB_H_
+
+#define InternalMemSetMem       ReferenceMemSetMem
+#define InternalMemSetMem16     ReferenceMemSetMem16
+#define InternalMemSetMem32     ReferenceMemSetMem32
+#define InternalMemSetMem64     ReferenceMemSetMem64
+#define InternalMemZeroMem      ReferenceMemZeroMem
+#define InternalMemCopyMem      ReferenceMemCopyMem
+#define InternalMemCompareMem   ReferenceMemCompareMem
+#define InternalMemScanMem8     ReferenceMemScanMem8
+#define InternalMemScanMem16    ReferenceMemScanMem16
+#define InternalMemScanMem32    ReferenceMemScanMem32
+#define InternalMemScanMem64    ReferenceMemScanMem64
+#define InternalMemIsZeroBuffer ReferenceMemIsZeroBuffer
+
+#endif
@@ -434,24 +434,26 @@ HttpBootDiscoverBootInfo (
 }
 
 /**
-  Create a HttpIo instance for the file download.
+  Create and configure a HTTP child with the station address of the HTTP boot instance.
 
   @param[in]    Private        The pointer to the driver's private data.
+  @param[out]   HttpIo         The HTTP_IO to be created.
 
   @retval EFI_SUCCESS          Successfully created.
   @retval Others               Failed to create HttpIo.
 
 **/
 EFI_STATUS
-HttpBootCreateHttpIo (
-  IN     HTTP_BOOT_PRIVATE_DATA       *Private
+HttpBootCreateHttpChild (
+  IN     HTTP_BOOT_PRIVATE_DATA       *Private,
+     OUT HTTP_IO                      *HttpIo
   )
 {
   HTTP_IO_CONFIG_DATA          ConfigData;
-  EFI_STATUS                   Status;
   EFI_HANDLE                   ImageHandle;
 
   ASSERT (Private != NULL);
+  ASSERT (HttpIo != NULL);
 
   ZeroMem (&ConfigData, sizeof (HTTP_IO_CONFIG_DATA));
   if (!Private->UsingIpv6) {
@@ -467,13 +469,34 @@ HttpBootCreateHttpIo (
     ImageHandle = Private->Ip6Nic->ImageHandle;
   }
 
-  Status = HttpIoCreateIo (
-             ImageHandle,
-             Private->Controller,
-             Private->UsingIpv6 ? IP_VERSION_6 : IP_VERSION_4,
-             &ConfigData,
-             &Private->HttpIo
-             );
+  return HttpIoCreateIo (
+           ImageHandle,
+           Private->Controller,
+           Private->UsingIpv6 ? IP_VERSION_6 : IP_VERSION_4,
+           &ConfigData,
+           HttpIo
+           );
+}
+
+/**
+  Create a HttpIo instance for the file download.
+
+  @param[in]    Private        The pointer to the driver's private data.
+
+  @retval EFI_SUCCESS          Successfully created.
+  @retval Others               Failed to create HttpIo.
+
+**/
+EFI_STATUS
+HttpBootCreateHttpIo (
+  IN     HTTP_BOOT_PRIVATE_DATA       *Private
+  )
+{
+  EFI_STATUS                   Status;
+
+  ASSERT (Private != NULL);
+
+  Status = HttpBootCreateHttpChild (Private, &Private->HttpIo);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -642,6 +665,281 @@ HttpBootGetFileFromCache (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Release a boot file kept across boot attempts.
+
+  @param[in]          Entry           The pointer to the kept boot file.
+
+**/
+VOID
+HttpBootFreeBootFileCacheEntry (
+  IN  HTTP_BOOT_FILE_CACHE       *Entry
+  )
+{
+  FreePool (Entry->Uri);
+  if (Entry->ETag != NULL) {
+    FreePool (Entry->ETag);
+  }
+  if (Entry->LastModified != NULL) {
+    FreePool (Entry->LastModified);
+  }
+  FreePages (Entry->Data, EFI_SIZE_TO_PAGES (Entry->Size));
+  FreePool (Entry);
+}
+
+/**
+  Release all the boot files kept across boot attempts.
+
+  @param[in]          Private         The pointer to the driver's private data.
+
+**/
+VOID
+HttpBootFreeBootFileCache (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private
+  )
+{
+  LIST_ENTRY                  *Entry;
+  LIST_ENTRY                  *NextEntry;
+  HTTP_BOOT_FILE_CACHE        *CacheEntry;
+
+  NET_LIST_FOR_EACH_SAFE (Entry, NextEntry, &Private->BootFileCacheList) {
+    CacheEntry = NET_LIST_USER_STRUCT (Entry, HTTP_BOOT_FILE_CACHE, Link);
+    RemoveEntryList (&CacheEntry->Link);
+    HttpBootFreeBootFileCacheEntry (CacheEntry);
+  }
+  Private->BootFileCacheSize = 0;
+
+  DEBUG ((
+    EFI_D_INFO,
+    "HttpBootFreeBootFileCache: %d hits, %d misses\n",
+    (UINT32) Private->BootFileCacheHits,
+    (UINT32) Private->BootFileCacheMisses
+    ));
+}
+
+/**
+  Record the cache validators of the boot file reported by the server.
+
+  @param[in]          Private         The pointer to the driver's private data.
+  @param[in]          HeaderCount     Number of HTTP header structures in Headers.
+  @param[in]          Headers         Array containing list of HTTP headers.
+
+**/
+VOID
+HttpBootSetBootFileValidators (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN     UINTN                    HeaderCount,
+  IN     EFI_HTTP_HEADER          *Headers
+  )
+{
+  EFI_HTTP_HEADER             *Header;
+
+  if (Private->BootFileETag != NULL) {
+    FreePool (Private->BootFileETag);
+    Private->BootFileETag = NULL;
+  }
+  if (Private->BootFileLastModified != NULL) {
+    FreePool (Private->BootFileLastModified);
+    Private->BootFileLastModified = NULL;
+  }
+
+  Header = HttpFindHeader (HeaderCount, Headers, HTTP_HEADER_ETAG);
+  if (Header != NULL) {
+    Private->BootFileETag = AllocateCopyPool (AsciiStrSize (Header->FieldValue), Header->FieldValue);
+  }
+
+  Header = HttpFindHeader (HeaderCount, Headers, HTTP_HEADER_LAST_MODIFIED);
+  if (Header != NULL) {
+    Private->BootFileLastModified = AllocateCopyPool (AsciiStrSize (Header->FieldValue), Header->FieldValue);
+  }
+}
+
+/**
+  Check whether an optional cache validator of a kept boot file matches the
+  one reported by the server.
+
+  @param[in]          Kept            The validator recorded with the kept boot file.
+  @param[in]          Current         The validator reported by the server.
+
+  @retval TRUE        The validators are both absent or equal.
+  @retval FALSE       The validators differ.
+
+**/
+BOOLEAN
+HttpBootValidatorMatch (
+  IN     CHAR8                    *Kept,
+  IN     CHAR8                    *Current
+  )
+{
+  if (Kept == NULL || Current == NULL) {
+    return (BOOLEAN) (Kept == Current);
+  }
+
+  return (BOOLEAN) (AsciiStrCmp (Kept, Current) == 0);
+}
+
+/**
+  Load the boot file from the files kept by previous boot attempts, if the server
+  reports the same size, ETag and Last-Modified for it.
+
+  @param[in]          Private         The pointer to the driver's private data.
+  @param[in, out]     BufferSize      On input the size of Buffer in bytes. On output with a return
+                                      code of EFI_SUCCESS, the amount of data transferred to
+                                      Buffer.
+  @param[out]         Buffer          The memory buffer to transfer the file to.
+  @param[out]         ImageType       The image type of the kept file.
+
+  @retval EFI_SUCCESS          The boot file is loaded from memory.
+  @retval EFI_NOT_FOUND        No valid copy of the boot file is kept.
+
+**/
+EFI_STATUS
+HttpBootGetFileFromBootFileCache (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN OUT UINTN                    *BufferSize,
+     OUT UINT8                    *Buffer,
+     OUT HTTP_BOOT_IMAGE_TYPE     *ImageType
+  )
+{
+  LIST_ENTRY                  *Entry;
+  LIST_ENTRY                  *NextEntry;
+  HTTP_BOOT_FILE_CACHE        *CacheEntry;
+
+  //
+  // Without a validator there is no way to tell whether the file has been changed on the server.
+  //
+  if (PcdGet32 (PcdHttpBootCacheSize) == 0 ||
+      (Private->BootFileETag == NULL && Private->BootFileLastModified == NULL)) {
+    return EFI_NOT_FOUND;
+  }
+
+  NET_LIST_FOR_EACH_SAFE (Entry, NextEntry, &Private->BootFileCacheList) {
+    CacheEntry = NET_LIST_USER_STRUCT (Entry, HTTP_BOOT_FILE_CACHE, Link);
+    if (AsciiStrCmp (CacheEntry->Uri, Private->BootFileUri) != 0) {
+      continue;
+    }
+
+    if (CacheEntry->Size != Private->BootFileSize ||
+        !HttpBootValidatorMatch (CacheEntry->ETag, Private->BootFileETag) ||
+        !HttpBootValidatorMatch (CacheEntry->LastModified, Private->BootFileLastModified)) {
+      //
+      // The file has been changed on the server, drop the stale copy.
+      //
+      RemoveEntryList (&CacheEntry->Link);
+      Private->BootFileCacheSize -= CacheEntry->Size;
+      HttpBootFreeBootFileCacheEntry (CacheEntry);
+      break;
+    }
+
+    if (*BufferSize < CacheEntry->Size) {
+      break;
+    }
+
+    CopyMem (Buffer, CacheEntry->Data, CacheEntry->Size);
+    *BufferSize = CacheEntry->Size;
+    *ImageType  = CacheEntry->ImageType;
+
+    //
+    // Keep the list in least recently used order.
+    //
+    RemoveEntryList (&CacheEntry->Link);
+    InsertTailList (&Private->BootFileCacheList, &CacheEntry->Link);
+
+    Private->BootFileCacheHits++;
+    DEBUG ((EFI_D_INFO, "HttpBootGetFileFromBootFileCache: hit %a\n", Private->BootFileUri));
+    return EFI_SUCCESS;
+  }
+
+  Private->BootFileCacheMisses++;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Keep a copy of the downloaded boot file for later boot attempts.
+
+  The oldest kept files are dropped if the total size would exceed PcdHttpBootCacheSize.
+
+  @param[in]          Private         The pointer to the driver's private data.
+  @param[in]          BufferSize      The size of the boot file.
+  @param[in]          Buffer          The downloaded boot file.
+  @param[in]          ImageType       The image type of the boot file.
+
+**/
+VOID
+HttpBootSaveFileToBootFileCache (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN     UINTN                    BufferSize,
+  IN     UINT8                    *Buffer,
+  IN     HTTP_BOOT_IMAGE_TYPE     ImageType
+  )
+{
+  LIST_ENTRY                  *Entry;
+  LIST_ENTRY                  *NextEntry;
+  HTTP_BOOT_FILE_CACHE        *CacheEntry;
+  UINTN                       CacheLimit;
+
+  CacheLimit = PcdGet32 (PcdHttpBootCacheSize);
+  if (BufferSize == 0 || BufferSize > CacheLimit ||
+      (Private->BootFileETag == NULL && Private->BootFileLastModified == NULL)) {
+    return;
+  }
+
+  //
+  // Drop the previous copy of the same file, and the least recently used
+  // files until the new one fits.
+  //
+  NET_LIST_FOR_EACH_SAFE (Entry, NextEntry, &Private->BootFileCacheList) {
+    CacheEntry = NET_LIST_USER_STRUCT (Entry, HTTP_BOOT_FILE_CACHE, Link);
+    if (AsciiStrCmp (CacheEntry->Uri, Private->BootFileUri) == 0 ||
+        Private->BootFileCacheSize + BufferSize > CacheLimit) {
+      RemoveEntryList (&CacheEntry->Link);
+      Private->BootFileCacheSize -= CacheEntry->Size;
+      HttpBootFreeBootFileCacheEntry (CacheEntry);
+    }
+  }
+
+  CacheEntry = AllocateZeroPool (sizeof (HTTP_BOOT_FILE_CACHE));
+  if (CacheEntry == NULL) {
+    return;
+  }
+
+  CacheEntry->Uri  = AllocateCopyPool (AsciiStrSize (Private->BootFileUri), Private->BootFileUri);
+  CacheEntry->Data = AllocatePages (EFI_SIZE_TO_PAGES (BufferSize));
+  if (Private->BootFileETag != NULL) {
+    CacheEntry->ETag = AllocateCopyPool (AsciiStrSize (Private->BootFileETag), Private->BootFileETag);
+  }
+  if (Private->BootFileLastModified != NULL) {
+    CacheEntry->LastModified = AllocateCopyPool (
+                                 AsciiStrSize (Private->BootFileLastModified),
+                                 Private->BootFileLastModified
+                                 );
+  }
+  if (CacheEntry->Uri == NULL || CacheEntry->Data == NULL ||
+      (Private->BootFileETag != NULL && CacheEntry->ETag == NULL) ||
+      (Private->BootFileLastModified != NULL && CacheEntry->LastModified == NULL)) {
+    if (CacheEntry->Uri != NULL) {
+      FreePool (CacheEntry->Uri);
+    }
+    if (CacheEntry->Data != NULL) {
+      FreePages (CacheEntry->Data, EFI_SIZE_TO_PAGES (BufferSize));
+    }
+    if (CacheEntry->ETag != NULL) {
+      FreePool (CacheEntry->ETag);
+    }
+    if (CacheEntry->LastModified != NULL) {
+      FreePool (CacheEntry->LastModified);
+    }
+    FreePool (CacheEntry);
+    return;
+  }
+
+  CopyMem (CacheEntry->Data, Buffer, BufferSize);
+  CacheEntry->Size      = BufferSize;
+  CacheEntry->ImageType = ImageType;
+  InsertTailList (&Private->BootFileCacheList, &CacheEntry->Link);
+  Private->BootFileCacheSize += BufferSize;
+}
+
 /**
   A callback function to intercept events during message parser.
 
@@ -758,6 +1056,7 @@ HttpBootGetBootFile (
   CHAR16                     *Url;
   BOOLEAN                    IdentityMode;
   UINTN                      ReceivedSize;
+  EFI_HTTP_HEADER            *Header;
   
   ASSERT (Private != NULL);
   ASSERT (Private->HttpCreated);
@@ -941,6 +1240,24 @@ HttpBootGetBootFile (
     goto ERROR_5;
   }
 
+  //
+  // Record whether the server accepts byte range requests for the file, so that
+  // the download can be split over several connections.
+  //
+  if (HeaderOnly) {
+    Header = HttpFindHeader (
+               ResponseData->HeaderCount,
+               ResponseData->Headers,
+               HTTP_HEADER_ACCEPT_RANGES
+               );
+    Private->AcceptRanges = (BOOLEAN) ((Header != NULL) && (AsciiStriCmp (Header->FieldValue, "bytes") == 0));
+
+    //
+    // Record the validators used to check the boot file kept by previous boot attempts.
+    //
+    HttpBootSetBootFileValidators (Private, ResponseData->HeaderCount, ResponseData->Headers);
+  }
+
   //
   // 3.2 Cache the response header.
   //
@@ -1129,3 +1446,488 @@ ERROR_1:
   return Status;
 }
 
+/**
+  Get the time elapsed since a performance counter value was sampled.
+
+  @param[in]  StartTick          The performance counter value at the start.
+
+  @return The elapsed time in milliseconds.
+
+**/
+UINT64
+HttpBootGetElapsedTime (
+  IN UINT64                       StartTick
+  )
+{
+  UINT64                     StartValue;
+  UINT64                     EndValue;
+  UINT64                     CurrentTick;
+  UINT64                     Delta;
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  CurrentTick = GetPerformanceCounter ();
+
+  //
+  // The performance counter may count down.
+  //
+  if (EndValue >= StartValue) {
+    Delta = CurrentTick - StartTick;
+  } else {
+    Delta = StartTick - CurrentTick;
+  }
+
+  return DivU64x32 (GetTimeInNanoSecond (Delta), 1000000);
+}
+
+/**
+  Build the HTTP request for a range connection and queue it to the HTTP child.
+
+  @param[in]       HostName        The host name of the boot file URI.
+  @param[in]       Url             The boot file URI.
+  @param[in, out]  Connection      The range connection.
+
+  @retval EFI_SUCCESS              The request has been queued.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+  @retval Others                   Failed to queue the request.
+
+**/
+EFI_STATUS
+HttpBootRangeSendRequest (
+  IN     CHAR8                        *HostName,
+  IN     CHAR16                       *Url,
+  IN OUT HTTP_BOOT_RANGE_CONNECTION   *Connection
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_IO                    *HttpIo;
+  CHAR8                      RangeValue[sizeof ("bytes=18446744073709551615-18446744073709551615")];
+
+  //
+  // 4 headers are needed to download a range of the boot file:
+  //       Host
+  //       Accept
+  //       User-Agent
+  //       Range
+  //
+  Connection->RequestHeader = HttpBootCreateHeader (4);
+  if (Connection->RequestHeader == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = HttpBootSetHeader (Connection->RequestHeader, HTTP_HEADER_HOST, HostName);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = HttpBootSetHeader (Connection->RequestHeader, HTTP_HEADER_ACCEPT, "*/*");
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = HttpBootSetHeader (Connection->RequestHeader, HTTP_HEADER_USER_AGENT, HTTP_USER_AGENT_EFI_HTTP_BOOT);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  AsciiSPrint (
+    RangeValue,
+    sizeof (RangeValue),
+    "bytes=%lu-%lu",
+    (UINT64) Connection->Offset,
+    (UINT64) (Connection->Offset + Connection->Length - 1)
+    );
+  Status = HttpBootSetHeader (Connection->RequestHeader, HTTP_HEADER_RANGE, RangeValue);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Connection->RequestData.Method = HttpMethodGet;
+  Connection->RequestData.Url    = Url;
+
+  //
+  // Queue the request token without waiting for it, all the connections are
+  // polled together by the caller.
+  //
+  HttpIo = &Connection->HttpIo;
+  HttpIo->ReqToken.Status                = EFI_NOT_READY;
+  HttpIo->ReqToken.Message->Data.Request = &Connection->RequestData;
+  HttpIo->ReqToken.Message->HeaderCount  = Connection->RequestHeader->HeaderCount;
+  HttpIo->ReqToken.Message->Headers      = Connection->RequestHeader->Headers;
+  HttpIo->ReqToken.Message->BodyLength   = 0;
+  HttpIo->ReqToken.Message->Body         = NULL;
+  HttpIo->IsTxDone                       = FALSE;
+
+  Status = HttpIo->Http->Request (HttpIo->Http, &HttpIo->ReqToken);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Connection->State = HttpBootRangeStateRequest;
+  return gBS->SetTimer (HttpIo->TimeoutEvent, TimerRelative, HTTP_BOOT_RESPONSE_TIMEOUT * TICKS_PER_MS);
+}
+
+/**
+  Queue a response token to the HTTP child of a range connection, to receive either
+  the response header or the rest of the message-body according to the connection state.
+
+  The message-body is received directly into its place in the caller's buffer.
+
+  @param[in, out]  Connection      The range connection.
+  @param[in]       Buffer          The memory buffer to transfer the boot file to.
+
+  @retval EFI_SUCCESS              The response token has been queued.
+  @retval Others                   Failed to queue the response token.
+
+**/
+EFI_STATUS
+HttpBootRangeQueueResponse (
+  IN OUT HTTP_BOOT_RANGE_CONNECTION   *Connection,
+  IN     UINT8                        *Buffer
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_IO                    *HttpIo;
+
+  HttpIo = &Connection->HttpIo;
+  HttpIo->RspToken.Status               = EFI_NOT_READY;
+  HttpIo->RspToken.Message->HeaderCount = 0;
+  HttpIo->RspToken.Message->Headers     = NULL;
+  if (Connection->State == HttpBootRangeStateHeader) {
+    HttpIo->RspToken.Message->Data.Response = &Connection->Response;
+    HttpIo->RspToken.Message->BodyLength    = 0;
+    HttpIo->RspToken.Message->Body          = NULL;
+  } else {
+    HttpIo->RspToken.Message->Data.Response = NULL;
+    HttpIo->RspToken.Message->BodyLength    = Connection->Length - Connection->ReceivedSize;
+    HttpIo->RspToken.Message->Body          = Buffer + Connection->Offset + Connection->ReceivedSize;
+  }
+  HttpIo->IsRxDone = FALSE;
+
+  Status = HttpIo->Http->Response (HttpIo->Http, &HttpIo->RspToken);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return gBS->SetTimer (HttpIo->TimeoutEvent, TimerRelative, HTTP_BOOT_RESPONSE_TIMEOUT * TICKS_PER_MS);
+}
+
+/**
+  Check that the server replied the requested byte range of the boot file.
+
+  @param[in]  Connection           The range connection.
+
+  @retval EFI_SUCCESS              The response contains the requested range.
+  @retval EFI_UNSUPPORTED          The server didn't honor the range request.
+
+**/
+EFI_STATUS
+HttpBootRangeCheckResponse (
+  IN     HTTP_BOOT_RANGE_CONNECTION   *Connection
+  )
+{
+  EFI_HTTP_MESSAGE           *Message;
+  EFI_HTTP_HEADER            *Header;
+
+  //
+  // A server may ignore the Range header and reply the whole entity with 200 OK.
+  //
+  if (Connection->Response.StatusCode != HTTP_STATUS_206_PARTIAL_CONTENT) {
+    HttpBootPrintErrorMessage (Connection->Response.StatusCode);
+    return EFI_UNSUPPORTED;
+  }
+
+  Message = Connection->HttpIo.RspToken.Message;
+  Header  = HttpFindHeader (Message->HeaderCount, Message->Headers, HTTP_HEADER_CONTENT_LENGTH);
+  if ((Header == NULL) || (AsciiStrDecimalToUintn (Header->FieldValue) != Connection->Length)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Poll the HTTP child of a range connection and advance the connection to the next
+  state if its pending token has completed.
+
+  On failure the error is recorded in the Status field of the connection.
+
+  @param[in, out]  Connection      The range connection.
+  @param[in]       Buffer          The memory buffer to transfer the boot file to.
+
+**/
+VOID
+HttpBootRangePoll (
+  IN OUT HTTP_BOOT_RANGE_CONNECTION   *Connection,
+  IN     UINT8                        *Buffer
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_IO                    *HttpIo;
+
+  HttpIo = &Connection->HttpIo;
+  HttpIo->Http->Poll (HttpIo->Http);
+
+  switch (Connection->State) {
+  case HttpBootRangeStateRequest:
+    if (!HttpIo->IsTxDone) {
+      break;
+    }
+
+    if (EFI_ERROR (HttpIo->ReqToken.Status)) {
+      Connection->Status = HttpIo->ReqToken.Status;
+      return;
+    }
+
+    Connection->State  = HttpBootRangeStateHeader;
+    Connection->Status = HttpBootRangeQueueResponse (Connection, Buffer);
+    return;
+
+  case HttpBootRangeStateHeader:
+    if (!HttpIo->IsRxDone) {
+      break;
+    }
+
+    Status = HttpIo->RspToken.Status;
+    if (!EFI_ERROR (Status)) {
+      Status = HttpBootRangeCheckResponse (Connection);
+    }
+    if (HttpIo->RspToken.Message->Headers != NULL) {
+      HttpFreeHeaderFields (HttpIo->RspToken.Message->Headers, HttpIo->RspToken.Message->HeaderCount);
+      HttpIo->RspToken.Message->Headers     = NULL;
+      HttpIo->RspToken.Message->HeaderCount = 0;
+    }
+    if (EFI_ERROR (Status)) {
+      Connection->Status = Status;
+      return;
+    }
+
+    Connection->State  = HttpBootRangeStateBody;
+    Connection->Status = HttpBootRangeQueueResponse (Connection, Buffer);
+    return;
+
+  case HttpBootRangeStateBody:
+    if (!HttpIo->IsRxDone) {
+      break;
+    }
+
+    if (EFI_ERROR (HttpIo->RspToken.Status)) {
+      Connection->Status = HttpIo->RspToken.Status;
+      return;
+    }
+
+    Connection->ReceivedSize += HttpIo->RspToken.Message->BodyLength;
+    if (Connection->ReceivedSize >= Connection->Length) {
+      gBS->SetTimer (HttpIo->TimeoutEvent, TimerCancel, 0);
+      Connection->State = HttpBootRangeStateDone;
+      return;
+    }
+
+    Connection->Status = HttpBootRangeQueueResponse (Connection, Buffer);
+    return;
+
+  default:
+    return;
+  }
+
+  //
+  // The pending token has not completed yet, check whether it has timed out.
+  //
+  if (!EFI_ERROR (gBS->CheckEvent (HttpIo->TimeoutEvent))) {
+    Connection->Status = EFI_TIMEOUT;
+  }
+}
+
+/**
+  This function downloads the boot file with several concurrent HTTP range requests.
+
+  The boot file is split into PcdHttpBootRangeConnections ranges, each range is
+  requested over a separate HTTP child and received directly into its place in
+  Buffer. The size and image type of the boot file must have been discovered by a
+  HEAD request already.
+
+  @param[in]       Private         The pointer to the driver's private data.
+  @param[in, out]  BufferSize      On input the size of Buffer in bytes. On output with a return
+                                   code of EFI_SUCCESS, the amount of data transferred to Buffer.
+  @param[out]      Buffer          The memory buffer to transfer the file to.
+
+  @retval EFI_SUCCESS              The file was loaded.
+  @retval EFI_INVALID_PARAMETER    BufferSize or Buffer is NULL.
+  @retval EFI_BUFFER_TOO_SMALL     The BufferSize is too small to hold the boot file.
+  @retval EFI_UNSUPPORTED          The server doesn't accept range requests for the boot file.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+  @retval Others                   Unexpected error happened.
+
+**/
+EFI_STATUS
+HttpBootGetBootFileByRange (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN OUT UINTN                    *BufferSize,
+     OUT UINT8                    *Buffer
+  )
+{
+  EFI_STATUS                   Status;
+  HTTP_BOOT_RANGE_CONNECTION   *Connections;
+  HTTP_BOOT_RANGE_CONNECTION   *Connection;
+  UINTN                        ConnectionCount;
+  UINTN                        Index;
+  UINTN                        RangeSize;
+  UINTN                        UrlSize;
+  CHAR16                       *Url;
+  CHAR8                        *HostName;
+  UINTN                        ReceivedSize;
+  UINTN                        Percentage;
+  UINTN                        LastPercentage;
+  BOOLEAN                      Complete;
+  UINT64                       StartTick;
+  UINT64                       ElapsedTime;
+
+  ASSERT (Private != NULL);
+
+  if (BufferSize == NULL || Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!Private->AcceptRanges || Private->BootFileSize == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (*BufferSize < Private->BootFileSize) {
+    *BufferSize = Private->BootFileSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  ConnectionCount = MIN (PcdGet8 (PcdHttpBootRangeConnections), HTTP_BOOT_RANGE_MAX_CONNECTIONS);
+  if (ConnectionCount < 2) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Connections = NULL;
+  HostName    = NULL;
+  UrlSize     = AsciiStrSize (Private->BootFileUri);
+  Url         = AllocatePool (UrlSize * sizeof (CHAR16));
+  if (Url == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  AsciiStrToUnicodeStrS (Private->BootFileUri, Url, UrlSize);
+
+  Status = HttpUrlGetHostName (
+             Private->BootFileUri,
+             Private->BootFileUriParser,
+             &HostName
+             );
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  Connections = AllocateZeroPool (ConnectionCount * sizeof (HTTP_BOOT_RANGE_CONNECTION));
+  if (Connections == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ON_EXIT;
+  }
+
+  //
+  // Split the boot file into equal ranges, the last range takes the remainder.
+  // Create a HTTP child for each range and send out all the requests.
+  //
+  RangeSize = Private->BootFileSize / ConnectionCount;
+  for (Index = 0; Index < ConnectionCount; Index++) {
+    Connection         = &Connections[Index];
+    Connection->Status = EFI_SUCCESS;
+    Connection->Offset = Index * RangeSize;
+    if (Index == ConnectionCount - 1) {
+      Connection->Length = Private->BootFileSize - Connection->Offset;
+    } else {
+      Connection->Length = RangeSize;
+    }
+
+    Status = HttpBootCreateHttpChild (Private, &Connection->HttpIo);
+    if (EFI_ERROR (Status)) {
+      goto ON_EXIT;
+    }
+    Connection->HttpCreated = TRUE;
+
+    Status = HttpBootRangeSendRequest (HostName, Url, Connection);
+    if (EFI_ERROR (Status)) {
+      goto ON_EXIT;
+    }
+  }
+
+  //
+  // Poll all the connections until every range has been received or any one fails.
+  //
+  AsciiPrint ("\n  Downloading boot file over %d connections... 0%%", (UINT32) ConnectionCount);
+  StartTick      = GetPerformanceCounter ();
+  LastPercentage = 0;
+  do {
+    Complete     = TRUE;
+    ReceivedSize = 0;
+    for (Index = 0; Index < ConnectionCount; Index++) {
+      Connection = &Connections[Index];
+      HttpBootRangePoll (Connection, Buffer);
+      if (EFI_ERROR (Connection->Status)) {
+        Status = Connection->Status;
+        DEBUG ((
+          EFI_D_ERROR,
+          "HttpBootGetBootFileByRange: range 0x%lx+0x%lx failed - %r\n",
+          (UINT64) Connection->Offset,
+          (UINT64) Connection->Length,
+          Status
+          ));
+        AsciiPrint ("\n");
+        goto ON_EXIT;
+      }
+      if (Connection->State != HttpBootRangeStateDone) {
+        Complete = FALSE;
+      }
+      ReceivedSize += Connection->ReceivedSize;
+    }
+
+    Percentage = (UINTN) DivU64x64Remainder (
+                           MultU64x32 ((UINT64) ReceivedSize, 100),
+                           (UINT64) Private->BootFileSize,
+                           NULL
+                           );
+    if (Percentage != LastPercentage) {
+      AsciiPrint ("\r  Downloading boot file over %d connections... %d%%", (UINT32) ConnectionCount, (UINT32) Percentage);
+      LastPercentage = Percentage;
+    }
+  } while (!Complete);
+
+  ElapsedTime = HttpBootGetElapsedTime (StartTick);
+  AsciiPrint (
+    "\n  Downloaded %ld bytes in %ld ms (%ld KB/s)\n",
+    (UINT64) Private->BootFileSize,
+    ElapsedTime,
+    DivU64x64Remainder ((UINT64) Private->BootFileSize, MAX (ElapsedTime, 1), NULL)
+    );
+
+  *BufferSize = Private->BootFileSize;
+  Status      = EFI_SUCCESS;
+
+ON_EXIT:
+  if (Connections != NULL) {
+    for (Index = 0; Index < ConnectionCount; Index++) {
+      Connection = &Connections[Index];
+      if (Connection->HttpCreated) {
+        //
+        // Abort the pending tokens before their events are closed.
+        //
+        if (Connection->State != HttpBootRangeStateDone) {
+          Connection->HttpIo.Http->Cancel (Connection->HttpIo.Http, NULL);
+        }
+        HttpIoDestroyIo (&Connection->HttpIo);
+      }
+      if (Connection->RequestHeader != NULL) {
+        HttpBootFreeHeader (Connection->RequestHeader);
+      }
+    }
+    FreePool (Connections);
+  }
+
+  if (HostName != NULL) {
+    FreePool (HostName);
+  }
+  FreePool (Url);
+
+  return Status;
+}
@@ -20,6 +20,9 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define HTTP_BOOT_RESPONSE_TIMEOUT           5000      // 5 seconds in uints of millisecond.
 #define HTTP_BOOT_BLOCK_SIZE                 1500
 
+#define HTTP_BOOT_RANGE_MAX_CONNECTIONS      16
+#define HTTP_BOOT_RANGE_MIN_FILE_SIZE        SIZE_1MB
+
 
 
 #define HTTP_USER_AGENT_EFI_HTTP_BOOT        "UefiHttpBoot/1.0"
@@ -46,6 +49,19 @@ typedef struct {
   LIST_ENTRY                 EntityDataList;  // Entity data (message-body)
 } HTTP_BOOT_CACHE_CONTENT;
 
+//
+// A downloaded boot file kept across boot attempts.
+//
+typedef struct {
+  LIST_ENTRY                 Link;            // Link to the BootFileCacheList in driver's private data.
+  CHAR8                      *Uri;
+  CHAR8                      *ETag;           // NULL if the server didn't report it.
+  CHAR8                      *LastModified;   // NULL if the server didn't report it.
+  HTTP_BOOT_IMAGE_TYPE       ImageType;
+  UINTN                      Size;
+  UINT8                      *Data;           // Allocated in pages.
+} HTTP_BOOT_FILE_CACHE;
+
 //
 // Callback data for HTTP_BODY_PARSER_CALLBACK()
 //
@@ -66,6 +82,32 @@ typedef struct {
   UINT8                      *Buffer;
 } HTTP_BOOT_CALLBACK_DATA;
 
+//
+// Download state of a range connection.
+//
+typedef enum {
+  HttpBootRangeStateRequest,      // Waiting for the request to be transmitted.
+  HttpBootRangeStateHeader,       // Waiting for the response header.
+  HttpBootRangeStateBody,         // Receiving the message-body.
+  HttpBootRangeStateDone
+} HTTP_BOOT_RANGE_STATE;
+
+//
+// A HTTP child which downloads one byte range of the boot file.
+//
+typedef struct {
+  HTTP_IO                    HttpIo;
+  BOOLEAN                    HttpCreated;
+  HTTP_BOOT_RANGE_STATE      State;
+  EFI_STATUS                 Status;
+  EFI_HTTP_REQUEST_DATA      RequestData;
+  HTTP_IO_HEADER             *RequestHeader;
+  EFI_HTTP_RESPONSE_DATA     Response;
+  UINTN                      Offset;          // Offset of the range in the boot file.
+  UINTN                      Length;          // Length of the range in bytes.
+  UINTN                      ReceivedSize;
+} HTTP_BOOT_RANGE_CONNECTION;
+
 /**
   Discover all the boot information for boot file.
 
@@ -127,6 +169,34 @@ HttpBootGetBootFile (
      OUT HTTP_BOOT_IMAGE_TYPE     *ImageType
   );
 
+/**
+  This function downloads the boot file with several concurrent HTTP range requests.
+
+  The boot file is split into PcdHttpBootRangeConnections ranges, each range is
+  requested over a separate HTTP child and received directly into its place in
+  Buffer. The size and image type of the boot file must have been discovered by a
+  HEAD request already.
+
+  @param[in]       Private         The pointer to the driver's private data.
+  @param[in, out]  BufferSize      On input the size of Buffer in bytes. On output with a return
+                                   code of EFI_SUCCESS, the amount of data transferred to Buffer.
+  @param[out]      Buffer          The memory buffer to transfer the file to.
+
+  @retval EFI_SUCCESS              The file was loaded.
+  @retval EFI_INVALID_PARAMETER    BufferSize or Buffer is NULL.
+  @retval EFI_BUFFER_TOO_SMALL     The BufferSize is too small to hold the boot file.
+  @retval EFI_UNSUPPORTED          The server doesn't accept range requests for the boot file.
+  @retval EFI_OUT_OF_RESOURCES     Could not allocate needed resources.
+  @retval Others                   Unexpected error happened.
+
+**/
+EFI_STATUS
+HttpBootGetBootFileByRange (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN OUT UINTN                    *BufferSize,
+     OUT UINT8                    *Buffer
+  );
+
 /**
   Clean up all cached data.
 
@@ -138,4 +208,57 @@ HttpBootFreeCacheList (
   IN     HTTP_BOOT_PRIVATE_DATA   *Private
   );
 
+/**
+  Release all the boot files kept across boot attempts.
+
+  @param[in]          Private         The pointer to the driver's private data.
+
+**/
+VOID
+HttpBootFreeBootFileCache (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private
+  );
+
+/**
+  Load the boot file from the files kept by previous boot attempts, if the server
+  reports the same size, ETag and Last-Modified for it.
+
+  @param[in]          Private         The pointer to the driver's private data.
+  @param[in, out]     BufferSize      On input the size of Buffer in bytes. On output with a return
+                                      code of EFI_SUCCESS, the amount of data transferred to
+                                      Buffer.
+  @param[out]         Buffer          The memory buffer to transfer the file to.
+  @param[out]         ImageType       The image type of the kept file.
+
+  @retval EFI_SUCCESS          The boot file is loaded from memory.
+  @retval EFI_NOT_FOUND        No valid copy of the boot file is kept.
+
+**/
+EFI_STATUS
+HttpBootGetFileFromBootFileCache (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN OUT UINTN                    *BufferSize,
+     OUT UINT8                    *Buffer,
+     OUT HTTP_BOOT_IMAGE_TYPE     *ImageType
+  );
+
+/**
+  Keep a copy of the downloaded boot file for later boot attempts.
+
+  The oldest kept files are dropped if the total size would exceed PcdHttpBootCacheSize.
+
+  @param[in]          Private         The pointer to the driver's private data.
+  @param[in]          BufferSize      The size of the boot file.
+  @param[in]          Buffer          The downloaded boot file.
+  @param[in]          ImageType       The image type of the boot file.
+
+**/
+VOID
+HttpBootSaveFileToBootFileCache (
+  IN     HTTP_BOOT_PRIVATE_DATA   *Private,
+  IN     UINTN                    BufferSize,
+  IN     UINT8                    *Buffer,
+  IN     HTTP_BOOT_IMAGE_TYPE     ImageType
+  );
+
 #endif
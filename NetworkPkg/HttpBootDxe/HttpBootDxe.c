@@ -333,6 +333,7 @@ HttpBootIp4DxeDriverBindingStart (
     Private->Signature = HTTP_BOOT_PRIVATE_DATA_SIGNATURE;
     Private->Controller = ControllerHandle;
     InitializeListHead (&Private->CacheList);
+    InitializeListHead (&Private->BootFileCacheList);
     //
     // Get the NII interface if it exists, it's not required.
     //
@@ -624,6 +625,7 @@ HttpBootIp4DxeDriverBindingStop (
     // Release the cached data.
     //
     HttpBootFreeCacheList (Private);
+    HttpBootFreeBootFileCache (Private);
 
     //
     // Unload the config form.
@@ -805,6 +807,7 @@ HttpBootIp6DxeDriverBindingStart (
     Private->Signature = HTTP_BOOT_PRIVATE_DATA_SIGNATURE;
     Private->Controller = ControllerHandle;
     InitializeListHead (&Private->CacheList);
+    InitializeListHead (&Private->BootFileCacheList);
     //
     // Get the NII interface if it exists, it's not required.
     //
@@ -1118,6 +1121,7 @@ HttpBootIp6DxeDriverBindingStop (
     // Release the cached data.
     //
     HttpBootFreeCacheList (Private);
+    HttpBootFreeBootFileCache (Private);
 
     //
     // Unload the config form.
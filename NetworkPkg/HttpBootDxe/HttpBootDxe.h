@@ -36,6 +36,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/HttpLib.h>
 #include <Library/HiiLib.h>
 #include <Library/PrintLib.h>
+#include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
 
 //
 // UEFI Driver Model Protocols
@@ -189,6 +191,7 @@ struct _HTTP_BOOT_PRIVATE_DATA {
   CHAR8                                     *BootFileUri;
   VOID                                      *BootFileUriParser;
   UINTN                                     BootFileSize;
+  BOOLEAN                                   AcceptRanges;
   BOOLEAN                                   NoGateway;
   HTTP_BOOT_IMAGE_TYPE                      ImageType;
 
@@ -203,6 +206,17 @@ struct _HTTP_BOOT_PRIVATE_DATA {
   //
   LIST_ENTRY                                CacheList;
 
+  //
+  // Boot files kept across boot attempts, and the cache validators of the
+  // boot file reported by the server in this attempt.
+  //
+  LIST_ENTRY                                BootFileCacheList;
+  UINTN                                     BootFileCacheSize;
+  UINTN                                     BootFileCacheHits;
+  UINTN                                     BootFileCacheMisses;
+  CHAR8                                     *BootFileETag;
+  CHAR8                                     *BootFileLastModified;
+
   //
   // Cached DHCP offer
   //
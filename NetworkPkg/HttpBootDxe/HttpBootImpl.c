@@ -279,6 +279,7 @@ HttpBootLoadFile (
       // Failed to get file size by HEAD method, may be trunked encoding, try HTTP GET method.
       //
       ASSERT (Private->BootFileSize == 0);
+      Private->AcceptRanges = FALSE;
       Status = HttpBootGetBootFile (
                  Private,
                  FALSE,
@@ -298,16 +299,51 @@ HttpBootLoadFile (
     return EFI_BUFFER_TOO_SMALL;
   }
 
+  //
+  // Reuse the boot file downloaded by a previous boot attempt if the server
+  // reports it unchanged.
+  //
+  Status = HttpBootGetFileFromBootFileCache (Private, BufferSize, Buffer, ImageType);
+  if (!EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Download the boot file with several concurrent range requests if the server
+  // supports it and the file is large enough to benefit from it.
+  //
+  if (Private->AcceptRanges &&
+      (PcdGet8 (PcdHttpBootRangeConnections) > 1) &&
+      (Private->BootFileSize >= HTTP_BOOT_RANGE_MIN_FILE_SIZE)) {
+    Status = HttpBootGetBootFileByRange (Private, BufferSize, Buffer);
+    if (!EFI_ERROR (Status)) {
+      *ImageType = Private->ImageType;
+      HttpBootSaveFileToBootFileCache (Private, *BufferSize, Buffer, *ImageType);
+      return Status;
+    }
+
+    //
+    // Fall back to a single GET request.
+    //
+    DEBUG ((EFI_D_WARN, "HttpBootLoadFile: range download failed - %r, retry with single request.\n", Status));
+    Private->AcceptRanges = FALSE;
+  }
+
   //
   // Load the boot file into Buffer
   //
-  return  HttpBootGetBootFile (
-            Private,
-            FALSE,
-            BufferSize,
-            Buffer,
-            ImageType
-            );
+  Status = HttpBootGetBootFile (
+             Private,
+             FALSE,
+             BufferSize,
+             Buffer,
+             ImageType
+             );
+  if (!EFI_ERROR (Status)) {
+    HttpBootSaveFileToBootFileCache (Private, *BufferSize, Buffer, *ImageType);
+  }
+
+  return Status;
 }
 
 /**
@@ -349,6 +385,15 @@ HttpBootStop (
   Private->BootFileUri = NULL;
   Private->BootFileUriParser = NULL;
   Private->BootFileSize = 0;
+  Private->AcceptRanges = FALSE;
+  if (Private->BootFileETag != NULL) {
+    FreePool (Private->BootFileETag);
+    Private->BootFileETag = NULL;
+  }
+  if (Private->BootFileLastModified != NULL) {
+    FreePool (Private->BootFileLastModified);
+    Private->BootFileLastModified = NULL;
+  }
   Private->SelectIndex = 0;
   Private->SelectProxyType = HttpOfferTypeMax; 
 
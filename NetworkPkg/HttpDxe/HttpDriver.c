@@ -76,6 +76,7 @@ HttpCreateService (
   HttpService->ControllerHandle = Controller;
   HttpService->ChildrenNumber = 0;
   InitializeListHead (&HttpService->ChildrenList);
+  InitializeListHead (&HttpService->IdleConnections);
   
   *ServiceData = HttpService;
   return EFI_SUCCESS;
@@ -99,6 +100,23 @@ HttpCleanService (
   if (HttpService == NULL) {
     return ;
   }
+
+  DEBUG ((
+    EFI_D_INFO,
+    "HttpCleanService: %d requests, %d connects, %d reused, %d pipelined, %d parked, %d idle hits\n",
+    (UINT32) HttpService->Statistics.Requests,
+    (UINT32) HttpService->Statistics.Connects,
+    (UINT32) HttpService->Statistics.Reused,
+    (UINT32) HttpService->Statistics.Pipelined,
+    (UINT32) HttpService->Statistics.Parked,
+    (UINT32) HttpService->Statistics.IdleHits
+    ));
+
+  //
+  // Close the TCP connections kept for reuse.
+  //
+  HttpCleanIdleConnections (HttpService, UsingIpv6);
+
   if (!UsingIpv6) {
     if (HttpService->Tcp4ChildHandle != NULL) {
       gBS->CloseProtocol (
@@ -241,6 +241,9 @@ EfiHttpRequest (
   HTTP_PROTOCOL                 *HttpInstance;
   BOOLEAN                       Configure;
   BOOLEAN                       ReConfigure;
+  BOOLEAN                       Adopted;
+  BOOLEAN                       Pipelined;
+  UINTN                         Connects;
   CHAR8                         *RequestMsg;
   CHAR8                         *Url;
   UINTN                         UrlLen;
@@ -260,6 +263,8 @@ EfiHttpRequest (
   HostNameStr = NULL;
   Wrap = NULL;
   FileUrl = NULL;
+  Adopted = FALSE;
+  Pipelined = FALSE;
 
   if ((This == NULL) || (Token == NULL)) {
     return EFI_INVALID_PARAMETER;
@@ -282,6 +287,7 @@ EfiHttpRequest (
 
   HttpInstance = HTTP_INSTANCE_FROM_PROTOCOL (This);
   ASSERT (HttpInstance != NULL);
+  Connects = HttpInstance->Service->Statistics.Connects;
 
   //
   // Capture the method into HttpInstance.
@@ -407,12 +413,11 @@ EfiHttpRequest (
 
           Wrap->TcpWrap.Method = Request->Method;
 
-          FreePool (HostName);
-
           //
           // Queue the HTTP token and return.
           //
-          return EFI_SUCCESS;
+          Pipelined = TRUE;
+          goto Exit;
         } else {
           //
           // Use existing TCP instance to transmit the packet.
@@ -433,7 +438,16 @@ EfiHttpRequest (
     }
   } 
 
-  if (Configure) {
+  if (Configure && !ReConfigure) {
+    //
+    // Take over an established connection to the same server left by another
+    // HTTP child, this saves both the name resolution and the TCP handshake.
+    //
+    Status  = HttpAdoptIdleConnection (HttpInstance, HostName, RemotePort);
+    Adopted = (BOOLEAN) !EFI_ERROR (Status);
+  }
+
+  if (Configure && !Adopted) {
     //
     // Parse Url for IPv4 or IPv6 address, if failed, perform DNS resolution.
     //
@@ -463,7 +477,9 @@ EfiHttpRequest (
         goto Error1;
       }
     }
+  }
 
+  if (Configure) {
     //
     // Save the RemotePort and RemoteHost.
     //
@@ -471,6 +487,13 @@ EfiHttpRequest (
     HttpInstance->RemotePort = RemotePort;
     HttpInstance->RemoteHost = HostName;
     HostName = NULL;
+
+    //
+    // The adopted TCP instance is already configured and connected.
+    //
+    if (Adopted) {
+      Configure = FALSE;
+    }
   }
 
   if (ReConfigure) {
@@ -551,6 +574,13 @@ EfiHttpRequest (
   // structure is NULL, we would not insert a TxToken.
   //
   if (Request != NULL) {
+    if (!NetMapIsEmpty (&HttpInstance->TxTokens)) {
+      //
+      // The responses of previous requests are not received yet.
+      //
+      Pipelined = TRUE;
+    }
+
     Status = NetMapInsertTail (&HttpInstance->TxTokens, Token, Wrap);
     if (EFI_ERROR (Status)) {
       goto Error4;
@@ -571,6 +601,20 @@ EfiHttpRequest (
   }
 
   DispatchDpc ();
+
+Exit:
+  //
+  // Account each request once, whether it is transmitted now or queued.
+  //
+  if (Request != NULL) {
+    HttpInstance->Service->Statistics.Requests++;
+    if (HttpInstance->Service->Statistics.Connects == Connects) {
+      HttpInstance->Service->Statistics.Reused++;
+    }
+    if (Pipelined) {
+      HttpInstance->Service->Statistics.Pipelined++;
+    }
+  }
   
   if (HostName != NULL) {
     FreePool (HostName);
@@ -882,6 +926,7 @@ HttpResponseWorker (
   NET_MAP_ITEM                  *Item;
   HTTP_TOKEN_WRAP               *ValueInItem;
   UINTN                         HdrLen;
+  EFI_HTTP_HEADER               *Header;
 
   if (Wrap == NULL || Wrap->HttpInstance == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -1090,6 +1135,13 @@ HttpResponseWorker (
       FreePool (HttpHeaders);
       HttpHeaders = NULL;
 
+      //
+      // Don't reuse the connection if the server is going to close it.
+      //
+      Header = HttpFindHeader (HttpMsg->HeaderCount, HttpMsg->Headers, HTTP_HEADER_CONNECTION);
+      HttpInstance->ConnectionClose = (BOOLEAN) (Header != NULL &&
+                                                 AsciiStriCmp (Header->FieldValue, HTTP_CONNECTION_CLOSE) == 0);
+
 
       //
       // Init message-body parser by header information.
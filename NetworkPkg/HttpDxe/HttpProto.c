@@ -831,7 +831,14 @@ HttpCleanProtocol (
   IN  HTTP_PROTOCOL          *HttpInstance
   )
 {
-  HttpCloseConnection (HttpInstance);
+  //
+  // Keep an established connection for later requests to the same server,
+  // close it otherwise.
+  //
+  if (!HttpParkConnection (HttpInstance)) {
+    HttpCloseConnection (HttpInstance);
+  }
+  HttpInstance->ConnectionClose = FALSE;
   
   HttpCloseTcpConnCloseEvent (HttpInstance);
 
@@ -930,6 +937,428 @@ HttpCleanProtocol (
   
 }
 
+/**
+  Close the TCP connection parked in the service and destroy its TCP child.
+
+  @param[in]  HttpService        The HTTP service.
+  @param[in]  Connection         The idle connection, already removed from the service.
+
+**/
+VOID
+HttpDestroyIdleConnection (
+  IN  HTTP_SERVICE           *HttpService,
+  IN  HTTP_IDLE_CONNECTION   *Connection
+  )
+{
+  if (!Connection->LocalAddressIsIPv6) {
+    //
+    // Reset the TCP4 child, this aborts the connection.
+    //
+    Connection->Tcp4->Configure (Connection->Tcp4, NULL);
+
+    gBS->CloseProtocol (
+           Connection->Tcp4ChildHandle,
+           &gEfiTcp4ProtocolGuid,
+           HttpService->ImageHandle,
+           HttpService->ControllerHandle
+           );
+
+    NetLibDestroyServiceChild (
+      HttpService->ControllerHandle,
+      HttpService->ImageHandle,
+      &gEfiTcp4ServiceBindingProtocolGuid,
+      Connection->Tcp4ChildHandle
+      );
+  } else {
+    Connection->Tcp6->Configure (Connection->Tcp6, NULL);
+
+    gBS->CloseProtocol (
+           Connection->Tcp6ChildHandle,
+           &gEfiTcp6ProtocolGuid,
+           HttpService->ImageHandle,
+           HttpService->ControllerHandle
+           );
+
+    NetLibDestroyServiceChild (
+      HttpService->ControllerHandle,
+      HttpService->ImageHandle,
+      &gEfiTcp6ServiceBindingProtocolGuid,
+      Connection->Tcp6ChildHandle
+      );
+  }
+
+  FreePool (Connection->RemoteHost);
+  FreePool (Connection);
+}
+
+/**
+  Check whether the TCP connection of the TCP4 or TCP6 child is still established.
+
+  @param[in]  UsingIpv6          Check the TCP6 child if TRUE, TCP4 child otherwise.
+  @param[in]  Tcp4               The TCP4 protocol of the child.
+  @param[in]  Tcp6               The TCP6 protocol of the child.
+
+  @retval TRUE                   The connection is established.
+  @retval FALSE                  The connection is closed or closing.
+
+**/
+BOOLEAN
+HttpIsTcpEstablished (
+  IN  BOOLEAN                UsingIpv6,
+  IN  EFI_TCP4_PROTOCOL      *Tcp4,
+  IN  EFI_TCP6_PROTOCOL      *Tcp6
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_TCP4_CONNECTION_STATE  Tcp4State;
+  EFI_TCP6_CONNECTION_STATE  Tcp6State;
+
+  if (!UsingIpv6) {
+    if (Tcp4 == NULL) {
+      return FALSE;
+    }
+
+    Status = Tcp4->GetModeData (Tcp4, &Tcp4State, NULL, NULL, NULL, NULL);
+    return (BOOLEAN) (!EFI_ERROR (Status) && Tcp4State == Tcp4StateEstablished);
+  } else {
+    if (Tcp6 == NULL) {
+      return FALSE;
+    }
+
+    Status = Tcp6->GetModeData (Tcp6, &Tcp6State, NULL, NULL, NULL, NULL);
+    return (BOOLEAN) (!EFI_ERROR (Status) && Tcp6State == Tcp6StateEstablished);
+  }
+}
+
+/**
+  Keep the established TCP connection of an HTTP child open in the service's
+  idle connection list instead of closing it.
+
+  @param[in]  HttpInstance       The HTTP child which no longer uses the connection.
+
+  @retval TRUE                   The connection is parked, the HTTP child no longer owns
+                                 the TCP child.
+  @retval FALSE                  The connection can't be reused, the caller should close it.
+
+**/
+BOOLEAN
+HttpParkConnection (
+  IN  HTTP_PROTOCOL          *HttpInstance
+  )
+{
+  HTTP_SERVICE               *HttpService;
+  HTTP_IDLE_CONNECTION       *Connection;
+  HTTP_IDLE_CONNECTION       *Oldest;
+
+  HttpService = HttpInstance->Service;
+
+  //
+  // Only a connection with no outstanding request or unread response data can
+  // be handed over to another HTTP child.
+  //
+  if (HttpInstance->State != HTTP_STATE_TCP_CONNECTED ||
+      HttpInstance->RemoteHost == NULL ||
+      HttpInstance->ConnectionClose ||
+      HttpInstance->CacheBody != NULL ||
+      HttpInstance->MsgParser != NULL ||
+      !NetMapIsEmpty (&HttpInstance->TxTokens) ||
+      !NetMapIsEmpty (&HttpInstance->RxTokens)) {
+    return FALSE;
+  }
+
+  if (!HttpIsTcpEstablished (HttpInstance->LocalAddressIsIPv6, HttpInstance->Tcp4, HttpInstance->Tcp6)) {
+    return FALSE;
+  }
+
+  Connection = AllocateZeroPool (sizeof (HTTP_IDLE_CONNECTION));
+  if (Connection == NULL) {
+    return FALSE;
+  }
+
+  Connection->Signature          = HTTP_IDLE_CONNECTION_SIGNATURE;
+  Connection->LocalAddressIsIPv6 = HttpInstance->LocalAddressIsIPv6;
+  Connection->RemoteHost         = HttpInstance->RemoteHost;
+  Connection->RemotePort         = HttpInstance->RemotePort;
+  HttpInstance->RemoteHost       = NULL;
+
+  if (!HttpInstance->LocalAddressIsIPv6) {
+    CopyMem (&Connection->IPv4Node, &HttpInstance->IPv4Node, sizeof (EFI_HTTPv4_ACCESS_POINT));
+    CopyMem (&Connection->Tcp4CfgData, &HttpInstance->Tcp4CfgData, sizeof (EFI_TCP4_CONFIG_DATA));
+    CopyMem (&Connection->Tcp4Option, &HttpInstance->Tcp4Option, sizeof (EFI_TCP4_OPTION));
+    IP4_COPY_ADDRESS (&Connection->RemoteAddr, &HttpInstance->RemoteAddr);
+    Connection->Tcp4ChildHandle = HttpInstance->Tcp4ChildHandle;
+    Connection->Tcp4            = HttpInstance->Tcp4;
+
+    //
+    // The service keeps the TCP child opened BY_DRIVER, only release the reference
+    // of the HTTP child.
+    //
+    gBS->CloseProtocol (
+           HttpInstance->Tcp4ChildHandle,
+           &gEfiTcp4ProtocolGuid,
+           HttpService->ImageHandle,
+           HttpInstance->Handle
+           );
+    HttpInstance->Tcp4ChildHandle = NULL;
+    HttpInstance->Tcp4            = NULL;
+  } else {
+    CopyMem (&Connection->Ipv6Node, &HttpInstance->Ipv6Node, sizeof (EFI_HTTPv6_ACCESS_POINT));
+    CopyMem (&Connection->Tcp6CfgData, &HttpInstance->Tcp6CfgData, sizeof (EFI_TCP6_CONFIG_DATA));
+    CopyMem (&Connection->Tcp6Option, &HttpInstance->Tcp6Option, sizeof (EFI_TCP6_OPTION));
+    IP6_COPY_ADDRESS (&Connection->RemoteIpv6Addr, &HttpInstance->RemoteIpv6Addr);
+    Connection->Tcp6ChildHandle = HttpInstance->Tcp6ChildHandle;
+    Connection->Tcp6            = HttpInstance->Tcp6;
+
+    gBS->CloseProtocol (
+           HttpInstance->Tcp6ChildHandle,
+           &gEfiTcp6ProtocolGuid,
+           HttpService->ImageHandle,
+           HttpInstance->Handle
+           );
+    HttpInstance->Tcp6ChildHandle = NULL;
+    HttpInstance->Tcp6            = NULL;
+  }
+
+  HttpInstance->State = HTTP_STATE_TCP_CLOSED;
+
+  //
+  // Drop the least recently parked connection if the list is full.
+  //
+  if (HttpService->IdleConnectionNumber >= HTTP_MAX_IDLE_CONNECTIONS) {
+    Oldest = NET_LIST_HEAD (&HttpService->IdleConnections, HTTP_IDLE_CONNECTION, Link);
+    RemoveEntryList (&Oldest->Link);
+    HttpService->IdleConnectionNumber--;
+    HttpDestroyIdleConnection (HttpService, Oldest);
+  }
+
+  InsertTailList (&HttpService->IdleConnections, &Connection->Link);
+  HttpService->IdleConnectionNumber++;
+  HttpService->Statistics.Parked++;
+
+  return TRUE;
+}
+
+/**
+  Take over an idle TCP connection to the specified server parked in the service,
+  replacing the unconnected TCP child of the HTTP child.
+
+  @param[in]  HttpInstance       The HTTP child which is going to send the first request.
+  @param[in]  RemoteHost         The host name of the request URL.
+  @param[in]  RemotePort         The port number of the request URL.
+
+  @retval EFI_SUCCESS            The HTTP child is connected with the parked connection.
+  @retval EFI_NOT_FOUND          No established connection to the server is parked.
+  @retval Others                 Other error as indicated.
+
+**/
+EFI_STATUS
+HttpAdoptIdleConnection (
+  IN  HTTP_PROTOCOL          *HttpInstance,
+  IN  CHAR8                  *RemoteHost,
+  IN  UINT16                 RemotePort
+  )
+{
+  EFI_STATUS                 Status;
+  HTTP_SERVICE               *HttpService;
+  HTTP_IDLE_CONNECTION       *Connection;
+  LIST_ENTRY                 *Entry;
+  LIST_ENTRY                 *Next;
+  BOOLEAN                    Found;
+
+  HttpService = HttpInstance->Service;
+  Connection  = NULL;
+  Found       = FALSE;
+
+  NET_LIST_FOR_EACH_SAFE (Entry, Next, &HttpService->IdleConnections) {
+    Connection = NET_LIST_USER_STRUCT_S (Entry, HTTP_IDLE_CONNECTION, Link, HTTP_IDLE_CONNECTION_SIGNATURE);
+
+    if (Connection->LocalAddressIsIPv6 != HttpInstance->LocalAddressIsIPv6 ||
+        Connection->RemotePort != RemotePort ||
+        AsciiStrCmp (Connection->RemoteHost, RemoteHost) != 0) {
+      continue;
+    }
+
+    if (!HttpInstance->LocalAddressIsIPv6) {
+      if (Connection->IPv4Node.UseDefaultAddress != HttpInstance->IPv4Node.UseDefaultAddress ||
+          Connection->IPv4Node.LocalPort != HttpInstance->IPv4Node.LocalPort ||
+          (!HttpInstance->IPv4Node.UseDefaultAddress &&
+           (!EFI_IP4_EQUAL (&Connection->IPv4Node.LocalAddress, &HttpInstance->IPv4Node.LocalAddress) ||
+            !EFI_IP4_EQUAL (&Connection->IPv4Node.LocalSubnet, &HttpInstance->IPv4Node.LocalSubnet)))) {
+        continue;
+      }
+    } else {
+      if (Connection->Ipv6Node.LocalPort != HttpInstance->Ipv6Node.LocalPort ||
+          !EFI_IP6_EQUAL (&Connection->Ipv6Node.LocalAddress, &HttpInstance->Ipv6Node.LocalAddress)) {
+        continue;
+      }
+    }
+
+    RemoveEntryList (&Connection->Link);
+    HttpService->IdleConnectionNumber--;
+
+    //
+    // The server may have closed the connection while it was parked.
+    //
+    if (!HttpIsTcpEstablished (Connection->LocalAddressIsIPv6, Connection->Tcp4, Connection->Tcp6)) {
+      HttpDestroyIdleConnection (HttpService, Connection);
+      continue;
+    }
+
+    Found = TRUE;
+    break;
+  }
+
+  if (!Found) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // The connection/close events belong to the HTTP child and are usually created
+  // when its own TCP child is configured. Create them before the TCP children are
+  // swapped, nothing can fail once the HTTP child owns the parked TCP child.
+  //
+  HttpCloseTcpConnCloseEvent (HttpInstance);
+  Status = HttpCreateTcpConnCloseEvent (HttpInstance);
+  if (EFI_ERROR (Status)) {
+    HttpDestroyIdleConnection (HttpService, Connection);
+    return Status;
+  }
+
+  if (!HttpInstance->LocalAddressIsIPv6) {
+    //
+    // Take over the parked TCP4 child first, so that the HTTP child keeps its own
+    // one if this fails.
+    //
+    Status = gBS->OpenProtocol (
+                    Connection->Tcp4ChildHandle,
+                    &gEfiTcp4ProtocolGuid,
+                    (VOID **) &Connection->Tcp4,
+                    HttpService->ImageHandle,
+                    HttpInstance->Handle,
+                    EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER
+                    );
+    if (EFI_ERROR (Status)) {
+      HttpCloseTcpConnCloseEvent (HttpInstance);
+      HttpDestroyIdleConnection (HttpService, Connection);
+      return Status;
+    }
+
+    //
+    // Release the unconnected TCP4 child created for this HTTP child.
+    //
+    if (HttpInstance->Tcp4ChildHandle != NULL) {
+      gBS->CloseProtocol (
+             HttpInstance->Tcp4ChildHandle,
+             &gEfiTcp4ProtocolGuid,
+             HttpService->ImageHandle,
+             HttpService->ControllerHandle
+             );
+
+      gBS->CloseProtocol (
+             HttpInstance->Tcp4ChildHandle,
+             &gEfiTcp4ProtocolGuid,
+             HttpService->ImageHandle,
+             HttpInstance->Handle
+             );
+
+      NetLibDestroyServiceChild (
+        HttpService->ControllerHandle,
+        HttpService->ImageHandle,
+        &gEfiTcp4ServiceBindingProtocolGuid,
+        HttpInstance->Tcp4ChildHandle
+        );
+    }
+
+    HttpInstance->Tcp4ChildHandle = Connection->Tcp4ChildHandle;
+    HttpInstance->Tcp4            = Connection->Tcp4;
+    CopyMem (&HttpInstance->Tcp4CfgData, &Connection->Tcp4CfgData, sizeof (EFI_TCP4_CONFIG_DATA));
+    CopyMem (&HttpInstance->Tcp4Option, &Connection->Tcp4Option, sizeof (EFI_TCP4_OPTION));
+    HttpInstance->Tcp4CfgData.ControlOption = &HttpInstance->Tcp4Option;
+    IP4_COPY_ADDRESS (&HttpInstance->RemoteAddr, &Connection->RemoteAddr);
+  } else {
+    Status = gBS->OpenProtocol (
+                    Connection->Tcp6ChildHandle,
+                    &gEfiTcp6ProtocolGuid,
+                    (VOID **) &Connection->Tcp6,
+                    HttpService->ImageHandle,
+                    HttpInstance->Handle,
+                    EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER
+                    );
+    if (EFI_ERROR (Status)) {
+      HttpCloseTcpConnCloseEvent (HttpInstance);
+      HttpDestroyIdleConnection (HttpService, Connection);
+      return Status;
+    }
+
+    if (HttpInstance->Tcp6ChildHandle != NULL) {
+      gBS->CloseProtocol (
+             HttpInstance->Tcp6ChildHandle,
+             &gEfiTcp6ProtocolGuid,
+             HttpService->ImageHandle,
+             HttpService->ControllerHandle
+             );
+
+      gBS->CloseProtocol (
+             HttpInstance->Tcp6ChildHandle,
+             &gEfiTcp6ProtocolGuid,
+             HttpService->ImageHandle,
+             HttpInstance->Handle
+             );
+
+      NetLibDestroyServiceChild (
+        HttpService->ControllerHandle,
+        HttpService->ImageHandle,
+        &gEfiTcp6ServiceBindingProtocolGuid,
+        HttpInstance->Tcp6ChildHandle
+        );
+    }
+
+    HttpInstance->Tcp6ChildHandle = Connection->Tcp6ChildHandle;
+    HttpInstance->Tcp6            = Connection->Tcp6;
+    CopyMem (&HttpInstance->Tcp6CfgData, &Connection->Tcp6CfgData, sizeof (EFI_TCP6_CONFIG_DATA));
+    CopyMem (&HttpInstance->Tcp6Option, &Connection->Tcp6Option, sizeof (EFI_TCP6_OPTION));
+    HttpInstance->Tcp6CfgData.ControlOption = &HttpInstance->Tcp6Option;
+    IP6_COPY_ADDRESS (&HttpInstance->RemoteIpv6Addr, &Connection->RemoteIpv6Addr);
+  }
+
+  FreePool (Connection->RemoteHost);
+  FreePool (Connection);
+
+  HttpInstance->State = HTTP_STATE_TCP_CONNECTED;
+  HttpService->Statistics.IdleHits++;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Close and destroy all the idle TCP connections of one IP version parked in the service.
+
+  @param[in]  HttpService        The HTTP service.
+  @param[in]  UsingIpv6          Clean the TCP6 connections if TRUE, TCP4 connections otherwise.
+
+**/
+VOID
+HttpCleanIdleConnections (
+  IN  HTTP_SERVICE           *HttpService,
+  IN  BOOLEAN                UsingIpv6
+  )
+{
+  LIST_ENTRY                 *Entry;
+  LIST_ENTRY                 *Next;
+  HTTP_IDLE_CONNECTION       *Connection;
+
+  NET_LIST_FOR_EACH_SAFE (Entry, Next, &HttpService->IdleConnections) {
+    Connection = NET_LIST_USER_STRUCT_S (Entry, HTTP_IDLE_CONNECTION, Link, HTTP_IDLE_CONNECTION_SIGNATURE);
+    if (Connection->LocalAddressIsIPv6 != UsingIpv6) {
+      continue;
+    }
+
+    RemoveEntryList (&Connection->Link);
+    HttpService->IdleConnectionNumber--;
+    HttpDestroyIdleConnection (HttpService, Connection);
+  }
+}
+
 /**
   Establish TCP connection with HTTP server.
 
@@ -982,6 +1411,7 @@ HttpCreateConnection (
   
   if (!EFI_ERROR (Status)) {
     HttpInstance->State = HTTP_STATE_TCP_CONNECTED;
+    HttpInstance->Service->Statistics.Connects++;
   }
 
   return Status;
@@ -56,6 +56,26 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define HTTP_URL_BUFFER_LEN          4096
 
+//
+// Maximum number of established TCP connections kept open per service after
+// their HTTP child is gone, for reuse by later requests to the same server.
+//
+#define HTTP_MAX_IDLE_CONNECTIONS    4
+
+#define HTTP_IDLE_CONNECTION_SIGNATURE  SIGNATURE_32('H', 't', 't', 'C')
+
+//
+// Connection statistics of an HTTP service, dumped when the service is destroyed.
+//
+typedef struct {
+  UINTN                         Requests;         // Requests accepted by Request().
+  UINTN                         Connects;         // TCP connections established.
+  UINTN                         Reused;           // Requests sent over an already established connection.
+  UINTN                         Pipelined;        // Requests sent while previous responses are outstanding.
+  UINTN                         Parked;           // Connections kept open in the idle list.
+  UINTN                         IdleHits;         // Connections taken over from the idle list.
+} HTTP_CONNECTION_STATISTICS;
+
 typedef struct _HTTP_SERVICE {
   UINT32                        Signature;
   EFI_SERVICE_BINDING_PROTOCOL  ServiceBinding;
@@ -66,8 +86,38 @@ typedef struct _HTTP_SERVICE {
   LIST_ENTRY                    ChildrenList;
   UINTN                         ChildrenNumber;
   INTN                          State;
+  LIST_ENTRY                    IdleConnections;  // List of HTTP_IDLE_CONNECTION, oldest first.
+  UINTN                         IdleConnectionNumber;
+  HTTP_CONNECTION_STATISTICS    Statistics;
 } HTTP_SERVICE;
 
+//
+// An established TCP connection released by a destroyed or reset HTTP child.
+// The TCP child stays opened BY_DRIVER by the service until it is taken over
+// by another HTTP child or the service is destroyed.
+//
+typedef struct {
+  UINT32                        Signature;
+  LIST_ENTRY                    Link;
+  BOOLEAN                       LocalAddressIsIPv6;
+  EFI_HTTPv4_ACCESS_POINT       IPv4Node;
+  EFI_HTTPv6_ACCESS_POINT       Ipv6Node;
+  CHAR8                         *RemoteHost;
+  UINT16                        RemotePort;
+
+  EFI_HANDLE                    Tcp4ChildHandle;
+  EFI_TCP4_PROTOCOL             *Tcp4;
+  EFI_TCP4_CONFIG_DATA          Tcp4CfgData;
+  EFI_TCP4_OPTION               Tcp4Option;
+  EFI_IPv4_ADDRESS              RemoteAddr;
+
+  EFI_HANDLE                    Tcp6ChildHandle;
+  EFI_TCP6_PROTOCOL             *Tcp6;
+  EFI_TCP6_CONFIG_DATA          Tcp6CfgData;
+  EFI_TCP6_OPTION               Tcp6Option;
+  EFI_IPv6_ADDRESS              RemoteIpv6Addr;
+} HTTP_IDLE_CONNECTION;
+
 typedef struct {
   EFI_TCP4_IO_TOKEN             Tx4Token;
   EFI_TCP4_TRANSMIT_DATA        Tx4Data;
@@ -153,6 +203,11 @@ typedef struct _HTTP_PROTOCOL {
   NET_MAP                       RxTokens;
 
   CHAR8                         *Url;
+
+  //
+  // The server asked to close the connection after the last response.
+  //
+  BOOLEAN                       ConnectionClose;
 } HTTP_PROTOCOL;
 
 typedef struct {
@@ -291,6 +346,55 @@ HttpCleanProtocol (
   IN  HTTP_PROTOCOL          *HttpInstance
   );
 
+/**
+  Keep the established TCP connection of an HTTP child open in the service's
+  idle connection list instead of closing it.
+
+  @param[in]  HttpInstance       The HTTP child which no longer uses the connection.
+
+  @retval TRUE                   The connection is parked, the HTTP child no longer owns
+                                 the TCP child.
+  @retval FALSE                  The connection can't be reused, the caller should close it.
+
+**/
+BOOLEAN
+HttpParkConnection (
+  IN  HTTP_PROTOCOL          *HttpInstance
+  );
+
+/**
+  Take over an idle TCP connection to the specified server parked in the service,
+  replacing the unconnected TCP child of the HTTP child.
+
+  @param[in]  HttpInstance       The HTTP child which is going to send the first request.
+  @param[in]  RemoteHost         The host name of the request URL.
+  @param[in]  RemotePort         The port number of the request URL.
+
+  @retval EFI_SUCCESS            The HTTP child is connected with the parked connection.
+  @retval EFI_NOT_FOUND          No established connection to the server is parked.
+  @retval Others                 Other error as indicated.
+
+**/
+EFI_STATUS
+HttpAdoptIdleConnection (
+  IN  HTTP_PROTOCOL          *HttpInstance,
+  IN  CHAR8                  *RemoteHost,
+  IN  UINT16                 RemotePort
+  );
+
+/**
+  Close and destroy all the idle TCP connections of one IP version parked in the service.
+
+  @param[in]  HttpService        The HTTP service.
+  @param[in]  UsingIpv6          Clean the TCP6 connections if TRUE, TCP4 connections otherwise.
+
+**/
+VOID
+HttpCleanIdleConnections (
+  IN  HTTP_SERVICE           *HttpService,
+  IN  BOOLEAN                UsingIpv6
+  );
+
 /**
   Establish TCP connection with HTTP server.
 
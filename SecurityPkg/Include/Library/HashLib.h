@@ -57,7 +57,8 @@ HashUpdate (
   Hash sequence complete and extend to PCR.
 
   @param HashHandle    Hash handle.
-  @param PcrIndex      PCR to be extended.
+  @param PcrIndex      PCR to be extended. TPM_RH_NULL only returns the digests
+                       without extending any PCR.
   @param DataToHash    Data to be hashed.
   @param DataToHashLen Data size.
   @param DigestList    Digest list.
@@ -77,7 +78,8 @@ HashCompleteAndExtend (
 /**
   Hash data and extend to PCR.
 
-  @param PcrIndex      PCR to be extended.
+  @param PcrIndex      PCR to be extended. TPM_RH_NULL only returns the digests
+                       without extending any PCR.
   @param DataToHash    Data to be hashed.
   @param DataToHashLen Data size.
   @param DigestList    Digest list.
@@ -42,6 +42,15 @@ UINT8                               *mImageBase       = NULL;
 UINT8                               mImageDigest[MAX_DIGEST_SIZE];
 UINTN                               mImageDigestSize;
 
+//
+// Authenticode digests of the current PE/COFF image. All the algorithms the image
+// needs are computed together in one walk of the image, then served from here.
+// The cache is reset for every image that goes through verification.
+//
+UINT8                               mImageDigestCache[HASHALG_MAX][MAX_DIGEST_SIZE];
+UINT32                              mImageDigestCacheMask;
+UINT32                              mImageHashAlgMask;
+
 //
 // Notify string for authorization UI.
 //
@@ -74,6 +83,30 @@ HASH_TABLE mHash[] = {
 
 EFI_STRING mHashTypeStr;
 
+//
+// Indexes of the signature databases searched for image hashes. They are built
+// at first use and rebuilt whenever the variable content changes.
+//
+SIGNATURE_DB_INDEX  mSignatureDbIndex[] = {
+  { EFI_IMAGE_SECURITY_DATABASE  },
+  { EFI_IMAGE_SECURITY_DATABASE1 }
+};
+
+//
+// Number of the current image verification. db and dbx are checked for
+// changes once per image verification.
+//
+UINT32              mSignatureDbVerification;
+
+//
+// Signature database lookup statistics, reported at ReadyToBoot.
+//
+UINTN               mSignatureDbLookups;
+UINTN               mSignatureDbReads;
+UINTN               mSignatureDbIndexBuilds;
+UINTN               mCertHashLookups;
+UINT64              mSignatureDbLookupTime;
+
 /**
   SecureBoot Hook for processing image verification.
 
@@ -272,9 +305,56 @@ GetImageType (
   return IMAGE_UNKNOWN;
 }
 
+/**
+  Feed a range of the PE/COFF image to the hash context of every selected algorithm.
+
+  The range is consumed in HASH_PE_IMAGE_CHUNK_SIZE pieces, so that all the algorithms
+  read a piece while it is still in the processor cache.
+
+  @param[in]  HashCtx       Hash contexts, indexed by hash algorithm type.
+  @param[in]  HashAlgMask   Bit mask of the hash algorithm types to update.
+  @param[in]  HashBase      Start of the range.
+  @param[in]  HashSize      Size of the range in bytes.
+
+  @retval TRUE            Successfully hash the range.
+  @retval FALSE           Fail in hash the range.
+
+**/
+BOOLEAN
+HashPeImageUpdate (
+  IN  VOID                *HashCtx[HASHALG_MAX],
+  IN  UINT32              HashAlgMask,
+  IN  UINT8               *HashBase,
+  IN  UINTN               HashSize
+  )
+{
+  UINTN                     Index;
+  UINTN                     ChunkSize;
+
+  while (HashSize > 0) {
+    ChunkSize = MIN (HashSize, HASH_PE_IMAGE_CHUNK_SIZE);
+    for (Index = 0; Index < HASHALG_MAX; Index++) {
+      if ((HashAlgMask & (1 << Index)) == 0) {
+        continue;
+      }
+      if (!mHash[Index].HashUpdate (HashCtx[Index], HashBase, ChunkSize)) {
+        return FALSE;
+      }
+    }
+    HashBase += ChunkSize;
+    HashSize -= ChunkSize;
+  }
+
+  return TRUE;
+}
+
 /**
   Calculate hash of Pe/Coff image based on the authenticode image hashing in
-  PE/COFF Specification 8.0 Appendix A
+  PE/COFF Specification 8.0 Appendix A, for several hash algorithms at once.
+
+  The image headers and sections are walked a single time and every selected
+  algorithm is updated with the same data. The digests are saved in
+  mImageDigestCache.
   
   Caution: This function may receive untrusted input.
   PE/COFF image is external input, so this function will validate its data structure
@@ -283,21 +363,21 @@ GetImageType (
   Notes: PE/COFF image has been checked by BasePeCoffLib PeCoffLoaderGetImageInfo() in 
   its caller function DxeImageVerificationHandler().
 
-  @param[in]    HashAlg   Hash algorithm type.
+  @param[in]    HashAlgMask   Bit mask of the hash algorithm types to calculate.
 
   @retval TRUE            Successfully hash image.
   @retval FALSE           Fail in hash image.
 
 **/
 BOOLEAN
-HashPeImage (
-  IN  UINT32              HashAlg
+HashPeImageAll (
+  IN  UINT32              HashAlgMask
   )
 {
   BOOLEAN                   Status;
   UINT16                    Magic;
   EFI_IMAGE_SECTION_HEADER  *Section;
-  VOID                      *HashCtx;
+  VOID                      *HashCtx[HASHALG_MAX];
   UINTN                     CtxSize;
   UINT8                     *HashBase;
   UINTN                     HashSize;
@@ -308,59 +388,39 @@ HashPeImage (
   UINT32                    CertSize;
   UINT32                    NumberOfRvaAndSizes;
 
-  HashCtx       = NULL;
+  ZeroMem (HashCtx, sizeof (HashCtx));
   SectionHeader = NULL;
   Status        = FALSE;
 
-  if ((HashAlg >= HASHALG_MAX)) {
-    return FALSE;
-  }
-
   //
-  // Initialize context of hash.
+  // Skip the algorithms without implementation (SHA224).
   //
-  ZeroMem (mImageDigest, MAX_DIGEST_SIZE);
-
-  switch (HashAlg) {
-  case HASHALG_SHA1:
-    mImageDigestSize = SHA1_DIGEST_SIZE;
-    mCertType        = gEfiCertSha1Guid;
-    break;
-
-  case HASHALG_SHA256:
-    mImageDigestSize = SHA256_DIGEST_SIZE;
-    mCertType        = gEfiCertSha256Guid;
-    break;
-
-  case HASHALG_SHA384:
-    mImageDigestSize = SHA384_DIGEST_SIZE;
-    mCertType        = gEfiCertSha384Guid;
-    break;
-
-  case HASHALG_SHA512:
-    mImageDigestSize = SHA512_DIGEST_SIZE;
-    mCertType        = gEfiCertSha512Guid;
-    break;
-
-  default:
-    return FALSE;
+  for (Index = 0; Index < HASHALG_MAX; Index++) {
+    if (mHash[Index].GetContextSize == NULL) {
+      HashAlgMask &= ~(1 << Index);
+    }
   }
-
-  mHashTypeStr = mHash[HashAlg].Name;
-  CtxSize   = mHash[HashAlg].GetContextSize();
-
-  HashCtx = AllocatePool (CtxSize);
-  if (HashCtx == NULL) {
+  if (HashAlgMask == 0) {
     return FALSE;
   }
 
   // 1.  Load the image header into memory.
 
   // 2.  Initialize a SHA hash context.
-  Status = mHash[HashAlg].HashInit(HashCtx);
-
-  if (!Status) {
-    goto Done;
+  for (Index = 0; Index < HASHALG_MAX; Index++) {
+    if ((HashAlgMask & (1 << Index)) == 0) {
+      continue;
+    }
+    CtxSize        = mHash[Index].GetContextSize ();
+    HashCtx[Index] = AllocatePool (CtxSize);
+    if (HashCtx[Index] == NULL) {
+      Status = FALSE;
+      goto Done;
+    }
+    Status = mHash[Index].HashInit (HashCtx[Index]);
+    if (!Status) {
+      goto Done;
+    }
   }
 
   //
@@ -407,7 +467,7 @@ HashPeImage (
     goto Done;
   }
 
-  Status  = mHash[HashAlg].HashUpdate(HashCtx, HashBase, HashSize);
+  Status  = HashPeImageUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
   if (!Status) {
     goto Done;
   }
@@ -435,7 +495,7 @@ HashPeImage (
     }
 
     if (HashSize != 0) {
-      Status  = mHash[HashAlg].HashUpdate(HashCtx, HashBase, HashSize);
+      Status  = HashPeImageUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
       if (!Status) {
         goto Done;
       }
@@ -459,7 +519,7 @@ HashPeImage (
     }
 
     if (HashSize != 0) {
-      Status  = mHash[HashAlg].HashUpdate(HashCtx, HashBase, HashSize);
+      Status  = HashPeImageUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
       if (!Status) {
         goto Done;
       }
@@ -484,7 +544,7 @@ HashPeImage (
     }
 
     if (HashSize != 0) {
-      Status  = mHash[HashAlg].HashUpdate(HashCtx, HashBase, HashSize);
+      Status  = HashPeImageUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
       if (!Status) {
         goto Done;
       }
@@ -557,7 +617,7 @@ HashPeImage (
     HashBase  = mImageBase + Section->PointerToRawData;
     HashSize  = (UINTN) Section->SizeOfRawData;
 
-    Status  = mHash[HashAlg].HashUpdate(HashCtx, HashBase, HashSize);
+    Status  = HashPeImageUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
     if (!Status) {
       goto Done;
     }
@@ -593,7 +653,7 @@ HashPeImage (
     if (mImageSize > CertSize + SumOfBytesHashed) {
       HashSize = (UINTN) (mImageSize - CertSize - SumOfBytesHashed);
 
-      Status  = mHash[HashAlg].HashUpdate(HashCtx, HashBase, HashSize);
+      Status  = HashPeImageUpdate (HashCtx, HashAlgMask, HashBase, HashSize);
       if (!Status) {
         goto Done;
       }
@@ -603,11 +663,22 @@ HashPeImage (
     }
   }
 
-  Status  = mHash[HashAlg].HashFinal(HashCtx, mImageDigest);
+  for (Index = 0; Index < HASHALG_MAX; Index++) {
+    if ((HashAlgMask & (1 << Index)) == 0) {
+      continue;
+    }
+    Status = mHash[Index].HashFinal (HashCtx[Index], mImageDigestCache[Index]);
+    if (!Status) {
+      goto Done;
+    }
+  }
+  mImageDigestCacheMask |= HashAlgMask;
 
 Done:
-  if (HashCtx != NULL) {
-    FreePool (HashCtx);
+  for (Index = 0; Index < HASHALG_MAX; Index++) {
+    if (HashCtx[Index] != NULL) {
+      FreePool (HashCtx[Index]);
+    }
   }
   if (SectionHeader != NULL) {
     FreePool (SectionHeader);
@@ -616,9 +687,76 @@ Done:
 }
 
 /**
-  Recognize the Hash algorithm in PE/COFF Authenticode and calculate hash of
-  Pe/Coff image based on the authenticode image hashing in PE/COFF Specification
-  8.0 Appendix A
+  Calculate hash of Pe/Coff image based on the authenticode image hashing in
+  PE/COFF Specification 8.0 Appendix A
+
+  The digest is taken from mImageDigestCache when the image has already been
+  hashed with this algorithm. Otherwise the image is hashed once for this
+  algorithm together with every other algorithm in mImageHashAlgMask.
+  
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  Notes: PE/COFF image has been checked by BasePeCoffLib PeCoffLoaderGetImageInfo() in 
+  its caller function DxeImageVerificationHandler().
+
+  @param[in]    HashAlg   Hash algorithm type.
+
+  @retval TRUE            Successfully hash image.
+  @retval FALSE           Fail in hash image.
+
+**/
+BOOLEAN
+HashPeImage (
+  IN  UINT32              HashAlg
+  )
+{
+  if ((HashAlg >= HASHALG_MAX)) {
+    return FALSE;
+  }
+
+  ZeroMem (mImageDigest, MAX_DIGEST_SIZE);
+
+  switch (HashAlg) {
+  case HASHALG_SHA1:
+    mImageDigestSize = SHA1_DIGEST_SIZE;
+    mCertType        = gEfiCertSha1Guid;
+    break;
+
+  case HASHALG_SHA256:
+    mImageDigestSize = SHA256_DIGEST_SIZE;
+    mCertType        = gEfiCertSha256Guid;
+    break;
+
+  case HASHALG_SHA384:
+    mImageDigestSize = SHA384_DIGEST_SIZE;
+    mCertType        = gEfiCertSha384Guid;
+    break;
+
+  case HASHALG_SHA512:
+    mImageDigestSize = SHA512_DIGEST_SIZE;
+    mCertType        = gEfiCertSha512Guid;
+    break;
+
+  default:
+    return FALSE;
+  }
+
+  mHashTypeStr = mHash[HashAlg].Name;
+
+  if ((mImageDigestCacheMask & (1 << HashAlg)) == 0) {
+    if (!HashPeImageAll ((mImageHashAlgMask | (1 << HashAlg)) & ~mImageDigestCacheMask)) {
+      return FALSE;
+    }
+  }
+
+  CopyMem (mImageDigest, mImageDigestCache[HashAlg], mImageDigestSize);
+  return TRUE;
+}
+
+/**
+  Recognize the Hash algorithm in PE/COFF Authenticode.
 
   Caution: This function may receive untrusted input.
   PE/COFF image is external input, so this function will validate its data structure
@@ -627,17 +765,16 @@ Done:
   @param[in]  AuthData            Pointer to the Authenticode Signature retrieved from signed image.
   @param[in]  AuthDataSize        Size of the Authenticode Signature in bytes.
 
-  @retval EFI_UNSUPPORTED             Hash algorithm is not supported.
-  @retval EFI_SUCCESS                 Hash successfully.
+  @return The hash algorithm type, or HASHALG_MAX if the algorithm is not recognized.
 
 **/
-EFI_STATUS
-HashPeImageByType (
+UINT32
+GetAuthenticodeHashAlg (
   IN UINT8              *AuthData,
   IN UINTN              AuthDataSize
   )
 {
-  UINT8                     Index;
+  UINT32                    Index;
 
   for (Index = 0; Index < HASHALG_MAX; Index++) {
     //
@@ -660,7 +797,7 @@ HashPeImageByType (
     }
 
     if (AuthDataSize < 32 + mHash[Index].OidLength) {
-      return EFI_UNSUPPORTED;
+      return HASHALG_MAX;
     }
 
     if (CompareMem (AuthData + 32, mHash[Index].OidValue, mHash[Index].OidLength) == 0) {
@@ -668,6 +805,34 @@ HashPeImageByType (
     }
   }
 
+  return Index;
+}
+
+/**
+  Recognize the Hash algorithm in PE/COFF Authenticode and calculate hash of
+  Pe/Coff image based on the authenticode image hashing in PE/COFF Specification
+  8.0 Appendix A
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  AuthData            Pointer to the Authenticode Signature retrieved from signed image.
+  @param[in]  AuthDataSize        Size of the Authenticode Signature in bytes.
+
+  @retval EFI_UNSUPPORTED             Hash algorithm is not supported.
+  @retval EFI_SUCCESS                 Hash successfully.
+
+**/
+EFI_STATUS
+HashPeImageByType (
+  IN UINT8              *AuthData,
+  IN UINTN              AuthDataSize
+  )
+{
+  UINT32                    Index;
+
+  Index = GetAuthenticodeHashAlg (AuthData, AuthDataSize);
   if (Index == HASHALG_MAX) {
     return EFI_UNSUPPORTED;
   }
@@ -683,6 +848,78 @@ HashPeImageByType (
 }
 
 
+/**
+  Collect the hash algorithms used by the Authenticode signatures attached to the
+  current PE/COFF image, so that the image can be hashed with all of them at once.
+
+  Caution: This function may receive untrusted input.
+  PE/COFF image is external input, so this function will validate its data structure
+  within this image buffer before use.
+
+  @param[in]  SecDataDir          Pointer to the security data directory of the image.
+
+  @return Bit mask of the hash algorithm types used by the signatures.
+
+**/
+UINT32
+GetImageHashAlgMask (
+  IN EFI_IMAGE_DATA_DIRECTORY   *SecDataDir
+  )
+{
+  UINT32                        HashAlgMask;
+  UINT32                        HashAlg;
+  UINT32                        OffSet;
+  WIN_CERTIFICATE               *WinCertificate;
+  WIN_CERTIFICATE_EFI_PKCS      *PkcsCertData;
+  WIN_CERTIFICATE_UEFI_GUID     *WinCertUefiGuid;
+  UINT8                         *AuthData;
+  UINTN                         AuthDataSize;
+
+  HashAlgMask    = 0;
+  WinCertificate = NULL;
+
+  for (OffSet = SecDataDir->VirtualAddress;
+       OffSet < (SecDataDir->VirtualAddress + SecDataDir->Size);
+       OffSet += (WinCertificate->dwLength + ALIGN_SIZE (WinCertificate->dwLength))) {
+    WinCertificate = (WIN_CERTIFICATE *) (mImageBase + OffSet);
+    if ((SecDataDir->VirtualAddress + SecDataDir->Size - OffSet) <= sizeof (WIN_CERTIFICATE) ||
+        (SecDataDir->VirtualAddress + SecDataDir->Size - OffSet) < WinCertificate->dwLength) {
+      break;
+    }
+
+    if (WinCertificate->wCertificateType == WIN_CERT_TYPE_PKCS_SIGNED_DATA) {
+      PkcsCertData = (WIN_CERTIFICATE_EFI_PKCS *) WinCertificate;
+      if (PkcsCertData->Hdr.dwLength <= sizeof (PkcsCertData->Hdr)) {
+        break;
+      }
+      AuthData     = PkcsCertData->CertData;
+      AuthDataSize = PkcsCertData->Hdr.dwLength - sizeof (PkcsCertData->Hdr);
+    } else if (WinCertificate->wCertificateType == WIN_CERT_TYPE_EFI_GUID) {
+      WinCertUefiGuid = (WIN_CERTIFICATE_UEFI_GUID *) WinCertificate;
+      if (WinCertUefiGuid->Hdr.dwLength <= OFFSET_OF (WIN_CERTIFICATE_UEFI_GUID, CertData)) {
+        break;
+      }
+      if (!CompareGuid (&WinCertUefiGuid->CertType, &gEfiCertPkcs7Guid)) {
+        continue;
+      }
+      AuthData     = WinCertUefiGuid->CertData;
+      AuthDataSize = WinCertUefiGuid->Hdr.dwLength - OFFSET_OF (WIN_CERTIFICATE_UEFI_GUID, CertData);
+    } else {
+      if (WinCertificate->dwLength < sizeof (WIN_CERTIFICATE)) {
+        break;
+      }
+      continue;
+    }
+
+    HashAlg = GetAuthenticodeHashAlg (AuthData, AuthDataSize);
+    if (HashAlg < HASHALG_MAX) {
+      HashAlgMask |= (1 << HashAlg);
+    }
+  }
+
+  return HashAlgMask;
+}
+
 /**
   Returns the size of a given image execution info table in bytes.
 
@@ -834,6 +1071,264 @@ AddImageExeInfo (
   }
 }
 
+/**
+  Return the time elapsed since a performance counter value was read.
+
+  @param[in]  Start     The performance counter value read at the start.
+
+  @return The elapsed time in nanoseconds.
+
+**/
+UINT64
+GetElapsedTime (
+  IN UINT64             Start
+  )
+{
+  UINT64                End;
+  UINT64                CounterStart;
+  UINT64                CounterEnd;
+
+  End = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterStart > CounterEnd) {
+    return GetTimeInNanoSecond (Start - End);
+  }
+  return GetTimeInNanoSecond (End - Start);
+}
+
+/**
+  Free the content of a signature database index.
+
+  @param[in, out]  DbIndex    The signature database index.
+
+**/
+VOID
+FreeSignatureDbIndex (
+  IN OUT SIGNATURE_DB_INDEX  *DbIndex
+  )
+{
+  if (DbIndex->Data != NULL) {
+    FreePool (DbIndex->Data);
+  }
+  if (DbIndex->Scratch != NULL) {
+    FreePool (DbIndex->Scratch);
+  }
+  if (DbIndex->Entries != NULL) {
+    FreePool (DbIndex->Entries);
+  }
+  DbIndex->Data     = NULL;
+  DbIndex->Scratch  = NULL;
+  DbIndex->Entries  = NULL;
+  DbIndex->DataSize = 0;
+  DbIndex->Cached   = FALSE;
+  ZeroMem (DbIndex->Bucket, sizeof (DbIndex->Bucket));
+}
+
+/**
+  Calculate the SHA-256 digest of signature database variable data.
+
+  @param[in]  Data        The variable data.
+  @param[in]  DataSize    Size of the variable data in bytes.
+  @param[out] Digest      The SHA-256 digest of the data.
+
+  @retval TRUE     The digest is calculated.
+  @retval FALSE    No enough resource to calculate the digest.
+
+**/
+BOOLEAN
+HashSignatureDb (
+  IN  UINT8                 *Data,
+  IN  UINTN                 DataSize,
+  OUT UINT8                 *Digest
+  )
+{
+  VOID     *HashCtx;
+  BOOLEAN  Status;
+
+  HashCtx = AllocatePool (Sha256GetContextSize ());
+  if (HashCtx == NULL) {
+    return FALSE;
+  }
+
+  Status = Sha256Init (HashCtx) &&
+           Sha256Update (HashCtx, Data, DataSize) &&
+           Sha256Final (HashCtx, Digest);
+
+  FreePool (HashCtx);
+  return Status;
+}
+
+/**
+  Build the index of the signatures in the variable data held by a signature
+  database index.
+
+  @param[in, out]  DbIndex    The signature database index, with Data and DataSize set.
+
+  @retval TRUE     The index is built.
+  @retval FALSE    No enough resource to build the index.
+
+**/
+BOOLEAN
+BuildSignatureDbIndex (
+  IN OUT SIGNATURE_DB_INDEX  *DbIndex
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  UINTN               DataSize;
+  UINTN               Index;
+  UINTN               CertCount;
+  UINTN               EntryCount;
+  UINTN               Pass;
+  UINT8               Bucket;
+
+  //
+  // Count the signatures in the first pass and record them in the second one.
+  //
+  EntryCount = 0;
+  for (Pass = 0; Pass < 2; Pass++) {
+    CertList = (EFI_SIGNATURE_LIST *) DbIndex->Data;
+    DataSize = DbIndex->DataSize;
+    while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
+      if (CertList->SignatureSize > sizeof (EFI_GUID)) {
+        CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+        Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+        for (Index = 0; Index < CertCount; Index++) {
+          if (Pass == 1) {
+            DbIndex->Entries[EntryCount].SignatureList = CertList;
+            DbIndex->Entries[EntryCount].Signature     = Cert;
+          }
+          EntryCount++;
+          Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+        }
+      }
+
+      DataSize -= CertList->SignatureListSize;
+      CertList = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+    }
+
+    if (Pass == 0) {
+      if (EntryCount == 0) {
+        return TRUE;
+      }
+      DbIndex->Entries = AllocateZeroPool (EntryCount * sizeof (SIGNATURE_DB_ENTRY));
+      if (DbIndex->Entries == NULL) {
+        return FALSE;
+      }
+      EntryCount = 0;
+    }
+  }
+
+  //
+  // Link the entries backwards, so that every bucket chain keeps the database
+  // order and a lookup finds the same signature as a linear scan would.
+  //
+  for (Index = EntryCount; Index > 0; Index--) {
+    Bucket = DbIndex->Entries[Index - 1].Signature->SignatureData[0];
+    DbIndex->Entries[Index - 1].Next = DbIndex->Bucket[Bucket];
+    DbIndex->Bucket[Bucket]          = (UINT32) Index;
+  }
+
+  return TRUE;
+}
+
+/**
+  Get the up-to-date index of a signature database variable.
+
+  The variable is read once per image verification. The cached index is used
+  as long as the size and the SHA-256 digest of the variable data are the
+  ones of the data the index was built from, otherwise it is rebuilt. The
+  variable is not read again for the lookups of the same image verification.
+
+  @param[in]  VariableName        Name of database variable.
+
+  @return The signature database index, or NULL if the variable does not exist
+          or cannot be read.
+
+**/
+SIGNATURE_DB_INDEX *
+GetSignatureDbIndex (
+  IN CHAR16             *VariableName
+  )
+{
+  EFI_STATUS          Status;
+  SIGNATURE_DB_INDEX  *DbIndex;
+  UINTN               DataSize;
+  UINTN               Index;
+  UINT8               Digest[SHA256_DIGEST_SIZE];
+
+  DbIndex = NULL;
+  for (Index = 0; Index < sizeof (mSignatureDbIndex) / sizeof (mSignatureDbIndex[0]); Index++) {
+    if (StrCmp (VariableName, mSignatureDbIndex[Index].VariableName) == 0) {
+      DbIndex = &mSignatureDbIndex[Index];
+      break;
+    }
+  }
+  ASSERT (DbIndex != NULL);
+  if (DbIndex == NULL) {
+    return NULL;
+  }
+
+  if (DbIndex->Cached && (DbIndex->Verification == mSignatureDbVerification)) {
+    //
+    // The variable has been checked for this image verification already.
+    //
+    return (DbIndex->Data != NULL) ? DbIndex : NULL;
+  }
+
+  mSignatureDbReads++;
+  DataSize = 0;
+  Status   = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    FreeSignatureDbIndex (DbIndex);
+    if (Status == EFI_NOT_FOUND) {
+      DbIndex->Cached       = TRUE;
+      DbIndex->Verification = mSignatureDbVerification;
+    }
+    return NULL;
+  }
+
+  if ((DbIndex->Data != NULL) && (DataSize == DbIndex->DataSize)) {
+    Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, DbIndex->Scratch);
+    if (!EFI_ERROR (Status) && (DataSize == DbIndex->DataSize) &&
+        HashSignatureDb (DbIndex->Scratch, DataSize, Digest) &&
+        (CompareMem (Digest, DbIndex->Digest, SHA256_DIGEST_SIZE) == 0)) {
+      DbIndex->Cached       = TRUE;
+      DbIndex->Verification = mSignatureDbVerification;
+      return DbIndex;
+    }
+  }
+
+  //
+  // The variable is read for the first time or it has changed, rebuild the index.
+  //
+  FreeSignatureDbIndex (DbIndex);
+  DbIndex->Data    = AllocateZeroPool (DataSize);
+  DbIndex->Scratch = AllocateZeroPool (DataSize);
+  if ((DbIndex->Data == NULL) || (DbIndex->Scratch == NULL)) {
+    FreeSignatureDbIndex (DbIndex);
+    return NULL;
+  }
+
+  Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, DbIndex->Data);
+  if (EFI_ERROR (Status)) {
+    FreeSignatureDbIndex (DbIndex);
+    return NULL;
+  }
+  DbIndex->DataSize = DataSize;
+
+  if (!HashSignatureDb (DbIndex->Data, DataSize, DbIndex->Digest) ||
+      !BuildSignatureDbIndex (DbIndex)) {
+    FreeSignatureDbIndex (DbIndex);
+    return NULL;
+  }
+
+  DbIndex->Cached       = TRUE;
+  DbIndex->Verification = mSignatureDbVerification;
+  mSignatureDbIndexBuilds++;
+  return DbIndex;
+}
+
 /**
   Check whether the hash of an given X.509 certificate is in forbidden database (DBX).
 
@@ -865,22 +1360,28 @@ IsCertHashFoundInDatabase (
   UINTN               Index;
   UINT32              HashAlg;
   VOID                *HashCtx;
-  UINT8               CertDigest[MAX_DIGEST_SIZE];
+  UINT8               CertDigest[HASHALG_MAX][MAX_DIGEST_SIZE];
+  UINT32              CertDigestMask;
   UINT8               *DbxCertHash;
   UINTN               SiglistHeaderSize;
   UINT8               *TBSCert;
   UINTN               TBSCertSize;
+  UINT64              Start;
 
-  IsFound  = FALSE;
-  DbxList  = SignatureList;
-  DbxSize  = SignatureListSize;
-  HashCtx  = NULL;
-  HashAlg  = HASHALG_MAX;
+  IsFound        = FALSE;
+  DbxList        = SignatureList;
+  DbxSize        = SignatureListSize;
+  HashCtx        = NULL;
+  HashAlg        = HASHALG_MAX;
+  CertDigestMask = 0;
 
   if ((RevocationTime == NULL) || (DbxList == NULL)) {
     return FALSE;
   }
 
+  mCertHashLookups++;
+  Start = GetPerformanceCounter ();
+
   //
   // Retrieve the TBSCertificate from the X.509 Certificate.
   //
@@ -905,27 +1406,33 @@ IsCertHashFoundInDatabase (
     }
 
     //
-    // Calculate the hash value of current TBSCertificate for comparision.
+    // Calculate the hash value of current TBSCertificate for comparision,
+    // once per hash algorithm.
     //
-    if (mHash[HashAlg].GetContextSize == NULL) {
-      goto Done;
-    }
-    ZeroMem (CertDigest, MAX_DIGEST_SIZE);
-    HashCtx = AllocatePool (mHash[HashAlg].GetContextSize ());
-    if (HashCtx == NULL) {
-      goto Done;
-    }
-    Status = mHash[HashAlg].HashInit (HashCtx);
-    if (!Status) {
-      goto Done;
-    }
-    Status = mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize);
-    if (!Status) {
-      goto Done;
-    }
-    Status = mHash[HashAlg].HashFinal (HashCtx, CertDigest);
-    if (!Status) {
-      goto Done;
+    if ((CertDigestMask & (1 << HashAlg)) == 0) {
+      if (mHash[HashAlg].GetContextSize == NULL) {
+        goto Done;
+      }
+      ZeroMem (CertDigest[HashAlg], MAX_DIGEST_SIZE);
+      HashCtx = AllocatePool (mHash[HashAlg].GetContextSize ());
+      if (HashCtx == NULL) {
+        goto Done;
+      }
+      Status = mHash[HashAlg].HashInit (HashCtx);
+      if (!Status) {
+        goto Done;
+      }
+      Status = mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize);
+      if (!Status) {
+        goto Done;
+      }
+      Status = mHash[HashAlg].HashFinal (HashCtx, CertDigest[HashAlg]);
+      if (!Status) {
+        goto Done;
+      }
+      FreePool (HashCtx);
+      HashCtx = NULL;
+      CertDigestMask |= (1 << HashAlg);
     }
 
     SiglistHeaderSize = sizeof (EFI_SIGNATURE_LIST) + DbxList->SignatureHeaderSize;
@@ -936,7 +1443,7 @@ IsCertHashFoundInDatabase (
       // Iterate each Signature Data Node within this CertList for verify.
       //
       DbxCertHash = CertHash->SignatureData;
-      if (CompareMem (DbxCertHash, CertDigest, mHash[HashAlg].DigestLength) == 0) {
+      if (CompareMem (DbxCertHash, CertDigest[HashAlg], mHash[HashAlg].DigestLength) == 0) {
         //
         // Hash of Certificate is found in forbidden database.
         //
@@ -960,12 +1467,16 @@ Done:
     FreePool (HashCtx);
   }
 
+  mSignatureDbLookupTime += GetElapsedTime (Start);
   return IsFound;
 }
 
 /**
   Check whether signature is in specified database.
 
+  The lookup goes through the in-memory index of the database, see
+  GetSignatureDbIndex().
+
   @param[in]  VariableName        Name of database variable that is searched in.
   @param[in]  Signature           Pointer to signature that is searched for.
   @param[in]  CertType            Pointer to hash algrithom.
@@ -983,70 +1494,40 @@ IsSignatureFoundInDatabase (
   IN UINTN              SignatureSize
   )
 {
-  EFI_STATUS          Status;
-  EFI_SIGNATURE_LIST  *CertList;
-  EFI_SIGNATURE_DATA  *Cert;
-  UINTN               DataSize;
-  UINT8               *Data;
-  UINTN               Index;
-  UINTN               CertCount;
+  SIGNATURE_DB_INDEX  *DbIndex;
+  SIGNATURE_DB_ENTRY  *Entry;
+  UINT32              EntryIndex;
   BOOLEAN             IsFound;
+  UINT64              Start;
 
-  //
-  // Read signature database variable.
-  //
-  IsFound   = FALSE;
-  Data      = NULL;
-  DataSize  = 0;
-  Status    = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    return FALSE;
-  }
+  IsFound = FALSE;
+  mSignatureDbLookups++;
+  Start   = GetPerformanceCounter ();
 
-  Data = (UINT8 *) AllocateZeroPool (DataSize);
-  if (Data == NULL) {
-    return FALSE;
-  }
-
-  Status = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, Data);
-  if (EFI_ERROR (Status)) {
+  DbIndex = GetSignatureDbIndex (VariableName);
+  if ((DbIndex == NULL) || (SignatureSize == 0)) {
     goto Done;
   }
+
   //
-  // Enumerate all signature data in SigDB to check if executable's signature exists.
+  // Only the signatures in the bucket of the first signature byte can match.
   //
-  CertList = (EFI_SIGNATURE_LIST *) Data;
-  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
-    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
-    Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
-    if ((CertList->SignatureSize == sizeof(EFI_SIGNATURE_DATA) - 1 + SignatureSize) && (CompareGuid(&CertList->SignatureType, CertType))) {
-      for (Index = 0; Index < CertCount; Index++) {
-        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
-          //
-          // Find the signature in database.
-          //
-          IsFound = TRUE;
-          SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
-          break;
-        }
-
-        Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
-      }
-
-      if (IsFound) {
-        break;
-      }
+  for (EntryIndex = DbIndex->Bucket[Signature[0]]; EntryIndex != 0; EntryIndex = Entry->Next) {
+    Entry = &DbIndex->Entries[EntryIndex - 1];
+    if ((Entry->SignatureList->SignatureSize == sizeof(EFI_SIGNATURE_DATA) - 1 + SignatureSize) &&
+        (CompareGuid (&Entry->SignatureList->SignatureType, CertType)) &&
+        (CompareMem (Entry->Signature->SignatureData, Signature, SignatureSize) == 0)) {
+      //
+      // Find the signature in database.
+      //
+      IsFound = TRUE;
+      SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, Entry->SignatureList->SignatureSize, Entry->Signature);
+      break;
     }
-
-    DataSize -= CertList->SignatureListSize;
-    CertList = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
   }
 
 Done:
-  if (Data != NULL) {
-    FreePool (Data);
-  }
-
+  mSignatureDbLookupTime += GetElapsedTime (Start);
   return IsFound;
 }
 
@@ -1679,6 +2160,19 @@ DxeImageVerificationHandler (
   mImageBase  = (UINT8 *) FileBuffer;
   mImageSize  = FileSize;
 
+  //
+  // Digests of the previous image must not be used for this one, even when
+  // it is loaded from the same buffer.
+  //
+  mImageDigestCacheMask = 0;
+  mImageHashAlgMask     = 0;
+
+  //
+  // db and dbx may have been updated since the previous image, check them
+  // again.
+  //
+  mSignatureDbVerification++;
+
   ZeroMem (&ImageContext, sizeof (ImageContext));
   ImageContext.Handle    = (VOID *) FileBuffer;
   ImageContext.ImageRead = (PE_COFF_LOADER_READ_FILE) DxeImageVerificationLibImageRead;
@@ -1787,6 +2281,11 @@ DxeImageVerificationHandler (
     goto Done;
   }
 
+  //
+  // Hash the image only once for all the algorithms used by its signatures.
+  //
+  mImageHashAlgMask = GetImageHashAlgMask (SecDataDir);
+
   //
   // Verify the signature of the image, multiple signatures are allowed as per PE/COFF Section 4.7
   // "Attribute Certificate Table".
@@ -1945,6 +2444,16 @@ OnReadyToBoot (
   EFI_IMAGE_EXECUTION_INFO_TABLE  *ImageExeInfoTable;
   UINTN                           ImageExeInfoTableSize;
 
+  DEBUG ((
+    DEBUG_INFO,
+    "DxeImageVerificationLib: %d db/dbx hash lookups, %d certificate hash lookups, %d variable reads, %d index builds, %ld us\n",
+    (UINT32) mSignatureDbLookups,
+    (UINT32) mCertHashLookups,
+    (UINT32) mSignatureDbReads,
+    (UINT32) mSignatureDbIndexBuilds,
+    DivU64x32 (mSignatureDbLookupTime, 1000)
+    ));
+
   EfiGetSystemConfigurationTable (&gEfiImageSecurityDatabaseGuid, (VOID **) &ImageExeInfoTable);
   if (ImageExeInfoTable != NULL) {
     return;
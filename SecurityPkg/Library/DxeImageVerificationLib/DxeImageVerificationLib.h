@@ -29,12 +29,14 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/DevicePathLib.h>
 #include <Library/SecurityManagementLib.h>
 #include <Library/PeCoffLib.h>
+#include <Library/TimerLib.h>
 #include <Protocol/FirmwareVolume2.h>
 #include <Protocol/DevicePath.h>
 #include <Protocol/BlockIo.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/VariableWrite.h>
 #include <Guid/ImageAuthentication.h>
+#include <Guid/EventGroup.h>
 #include <Guid/AuthenticatedVariableFormat.h>
 #include <IndustryStandard/PeImage.h>
 
@@ -75,6 +77,12 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define HASHALG_SHA512                         0x00000004
 #define HASHALG_MAX                            0x00000005
 
+//
+// Size of the pieces in which a PE/COFF image range is fed to each hash algorithm
+// when several digests of the image are calculated together.
+//
+#define HASH_PE_IMAGE_CHUNK_SIZE               SIZE_64KB
+
 //
 // Set max digest size as SHA512 Output (64 bytes) by far
 //
@@ -204,4 +212,66 @@ typedef struct {
   HASH_FINAL               HashFinal;
 } HASH_TABLE;
 
+//
+// Number of hash buckets of a signature database index. The first byte of the
+// signature data selects the bucket, which spreads image hashes evenly.
+//
+#define SIGNATURE_DB_INDEX_BUCKETS  256
+
+//
+// One signature in a signature database index.
+//
+typedef struct {
+  //
+  // Signature list the signature belongs to, in the cached variable data
+  //
+  EFI_SIGNATURE_LIST       *SignatureList;
+  //
+  // The signature, in the cached variable data
+  //
+  EFI_SIGNATURE_DATA       *Signature;
+  //
+  // 1-based index of the next entry in the same bucket, 0 ends the chain
+  //
+  UINT32                   Next;
+} SIGNATURE_DB_ENTRY;
+
+//
+// In-memory index of a signature database variable (db or dbx).
+//
+typedef struct {
+  //
+  // Name of the signature database variable
+  //
+  CHAR16                   *VariableName;
+  //
+  // Copy of the variable data the index was built from
+  //
+  UINT8                    *Data;
+  UINTN                    DataSize;
+  //
+  // SHA-256 digest of Data
+  //
+  UINT8                    Digest[SHA256_DIGEST_SIZE];
+  //
+  // Buffer of DataSize bytes the variable is read into to detect changes
+  //
+  UINT8                    *Scratch;
+  //
+  // TRUE if Data (or the absence of the variable when Data is NULL) has been
+  // checked against the variable for the image verification numbered
+  // Verification
+  //
+  BOOLEAN                  Cached;
+  UINT32                   Verification;
+  //
+  // All the signatures in the variable, in database order
+  //
+  SIGNATURE_DB_ENTRY       *Entries;
+  //
+  // 1-based index of the first entry of each bucket, 0 for an empty bucket
+  //
+  UINT32                   Bucket[SIGNATURE_DB_INDEX_BUCKETS];
+} SIGNATURE_DB_INDEX;
+
 #endif
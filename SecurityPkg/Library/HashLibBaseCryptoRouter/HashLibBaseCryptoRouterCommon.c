@@ -21,6 +21,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/HashLib.h>
 #include <Protocol/Tcg2Protocol.h>
 
+#include "HashLibBaseCryptoRouterCommon.h"
+
 typedef struct {
   EFI_GUID  Guid;
   UINT32    Mask;
@@ -75,3 +77,59 @@ Tpm2SetHashToDigestList (
     );
   DigestList->count ++;
 }
+
+/**
+  Update the hash contexts of all the enabled hash interfaces with the same data.
+
+  The data is streamed through all the enabled algorithms HASH_LIB_CHUNK_SIZE
+  bytes at a time, so it is read from memory once instead of once per algorithm.
+
+  @param HashInterface      Registered hash interfaces.
+  @param HashInterfaceCount Number of registered hash interfaces.
+  @param HashCtx            Hash contexts, one per hash interface.
+  @param HashMask           Bitmap of the enabled hash algorithms.
+  @param DataToHash         Data to be hashed.
+  @param DataToHashLen      Data size.
+**/
+VOID
+EFIAPI
+Tpm2HashUpdateInterfaces (
+  IN HASH_INTERFACE         *HashInterface,
+  IN UINTN                  HashInterfaceCount,
+  IN HASH_HANDLE            *HashCtx,
+  IN UINT32                 HashMask,
+  IN VOID                   *DataToHash,
+  IN UINTN                  DataToHashLen
+  )
+{
+  UINTN  Active[HASH_COUNT];
+  UINTN  ActiveCount;
+  UINTN  Index;
+  UINTN  ChunkSize;
+  UINT8  *Data;
+
+  //
+  // Resolve the enabled interfaces once, not for every chunk.
+  //
+  ActiveCount = 0;
+  for (Index = 0; Index < HashInterfaceCount && ActiveCount < HASH_COUNT; Index++) {
+    if ((Tpm2GetHashMaskFromAlgo (&HashInterface[Index].HashGuid) & HashMask) != 0) {
+      Active[ActiveCount++] = Index;
+    }
+  }
+
+  if (ActiveCount == 1) {
+    HashInterface[Active[0]].HashUpdate (HashCtx[Active[0]], DataToHash, DataToHashLen);
+    return;
+  }
+
+  Data = (UINT8 *) DataToHash;
+  while (DataToHashLen > 0) {
+    ChunkSize = MIN (DataToHashLen, HASH_LIB_CHUNK_SIZE);
+    for (Index = 0; Index < ActiveCount; Index++) {
+      HashInterface[Active[Index]].HashUpdate (HashCtx[Active[Index]], Data, ChunkSize);
+    }
+    Data          += ChunkSize;
+    DataToHashLen -= ChunkSize;
+  }
+}
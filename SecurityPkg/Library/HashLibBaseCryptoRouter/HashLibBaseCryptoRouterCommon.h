@@ -15,6 +15,13 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #ifndef _HASH_LIB_BASE_CRYPTO_ROUTER_COMMON_H_
 #define _HASH_LIB_BASE_CRYPTO_ROUTER_COMMON_H_
 
+//
+// Size of the pieces the data is streamed in through all the hash algorithms.
+// Small enough for a piece to stay in the processor data cache while every
+// algorithm reads it.
+//
+#define HASH_LIB_CHUNK_SIZE  SIZE_16KB
+
 /**
   The function get hash mask info from algorithm.
 
@@ -41,4 +48,28 @@ Tpm2SetHashToDigestList (
   IN TPML_DIGEST_VALUES     *Digest
   );
 
+/**
+  Update the hash contexts of all the enabled hash interfaces with the same data.
+
+  The data is streamed through all the enabled algorithms HASH_LIB_CHUNK_SIZE
+  bytes at a time, so it is read from memory once instead of once per algorithm.
+
+  @param HashInterface      Registered hash interfaces.
+  @param HashInterfaceCount Number of registered hash interfaces.
+  @param HashCtx            Hash contexts, one per hash interface.
+  @param HashMask           Bitmap of the enabled hash algorithms.
+  @param DataToHash         Data to be hashed.
+  @param DataToHashLen      Data size.
+**/
+VOID
+EFIAPI
+Tpm2HashUpdateInterfaces (
+  IN HASH_INTERFACE         *HashInterface,
+  IN UINTN                  HashInterfaceCount,
+  IN HASH_HANDLE            *HashCtx,
+  IN UINT32                 HashMask,
+  IN VOID                   *DataToHash,
+  IN UINTN                  DataToHashLen
+  );
+
 #endif
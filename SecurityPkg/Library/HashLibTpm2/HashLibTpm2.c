@@ -204,10 +204,12 @@ HashCompleteAndExtend (
     DigestList->count = 1;
     DigestList->digests[0].hashAlg = AlgoId;
     CopyMem (&DigestList->digests[0].digest, Result.buffer, Result.size);
-    Status = Tpm2PcrExtend (
-               PcrIndex,
-               DigestList
-               );
+    if (PcrIndex != TPM_RH_NULL) {
+      Status = Tpm2PcrExtend (
+                 PcrIndex,
+                 DigestList
+                 );
+    }
   }
   if (EFI_ERROR(Status)) {
     return EFI_DEVICE_ERROR;
@@ -310,14 +312,16 @@ HashAndExtend (
     DigestList->count = 1;
     DigestList->digests[0].hashAlg = AlgoId;
     CopyMem (&DigestList->digests[0].digest, Result.buffer, Result.size);
-    Status = Tpm2PcrExtend (
-               PcrIndex,
-               DigestList
-               );
-    if (EFI_ERROR(Status)) {
-      return EFI_DEVICE_ERROR;
+    if (PcrIndex != TPM_RH_NULL) {
+      Status = Tpm2PcrExtend (
+                 PcrIndex,
+                 DigestList
+                 );
+      if (EFI_ERROR(Status)) {
+        return EFI_DEVICE_ERROR;
+      }
+      DEBUG((EFI_D_VERBOSE, "\n Tpm2PcrExtend Success \n"));
     }
-    DEBUG((EFI_D_VERBOSE, "\n Tpm2PcrExtend Success \n"));
   }
 
   return EFI_SUCCESS;
@@ -106,6 +106,31 @@ TCG_DXE_DATA                 mTcgDxeData = {
   },
 };
 
+//
+// PCR extend queued until the next measurement barrier (PcdTcg2DeferPcrExtend).
+//
+typedef struct {
+  LIST_ENTRY                        Link;
+  TPMI_DH_PCR                       PcrIndex;
+  TPML_DIGEST_VALUES                DigestList;
+} TCG_PENDING_PCR_EXTEND;
+
+BOOLEAN     mDeferPcrExtend;
+LIST_ENTRY  mPendingPcrExtendList = INITIALIZE_LIST_HEAD_VARIABLE (mPendingPcrExtendList);
+
+typedef struct {
+  UINT32                            HashAlgorithmMask;
+  TPMI_ALG_HASH                     HashAlg;
+} TCG2_PCR_BANK_STRUCT;
+
+TCG2_PCR_BANK_STRUCT mTcg2PcrBanks[] = {
+  {EFI_TCG2_BOOT_HASH_ALG_SHA1,    TPM_ALG_SHA1},
+  {EFI_TCG2_BOOT_HASH_ALG_SHA256,  TPM_ALG_SHA256},
+  {EFI_TCG2_BOOT_HASH_ALG_SHA384,  TPM_ALG_SHA384},
+  {EFI_TCG2_BOOT_HASH_ALG_SHA512,  TPM_ALG_SHA512},
+  {EFI_TCG2_BOOT_HASH_ALG_SM3_256, TPM_ALG_SM3_256},
+};
+
 UINTN  mBootAttempts  = 0;
 CHAR16 mBootVarName[] = L"BootOrder";
 
@@ -603,6 +628,175 @@ DumpEventLog (
   return ;
 }
 
+/**
+  Get the PCR handle that the data of a measurement is hashed against.
+
+  When PCR extends are deferred, the data is only hashed (TPM_RH_NULL) and the
+  extend is queued by TcgDxeExtendPcr() after the digests are returned.
+
+  @param[in]  PcrIndex         PCR the measurement is extended to.
+
+  @return PCR handle to pass to HashLib.
+**/
+TPMI_DH_PCR
+TcgDxeGetHashPcrHandle (
+  IN TPMI_DH_PCR                    PcrIndex
+  )
+{
+  if (mDeferPcrExtend) {
+    return TPM_RH_NULL;
+  }
+  return PcrIndex;
+}
+
+/**
+  Send all the deferred PCR extends to the TPM.
+
+  Every deferred event is extended with its own TPM2_PCR_Extend, which carries
+  one digest per active PCR bank, in the order the events were measured. The
+  TPM receives the same commands as in the non-deferred mode, only later.
+
+  If a command fails, the remaining deferred extends are dropped and the TPM
+  is disabled, as when an extend fails in the non-deferred mode.
+
+  @retval EFI_SUCCESS           All deferred PCR extends are sent to the TPM.
+  @retval EFI_DEVICE_ERROR      The command was unsuccessful. The TPM is disabled.
+**/
+EFI_STATUS
+TcgDxeFlushPcrExtends (
+  VOID
+  )
+{
+  EFI_STATUS                        Status;
+  TCG_PENDING_PCR_EXTEND            *Pending;
+  UINTN                             Count;
+
+  Status = EFI_SUCCESS;
+  Count  = 0;
+  while (!IsListEmpty (&mPendingPcrExtendList)) {
+    Pending = BASE_CR (GetFirstNode (&mPendingPcrExtendList), TCG_PENDING_PCR_EXTEND, Link);
+    RemoveEntryList (&Pending->Link);
+
+    if (!EFI_ERROR (Status)) {
+      Status = Tpm2PcrExtend (Pending->PcrIndex, &Pending->DigestList);
+      Count++;
+    }
+
+    //
+    // Deferring stops when ExitBootServices() is signaled, memory services
+    // must not be used any more from that point.
+    //
+    if (mDeferPcrExtend) {
+      FreePool (Pending);
+    }
+  }
+
+  if (Count != 0) {
+    DEBUG ((EFI_D_INFO, "Tcg2Dxe: %d deferred PCR extends flushed - %r\n", (UINT32) Count, Status));
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "TcgDxeFlushPcrExtends - %r. Disable TPM.\n", Status));
+    mTcgDxeData.BsCap.TPMPresentFlag = FALSE;
+    REPORT_STATUS_CODE (
+      EFI_ERROR_CODE | EFI_ERROR_MINOR,
+      (PcdGet32 (PcdStatusCodeSubClassTpmDevice) | EFI_P_EC_INTERFACE_ERROR)
+      );
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Extend the digests of a measurement hashed against TcgDxeGetHashPcrHandle ().
+
+  In the non-deferred mode HashLib has already extended the PCR and nothing is
+  left to do. Otherwise the extend is queued for TcgDxeFlushPcrExtends ().
+
+  @param[in]  PcrIndex         PCR to be extended.
+  @param[in]  DigestList       Digests of the measurement.
+
+  @retval EFI_SUCCESS           The PCR extend is done or queued.
+  @retval EFI_DEVICE_ERROR      The command was unsuccessful.
+**/
+EFI_STATUS
+TcgDxeExtendPcr (
+  IN TPMI_DH_PCR                    PcrIndex,
+  IN TPML_DIGEST_VALUES             *DigestList
+  )
+{
+  EFI_STATUS                        Status;
+  TCG_PENDING_PCR_EXTEND            *Pending;
+
+  if (!mDeferPcrExtend) {
+    return EFI_SUCCESS;
+  }
+
+  Pending = AllocatePool (sizeof (*Pending));
+  if (Pending == NULL) {
+    //
+    // Keep the extend order: drain the queue, then extend this one directly.
+    //
+    Status = TcgDxeFlushPcrExtends ();
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    return Tpm2PcrExtend (PcrIndex, DigestList);
+  }
+
+  Pending->PcrIndex = PcrIndex;
+  CopyMem (&Pending->DigestList, DigestList, sizeof (*DigestList));
+  InsertTailList (&mPendingPcrExtendList, &Pending->Link);
+  return EFI_SUCCESS;
+}
+
+/**
+  Dump PCR 0-7 of all active PCR banks.
+
+  The output of a boot with PcdTcg2DeferPcrExtend set to TRUE can be compared
+  with the one of a boot with it set to FALSE (e.g. against a TPM simulator)
+  to check that deferring the extends does not change the PCR values.
+**/
+VOID
+DumpPcrValues (
+  VOID
+  )
+{
+  EFI_STATUS                        Status;
+  TPML_PCR_SELECTION                PcrSelectionIn;
+  TPML_PCR_SELECTION                PcrSelectionOut;
+  TPML_DIGEST                       PcrValues;
+  UINT32                            PcrUpdateCounter;
+  UINTN                             BankIndex;
+  UINTN                             PcrIndex;
+
+  for (BankIndex = 0; BankIndex < sizeof (mTcg2PcrBanks) / sizeof (mTcg2PcrBanks[0]); BankIndex++) {
+    if ((mTcgDxeData.BsCap.ActivePcrBanks & mTcg2PcrBanks[BankIndex].HashAlgorithmMask) == 0) {
+      continue;
+    }
+
+    ZeroMem (&PcrSelectionIn, sizeof (PcrSelectionIn));
+    PcrSelectionIn.count = 1;
+    PcrSelectionIn.pcrSelections[0].hash = mTcg2PcrBanks[BankIndex].HashAlg;
+    PcrSelectionIn.pcrSelections[0].sizeofSelect = PCR_SELECT_MAX;
+    PcrSelectionIn.pcrSelections[0].pcrSelect[0] = 0xFF;
+
+    Status = Tpm2PcrRead (&PcrSelectionIn, &PcrUpdateCounter, &PcrSelectionOut, &PcrValues);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "Tpm2PcrRead (0x%04x) - %r\n", mTcg2PcrBanks[BankIndex].HashAlg, Status));
+      continue;
+    }
+
+    DEBUG ((EFI_D_INFO, "PCR bank 0x%04x (PcrUpdateCounter - 0x%x):\n", mTcg2PcrBanks[BankIndex].HashAlg, PcrUpdateCounter));
+    for (PcrIndex = 0; PcrIndex < PcrValues.count; PcrIndex++) {
+      DEBUG ((EFI_D_INFO, "  PCR[%d] - ", (UINT32) PcrIndex));
+      InternalDumpData (PcrValues.digests[PcrIndex].buffer, PcrValues.digests[PcrIndex].size);
+      DEBUG ((EFI_D_INFO, "\n"));
+    }
+  }
+}
+
 /**
   The EFI_TCG2_PROTOCOL Get Event Log function call allows a caller to
   retrieve the address of a given event log and its last entry. 
@@ -630,7 +824,8 @@ Tcg2GetEventLog (
   OUT BOOLEAN                  *EventLogTruncated
   )
 {
-  UINTN  Index;
+  EFI_STATUS  Status;
+  UINTN       Index;
 
   DEBUG ((EFI_D_INFO, "Tcg2GetEventLog ... (0x%x)\n", EventLogFormat));
 
@@ -652,6 +847,17 @@ Tcg2GetEventLog (
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // The event log is handed out, make the PCRs match it. If that fails, the
+  // TPM is disabled and no event log is returned.
+  //
+  if (mTcgDxeData.BsCap.TPMPresentFlag) {
+    Status = TcgDxeFlushPcrExtends ();
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "Tcg2GetEventLog - deferred PCR extends not sent - %r\n", Status));
+    }
+  }
+
   if (!mTcgDxeData.BsCap.TPMPresentFlag) {
     if (EventLogLocation != NULL) {
       *EventLogLocation = 0;
@@ -1019,11 +1225,14 @@ TcgDxeHashLogExtendEvent (
   }
 
   Status = HashAndExtend (
-             NewEventHdr->PCRIndex,
+             TcgDxeGetHashPcrHandle (NewEventHdr->PCRIndex),
              HashData,
              (UINTN)HashDataLen,
              &DigestList
              );
+  if (!EFI_ERROR (Status)) {
+    Status = TcgDxeExtendPcr (NewEventHdr->PCRIndex, &DigestList);
+  }
   if (!EFI_ERROR (Status)) {
     if ((Flags & EFI_TCG2_EXTEND_ONLY) == 0) {
       Status = TcgDxeLogHashEvent (&DigestList, NewEventHdr, NewEventData);
@@ -1098,11 +1307,14 @@ Tcg2HashLogExtendEvent (
   NewEventHdr.EventSize = Event->Size - sizeof(UINT32) - Event->Header.HeaderSize;
   if ((Flags & PE_COFF_IMAGE) != 0) {
     Status = MeasurePeImageAndExtend (
-               NewEventHdr.PCRIndex,
+               TcgDxeGetHashPcrHandle (NewEventHdr.PCRIndex),
                DataToHash,
                (UINTN)DataToHashLen,
                &DigestList
                );
+    if (!EFI_ERROR (Status)) {
+      Status = TcgDxeExtendPcr (NewEventHdr.PCRIndex, &DigestList);
+    }
     if (!EFI_ERROR (Status)) {
       if ((Flags & EFI_TCG2_EXTEND_ONLY) == 0) {
         Status = TcgDxeLogHashEvent (&DigestList, &NewEventHdr, Event->Event);
@@ -1174,6 +1386,14 @@ Tcg2SubmitCommand (
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // The caller may read PCRs, so send the deferred PCR extends first.
+  //
+  Status = TcgDxeFlushPcrExtends ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Status = Tpm2SubmitCommand (
              InputParameterBlockSize,
              InputParameterBlock,
@@ -2100,6 +2320,17 @@ OnReadyToBoot (
     }
   }
 
+  //
+  // ReadyToBoot is a measurement barrier, the boot option runs with all PCRs extended.
+  //
+  Status = TcgDxeFlushPcrExtends ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "Deferred PCR extends not sent at ReadyToBoot. Error!\n"));
+  }
+  DEBUG_CODE (
+    DumpPcrValues ();
+  );
+
   DEBUG ((EFI_D_INFO, "TPM2 Tcg2Dxe Measure Data when ReadyToBoot\n"));
   //
   // Increase boot attempt counter.
@@ -2126,6 +2357,16 @@ OnExitBootServices (
 {
   EFI_STATUS    Status;
 
+  //
+  // Send the PCR extends queued since ReadyToBoot (e.g. the OS loader) and
+  // extend the remaining measurements directly.
+  //
+  mDeferPcrExtend = FALSE;
+  Status = TcgDxeFlushPcrExtends ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "Deferred PCR extends not sent at ExitBootServices. Error!\n"));
+  }
+
   //
   // Measure invocation of ExitBootServices,
   //
@@ -2175,6 +2416,10 @@ OnExitBootServicesFailed (
     DEBUG ((EFI_D_ERROR, "%a not Measured. Error!\n", EFI_EXIT_BOOT_SERVICES_FAILED));
   }
 
+  Status = TcgDxeFlushPcrExtends ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "Deferred PCR extends not sent after ExitBootServices failed. Error!\n"));
+  }
 }
 
 /**
@@ -2228,6 +2473,7 @@ DriverEntry (
   UINT32                            NumberOfPCRBanks;
 
   mImageHandle = ImageHandle;
+  mDeferPcrExtend = PcdGetBool (PcdTcg2DeferPcrExtend);
 
   if (CompareGuid (PcdGetPtr(PcdTpmInstanceGuid), &gEfiTpmDeviceInstanceNoneGuid) ||
       CompareGuid (PcdGetPtr(PcdTpmInstanceGuid), &gEfiTpmDeviceInstanceTpm12Guid)){
@@ -0,0 +1,178 @@
+/** @file
+  UEFI Application to measure the latency of the MP services.
+
+  Reports how long StartupAllAPs() and StartupThisAP() take to wake up the
+  APs, run an empty procedure and detect its completion, so that the MP
+  initialization cost can be compared across processor counts, for example
+  under QEMU with several "-smp" values and both PcdCpuApLoopMode settings.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Pi/PiMultiPhase.h>
+#include <Protocol/MpService.h>
+#include <Library/BaseLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+///
+/// Number of StartupAllAPs() calls that are averaged.
+///
+#define MP_BENCHMARK_ITERATIONS  100
+
+UINT32  mCheckInCount;
+
+/**
+  AP procedure that only checks in.
+
+  @param[in, out] Buffer  Not used.
+**/
+VOID
+EFIAPI
+BenchmarkApProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  InterlockedIncrement (&mCheckInCount);
+}
+
+/**
+  Return the time elapsed since StartTime in nanoseconds.
+
+  @param[in] StartTime  The performance counter value at the start.
+
+  @return The elapsed time in nanoseconds.
+**/
+UINT64
+ElapsedNanoSeconds (
+  IN UINT64  StartTime
+  )
+{
+  UINT64  EndTime;
+  UINT64  Start;
+  UINT64  End;
+
+  EndTime = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&Start, &End);
+  if (End < Start) {
+    return GetTimeInNanoSecond (StartTime - EndTime);
+  }
+  return GetTimeInNanoSecond (EndTime - StartTime);
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The entry point is executed successfully.
+  @retval other             Some error occurs when executing this entry point.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                Status;
+  EFI_MP_SERVICES_PROTOCOL  *MpService;
+  UINTN                     NumberOfProcessors;
+  UINTN                     NumberOfEnabledProcessors;
+  UINTN                     BspNumber;
+  UINTN                     ProcessorNumber;
+  UINTN                     Index;
+  UINTN                     ApCount;
+  UINT64                    StartTime;
+  UINT64                    Elapsed;
+  UINT64                    Total;
+  UINT64                    Max;
+
+  Print (L"UEFI MP Services Benchmark Version 0.1\n");
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &MpService);
+  if (EFI_ERROR (Status)) {
+    Print (L"MP Services Protocol not found - %r\n", Status);
+    return Status;
+  }
+
+  MpService->GetNumberOfProcessors (MpService, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  MpService->WhoAmI (MpService, &BspNumber);
+  Print (L"Processors: %d, enabled: %d\n", (UINT32) NumberOfProcessors, (UINT32) NumberOfEnabledProcessors);
+  if (NumberOfEnabledProcessors < 2) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // StartupAllAPs() round trip: wake up all the APs, run an empty procedure
+  // and detect the completion of all of them.
+  //
+  Total = 0;
+  Max   = 0;
+  for (Index = 0; Index < MP_BENCHMARK_ITERATIONS; Index++) {
+    mCheckInCount = 0;
+    StartTime = GetPerformanceCounter ();
+    Status = MpService->StartupAllAPs (MpService, BenchmarkApProcedure, FALSE, NULL, 0, NULL, NULL);
+    Elapsed = ElapsedNanoSeconds (StartTime);
+    if (EFI_ERROR (Status)) {
+      Print (L"StartupAllAPs failed - %r\n", Status);
+      return Status;
+    }
+    if (mCheckInCount != NumberOfEnabledProcessors - 1) {
+      Print (L"StartupAllAPs: %d of %d APs checked in\n", mCheckInCount, (UINT32) (NumberOfEnabledProcessors - 1));
+    }
+    Total += Elapsed;
+    Max    = MAX (Max, Elapsed);
+  }
+  Print (
+    L"StartupAllAPs: average %ld us, max %ld us over %d calls\n",
+    DivU64x32 (Total, MP_BENCHMARK_ITERATIONS * 1000),
+    DivU64x32 (Max, 1000),
+    MP_BENCHMARK_ITERATIONS
+    );
+
+  //
+  // StartupThisAP() round trip on each AP in turn.
+  //
+  Total   = 0;
+  Max     = 0;
+  ApCount = 0;
+  for (ProcessorNumber = 0; ProcessorNumber < NumberOfProcessors; ProcessorNumber++) {
+    if (ProcessorNumber == BspNumber) {
+      continue;
+    }
+    StartTime = GetPerformanceCounter ();
+    Status = MpService->StartupThisAP (MpService, BenchmarkApProcedure, ProcessorNumber, NULL, 0, NULL, NULL);
+    Elapsed = ElapsedNanoSeconds (StartTime);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+    Total += Elapsed;
+    Max    = MAX (Max, Elapsed);
+    ApCount++;
+  }
+  if (ApCount != 0) {
+    Print (
+      L"StartupThisAP: average %ld us, max %ld us over %d APs\n",
+      DivU64x32 (Total, (UINT32) ApCount * 1000),
+      DivU64x32 (Max, 1000),
+      (UINT32) ApCount
+      );
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,458 @@
+/** @file
+  CPU DXE Module to produce the EDKII AP Task Protocol.
+
+  Submitted tasks are handed to idle APs through MpInitLibStartupThisAP() in
+  non-blocking mode. MpInitLib signals the per-task wait event on the BSP once
+  the AP has returned, and the notification function then signals the
+  caller's completion event and starts the next queued task on that AP.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "CpuDxe.h"
+#include "CpuMp.h"
+
+#define AP_TASK_SIGNATURE  SIGNATURE_32 ('A', 'P', 'T', 'K')
+
+typedef struct {
+  UINT32            Signature;
+  LIST_ENTRY        Link;
+  CHAR8             *Name;
+  EFI_AP_PROCEDURE  Procedure;
+  VOID              *ProcedureArgument;
+  EFI_EVENT         CompletionEvent;
+  EFI_EVENT         WaitEvent;
+  UINTN             ProcessorNumber;
+  UINT64            StartTicks;
+  UINT64            EndTicks;
+} AP_TASK;
+
+extern UINTN     mNumberOfProcessors;
+
+LIST_ENTRY       mApTaskQueue       = INITIALIZE_LIST_HEAD_VARIABLE (mApTaskQueue);
+LIST_ENTRY       mApTaskDoneList    = INITIALIZE_LIST_HEAD_VARIABLE (mApTaskDoneList);
+BOOLEAN          *mApTaskCpuBusy    = NULL;
+UINTN            mApTaskRunning     = 0;
+volatile UINTN   mApTaskOutstanding = 0;
+UINTN            mApTaskBspNumber   = 0;
+UINT64           mApTaskTimeBase    = 0;
+
+/**
+  Queue a task to run on the next idle AP.
+
+  @param This              The pointer to this protocol instance.
+  @param Name              A short description of the task.
+  @param Procedure         The AP-safe procedure to run.
+  @param ProcedureArgument The parameter passed into Procedure.
+  @param CompletionEvent   The event to signal on the BSP when Procedure has
+                           returned.
+
+  @retval EFI_SUCCESS            The task was queued or has completed.
+  @retval EFI_INVALID_PARAMETER  Name or Procedure is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to queue the task.
+
+**/
+EFI_STATUS
+EFIAPI
+ApTaskSubmit (
+  IN EDKII_AP_TASK_PROTOCOL  *This,
+  IN CONST CHAR8             *Name,
+  IN EFI_AP_PROCEDURE        Procedure,
+  IN VOID                    *ProcedureArgument OPTIONAL,
+  IN EFI_EVENT               CompletionEvent OPTIONAL
+  );
+
+/**
+  Wait until every submitted task has completed.
+
+  @param This              The pointer to this protocol instance.
+
+  @return The number of tasks that were still queued or running on entry.
+
+**/
+UINTN
+EFIAPI
+ApTaskWaitAll (
+  IN EDKII_AP_TASK_PROTOCOL  *This
+  );
+
+EDKII_AP_TASK_PROTOCOL  mApTaskProtocol = {
+  ApTaskSubmit,
+  ApTaskWaitAll
+};
+
+/**
+  Run the procedure of a task and time stamp it. Runs on an AP, or on the BSP
+  when no AP is available.
+
+  @param[in, out] Buffer  Pointer to the AP_TASK.
+
+**/
+VOID
+EFIAPI
+ApTaskProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  AP_TASK  *Task;
+
+  Task             = (AP_TASK *) Buffer;
+  Task->StartTicks = GetPerformanceCounter ();
+  Task->Procedure (Task->ProcedureArgument);
+  Task->EndTicks   = GetPerformanceCounter ();
+}
+
+/**
+  Retire a task whose procedure has returned, and signal its completion event.
+  Must be called at TPL_CALLBACK.
+
+  @param[in] Task  The task that has finished.
+
+**/
+VOID
+ApTaskFinish (
+  IN AP_TASK  *Task
+  )
+{
+  if (Task->WaitEvent != NULL) {
+    gBS->CloseEvent (Task->WaitEvent);
+    Task->WaitEvent = NULL;
+  }
+
+  InsertTailList (&mApTaskDoneList, &Task->Link);
+  if (Task->CompletionEvent != NULL) {
+    gBS->SignalEvent (Task->CompletionEvent);
+  }
+
+  mApTaskOutstanding--;
+}
+
+/**
+  Start queued tasks on every idle AP. If no task is running on any AP
+  afterwards, for example because all APs are disabled, run the rest of the
+  queue on the BSP so that it cannot stall. Must be called at TPL_CALLBACK.
+
+**/
+VOID
+ApTaskDispatch (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  AP_TASK     *Task;
+
+  MpInitLibWhoAmI (&mApTaskBspNumber);
+
+  for (Index = 0; Index < mNumberOfProcessors && !IsListEmpty (&mApTaskQueue); Index++) {
+    if (Index == mApTaskBspNumber || mApTaskCpuBusy[Index]) {
+      continue;
+    }
+
+    Task   = CR (GetFirstNode (&mApTaskQueue), AP_TASK, Link, AP_TASK_SIGNATURE);
+    Status = MpInitLibStartupThisAP (
+               ApTaskProcedure,
+               Index,
+               Task->WaitEvent,
+               0,
+               Task,
+               NULL
+               );
+    if (EFI_ERROR (Status)) {
+      //
+      // The AP is disabled, or busy with work started through the MP
+      // Services Protocol.
+      //
+      continue;
+    }
+
+    RemoveEntryList (&Task->Link);
+    Task->ProcessorNumber = Index;
+    mApTaskCpuBusy[Index] = TRUE;
+    mApTaskRunning++;
+  }
+
+  while (mApTaskRunning == 0 && !IsListEmpty (&mApTaskQueue)) {
+    Task = CR (GetFirstNode (&mApTaskQueue), AP_TASK, Link, AP_TASK_SIGNATURE);
+    RemoveEntryList (&Task->Link);
+    Task->ProcessorNumber = mApTaskBspNumber;
+    ApTaskProcedure (Task);
+    ApTaskFinish (Task);
+  }
+}
+
+/**
+  Notification function of the per-task wait event, signaled on the BSP by
+  MpInitLib once the AP has returned from the task.
+
+  @param[in] Event    The wait event.
+  @param[in] Context  Pointer to the AP_TASK.
+
+**/
+VOID
+EFIAPI
+ApTaskOnApDone (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  AP_TASK  *Task;
+
+  Task = (AP_TASK *) Context;
+  mApTaskCpuBusy[Task->ProcessorNumber] = FALSE;
+  mApTaskRunning--;
+
+  ApTaskFinish (Task);
+  ApTaskDispatch ();
+}
+
+/**
+  Queue a task to run on the next idle AP.
+
+  If no AP is available at all, the task is run on the BSP before this
+  function returns. In both cases CompletionEvent is signaled on the BSP once
+  Procedure has returned.
+
+  @param This              The pointer to this protocol instance.
+  @param Name              A short description of the task, used for the
+                           per-CPU timeline report. It is copied.
+  @param Procedure         The AP-safe procedure to run.
+  @param ProcedureArgument The parameter passed into Procedure.
+  @param CompletionEvent   The event to signal on the BSP when Procedure has
+                           returned. Optional.
+
+  @retval EFI_SUCCESS            The task was queued or has completed.
+  @retval EFI_INVALID_PARAMETER  Name or Procedure is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to queue the task.
+
+**/
+EFI_STATUS
+EFIAPI
+ApTaskSubmit (
+  IN EDKII_AP_TASK_PROTOCOL  *This,
+  IN CONST CHAR8             *Name,
+  IN EFI_AP_PROCEDURE        Procedure,
+  IN VOID                    *ProcedureArgument OPTIONAL,
+  IN EFI_EVENT               CompletionEvent OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+  AP_TASK     *Task;
+  EFI_TPL     OldTpl;
+
+  if (Name == NULL || Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Task = AllocateZeroPool (sizeof (AP_TASK));
+  if (Task == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Task->Signature         = AP_TASK_SIGNATURE;
+  Task->Procedure         = Procedure;
+  Task->ProcedureArgument = ProcedureArgument;
+  Task->CompletionEvent   = CompletionEvent;
+  Task->Name              = AllocateCopyPool (AsciiStrSize (Name), Name);
+  if (Task->Name == NULL) {
+    FreePool (Task);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (mNumberOfProcessors > 1) {
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    ApTaskOnApDone,
+                    Task,
+                    &Task->WaitEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      FreePool (Task->Name);
+      FreePool (Task);
+      return Status;
+    }
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (mApTaskOutstanding == 0 && IsListEmpty (&mApTaskDoneList)) {
+    mApTaskTimeBase = GetPerformanceCounter ();
+  }
+  mApTaskOutstanding++;
+  InsertTailList (&mApTaskQueue, &Task->Link);
+  ApTaskDispatch ();
+
+  gBS->RestoreTPL (OldTpl);
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait until every submitted task has completed and its completion event has
+  been signaled.
+
+  This function must be called on the BSP below TPL_CALLBACK.
+
+  @param This              The pointer to this protocol instance.
+
+  @return The number of tasks that were still queued or running on entry.
+
+**/
+UINTN
+EFIAPI
+ApTaskWaitAll (
+  IN EDKII_AP_TASK_PROTOCOL  *This
+  )
+{
+  UINTN  Outstanding;
+
+  Outstanding = mApTaskOutstanding;
+  if (Outstanding == 0) {
+    return 0;
+  }
+
+  if (EfiGetCurrentTpl () >= TPL_CALLBACK) {
+    //
+    // Completion notifications cannot run, waiting here would hang.
+    //
+    DEBUG ((DEBUG_ERROR, "ApTaskWaitAll: called at TPL %d, not waiting\n", EfiGetCurrentTpl ()));
+    ASSERT (FALSE);
+    return Outstanding;
+  }
+
+  while (mApTaskOutstanding != 0) {
+    CpuPause ();
+  }
+
+  return Outstanding;
+}
+
+/**
+  Convert a performance counter value taken after mApTaskTimeBase to
+  microseconds since mApTaskTimeBase.
+
+  @param[in] Ticks  The performance counter value.
+
+  @return The elapsed time in microseconds.
+
+**/
+UINT64
+ApTaskTicksToMicroseconds (
+  IN UINT64  Ticks
+  )
+{
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (EndValue >= StartValue) {
+    Ticks = Ticks - mApTaskTimeBase;
+  } else {
+    Ticks = mApTaskTimeBase - Ticks;
+  }
+
+  return DivU64x32 (GetTimeInNanoSecond (Ticks), 1000);
+}
+
+/**
+  Report the timeline of the tasks that ran before ReadyToBoot, per CPU, and
+  release them.
+
+  @param[in] Event    The ReadyToBoot event.
+  @param[in] Context  Not used.
+
+**/
+VOID
+EFIAPI
+ApTaskOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  LIST_ENTRY  *Link;
+  AP_TASK     *Task;
+  UINT64      *BusyTime;
+  UINTN       Index;
+
+  if (IsListEmpty (&mApTaskDoneList)) {
+    return;
+  }
+
+  BusyTime = AllocateZeroPool (mNumberOfProcessors * sizeof (UINT64));
+
+  DEBUG ((DEBUG_INFO, "AP task timeline (us since the first task was submitted):\n"));
+  DEBUG ((DEBUG_INFO, "  CPU      Start        End   Task\n"));
+  while (!IsListEmpty (&mApTaskDoneList)) {
+    Link = GetFirstNode (&mApTaskDoneList);
+    Task = CR (Link, AP_TASK, Link, AP_TASK_SIGNATURE);
+    DEBUG ((
+      DEBUG_INFO,
+      "  %3d %10ld %10ld   %a\n",
+      (UINT32) Task->ProcessorNumber,
+      ApTaskTicksToMicroseconds (Task->StartTicks),
+      ApTaskTicksToMicroseconds (Task->EndTicks),
+      Task->Name
+      ));
+    if (BusyTime != NULL) {
+      BusyTime[Task->ProcessorNumber] += ApTaskTicksToMicroseconds (Task->EndTicks) -
+                                         ApTaskTicksToMicroseconds (Task->StartTicks);
+    }
+
+    RemoveEntryList (Link);
+    FreePool (Task->Name);
+    FreePool (Task);
+  }
+
+  if (BusyTime != NULL) {
+    for (Index = 0; Index < mNumberOfProcessors; Index++) {
+      if (BusyTime[Index] != 0) {
+        DEBUG ((DEBUG_INFO, "  CPU %3d busy for %ld us\n", (UINT32) Index, BusyTime[Index]));
+      }
+    }
+    FreePool (BusyTime);
+  }
+}
+
+/**
+  Install the EDKII AP Task Protocol. Must be called after MpInitLib has been
+  initialized.
+
+**/
+VOID
+InitializeApTaskSupport (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  Handle;
+  EFI_EVENT   Event;
+
+  mApTaskCpuBusy = AllocateZeroPool (mNumberOfProcessors * sizeof (BOOLEAN));
+  if (mApTaskCpuBusy == NULL) {
+    return;
+  }
+
+  Status = EfiCreateEventReadyToBootEx (
+             TPL_CALLBACK,
+             ApTaskOnReadyToBoot,
+             NULL,
+             &Event
+             );
+  ASSERT_EFI_ERROR (Status);
+
+  Handle = NULL;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &Handle,
+                  &gEdkiiApTaskProtocolGuid, &mApTaskProtocol,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+}
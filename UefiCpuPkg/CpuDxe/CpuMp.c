@@ -635,5 +635,7 @@ InitializeMpSupport (
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
+
+  InitializeApTaskSupport ();
 }
 
@@ -24,6 +24,16 @@ InitializeMpSupport (
   VOID
   );
 
+/**
+  Install the EDKII AP Task Protocol. Must be called after MpInitLib has been
+  initialized.
+
+**/
+VOID
+InitializeApTaskSupport (
+  VOID
+  );
+
 /**
   This service retrieves the number of logical processor in the platform
   and the number of those logical processors that are enabled on this boot.
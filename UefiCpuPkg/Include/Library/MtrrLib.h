@@ -129,6 +129,15 @@ typedef enum {
 #define  MTRR_CACHE_WRITE_BACK       6
 #define  MTRR_CACHE_INVALID_TYPE     7
 
+//
+// Structure to describe the memory type of a memory range
+//
+typedef struct {
+  UINT64                  BaseAddress;
+  UINT64                  Length;
+  MTRR_MEMORY_CACHE_TYPE  Type;
+} MTRR_MEMORY_RANGE;
+
 /**
   Returns the variable MTRR count for the CPU.
 
@@ -383,4 +392,63 @@ MtrrSetMemoryAttributeInMtrrSettings (
   IN MTRR_MEMORY_CACHE_TYPE  Attribute
   );
 
+/**
+  This function attempts to set the attributes for multiple memory ranges.
+
+  The variable MTRRs are recomputed for the whole memory map, so the minimal
+  number of variable MTRRs is used, and all the modified MTRRs are written
+  with the cache disabled only once.
+
+  @param[in]  Ranges             The memory ranges to set, in order of
+                                 precedence: a later range overrides an
+                                 earlier one.
+  @param[in]  RangeCount         The number of memory ranges.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory
+                                    ranges.
+  @retval RETURN_INVALID_PARAMETER  Ranges is NULL or a Length is zero.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or
+                                    more bytes of a memory range, or the
+                                    memory type is not supported for a memory
+                                    range.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough variable MTRRs to
+                                    describe the memory map.
+
+**/
+RETURN_STATUS
+EFIAPI
+MtrrSetMemoryAttributes (
+  IN CONST MTRR_MEMORY_RANGE  *Ranges,
+  IN UINTN                    RangeCount
+  );
+
+/**
+  This function attempts to set the attributes into MTRR setting buffer for
+  multiple memory ranges.
+
+  @param[in, out]  MtrrSetting  MTRR setting buffer to be set.
+  @param[in]       Ranges       The memory ranges to set, in order of
+                                precedence: a later range overrides an
+                                earlier one.
+  @param[in]       RangeCount   The number of memory ranges.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory
+                                    ranges.
+  @retval RETURN_INVALID_PARAMETER  Ranges is NULL or a Length is zero.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or
+                                    more bytes of a memory range, or the
+                                    memory type is not supported for a memory
+                                    range.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough variable MTRRs to
+                                    describe the memory map.
+
+**/
+RETURN_STATUS
+EFIAPI
+MtrrSetMemoryAttributesInMtrrSettings (
+  IN OUT MTRR_SETTINGS            *MtrrSetting,
+  IN     CONST MTRR_MEMORY_RANGE  *Ranges,
+  IN     UINTN                    RangeCount
+  );
+
 #endif // _MTRR_LIB_H_
@@ -322,7 +322,9 @@ IsMwaitSupport (
 /**
   Get AP loop mode.
 
-  @param[out] MonitorFilterSize  Returns the largest monitor-line size in bytes.
+  @param[out] MonitorFilterSize  Returns the size in bytes of the start-up
+                                 signal of each AP: the largest monitor-line
+                                 size, and at least one cache line.
 
   @return The AP loop mode.
 **/
@@ -333,6 +335,8 @@ GetApLoopMode (
 {
   UINT8                         ApLoopMode;
   CPUID_MONITOR_MWAIT_EBX       MonitorMwaitEbx;
+  CPUID_VERSION_INFO_EBX        VersionInfoEbx;
+  UINT32                        CacheLineSize;
 
   ASSERT (MonitorFilterSize != NULL);
 
@@ -359,6 +363,19 @@ GetApLoopMode (
     *MonitorFilterSize = MonitorMwaitEbx.Bits.LargestMonitorLineSize;
   }
 
+  //
+  // Give each AP its own cache line, so that waking up one AP does not pull
+  // the signals of its neighbors out of their caches in the Run-loop mode.
+  //
+  AsmCpuid (CPUID_VERSION_INFO, NULL, &VersionInfoEbx.Uint32, NULL, NULL);
+  CacheLineSize = VersionInfoEbx.Bits.CacheLineSize * 8;
+  if (CacheLineSize == 0) {
+    CacheLineSize = 64;
+  }
+  if (*MonitorFilterSize < CacheLineSize) {
+    *MonitorFilterSize = CacheLineSize;
+  }
+
   return ApLoopMode;
 }
 
@@ -484,10 +501,15 @@ GetProcessorNumber (
 {
   UINTN                   TotalProcessorNumber;
   UINTN                   Index;
+  UINT32                  ApicId;
 
+  //
+  // Read the APIC ID once: in x2APIC mode every read is an MSR access.
+  //
+  ApicId = GetApicId ();
   TotalProcessorNumber = CpuMpData->CpuCount;
   for (Index = 0; Index < TotalProcessorNumber; Index ++) {
-    if (CpuMpData->CpuData[Index].ApicId == GetApicId ()) {
+    if (CpuMpData->CpuData[Index].ApicId == ApicId) {
       *ProcessorNumber = Index;
       return EFI_SUCCESS;
     }
@@ -507,6 +529,9 @@ CollectProcessorCount (
   IN CPU_MP_DATA         *CpuMpData
   )
 {
+  UINT64                 StartTime;
+
+  StartTime = GetPerformanceCounter ();
   //
   // Send 1st broadcast IPI to APs to wakeup APs
   //
@@ -545,7 +570,12 @@ CollectProcessorCount (
   //
   SortApicId (CpuMpData);
 
-  DEBUG ((DEBUG_INFO, "MpInitLib: Find %d processors in system.\n", CpuMpData->CpuCount));
+  DEBUG ((
+    DEBUG_INFO,
+    "MpInitLib: Find %d processors in system in %ld us.\n",
+    CpuMpData->CpuCount,
+    DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter () - StartTime), 1000)
+    ));
 
   return CpuMpData->CpuCount;
 }
@@ -749,14 +779,11 @@ WaitApWakeup (
   )
 {
   //
-  // If AP is waken up, StartupApSignal should be cleared.
-  // Otherwise, write StartupApSignal again till AP waken up.
+  // If AP is waken up, StartupApSignal should be cleared. Only read it while
+  // waiting: a locked access would take the cache line away from the AP that
+  // is trying to clear it.
   //
-  while (InterlockedCompareExchange32 (
-          (UINT32 *) ApStartupSignalBuffer,
-          WAKEUP_AP_SIGNAL,
-          WAKEUP_AP_SIGNAL
-          ) != 0) {
+  while (*ApStartupSignalBuffer != 0) {
     CpuPause ();
   }
 }
@@ -861,12 +888,21 @@ WakeUpAP (
     }
     if (CpuMpData->InitFlag == ApInitConfig) {
       //
-      // Wait for all potential APs waken up in one specified period
+      // Wait for all potential APs waken up in one specified period, or
+      // until the maximum number of processors has checked in.
       //
-      MicroSecondDelay (PcdGet32(PcdCpuApInitTimeOutInMicroSeconds));
-    } else {
+      TimedWaitForApFinish (
+        CpuMpData,
+        PcdGet32 (PcdCpuMaxLogicalProcessorNumber) - 1,
+        PcdGet32 (PcdCpuApInitTimeOutInMicroSeconds)
+        );
+    } else if (ResetVectorRequired) {
       //
-      // Wait all APs waken up if this is not the 1st broadcast of SIPI
+      // Wait all APs waken up if this is not the 1st broadcast of SIPI, so
+      // that the reset vector can be freed. APs in MWAIT-loop or Run-loop
+      // clear their own signal before running the procedure, and the callers
+      // track their completion, so the broadcast does not wait for them one
+      // by one.
       //
       for (Index = 0; Index < CpuMpData->CpuCount; Index++) {
         CpuData = &CpuMpData->CpuData[Index];
@@ -1008,6 +1044,54 @@ CheckTimeout (
   return FALSE;
 }
 
+/**
+  Wait until FinishedApLimit APs have finished the current wakeup, or until
+  the time limit expires.
+
+  @param[in] CpuMpData        Pointer to CPU MP Data.
+  @param[in] FinishedApLimit  The number of finished APs to wait for.
+  @param[in] TimeLimit        The time limit in microseconds. 0 returns at
+                              once.
+**/
+VOID
+TimedWaitForApFinish (
+  IN CPU_MP_DATA               *CpuMpData,
+  IN UINT32                    FinishedApLimit,
+  IN UINT32                    TimeLimit
+  )
+{
+  //
+  // CalculateTimeout() and CheckTimeout() consider a TimeLimit of 0
+  // "infinity", so check for (TimeLimit == 0) explicitly.
+  //
+  if (TimeLimit == 0) {
+    return;
+  }
+
+  CpuMpData->TotalTime    = 0;
+  CpuMpData->ExpectedTime = CalculateTimeout (
+                              TimeLimit,
+                              &CpuMpData->CurrentTime
+                              );
+  while (CpuMpData->FinishedCount < FinishedApLimit &&
+         !CheckTimeout (
+            &CpuMpData->CurrentTime,
+            &CpuMpData->TotalTime,
+            CpuMpData->ExpectedTime
+            )) {
+    CpuPause ();
+  }
+
+  if (CpuMpData->FinishedCount >= FinishedApLimit) {
+    DEBUG ((
+      DEBUG_VERBOSE,
+      "MpInitLib: All %d APs checked in before the %d us timeout.\n",
+      FinishedApLimit,
+      TimeLimit
+      ));
+  }
+}
+
 /**
   Reset an AP to Idle state.
 
@@ -1142,6 +1226,17 @@ CheckAllAPs (
 
   NextProcessorNumber = 0;
 
+  //
+  // Every AP increases FinishedCount after it finished the procedure. While
+  // fewer APs than started have finished and the timeout has not expired,
+  // skip the scan of all the APs.
+  //
+  if (!CpuMpData->SingleThread &&
+      CpuMpData->FinishedCount < CpuMpData->StartCount &&
+      !CheckTimeout (&CpuMpData->CurrentTime, &CpuMpData->TotalTime, CpuMpData->ExpectedTime)) {
+    return EFI_NOT_READY;
+  }
+
   //
   // Go through all APs that are responsible for the StartupAllAPs().
   //
@@ -337,6 +337,22 @@ WakeUpAP (
   IN VOID                      *ProcedureArgument      OPTIONAL
   );
 
+/**
+  Wait until FinishedApLimit APs have finished the current wakeup, or until
+  the time limit expires.
+
+  @param[in] CpuMpData        Pointer to CPU MP Data.
+  @param[in] FinishedApLimit  The number of finished APs to wait for.
+  @param[in] TimeLimit        The time limit in microseconds. 0 returns at
+                              once.
+**/
+VOID
+TimedWaitForApFinish (
+  IN CPU_MP_DATA               *CpuMpData,
+  IN UINT32                    FinishedApLimit,
+  IN UINT32                    TimeLimit
+  );
+
 /**
   Initialize global data for MP support.
 
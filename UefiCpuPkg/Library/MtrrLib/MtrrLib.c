@@ -5,7 +5,7 @@
     Most of services in this library instance are suggested to be invoked by BSP only,
     except for MtrrSetAllMtrrs() which is used to sync BSP's MTRR setting to APs.
 
-  Copyright (c) 2008 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2008 - 2017, Intel Corporation. All rights reserved.<BR>
   This program and the accompanying materials
   are licensed and made available under the terms and conditions of the BSD License
   which accompanies this distribution.  The full text of the license may be found at
@@ -27,6 +27,17 @@
 #define OR_SEED      0x0101010101010101ull
 #define CLEAR_SEED   0xFFFFFFFFFFFFFFFFull
 
+//
+// A memory map that the variable MTRRs can describe has at most 2 ranges per
+// variable MTRR, plus the ranges split at 1MB.
+//
+#define MTRR_LIB_MAX_MEMORY_RANGES  (2 * MTRR_NUMBER_OF_VARIABLE_MTRR + 8)
+
+//
+// Cost of a memory map block that the variable MTRRs cannot describe
+//
+#define MTRR_LIB_INFINITE_COST      MAX_UINT8
+
 //
 // Context to save and restore when MTRRs are programmed
 //
@@ -96,6 +107,17 @@ CONST FIXED_MTRR  mMtrrLibFixedMtrrTable[] = {
   }
 };
 
+//
+// The memory types a variable MTRR can be programmed with
+//
+CONST UINT64  mMtrrLibMemoryTypes[] = {
+  MTRR_CACHE_UNCACHEABLE,
+  MTRR_CACHE_WRITE_COMBINING,
+  MTRR_CACHE_WRITE_THROUGH,
+  MTRR_CACHE_WRITE_PROTECTED,
+  MTRR_CACHE_WRITE_BACK
+};
+
 //
 // Lookup table used to print MTRRs
 //
@@ -640,324 +662,6 @@ MtrrGetMemoryAttributeInVariableMtrr (
 }
 
 
-/**
-  Checks overlap between given memory range and MTRRs.
-
-  @param[in]  FirmwareVariableMtrrCount  The number of variable MTRRs available
-                                         to firmware.
-  @param[in]  Start                      The start address of memory range.
-  @param[in]  End                        The end address of memory range.
-  @param[in]  VariableMtrr               The array to shadow variable MTRRs content
-
-  @retval TRUE             Overlap exists.
-  @retval FALSE            No overlap.
-
-**/
-BOOLEAN
-CheckMemoryAttributeOverlap (
-  IN UINTN             FirmwareVariableMtrrCount,
-  IN PHYSICAL_ADDRESS  Start,
-  IN PHYSICAL_ADDRESS  End,
-  IN VARIABLE_MTRR     *VariableMtrr
-  )
-{
-  UINT32  Index;
-
-  for (Index = 0; Index < FirmwareVariableMtrrCount; Index++) {
-    if (
-         VariableMtrr[Index].Valid &&
-         !(
-           (Start > (VariableMtrr[Index].BaseAddress +
-                     VariableMtrr[Index].Length - 1)
-           ) ||
-           (End < VariableMtrr[Index].BaseAddress)
-         )
-       ) {
-      return TRUE;
-    }
-  }
-
-  return FALSE;
-}
-
-
-/**
-  Marks a variable MTRR as non-valid.
-
-  @param[in]   Index         The index of the array VariableMtrr to be invalidated
-  @param[in]   VariableMtrr  The array to shadow variable MTRRs content
-  @param[out]  UsedMtrr      The number of MTRRs which has already been used
-
-**/
-VOID
-InvalidateShadowMtrr (
-  IN   UINTN              Index,
-  IN   VARIABLE_MTRR      *VariableMtrr,
-  OUT  UINT32             *UsedMtrr
-  )
-{
-  VariableMtrr[Index].Valid = FALSE;
-  *UsedMtrr = *UsedMtrr - 1;
-}
-
-
-/**
-  Combines memory attributes.
-
-  If overlap exists between given memory range and MTRRs, try to combine them.
-
-  @param[in]       FirmwareVariableMtrrCount  The number of variable MTRRs
-                                              available to firmware.
-  @param[in]       Attributes                 The memory type to set.
-  @param[in, out]  Base                       The base address of memory range.
-  @param[in, out]  Length                     The length of memory range.
-  @param[in]       VariableMtrr               The array to shadow variable MTRRs content
-  @param[in, out]  UsedMtrr                   The number of MTRRs which has already been used
-  @param[out]      OverwriteExistingMtrr      Returns whether an existing MTRR was used
-
-  @retval EFI_SUCCESS            Memory region successfully combined.
-  @retval EFI_ACCESS_DENIED      Memory region cannot be combined.
-
-**/
-RETURN_STATUS
-CombineMemoryAttribute (
-  IN     UINT32             FirmwareVariableMtrrCount,
-  IN     UINT64             Attributes,
-  IN OUT UINT64             *Base,
-  IN OUT UINT64             *Length,
-  IN     VARIABLE_MTRR      *VariableMtrr,
-  IN OUT UINT32             *UsedMtrr,
-  OUT    BOOLEAN            *OverwriteExistingMtrr
-  )
-{
-  UINT32  Index;
-  UINT64  CombineStart;
-  UINT64  CombineEnd;
-  UINT64  MtrrEnd;
-  UINT64  EndAddress;
-  BOOLEAN CoveredByExistingMtrr;
-
-  *OverwriteExistingMtrr = FALSE;
-  CoveredByExistingMtrr = FALSE;
-  EndAddress = *Base +*Length - 1;
-
-  for (Index = 0; Index < FirmwareVariableMtrrCount; Index++) {
-
-    MtrrEnd = VariableMtrr[Index].BaseAddress + VariableMtrr[Index].Length - 1;
-    if (
-         !VariableMtrr[Index].Valid ||
-         (
-           *Base > (MtrrEnd) ||
-           (EndAddress < VariableMtrr[Index].BaseAddress)
-         )
-       ) {
-      continue;
-    }
-
-    //
-    // Combine same attribute MTRR range
-    //
-    if (Attributes == VariableMtrr[Index].Type) {
-      //
-      // if the MTRR range contain the request range, set a flag, then continue to
-      // invalidate any MTRR of the same request range with higher priority cache type.
-      //
-      if (VariableMtrr[Index].BaseAddress <= *Base && MtrrEnd >= EndAddress) {
-        CoveredByExistingMtrr = TRUE;
-        continue;
-      }
-      //
-      // invalid this MTRR, and program the combine range
-      //
-      CombineStart  =
-        (*Base) < VariableMtrr[Index].BaseAddress ?
-          (*Base) :
-          VariableMtrr[Index].BaseAddress;
-      CombineEnd    = EndAddress > MtrrEnd ? EndAddress : MtrrEnd;
-
-      //
-      // Record the MTRR usage status in VariableMtrr array.
-      //
-      InvalidateShadowMtrr (Index, VariableMtrr, UsedMtrr);
-      *Base       = CombineStart;
-      *Length     = CombineEnd - CombineStart + 1;
-      EndAddress  = CombineEnd;
-      *OverwriteExistingMtrr = TRUE;
-      continue;
-    } else {
-      //
-      // The cache type is different, but the range is convered by one MTRR
-      //
-      if (VariableMtrr[Index].BaseAddress == *Base && MtrrEnd == EndAddress) {
-        InvalidateShadowMtrr (Index, VariableMtrr, UsedMtrr);
-        continue;
-      }
-
-    }
-
-    if ((Attributes== MTRR_CACHE_WRITE_THROUGH &&
-         VariableMtrr[Index].Type == MTRR_CACHE_WRITE_BACK) ||
-        (Attributes == MTRR_CACHE_WRITE_BACK &&
-         VariableMtrr[Index].Type == MTRR_CACHE_WRITE_THROUGH) ||
-        (Attributes == MTRR_CACHE_UNCACHEABLE) ||
-        (VariableMtrr[Index].Type == MTRR_CACHE_UNCACHEABLE)
-     ) {
-      *OverwriteExistingMtrr = TRUE;
-      continue;
-    }
-    //
-    // Other type memory overlap is invalid
-    //
-    return RETURN_ACCESS_DENIED;
-  }
-
-  if (CoveredByExistingMtrr) {
-    *Length = 0;
-  }
-
-  return RETURN_SUCCESS;
-}
-
-
-/**
-  Calculates the maximum value which is a power of 2, but less the MemoryLength.
-
-  @param[in]  MemoryLength        The number to pass in.
-
-  @return The maximum value which is align to power of 2 and less the MemoryLength
-
-**/
-UINT64
-Power2MaxMemory (
-  IN UINT64                     MemoryLength
-  )
-{
-  UINT64  Result;
-
-  if (RShiftU64 (MemoryLength, 32) != 0) {
-    Result = LShiftU64 (
-               (UINT64) GetPowerOfTwo32 (
-                          (UINT32) RShiftU64 (MemoryLength, 32)
-                          ),
-               32
-               );
-  } else {
-    Result = (UINT64) GetPowerOfTwo32 ((UINT32) MemoryLength);
-  }
-
-  return Result;
-}
-
-
-/**
-  Determines the MTRR numbers used to program a memory range.
-
-  This function first checks the alignment of the base address.
-  If the alignment of the base address <= Length, cover the memory range
- (BaseAddress, alignment) by a MTRR, then BaseAddress += alignment and
-  Length -= alignment. Repeat the step until alignment > Length.
-
-  Then this function determines which direction of programming the variable
-  MTRRs for the remaining length will use fewer MTRRs.
-
-  @param[in]  BaseAddress Length of Memory to program MTRR
-  @param[in]  Length      Length of Memory to program MTRR
-  @param[in]  MtrrNumber  Pointer to the number of necessary MTRRs
-
-  @retval TRUE        Positive direction is better.
-          FALSE       Negative direction is better.
-
-**/
-BOOLEAN
-GetMtrrNumberAndDirection (
-  IN UINT64      BaseAddress,
-  IN UINT64      Length,
-  IN UINTN       *MtrrNumber
-  )
-{
-  UINT64  TempQword;
-  UINT64  Alignment;
-  UINT32  Positive;
-  UINT32  Subtractive;
-
-  *MtrrNumber = 0;
-
-  if (BaseAddress != 0) {
-    do {
-      //
-      // Calculate the alignment of the base address.
-      //
-      Alignment = LShiftU64 (1, (UINTN)LowBitSet64 (BaseAddress));
-
-      if (Alignment > Length) {
-        break;
-      }
-
-      (*MtrrNumber)++;
-      BaseAddress += Alignment;
-      Length -= Alignment;
-    } while (TRUE);
-
-    if (Length == 0) {
-      return TRUE;
-    }
-  }
-
-  TempQword   = Length;
-  Positive    = 0;
-  Subtractive = 0;
-
-  do {
-    TempQword -= Power2MaxMemory (TempQword);
-    Positive++;
-  } while (TempQword != 0);
-
-  TempQword = Power2MaxMemory (LShiftU64 (Length, 1)) - Length;
-  Subtractive++;
-  do {
-    TempQword -= Power2MaxMemory (TempQword);
-    Subtractive++;
-  } while (TempQword != 0);
-
-  if (Positive <= Subtractive) {
-    *MtrrNumber += Positive;
-    return TRUE;
-  } else {
-    *MtrrNumber += Subtractive;
-    return FALSE;
-  }
-}
-
-/**
-  Invalid variable MTRRs according to the value in the shadow array.
-
-  This function programs MTRRs according to the values specified
-  in the shadow array.
-
-  @param[in, out]  VariableSettings   Variable MTRR settings
-  @param[in]       VariableMtrrCount  Number of variable MTRRs
-  @param[in, out]  VariableMtrr       Shadow of variable MTRR contents
-
-**/
-VOID
-InvalidateMtrr (
-  IN OUT MTRR_VARIABLE_SETTINGS  *VariableSettings,
-  IN     UINTN                   VariableMtrrCount,
-  IN OUT VARIABLE_MTRR           *VariableMtrr
-  )
-{
-  UINTN         Index;
-
-  for (Index = 0; Index < VariableMtrrCount; Index++) {
-    if (!VariableMtrr[Index].Valid && VariableMtrr[Index].Used) {
-       VariableSettings->Mtrr[Index].Base = 0;
-       VariableSettings->Mtrr[Index].Mask = 0;
-       VariableMtrr[Index].Used = FALSE;
-    }
-  }
-}
-
-
 /**
   Programs variable MTRRs
 
@@ -1449,359 +1153,588 @@ MtrrDebugPrintAllMtrrs (
 
 
 /**
-  Worker function attempts to set the attributes for a memory range.
+  Applies a memory type to a range of the memory map.
 
-  If MtrrSettings is not NULL, set the attributes into the input MTRR
-  settings buffer.
-  If MtrrSettings is NULL, set the attributes into MTRRs registers.
+  The memory map is an array of ranges sorted by base address that covers
+  the whole physical address space. Adjacent ranges of the same type are
+  merged.
 
-  @param[in, out]  MtrrSetting       A buffer holding all MTRRs content.
-  @param[in]       BaseAddress       The physical address that is the start
-                                     address of a memory region.
-  @param[in]       Length            The size in bytes of the memory region.
-  @param[in]       Attribute         The bit mask of attributes to set for the
-                                     memory region.
+  @param[in, out]  Map          The memory map.
+  @param[in, out]  MapCount     The number of ranges in the memory map.
+  @param[in]       BaseAddress  The base address of the range to apply.
+  @param[in]       Length       The length of the range to apply.
+  @param[in]       Type         The memory type to apply.
+  @param[in]       Combine      TRUE to combine Type with the type of the
+                                covered ranges using the MTRR precedence
+                                rules, FALSE to replace it.
 
-  @retval RETURN_SUCCESS            The attributes were set for the memory
-                                    region.
-  @retval RETURN_INVALID_PARAMETER  Length is zero.
-  @retval RETURN_UNSUPPORTED        The processor does not support one or
-                                    more bytes of the memory resource range
-                                    specified by BaseAddress and Length.
-  @retval RETURN_UNSUPPORTED        The bit mask of attributes is not support
-                                    for the memory resource range specified
-                                    by BaseAddress and Length.
-  @retval RETURN_ACCESS_DENIED      The attributes for the memory resource
-                                    range specified by BaseAddress and Length
-                                    cannot be modified.
-  @retval RETURN_OUT_OF_RESOURCES   There are not enough system resources to
-                                    modify the attributes of the memory
-                                    resource range.
+  @retval RETURN_SUCCESS            The range is applied.
+  @retval RETURN_OUT_OF_RESOURCES   The memory map is full.
 
 **/
 RETURN_STATUS
-MtrrSetMemoryAttributeWorker (
-  IN OUT MTRR_SETTINGS           *MtrrSetting,
-  IN PHYSICAL_ADDRESS            BaseAddress,
-  IN UINT64                      Length,
-  IN MTRR_MEMORY_CACHE_TYPE      Attribute
+MtrrLibApplyMemoryRange (
+  IN OUT MTRR_MEMORY_RANGE       *Map,
+  IN OUT UINTN                   *MapCount,
+  IN     UINT64                  BaseAddress,
+  IN     UINT64                  Length,
+  IN     UINT64                  Type,
+  IN     BOOLEAN                 Combine
   )
 {
-  UINT64                    TempQword;
-  RETURN_STATUS             Status;
-  UINT64                    MemoryType;
-  UINT64                    Alignment;
-  BOOLEAN                   OverLap;
-  BOOLEAN                   Positive;
-  UINT32                    MsrNum;
-  UINTN                     MtrrNumber;
-  VARIABLE_MTRR             VariableMtrr[MTRR_NUMBER_OF_VARIABLE_MTRR];
-  UINT32                    UsedMtrr;
-  UINT64                    MtrrValidBitsMask;
-  UINT64                    MtrrValidAddressMask;
-  BOOLEAN                   OverwriteExistingMtrr;
-  UINT32                    FirmwareVariableMtrrCount;
-  MTRR_CONTEXT              MtrrContext;
-  BOOLEAN                   MtrrContextValid;
-  BOOLEAN                   FixedSettingsValid[MTRR_NUMBER_OF_FIXED_MTRR];
-  BOOLEAN                   FixedSettingsModified[MTRR_NUMBER_OF_FIXED_MTRR];
-  MTRR_FIXED_SETTINGS       WorkingFixedSettings;
-  UINT32                    VariableMtrrCount;
-  MTRR_VARIABLE_SETTINGS    OriginalVariableSettings;
-  BOOLEAN                   ProgramVariableSettings;
-  MTRR_VARIABLE_SETTINGS    WorkingVariableSettings;
-  UINT32                    Index;
-  UINT64                    ClearMask;
-  UINT64                    OrMask;
-  UINT64                    NewValue;
-  MTRR_VARIABLE_SETTINGS    *VariableSettings;
+  UINTN   Index;
+  UINTN   Count;
+  UINT64  Limit;
+  UINT64  RangeLimit;
 
-  MtrrContextValid  = FALSE;
-  VariableMtrrCount = 0;
-  ZeroMem (&WorkingFixedSettings, sizeof (WorkingFixedSettings));
-  for (Index = 0; Index < MTRR_NUMBER_OF_FIXED_MTRR; Index++) {
-    FixedSettingsValid[Index]    = FALSE;
-    FixedSettingsModified[Index] = FALSE;
+  Limit = BaseAddress + Length;
+
+  //
+  // Split the ranges across the base and the limit of the new range.
+  //
+  for (Index = 0; Index < *MapCount; Index++) {
+    RangeLimit = Map[Index].BaseAddress + Map[Index].Length;
+    if ((BaseAddress > Map[Index].BaseAddress && BaseAddress < RangeLimit) ||
+        (Limit > Map[Index].BaseAddress && Limit < RangeLimit)) {
+      if (*MapCount == MTRR_LIB_MAX_MEMORY_RANGES) {
+        return RETURN_OUT_OF_RESOURCES;
+      }
+      CopyMem (&Map[Index + 1], &Map[Index], (*MapCount - Index) * sizeof (Map[0]));
+      (*MapCount)++;
+      if (BaseAddress > Map[Index].BaseAddress && BaseAddress < RangeLimit) {
+        Map[Index].Length = BaseAddress - Map[Index].BaseAddress;
+      } else {
+        Map[Index].Length = Limit - Map[Index].BaseAddress;
+      }
+      Map[Index + 1].BaseAddress = Map[Index].BaseAddress + Map[Index].Length;
+      Map[Index + 1].Length      = RangeLimit - Map[Index + 1].BaseAddress;
+    }
   }
-  ProgramVariableSettings = FALSE;
 
-  if (!IsMtrrSupported ()) {
-    Status = RETURN_UNSUPPORTED;
-    goto Done;
+  for (Index = 0; Index < *MapCount; Index++) {
+    if (Map[Index].BaseAddress >= BaseAddress && Map[Index].BaseAddress < Limit) {
+      if (Combine) {
+        Map[Index].Type = (MTRR_MEMORY_CACHE_TYPE) MtrrPrecedence (Map[Index].Type, Type);
+      } else {
+        Map[Index].Type = (MTRR_MEMORY_CACHE_TYPE) Type;
+      }
+    }
   }
 
-  MtrrLibInitializeMtrrMask (&MtrrValidBitsMask, &MtrrValidAddressMask);
+  //
+  // Merge the adjacent ranges of the same type.
+  //
+  for (Index = 1, Count = 1; Index < *MapCount; Index++) {
+    if (Map[Index].Type == Map[Count - 1].Type) {
+      Map[Count - 1].Length += Map[Index].Length;
+    } else {
+      CopyMem (&Map[Count], &Map[Index], sizeof (Map[0]));
+      Count++;
+    }
+  }
+  *MapCount = Count;
 
-  TempQword = 0;
-  MemoryType = (UINT64)Attribute;
-  OverwriteExistingMtrr = FALSE;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Computes the minimal number of variable MTRRs needed inside an aligned
+  block of the memory map.
+
+  Variable MTRRs cover naturally aligned power of 2 blocks, so any two of
+  them are either nested or disjoint. The blocks form a binary tree, and the
+  minimal MTRR set is found by dynamic programming over that tree: a block
+  is either left without an MTRR of its own, or covered by one MTRR whose
+  type is combined with the MTRRs covering the enclosing blocks. The UC over
+  anything and WT over WB precedence rules let a large MTRR be carved by
+  smaller ones.
+
+  The ranges of type MTRR_CACHE_INVALID_TYPE in the memory map may get any
+  memory type.
+
+  @param[in]  Map          The memory map.
+  @param[in]  MapCount     The number of ranges in the memory map.
+  @param[in]  MapIndex     The index of a range starting at or below
+                           BaseAddress.
+  @param[in]  BaseAddress  The base address of the block.
+  @param[in]  Length       The length of the block, a power of 2 that
+                           aligns BaseAddress.
+  @param[in]  DefaultType  The default memory type.
+  @param[out] Cost         Cost[State] returns the minimal number of MTRRs
+                           needed inside the block when the MTRRs covering
+                           the enclosing blocks combine to the memory type
+                           State, or MTRR_CACHE_INVALID_TYPE when no MTRR
+                           covers them. MTRR_LIB_INFINITE_COST means the
+                           block cannot be described.
+
+**/
+VOID
+MtrrLibSolveBlock (
+  IN  CONST MTRR_MEMORY_RANGE  *Map,
+  IN  UINTN                    MapCount,
+  IN  UINTN                    MapIndex,
+  IN  UINT64                   BaseAddress,
+  IN  UINT64                   Length,
+  IN  UINT64                   DefaultType,
+  OUT UINT8                    *Cost
+  )
+{
+  UINT64  Type;
+  UINT64  State;
+  UINT64  Combined;
+  UINTN   Index;
+  UINTN   TypeIndex;
+  UINT8   LeftCost[MTRR_CACHE_INVALID_TYPE + 1];
+  UINT8   RightCost[MTRR_CACHE_INVALID_TYPE + 1];
+  UINTN   Total;
+
+  while (Map[MapIndex].BaseAddress + Map[MapIndex].Length <= BaseAddress) {
+    MapIndex++;
+  }
 
   //
-  // Check for an invalid parameter
+  // Check whether the block has a single memory type.
   //
-  if (Length == 0) {
-    Status = RETURN_INVALID_PARAMETER;
-    goto Done;
+  Type = MTRR_CACHE_INVALID_TYPE;
+  for (Index = MapIndex; Index < MapCount && Map[Index].BaseAddress < BaseAddress + Length; Index++) {
+    if (Map[Index].Type == MTRR_CACHE_INVALID_TYPE || Map[Index].Type == Type) {
+      continue;
+    }
+    if (Type != MTRR_CACHE_INVALID_TYPE) {
+      break;
+    }
+    Type = Map[Index].Type;
   }
 
-  if (
-       (BaseAddress & ~MtrrValidAddressMask) != 0 ||
-       (Length & ~MtrrValidAddressMask) != 0
-     ) {
-    Status = RETURN_UNSUPPORTED;
-    goto Done;
+  if (Index == MapCount || Map[Index].BaseAddress >= BaseAddress + Length) {
+    for (State = 0; State <= MTRR_CACHE_INVALID_TYPE; State++) {
+      if (Type == MTRR_CACHE_INVALID_TYPE ||
+          Type == ((State == MTRR_CACHE_INVALID_TYPE) ? DefaultType : State)) {
+        Cost[State] = 0;
+      } else if (MtrrPrecedence (State, Type) == Type) {
+        Cost[State] = 1;
+      } else {
+        Cost[State] = MTRR_LIB_INFINITE_COST;
+      }
+    }
+    return;
   }
 
   //
-  // Check if Fixed MTRR
+  // The memory map is 4KB aligned, so a 4KB block has a single memory type.
   //
-  Status = RETURN_SUCCESS;
-  if (BaseAddress < BASE_1MB) {
-    MsrNum = (UINT32)-1;
-    while ((BaseAddress < BASE_1MB) && (Length > 0) && Status == RETURN_SUCCESS) {
-      Status = ProgramFixedMtrr (MemoryType, &BaseAddress, &Length, &MsrNum, &ClearMask, &OrMask);
-      if (RETURN_ERROR (Status)) {
-        goto Done;
+  ASSERT (Length > SIZE_4KB);
+  Length = RShiftU64 (Length, 1);
+  MtrrLibSolveBlock (Map, MapCount, MapIndex, BaseAddress, Length, DefaultType, LeftCost);
+  MtrrLibSolveBlock (Map, MapCount, MapIndex, BaseAddress + Length, Length, DefaultType, RightCost);
+
+  for (State = 0; State <= MTRR_CACHE_INVALID_TYPE; State++) {
+    Total       = LeftCost[State] + RightCost[State];
+    Cost[State] = (UINT8) MIN (Total, MTRR_LIB_INFINITE_COST);
+    for (TypeIndex = 0; TypeIndex < sizeof (mMtrrLibMemoryTypes) / sizeof (mMtrrLibMemoryTypes[0]); TypeIndex++) {
+      Combined = MtrrPrecedence (State, mMtrrLibMemoryTypes[TypeIndex]);
+      if (Combined == MTRR_CACHE_INVALID_TYPE || Combined == State) {
+        continue;
       }
-      if (MtrrSetting != NULL) {
-        MtrrSetting->Fixed.Mtrr[MsrNum] = (MtrrSetting->Fixed.Mtrr[MsrNum] & ~ClearMask) | OrMask;
-        MtrrSetting->MtrrDefType |= MTRR_LIB_CACHE_FIXED_MTRR_ENABLED;
-      } else {
-        if (!FixedSettingsValid[MsrNum]) {
-          WorkingFixedSettings.Mtrr[MsrNum] = AsmReadMsr64 (mMtrrLibFixedMtrrTable[MsrNum].Msr);
-          FixedSettingsValid[MsrNum] = TRUE;
-        }
-        NewValue = (WorkingFixedSettings.Mtrr[MsrNum] & ~ClearMask) | OrMask;
-        if (WorkingFixedSettings.Mtrr[MsrNum] != NewValue) {
-          WorkingFixedSettings.Mtrr[MsrNum] = NewValue;
-          FixedSettingsModified[MsrNum] = TRUE;
-        }
+      Total = 1 + LeftCost[Combined] + RightCost[Combined];
+      if (Total < Cost[State]) {
+        Cost[State] = (UINT8) Total;
       }
     }
+  }
+}
 
-    if (Length == 0) {
-      //
-      // A Length of 0 can only make sense for fixed MTTR ranges.
-      // Since we just handled the fixed MTRRs, we can skip the
-      // variable MTRR section.
-      //
-      goto Done;
+/**
+  Collects the variable MTRRs of the minimal MTRR set computed by
+  MtrrLibSolveBlock() for an aligned block of the memory map.
+
+  @param[in]      Map          The memory map.
+  @param[in]      MapCount     The number of ranges in the memory map.
+  @param[in]      MapIndex     The index of a range starting at or below
+                               BaseAddress.
+  @param[in]      BaseAddress  The base address of the block.
+  @param[in]      Length       The length of the block.
+  @param[in]      DefaultType  The default memory type.
+  @param[in]      State        The memory type the MTRRs covering the
+                               enclosing blocks combine to, or
+                               MTRR_CACHE_INVALID_TYPE.
+  @param[in]      Cost         The costs of the block returned by
+                               MtrrLibSolveBlock().
+  @param[out]     Mtrrs        The array receiving the variable MTRRs.
+  @param[in, out] MtrrCount    The number of variable MTRRs in Mtrrs.
+
+**/
+VOID
+MtrrLibCollectBlockMtrrs (
+  IN     CONST MTRR_MEMORY_RANGE  *Map,
+  IN     UINTN                    MapCount,
+  IN     UINTN                    MapIndex,
+  IN     UINT64                   BaseAddress,
+  IN     UINT64                   Length,
+  IN     UINT64                   DefaultType,
+  IN     UINT64                   State,
+  IN     CONST UINT8              *Cost,
+  OUT    MTRR_MEMORY_RANGE        *Mtrrs,
+  IN OUT UINTN                    *MtrrCount
+  )
+{
+  UINT8   LeftCost[MTRR_CACHE_INVALID_TYPE + 1];
+  UINT8   RightCost[MTRR_CACHE_INVALID_TYPE + 1];
+  UINTN   TypeIndex;
+  UINT64  Combined;
+  UINT64  HalfLength;
+
+  if (Cost[State] == 0) {
+    return;
+  }
+  ASSERT (Cost[State] != MTRR_LIB_INFINITE_COST);
+
+  while (Map[MapIndex].BaseAddress + Map[MapIndex].Length <= BaseAddress) {
+    MapIndex++;
+  }
+
+  HalfLength = RShiftU64 (Length, 1);
+  if (HalfLength >= SIZE_4KB) {
+    MtrrLibSolveBlock (Map, MapCount, MapIndex, BaseAddress, HalfLength, DefaultType, LeftCost);
+    MtrrLibSolveBlock (Map, MapCount, MapIndex, BaseAddress + HalfLength, HalfLength, DefaultType, RightCost);
+    if ((UINTN) LeftCost[State] + RightCost[State] == Cost[State]) {
+      Combined = State;
+      goto Split;
     }
   }
 
   //
-  // Since memory ranges below 1MB will be overridden by the fixed MTRRs,
-  // we can set the base to 0 to save variable MTRRs.
+  // The block needs an MTRR of its own. Use the first type that reaches
+  // the minimal cost, in the order MtrrLibSolveBlock() tried them.
   //
-  if (BaseAddress == BASE_1MB) {
-    BaseAddress = 0;
-    Length += SIZE_1MB;
+  for (TypeIndex = 0; TypeIndex < sizeof (mMtrrLibMemoryTypes) / sizeof (mMtrrLibMemoryTypes[0]); TypeIndex++) {
+    Combined = MtrrPrecedence (State, mMtrrLibMemoryTypes[TypeIndex]);
+    if (Combined == MTRR_CACHE_INVALID_TYPE || Combined == State) {
+      continue;
+    }
+    if (HalfLength < SIZE_4KB) {
+      if (Cost[Combined] == 0) {
+        break;
+      }
+    } else if (1 + (UINTN) LeftCost[Combined] + RightCost[Combined] == Cost[State]) {
+      break;
+    }
+  }
+  ASSERT (TypeIndex < sizeof (mMtrrLibMemoryTypes) / sizeof (mMtrrLibMemoryTypes[0]));
+  ASSERT (*MtrrCount < MTRR_NUMBER_OF_VARIABLE_MTRR);
+  Mtrrs[*MtrrCount].BaseAddress = BaseAddress;
+  Mtrrs[*MtrrCount].Length      = Length;
+  Mtrrs[*MtrrCount].Type        = (MTRR_MEMORY_CACHE_TYPE) mMtrrLibMemoryTypes[TypeIndex];
+  (*MtrrCount)++;
+
+  if (HalfLength < SIZE_4KB) {
+    return;
   }
 
-  //
-  // Read all variable MTRRs
-  //
-  VariableMtrrCount = GetVariableMtrrCountWorker ();
-  FirmwareVariableMtrrCount = GetFirmwareVariableMtrrCountWorker ();
-  if (MtrrSetting != NULL) {
-    VariableSettings = &MtrrSetting->Variables;
-  } else {
-    MtrrGetVariableMtrrWorker (NULL, VariableMtrrCount, &OriginalVariableSettings);
-    CopyMem (&WorkingVariableSettings, &OriginalVariableSettings, sizeof (WorkingVariableSettings));
-    ProgramVariableSettings = TRUE;
-    VariableSettings = &WorkingVariableSettings;
+Split:
+  MtrrLibCollectBlockMtrrs (Map, MapCount, MapIndex, BaseAddress, HalfLength, DefaultType, Combined, LeftCost, Mtrrs, MtrrCount);
+  MtrrLibCollectBlockMtrrs (Map, MapCount, MapIndex, BaseAddress + HalfLength, HalfLength, DefaultType, Combined, RightCost, Mtrrs, MtrrCount);
+}
+
+/**
+  Worker function attempts to set the attributes for multiple memory ranges.
+
+  The variable MTRRs are recomputed for the whole memory map, so the minimal
+  number of variable MTRRs is used whatever the order of the requests.
+
+  If MtrrSetting is not NULL, set the attributes into the input MTRR
+  settings buffer.
+  If MtrrSetting is NULL, set the attributes into MTRRs registers. All the
+  modified MTRRs are written with the cache disabled only once.
+
+  @param[in, out]  MtrrSetting       A buffer holding all MTRRs content.
+  @param[in]       Ranges            The memory ranges to set, in order of
+                                     precedence: a later range overrides an
+                                     earlier one.
+  @param[in]       RangeCount        The number of memory ranges.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory
+                                    ranges.
+  @retval RETURN_INVALID_PARAMETER  Ranges is NULL or a Length is zero.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or
+                                    more bytes of a memory range, or the
+                                    memory type is not supported for a memory
+                                    range.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough variable MTRRs to
+                                    describe the memory map.
+
+**/
+RETURN_STATUS
+MtrrSetMemoryAttributesWorker (
+  IN OUT MTRR_SETTINGS            *MtrrSetting,
+  IN     CONST MTRR_MEMORY_RANGE  *Ranges,
+  IN     UINTN                    RangeCount
+  )
+{
+  RETURN_STATUS             Status;
+  UINTN                     Index;
+  UINTN                     MtrrIndex;
+  UINT64                    BaseAddress;
+  UINT64                    Length;
+  UINT64                    MemoryType;
+  UINT64                    MtrrValidBitsMask;
+  UINT64                    MtrrValidAddressMask;
+  UINT64                    MtrrDefType;
+  UINT64                    DefaultType;
+  UINT32                    MsrNum;
+  UINT64                    ClearMask;
+  UINT64                    OrMask;
+  BOOLEAN                   FixedProgrammed;
+  UINT32                    VariableMtrrCount;
+  UINT32                    FirmwareVariableMtrrCount;
+  VARIABLE_MTRR             VariableMtrr[MTRR_NUMBER_OF_VARIABLE_MTRR];
+  BOOLEAN                   VariableMtrrKept[MTRR_NUMBER_OF_VARIABLE_MTRR];
+  MTRR_FIXED_SETTINGS       OriginalFixedSettings;
+  MTRR_FIXED_SETTINGS       WorkingFixedSettings;
+  MTRR_VARIABLE_SETTINGS    OriginalVariableSettings;
+  MTRR_VARIABLE_SETTINGS    WorkingVariableSettings;
+  MTRR_MEMORY_RANGE         Map[MTRR_LIB_MAX_MEMORY_RANGES];
+  UINTN                     MapCount;
+  UINT8                     Cost[MTRR_CACHE_INVALID_TYPE + 1];
+  MTRR_MEMORY_RANGE         Mtrrs[MTRR_NUMBER_OF_VARIABLE_MTRR];
+  UINTN                     MtrrCount;
+  MTRR_CONTEXT              MtrrContext;
+  BOOLEAN                   MtrrContextValid;
+
+  if (!IsMtrrSupported ()) {
+    Status = RETURN_UNSUPPORTED;
+    goto Done;
+  }
+
+  if (Ranges == NULL) {
+    Status = RETURN_INVALID_PARAMETER;
+    goto Done;
   }
 
+  MtrrLibInitializeMtrrMask (&MtrrValidBitsMask, &MtrrValidAddressMask);
+
   //
-  // Check for overlap
-  //
-  UsedMtrr = MtrrGetMemoryAttributeInVariableMtrrWorker (
-               VariableSettings,
-               FirmwareVariableMtrrCount,
-               MtrrValidBitsMask,
-               MtrrValidAddressMask,
-               VariableMtrr
-               );
-  OverLap = CheckMemoryAttributeOverlap (
-              FirmwareVariableMtrrCount,
-              BaseAddress,
-              BaseAddress + Length - 1,
-              VariableMtrr
-              );
-  if (OverLap) {
-    Status = CombineMemoryAttribute (
-               FirmwareVariableMtrrCount,
-               MemoryType,
-               &BaseAddress,
-               &Length,
-               VariableMtrr,
-               &UsedMtrr,
-               &OverwriteExistingMtrr
-               );
-    if (RETURN_ERROR (Status)) {
+  // Check all the ranges before anything is modified.
+  //
+  for (Index = 0; Index < RangeCount; Index++) {
+    BaseAddress = Ranges[Index].BaseAddress;
+    Length      = Ranges[Index].Length;
+    MemoryType  = (UINT64) Ranges[Index].Type;
+    if (Length == 0) {
+      Status = RETURN_INVALID_PARAMETER;
       goto Done;
     }
-
-    if (Length == 0) {
-      //
-      // Combined successfully, invalidate the now-unused MTRRs
-      //
-      InvalidateMtrr (VariableSettings, VariableMtrrCount, VariableMtrr);
-      Status = RETURN_SUCCESS;
+    if ((BaseAddress & ~MtrrValidAddressMask) != 0 ||
+        (Length & ~MtrrValidAddressMask) != 0 ||
+        Length > MtrrValidBitsMask + 1 - BaseAddress) {
+      Status = RETURN_UNSUPPORTED;
+      goto Done;
+    }
+    if (MemoryType != MTRR_CACHE_UNCACHEABLE &&
+        MemoryType != MTRR_CACHE_WRITE_COMBINING &&
+        MemoryType != MTRR_CACHE_WRITE_THROUGH &&
+        MemoryType != MTRR_CACHE_WRITE_PROTECTED &&
+        MemoryType != MTRR_CACHE_WRITE_BACK) {
+      Status = RETURN_UNSUPPORTED;
       goto Done;
     }
   }
 
   //
-  // The memory type is the same with the type specified by
-  // MTRR_LIB_IA32_MTRR_DEF_TYPE.
+  // Read all MTRRs
   //
-  if ((!OverwriteExistingMtrr) && (Attribute == MtrrGetDefaultMemoryTypeWorker (MtrrSetting))) {
-    //
-    // Invalidate the now-unused MTRRs
-    //
-    InvalidateMtrr (VariableSettings, VariableMtrrCount, VariableMtrr);
-    goto Done;
-  }
-
-  Positive = GetMtrrNumberAndDirection (BaseAddress, Length, &MtrrNumber);
-
-  if ((UsedMtrr + MtrrNumber) > FirmwareVariableMtrrCount) {
-    Status = RETURN_OUT_OF_RESOURCES;
-    goto Done;
+  VariableMtrrCount         = GetVariableMtrrCountWorker ();
+  FirmwareVariableMtrrCount = GetFirmwareVariableMtrrCountWorker ();
+  if (MtrrSetting != NULL) {
+    MtrrDefType = MtrrSetting->MtrrDefType;
+    CopyMem (&OriginalFixedSettings, &MtrrSetting->Fixed, sizeof (OriginalFixedSettings));
+  } else {
+    MtrrDefType = AsmReadMsr64 (MTRR_LIB_IA32_MTRR_DEF_TYPE);
+    MtrrGetFixedMtrrWorker (&OriginalFixedSettings);
   }
+  MtrrGetVariableMtrrWorker (MtrrSetting, VariableMtrrCount, &OriginalVariableSettings);
+  CopyMem (&WorkingFixedSettings, &OriginalFixedSettings, sizeof (WorkingFixedSettings));
+  CopyMem (&WorkingVariableSettings, &OriginalVariableSettings, sizeof (WorkingVariableSettings));
+  DefaultType = MtrrDefType & 0x7;
 
   //
-  // Invalidate the now-unused MTRRs
+  // Program the fixed MTRRs for the parts of the ranges below 1MB.
   //
-  InvalidateMtrr (VariableSettings, VariableMtrrCount, VariableMtrr);
+  FixedProgrammed = FALSE;
+  for (Index = 0; Index < RangeCount; Index++) {
+    BaseAddress = Ranges[Index].BaseAddress;
+    Length      = Ranges[Index].Length;
+    MsrNum      = (UINT32)-1;
+    while ((BaseAddress < BASE_1MB) && (Length > 0)) {
+      Status = ProgramFixedMtrr (Ranges[Index].Type, &BaseAddress, &Length, &MsrNum, &ClearMask, &OrMask);
+      if (RETURN_ERROR (Status)) {
+        goto Done;
+      }
+      WorkingFixedSettings.Mtrr[MsrNum] = (WorkingFixedSettings.Mtrr[MsrNum] & ~ClearMask) | OrMask;
+      FixedProgrammed = TRUE;
+    }
+  }
 
   //
-  // Find first unused MTRR
+  // Build the memory map described by the firmware variable MTRRs. The
+  // ranges that no MTRR covers get the default memory type.
   //
-  for (MsrNum = 0; MsrNum < VariableMtrrCount; MsrNum++) {
-    if ((VariableSettings->Mtrr[MsrNum].Mask & MTRR_LIB_CACHE_MTRR_ENABLED) == 0) {
-      break;
+  Map[0].BaseAddress = 0;
+  Map[0].Length      = MtrrValidBitsMask + 1;
+  Map[0].Type        = (MTRR_MEMORY_CACHE_TYPE) MTRR_CACHE_INVALID_TYPE;
+  MapCount           = 1;
+  MtrrGetMemoryAttributeInVariableMtrrWorker (
+    &WorkingVariableSettings,
+    FirmwareVariableMtrrCount,
+    MtrrValidBitsMask,
+    MtrrValidAddressMask,
+    VariableMtrr
+    );
+  for (Index = 0; Index < FirmwareVariableMtrrCount; Index++) {
+    if (VariableMtrr[Index].Valid) {
+      Status = MtrrLibApplyMemoryRange (
+                 Map,
+                 &MapCount,
+                 VariableMtrr[Index].BaseAddress,
+                 VariableMtrr[Index].Length,
+                 VariableMtrr[Index].Type,
+                 TRUE
+                 );
+      if (RETURN_ERROR (Status)) {
+        goto Done;
+      }
     }
   }
-
-  if (BaseAddress != 0) {
-    do {
+  for (Index = 0; Index < MapCount;) {
+    if (Map[Index].Type == MTRR_CACHE_INVALID_TYPE) {
       //
-      // Calculate the alignment of the base address.
+      // The range may be merged with its neighbours, so check Index again.
       //
-      Alignment = LShiftU64 (1, (UINTN)LowBitSet64 (BaseAddress));
-
-      if (Alignment > Length) {
-        break;
+      Status = MtrrLibApplyMemoryRange (Map, &MapCount, Map[Index].BaseAddress, Map[Index].Length, DefaultType, FALSE);
+      if (RETURN_ERROR (Status)) {
+        goto Done;
       }
+      continue;
+    }
+    Index++;
+  }
 
-      //
-      // Find unused MTRR
-      //
-      for (; MsrNum < VariableMtrrCount; MsrNum++) {
-        if ((VariableSettings->Mtrr[MsrNum].Mask & MTRR_LIB_CACHE_MTRR_ENABLED) == 0) {
-          break;
-        }
+  //
+  // Apply the parts of the ranges above 1MB. Since memory ranges below 1MB
+  // are overridden by the fixed MTRRs, they may get any memory type, which
+  // saves variable MTRRs.
+  //
+  for (Index = 0; Index < RangeCount; Index++) {
+    BaseAddress = MAX (Ranges[Index].BaseAddress, BASE_1MB);
+    if (Ranges[Index].BaseAddress + Ranges[Index].Length > BaseAddress) {
+      Status = MtrrLibApplyMemoryRange (
+                 Map,
+                 &MapCount,
+                 BaseAddress,
+                 Ranges[Index].BaseAddress + Ranges[Index].Length - BaseAddress,
+                 Ranges[Index].Type,
+                 FALSE
+                 );
+      if (RETURN_ERROR (Status)) {
+        goto Done;
       }
-
-      ProgramVariableMtrr (
-        VariableSettings,
-        MsrNum,
-        BaseAddress,
-        Alignment,
-        MemoryType,
-        MtrrValidAddressMask
-        );
-      BaseAddress += Alignment;
-      Length -= Alignment;
-    } while (TRUE);
-
-    if (Length == 0) {
+    }
+  }
+  if (FixedProgrammed || (MtrrDefType & MTRR_LIB_CACHE_FIXED_MTRR_ENABLED) != 0) {
+    Status = MtrrLibApplyMemoryRange (Map, &MapCount, 0, BASE_1MB, MTRR_CACHE_INVALID_TYPE, FALSE);
+    if (RETURN_ERROR (Status)) {
       goto Done;
     }
   }
 
-  TempQword = Length;
-
-  if (!Positive) {
-    Length = Power2MaxMemory (LShiftU64 (TempQword, 1));
+  //
+  // Compute the minimal variable MTRR set for the memory map.
+  //
+  MtrrLibSolveBlock (Map, MapCount, 0, 0, MtrrValidBitsMask + 1, DefaultType, Cost);
+  if (Cost[MTRR_CACHE_INVALID_TYPE] > FirmwareVariableMtrrCount) {
+    Status = RETURN_OUT_OF_RESOURCES;
+    goto Done;
+  }
+  MtrrCount = 0;
+  MtrrLibCollectBlockMtrrs (
+    Map,
+    MapCount,
+    0,
+    0,
+    MtrrValidBitsMask + 1,
+    DefaultType,
+    MTRR_CACHE_INVALID_TYPE,
+    Cost,
+    Mtrrs,
+    &MtrrCount
+    );
+  ASSERT (MtrrCount == Cost[MTRR_CACHE_INVALID_TYPE]);
 
-    //
-    // Find unused MTRR
-    //
-    for (; MsrNum < VariableMtrrCount; MsrNum++) {
-      if ((VariableSettings->Mtrr[MsrNum].Mask & MTRR_LIB_CACHE_MTRR_ENABLED) == 0) {
+  //
+  // Keep the variable MTRRs that are already programmed in place, so that
+  // only the MTRRs which change are written.
+  //
+  for (Index = 0; Index < FirmwareVariableMtrrCount; Index++) {
+    VariableMtrrKept[Index] = FALSE;
+    for (MtrrIndex = 0; MtrrIndex < MtrrCount; MtrrIndex++) {
+      if (VariableMtrr[Index].Valid &&
+          Mtrrs[MtrrIndex].Length != 0 &&
+          VariableMtrr[Index].BaseAddress == Mtrrs[MtrrIndex].BaseAddress &&
+          VariableMtrr[Index].Length == Mtrrs[MtrrIndex].Length &&
+          VariableMtrr[Index].Type == Mtrrs[MtrrIndex].Type) {
+        VariableMtrrKept[Index] = TRUE;
+        Mtrrs[MtrrIndex].Length = 0;
         break;
       }
     }
-
-    ProgramVariableMtrr (
-      VariableSettings,
-      MsrNum,
-      BaseAddress,
-      Length,
-      MemoryType,
-      MtrrValidAddressMask
-      );
-    BaseAddress += Length;
-    TempQword   = Length - TempQword;
-    MemoryType  = MTRR_CACHE_UNCACHEABLE;
+    if (!VariableMtrrKept[Index]) {
+      WorkingVariableSettings.Mtrr[Index].Base = 0;
+      WorkingVariableSettings.Mtrr[Index].Mask = 0;
+    }
   }
-
-  do {
-    //
-    // Find unused MTRR
-    //
-    for (; MsrNum < VariableMtrrCount; MsrNum++) {
-      if ((VariableSettings->Mtrr[MsrNum].Mask & MTRR_LIB_CACHE_MTRR_ENABLED) == 0) {
-        break;
-      }
+  for (Index = 0, MtrrIndex = 0; MtrrIndex < MtrrCount; MtrrIndex++) {
+    if (Mtrrs[MtrrIndex].Length == 0) {
+      continue;
     }
-
-    Length = Power2MaxMemory (TempQword);
-    if (!Positive) {
-      BaseAddress -= Length;
+    while (VariableMtrrKept[Index]) {
+      Index++;
     }
-
     ProgramVariableMtrr (
-      VariableSettings,
-      MsrNum,
-      BaseAddress,
-      Length,
-      MemoryType,
+      &WorkingVariableSettings,
+      Index,
+      Mtrrs[MtrrIndex].BaseAddress,
+      Mtrrs[MtrrIndex].Length,
+      Mtrrs[MtrrIndex].Type,
       MtrrValidAddressMask
       );
+    Index++;
+  }
 
-    if (Positive) {
-      BaseAddress += Length;
+  if (MtrrSetting != NULL) {
+    CopyMem (&MtrrSetting->Fixed, &WorkingFixedSettings, sizeof (WorkingFixedSettings));
+    CopyMem (&MtrrSetting->Variables, &WorkingVariableSettings, VariableMtrrCount * sizeof (MTRR_VARIABLE_SETTING));
+    if (FixedProgrammed) {
+      MtrrSetting->MtrrDefType |= MTRR_LIB_CACHE_FIXED_MTRR_ENABLED;
     }
-    TempQword -= Length;
-
-  } while (TempQword > 0);
-
-Done:
-
-  //
-  // Write fixed MTRRs that have been modified
-  //
-  for (Index = 0; Index < MTRR_NUMBER_OF_FIXED_MTRR; Index++) {
-    if (FixedSettingsModified[Index]) {
-      if (!MtrrContextValid) {
-        PreMtrrChange (&MtrrContext);
-        MtrrContextValid = TRUE;
+    MtrrSetting->MtrrDefType |= MTRR_LIB_CACHE_MTRR_ENABLED;
+  } else {
+    //
+    // Write the modified MTRRs in a single cache disabled window.
+    //
+    MtrrContextValid = FALSE;
+    for (Index = 0; Index < MTRR_NUMBER_OF_FIXED_MTRR; Index++) {
+      if (WorkingFixedSettings.Mtrr[Index] != OriginalFixedSettings.Mtrr[Index]) {
+        if (!MtrrContextValid) {
+          PreMtrrChange (&MtrrContext);
+          MtrrContextValid = TRUE;
+        }
+        AsmWriteMsr64 (
+          mMtrrLibFixedMtrrTable[Index].Msr,
+          WorkingFixedSettings.Mtrr[Index]
+          );
       }
-      AsmWriteMsr64 (
-        mMtrrLibFixedMtrrTable[Index].Msr,
-        WorkingFixedSettings.Mtrr[Index]
-        );
     }
-  }
 
-  //
-  // Write variable MTRRs
-  //
-  if (ProgramVariableSettings) {
     for (Index = 0; Index < VariableMtrrCount; Index++) {
       if (WorkingVariableSettings.Mtrr[Index].Base != OriginalVariableSettings.Mtrr[Index].Base ||
           WorkingVariableSettings.Mtrr[Index].Mask != OriginalVariableSettings.Mtrr[Index].Mask    ) {
@@ -1819,16 +1752,16 @@ Done:
           );
       }
     }
+    if (MtrrContextValid) {
+      PostMtrrChange (&MtrrContext);
+    }
   }
-  if (MtrrContextValid) {
-    PostMtrrChange (&MtrrContext);
-  }
 
+  Status = RETURN_SUCCESS;
+
+Done:
   DEBUG((DEBUG_CACHE, "  Status = %r\n", Status));
   if (!RETURN_ERROR (Status)) {
-    if (MtrrSetting != NULL) {
-      MtrrSetting->MtrrDefType |= MTRR_LIB_CACHE_MTRR_ENABLED;
-    }
     MtrrDebugPrintAllMtrrsWorker (MtrrSetting);
   }
 
@@ -1869,13 +1802,13 @@ MtrrSetMemoryAttribute (
   IN MTRR_MEMORY_CACHE_TYPE  Attribute
   )
 {
+  MTRR_MEMORY_RANGE  Range;
+
   DEBUG((DEBUG_CACHE, "MtrrSetMemoryAttribute() %a:%016lx-%016lx\n", mMtrrMemoryCacheTypeShortName[Attribute], BaseAddress, Length));
-  return MtrrSetMemoryAttributeWorker (
-           NULL,
-           BaseAddress,
-           Length,
-           Attribute
-           );
+  Range.BaseAddress = BaseAddress;
+  Range.Length      = Length;
+  Range.Type        = Attribute;
+  return MtrrSetMemoryAttributesWorker (NULL, &Range, 1);
 }
 
 /**
@@ -1909,13 +1842,79 @@ MtrrSetMemoryAttributeInMtrrSettings (
   IN MTRR_MEMORY_CACHE_TYPE  Attribute
   )
 {
+  MTRR_MEMORY_RANGE  Range;
+
   DEBUG((DEBUG_CACHE, "MtrrSetMemoryAttributeMtrrSettings(%p) %a:%016lx-%016lx\n", MtrrSetting, mMtrrMemoryCacheTypeShortName[Attribute], BaseAddress, Length));
-  return MtrrSetMemoryAttributeWorker (
-           MtrrSetting,
-           BaseAddress,
-           Length,
-           Attribute
-           );
+  Range.BaseAddress = BaseAddress;
+  Range.Length      = Length;
+  Range.Type        = Attribute;
+  return MtrrSetMemoryAttributesWorker (MtrrSetting, &Range, 1);
+}
+
+/**
+  This function attempts to set the attributes for multiple memory ranges.
+
+  The variable MTRRs are recomputed for the whole memory map, and all the
+  modified MTRRs are written with the cache disabled only once.
+
+  @param[in]  Ranges             The memory ranges to set, in order of
+                                 precedence: a later range overrides an
+                                 earlier one.
+  @param[in]  RangeCount         The number of memory ranges.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory
+                                    ranges.
+  @retval RETURN_INVALID_PARAMETER  Ranges is NULL or a Length is zero.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or
+                                    more bytes of a memory range, or the
+                                    memory type is not supported for a memory
+                                    range.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough variable MTRRs to
+                                    describe the memory map.
+
+**/
+RETURN_STATUS
+EFIAPI
+MtrrSetMemoryAttributes (
+  IN CONST MTRR_MEMORY_RANGE  *Ranges,
+  IN UINTN                    RangeCount
+  )
+{
+  DEBUG((DEBUG_CACHE, "MtrrSetMemoryAttributes() %d ranges\n", (UINT32) RangeCount));
+  return MtrrSetMemoryAttributesWorker (NULL, Ranges, RangeCount);
+}
+
+/**
+  This function attempts to set the attributes into MTRR setting buffer for
+  multiple memory ranges.
+
+  @param[in, out]  MtrrSetting  MTRR setting buffer to be set.
+  @param[in]       Ranges       The memory ranges to set, in order of
+                                precedence: a later range overrides an
+                                earlier one.
+  @param[in]       RangeCount   The number of memory ranges.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory
+                                    ranges.
+  @retval RETURN_INVALID_PARAMETER  Ranges is NULL or a Length is zero.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or
+                                    more bytes of a memory range, or the
+                                    memory type is not supported for a memory
+                                    range.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough variable MTRRs to
+                                    describe the memory map.
+
+**/
+RETURN_STATUS
+EFIAPI
+MtrrSetMemoryAttributesInMtrrSettings (
+  IN OUT MTRR_SETTINGS            *MtrrSetting,
+  IN     CONST MTRR_MEMORY_RANGE  *Ranges,
+  IN     UINTN                    RangeCount
+  )
+{
+  DEBUG((DEBUG_CACHE, "MtrrSetMemoryAttributesInMtrrSettings(%p) %d ranges\n", MtrrSetting, (UINT32) RangeCount));
+  return MtrrSetMemoryAttributesWorker (MtrrSetting, Ranges, RangeCount);
 }
 
 /**
@@ -0,0 +1,30 @@
+/** @file
+  Stand-in for the build tools generated AutoGen.h of MtrrLib, used when the
+  library is built with the host compiler for the unit test.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _MTRR_LIB_UNIT_TEST_AUTOGEN_H_
+#define _MTRR_LIB_UNIT_TEST_AUTOGEN_H_
+
+#include <Base.h>
+#include <Library/PcdLib.h>
+
+//
+// The PCD is a global of the test, so that each test case can reserve
+// variable MTRRs.
+//
+extern UINT32  mReservedVariableMtrrs;
+
+#define _PCD_GET_MODE_32_PcdCpuNumberOfReservedVariableMtrrs  mReservedVariableMtrrs
+
+#endif
@@ -0,0 +1,463 @@
+/** @file
+  Randomized host unit test of MtrrLib.
+
+  Every test case builds a random memory map, programs it with the single range
+  and the batch services, both into an MTRR_SETTINGS buffer and into the
+  emulated MSRs, and checks that:
+  - the MTRRs describe exactly the requested memory map, decoded by a
+    reference implementation of the MTRR precedence rules;
+  - the batch services succeed whenever the single range services do;
+  - programming the same memory map again writes no MSR;
+  - the reserved variable MTRRs are left untouched.
+
+  Usage: MtrrLibUnitTest [TestCaseCount [FirstSeed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "MtrrLibUnitTest.h"
+
+#define MAX_TEST_RANGES         24
+#define TYPE_UNDEFINED          0xFF
+#define ARRAY_SIZE(Array)       (sizeof (Array) / sizeof ((Array)[0]))
+
+typedef struct {
+  UINT32             PhysicalAddressBits;
+  UINT32             VariableMtrrCount;
+  UINT32             ReservedMtrrs;
+  UINT32             DefaultType;
+  UINTN              RangeCount;
+  MTRR_MEMORY_RANGE  Ranges[MAX_TEST_RANGES];
+} MTRR_TEST_CASE;
+
+UINT64  mRandomState;
+
+CONST MTRR_MEMORY_CACHE_TYPE  mCacheTypes[] = {
+  CacheUncacheable, CacheWriteCombining, CacheWriteThrough, CacheWriteProtected, CacheWriteBack
+};
+
+/**
+  Return the next value of a xorshift64* generator, so that a seed gives the
+  same test case on every host.
+**/
+UINT64
+Random64 (
+  VOID
+  )
+{
+  mRandomState ^= mRandomState >> 12;
+  mRandomState ^= mRandomState << 25;
+  mRandomState ^= mRandomState >> 27;
+  return mRandomState * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+  Return a random value in [0, Limit).
+**/
+UINT64
+RandomBelow (
+  IN UINT64  Limit
+  )
+{
+  return Random64 () % Limit;
+}
+
+/**
+  Build a random test case.
+**/
+VOID
+GenerateTestCase (
+  IN  UINT32          Seed,
+  OUT MTRR_TEST_CASE  *TestCase
+  )
+{
+  UINTN   Index;
+  UINT64  Top;
+  UINT64  Granularity;
+  UINT64  Base;
+  UINT64  Length;
+
+  mRandomState = 0x9E3779B97F4A7C15ULL * (Seed + 1);
+
+  TestCase->PhysicalAddressBits = (RandomBelow (3) == 0) ? 39 : 36;
+  TestCase->VariableMtrrCount   = (RandomBelow (2) == 0) ? 8 : 10;
+  TestCase->ReservedMtrrs       = (UINT32) RandomBelow (3);
+  TestCase->DefaultType         = (RandomBelow (2) == 0) ? CacheWriteBack : CacheUncacheable;
+  //
+  // Mostly small memory maps, which fit in the MTRRs, and some large ones,
+  // which exercise the out of resources paths.
+  //
+  TestCase->RangeCount          = 1 + (UINTN) RandomBelow ((RandomBelow (4) == 0) ? MAX_TEST_RANGES : 6);
+  Top = LShiftU64 (1, TestCase->PhysicalAddressBits);
+
+  for (Index = 0; Index < TestCase->RangeCount; Index++) {
+    switch (RandomBelow (6)) {
+    case 0:
+      //
+      // Below 1MB, aligned to the fixed MTRRs
+      //
+      Base   = RandomBelow (16) * SIZE_64KB;
+      Length = (1 + RandomBelow (4)) * SIZE_64KB;
+      break;
+
+    case 1:
+      //
+      // System memory starting at 0
+      //
+      Base   = 0;
+      Length = (1 + RandomBelow (4096)) * SIZE_1MB;
+      break;
+
+    default:
+      //
+      // Anywhere above 1MB, with a granularity of 4KB to 512MB
+      //
+      Granularity = LShiftU64 (1, 12 + (UINTN) RandomBelow (18));
+      Base        = RandomBelow (DivU64x32 (Top, (UINT32) SIZE_4KB)) * SIZE_4KB;
+      Base       &= ~(Granularity - 1);
+      Length      = (1 + RandomBelow (4)) * Granularity;
+      if (Base < SIZE_1MB) {
+        Base = SIZE_1MB;
+      }
+      break;
+    }
+    if (Base + Length > Top) {
+      Length = Top - Base;
+    }
+
+    TestCase->Ranges[Index].BaseAddress = Base;
+    TestCase->Ranges[Index].Length      = Length;
+    TestCase->Ranges[Index].Type        = mCacheTypes[RandomBelow (ARRAY_SIZE (mCacheTypes))];
+    if (RandomBelow (3) == 0) {
+      //
+      // More UC and WT holes, which need the MTRR precedence rules
+      //
+      TestCase->Ranges[Index].Type = (RandomBelow (2) == 0) ? CacheUncacheable : CacheWriteThrough;
+    }
+  }
+}
+
+/**
+  Return the memory type the test case requests for an address.
+**/
+UINT32
+GetExpectedType (
+  IN MTRR_TEST_CASE  *TestCase,
+  IN UINT64          Address
+  )
+{
+  UINTN   Index;
+  UINT32  Type;
+
+  Type = TestCase->DefaultType;
+  for (Index = 0; Index < TestCase->RangeCount; Index++) {
+    if (Address >= TestCase->Ranges[Index].BaseAddress &&
+        Address - TestCase->Ranges[Index].BaseAddress < TestCase->Ranges[Index].Length) {
+      Type = TestCase->Ranges[Index].Type;
+    }
+  }
+  return Type;
+}
+
+/**
+  Decode the memory type of an address from MTRR settings, following the
+  rules of the Intel SDM rather than reusing any MtrrLib code.
+**/
+UINT32
+GetProgrammedType (
+  IN MTRR_TEST_CASE  *TestCase,
+  IN MTRR_SETTINGS   *Mtrrs,
+  IN UINT64          Address
+  )
+{
+  UINTN   Index;
+  UINT64  FixedMtrr;
+  UINTN   ByteIndex;
+  UINT64  PhysicalMask;
+  UINT64  Mask;
+  UINT32  TypeSet;
+
+  if ((Mtrrs->MtrrDefType & BIT11) == 0) {
+    return CacheUncacheable;
+  }
+
+  if (Address < SIZE_1MB && (Mtrrs->MtrrDefType & BIT10) != 0) {
+    if (Address < 0x80000) {
+      FixedMtrr = Mtrrs->Fixed.Mtrr[0];
+      ByteIndex = (UINTN) (Address >> 16);
+    } else if (Address < 0xC0000) {
+      FixedMtrr = Mtrrs->Fixed.Mtrr[1 + ((Address - 0x80000) >> 17)];
+      ByteIndex = (UINTN) ((Address - 0x80000) >> 14) & 7;
+    } else {
+      FixedMtrr = Mtrrs->Fixed.Mtrr[3 + ((Address - 0xC0000) >> 15)];
+      ByteIndex = (UINTN) ((Address - 0xC0000) >> 12) & 7;
+    }
+    return (UINT32) (FixedMtrr >> (ByteIndex * 8)) & 0xFF;
+  }
+
+  PhysicalMask = (LShiftU64 (1, TestCase->PhysicalAddressBits) - 1) & ~(UINT64) (SIZE_4KB - 1);
+  TypeSet      = 0;
+  for (Index = 0; Index < TestCase->VariableMtrrCount; Index++) {
+    if ((Mtrrs->Variables.Mtrr[Index].Mask & BIT11) == 0) {
+      continue;
+    }
+    Mask = Mtrrs->Variables.Mtrr[Index].Mask & PhysicalMask;
+    if ((Address & Mask) == (Mtrrs->Variables.Mtrr[Index].Base & Mask)) {
+      TypeSet |= 1u << (Mtrrs->Variables.Mtrr[Index].Base & 0xFF);
+    }
+  }
+
+  if (TypeSet == 0) {
+    return (UINT32) (Mtrrs->MtrrDefType & 0xFF);
+  }
+  if ((TypeSet & (1u << CacheUncacheable)) != 0) {
+    return CacheUncacheable;
+  }
+  if (TypeSet == ((1u << CacheWriteThrough) | (1u << CacheWriteBack))) {
+    return CacheWriteThrough;
+  }
+  if ((TypeSet & (TypeSet - 1)) != 0) {
+    return TYPE_UNDEFINED;
+  }
+  return (UINT32) HighBitSet64 (TypeSet);
+}
+
+/**
+  Check the MTRR settings against the memory map of the test case, at the
+  edges of every range and at random addresses.
+
+  @retval TRUE   The MTRR settings describe the memory map.
+  @retval FALSE  An address has the wrong type.
+**/
+BOOLEAN
+VerifyMtrrs (
+  IN MTRR_TEST_CASE  *TestCase,
+  IN MTRR_SETTINGS   *Mtrrs
+  )
+{
+  UINTN   Index;
+  UINTN   EdgeIndex;
+  UINT64  Top;
+  UINT64  Edges[4];
+  UINT64  Address;
+
+  Top = LShiftU64 (1, TestCase->PhysicalAddressBits);
+  for (Index = 0; Index < TestCase->RangeCount; Index++) {
+    Edges[0] = TestCase->Ranges[Index].BaseAddress;
+    Edges[1] = TestCase->Ranges[Index].BaseAddress + TestCase->Ranges[Index].Length - SIZE_4KB;
+    Edges[2] = TestCase->Ranges[Index].BaseAddress + TestCase->Ranges[Index].Length;
+    Edges[3] = TestCase->Ranges[Index].BaseAddress - SIZE_4KB;
+    for (EdgeIndex = 0; EdgeIndex < ARRAY_SIZE (Edges); EdgeIndex++) {
+      Address = Edges[EdgeIndex];
+      if (Address >= Top) {
+        continue;
+      }
+      if (GetProgrammedType (TestCase, Mtrrs, Address) != GetExpectedType (TestCase, Address)) {
+        printf ("  0x%llx: type %u, expected %u\n",
+          (unsigned long long) Address,
+          GetProgrammedType (TestCase, Mtrrs, Address),
+          GetExpectedType (TestCase, Address)
+          );
+        return FALSE;
+      }
+    }
+  }
+
+  for (Index = 0; Index < 2000; Index++) {
+    Address = RandomBelow (DivU64x32 ((Index % 2 == 0) ? Top : SIZE_4GB, (UINT32) SIZE_4KB)) * SIZE_4KB;
+    if (GetProgrammedType (TestCase, Mtrrs, Address) != GetExpectedType (TestCase, Address)) {
+      printf ("  0x%llx: type %u, expected %u\n",
+        (unsigned long long) Address,
+        GetProgrammedType (TestCase, Mtrrs, Address),
+        GetExpectedType (TestCase, Address)
+        );
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Reset the emulated processor and an MTRR settings buffer to the default
+  memory type of the test case, with every variable MTRR free except the
+  reserved ones, which hold a marker.
+**/
+VOID
+ResetMtrrs (
+  IN  MTRR_TEST_CASE  *TestCase,
+  OUT MTRR_SETTINGS   *Mtrrs
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (mMsr, sizeof (mMsr));
+  ZeroMem (Mtrrs, sizeof (*Mtrrs));
+  mPhysicalAddressBits   = TestCase->PhysicalAddressBits;
+  mReservedVariableMtrrs = TestCase->ReservedMtrrs;
+
+  mMsr[UNIT_TEST_MSR_MTRRCAP]  = TestCase->VariableMtrrCount | BIT8 | BIT10;
+  mMsr[UNIT_TEST_MSR_DEF_TYPE] = BIT11 | BIT10 | TestCase->DefaultType;
+  Mtrrs->MtrrDefType           = mMsr[UNIT_TEST_MSR_DEF_TYPE];
+  for (Index = 0; Index < ARRAY_SIZE (Mtrrs->Fixed.Mtrr); Index++) {
+    Mtrrs->Fixed.Mtrr[Index] = MultU64x32 (0x0101010101010101ULL, TestCase->DefaultType);
+  }
+  MtrrSetFixedMtrr (&Mtrrs->Fixed);
+
+  //
+  // The reserved variable MTRRs are the last ones. MtrrLib must not use them.
+  //
+  for (Index = TestCase->VariableMtrrCount - TestCase->ReservedMtrrs; Index < TestCase->VariableMtrrCount; Index++) {
+    mMsr[0x200 + 2 * Index]     = 0x5A5A000 | CacheWriteProtected;
+    mMsr[0x200 + 2 * Index + 1] = 0;
+  }
+}
+
+/**
+  Check that the reserved variable MTRRs still hold their marker.
+**/
+BOOLEAN
+VerifyReservedMtrrs (
+  IN MTRR_TEST_CASE  *TestCase,
+  IN MTRR_SETTINGS   *Mtrrs
+  )
+{
+  UINTN  Index;
+
+  for (Index = TestCase->VariableMtrrCount - TestCase->ReservedMtrrs; Index < TestCase->VariableMtrrCount; Index++) {
+    if (Mtrrs->Variables.Mtrr[Index].Mask != 0) {
+      return FALSE;
+    }
+    if (mMsr[0x200 + 2 * Index] != (0x5A5A000 | CacheWriteProtected) || mMsr[0x200 + 2 * Index + 1] != 0) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/**
+  Run one test case.
+
+  @param[in]      Seed              The seed of the test case.
+  @param[in, out] OutOfResources    Incremented when the MTRRs cannot describe
+                                    the memory map.
+
+  @retval TRUE    The test case passed.
+  @retval FALSE   The test case failed.
+**/
+BOOLEAN
+RunTestCase (
+  IN     UINT32  Seed,
+  IN OUT UINTN   *OutOfResources
+  )
+{
+  MTRR_TEST_CASE  TestCase;
+  MTRR_SETTINGS   Mtrrs;
+  RETURN_STATUS   Status;
+  RETURN_STATUS   BatchStatus;
+  UINTN           Index;
+
+  GenerateTestCase (Seed, &TestCase);
+
+  //
+  // One range at a time, into a settings buffer
+  //
+  ResetMtrrs (&TestCase, &Mtrrs);
+  MtrrGetAllMtrrs (&Mtrrs);
+  Status = RETURN_SUCCESS;
+  for (Index = 0; Index < TestCase.RangeCount && !RETURN_ERROR (Status); Index++) {
+    Status = MtrrSetMemoryAttributeInMtrrSettings (
+               &Mtrrs,
+               TestCase.Ranges[Index].BaseAddress,
+               TestCase.Ranges[Index].Length,
+               TestCase.Ranges[Index].Type
+               );
+  }
+  if (!RETURN_ERROR (Status) && !VerifyMtrrs (&TestCase, &Mtrrs)) {
+    printf ("Seed %u: MtrrSetMemoryAttributeInMtrrSettings() programmed a wrong memory map\n", Seed);
+    return FALSE;
+  }
+
+  //
+  // All the ranges at once, into a settings buffer
+  //
+  ResetMtrrs (&TestCase, &Mtrrs);
+  MtrrGetAllMtrrs (&Mtrrs);
+  BatchStatus = MtrrSetMemoryAttributesInMtrrSettings (&Mtrrs, TestCase.Ranges, TestCase.RangeCount);
+  if (RETURN_ERROR (BatchStatus)) {
+    if (!RETURN_ERROR (Status)) {
+      printf ("Seed %u: MtrrSetMemoryAttributesInMtrrSettings() - %llx, single ranges succeeded\n", Seed, (unsigned long long) BatchStatus);
+      return FALSE;
+    }
+    if (BatchStatus != RETURN_OUT_OF_RESOURCES) {
+      printf ("Seed %u: MtrrSetMemoryAttributesInMtrrSettings() - %llx\n", Seed, (unsigned long long) BatchStatus);
+      return FALSE;
+    }
+    (*OutOfResources)++;
+    return TRUE;
+  }
+  if (!VerifyMtrrs (&TestCase, &Mtrrs) || !VerifyReservedMtrrs (&TestCase, &Mtrrs)) {
+    printf ("Seed %u: MtrrSetMemoryAttributesInMtrrSettings() programmed a wrong memory map\n", Seed);
+    return FALSE;
+  }
+
+  //
+  // All the ranges at once, into the MSRs, then again without any change
+  //
+  ResetMtrrs (&TestCase, &Mtrrs);
+  Status = MtrrSetMemoryAttributes (TestCase.Ranges, TestCase.RangeCount);
+  MtrrGetAllMtrrs (&Mtrrs);
+  if (RETURN_ERROR (Status) || !VerifyMtrrs (&TestCase, &Mtrrs) || !VerifyReservedMtrrs (&TestCase, &Mtrrs)) {
+    printf ("Seed %u: MtrrSetMemoryAttributes() - %llx, or programmed a wrong memory map\n", Seed, (unsigned long long) Status);
+    return FALSE;
+  }
+  mMsrWrites = 0;
+  Status = MtrrSetMemoryAttributes (TestCase.Ranges, TestCase.RangeCount);
+  if (RETURN_ERROR (Status) || mMsrWrites != 0) {
+    printf ("Seed %u: MtrrSetMemoryAttributes() - %llx, %u MSR writes to program the same map again\n",
+      Seed, (unsigned long long) Status, (unsigned) mMsrWrites);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINT32  TestCaseCount;
+  UINT32  FirstSeed;
+  UINT32  Seed;
+  UINTN   Failures;
+  UINTN   OutOfResources;
+
+  TestCaseCount = (argc > 1) ? (UINT32) strtoul (argv[1], NULL, 0) : 5000;
+  FirstSeed     = (argc > 2) ? (UINT32) strtoul (argv[2], NULL, 0) : 0;
+
+  Failures       = 0;
+  OutOfResources = 0;
+  for (Seed = FirstSeed; Seed < FirstSeed + TestCaseCount; Seed++) {
+    if (!RunTestCase (Seed, &OutOfResources)) {
+      Failures++;
+    }
+  }
+
+  printf (
+    "MtrrLib: %u test cases, %u failed, %u memory maps need more MTRRs than available\n",
+    TestCaseCount,
+    (unsigned) Failures,
+    (unsigned) OutOfResources
+    );
+  return (Failures == 0) ? 0 : 1;
+}
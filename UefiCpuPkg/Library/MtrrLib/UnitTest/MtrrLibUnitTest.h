@@ -0,0 +1,46 @@
+/** @file
+  Definitions shared by the MtrrLib host unit test and its support functions.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _MTRR_LIB_UNIT_TEST_H_
+#define _MTRR_LIB_UNIT_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// Base.h defines NULL as well.
+//
+#undef NULL
+
+#include "AutoGen.h"
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/CpuLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MtrrLib.h>
+
+//
+// The MSRs emulated for MtrrLib. All the MTRR MSRs are below 0x400.
+//
+#define UNIT_TEST_MSR_COUNT         0x400
+#define UNIT_TEST_MSR_MTRRCAP       0xFE
+#define UNIT_TEST_MSR_DEF_TYPE      0x2FF
+
+extern UINT64  mMsr[UNIT_TEST_MSR_COUNT];
+extern UINTN   mMsrWrites;
+extern UINT32  mPhysicalAddressBits;
+
+#endif
@@ -0,0 +1,373 @@
+/** @file
+  Host implementations of the processor and library services used by MtrrLib.
+
+  The MSRs are kept in an array, CPUID reports MTRR support and the physical
+  address size selected by the test, and the cache control services do
+  nothing.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "MtrrLibUnitTest.h"
+
+UINT64  mMsr[UNIT_TEST_MSR_COUNT];
+UINTN   mMsrWrites;
+UINT32  mPhysicalAddressBits = 36;
+UINT32  mReservedVariableMtrrs;
+
+UINT64
+EFIAPI
+AsmReadMsr64 (
+  IN UINT32  Index
+  )
+{
+  if (Index >= UNIT_TEST_MSR_COUNT) {
+    abort ();
+  }
+  return mMsr[Index];
+}
+
+UINT64
+EFIAPI
+AsmWriteMsr64 (
+  IN UINT32  Index,
+  IN UINT64  Value
+  )
+{
+  if (Index >= UNIT_TEST_MSR_COUNT) {
+    abort ();
+  }
+  mMsr[Index] = Value;
+  mMsrWrites++;
+  return Value;
+}
+
+UINT64
+EFIAPI
+AsmMsrBitFieldWrite64 (
+  IN UINT32  Index,
+  IN UINTN   StartBit,
+  IN UINTN   EndBit,
+  IN UINT64  Value
+  )
+{
+  return AsmWriteMsr64 (Index, BitFieldWrite64 (AsmReadMsr64 (Index), StartBit, EndBit, Value));
+}
+
+UINT32
+EFIAPI
+AsmCpuid (
+  IN  UINT32  Index,
+  OUT UINT32  *RegisterEax,  OPTIONAL
+  OUT UINT32  *RegisterEbx,  OPTIONAL
+  OUT UINT32  *RegisterEcx,  OPTIONAL
+  OUT UINT32  *RegisterEdx   OPTIONAL
+  )
+{
+  UINT32  Eax;
+  UINT32  Edx;
+
+  Eax = 0;
+  Edx = 0;
+  if (Index == 1) {
+    Edx = BIT12;
+  } else if (Index == 0x80000000) {
+    Eax = 0x80000008;
+  } else if (Index == 0x80000008) {
+    Eax = mPhysicalAddressBits;
+  }
+
+  if (RegisterEax != NULL) {
+    *RegisterEax = Eax;
+  }
+  if (RegisterEbx != NULL) {
+    *RegisterEbx = 0;
+  }
+  if (RegisterEcx != NULL) {
+    *RegisterEcx = 0;
+  }
+  if (RegisterEdx != NULL) {
+    *RegisterEdx = Edx;
+  }
+  return Index;
+}
+
+UINTN
+EFIAPI
+AsmReadCr4 (
+  VOID
+  )
+{
+  return 0;
+}
+
+UINTN
+EFIAPI
+AsmWriteCr4 (
+  IN UINTN  Cr4
+  )
+{
+  return Cr4;
+}
+
+VOID
+EFIAPI
+AsmDisableCache (
+  VOID
+  )
+{
+}
+
+VOID
+EFIAPI
+AsmEnableCache (
+  VOID
+  )
+{
+}
+
+VOID
+EFIAPI
+CpuFlushTlb (
+  VOID
+  )
+{
+}
+
+BOOLEAN
+EFIAPI
+SaveAndDisableInterrupts (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+SetInterruptState (
+  IN BOOLEAN  InterruptState
+  )
+{
+  return InterruptState;
+}
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN  CONST VOID *SourceBuffer,
+  IN  UINTN      Length
+  )
+{
+  return memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+SetMem (
+  OUT VOID  *Buffer,
+  IN  UINTN Length,
+  IN  UINT8 Value
+  )
+{
+  return memset (Buffer, Value, Length);
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN  UINTN Length
+  )
+{
+  return memset (Buffer, 0, Length);
+}
+
+UINT64
+EFIAPI
+LShiftU64 (
+  IN UINT64  Operand,
+  IN UINTN   Count
+  )
+{
+  return Operand << Count;
+}
+
+UINT64
+EFIAPI
+RShiftU64 (
+  IN UINT64  Operand,
+  IN UINTN   Count
+  )
+{
+  return Operand >> Count;
+}
+
+UINT64
+EFIAPI
+MultU64x32 (
+  IN UINT64  Multiplicand,
+  IN UINT32  Multiplier
+  )
+{
+  return Multiplicand * Multiplier;
+}
+
+UINT64
+EFIAPI
+DivU64x32 (
+  IN UINT64  Dividend,
+  IN UINT32  Divisor
+  )
+{
+  return Dividend / Divisor;
+}
+
+INTN
+EFIAPI
+LowBitSet64 (
+  IN UINT64  Operand
+  )
+{
+  return (Operand == 0) ? -1 : __builtin_ctzll (Operand);
+}
+
+INTN
+EFIAPI
+HighBitSet64 (
+  IN UINT64  Operand
+  )
+{
+  return (Operand == 0) ? -1 : 63 - __builtin_clzll (Operand);
+}
+
+UINT64
+EFIAPI
+GetPowerOfTwo64 (
+  IN UINT64  Operand
+  )
+{
+  return (Operand == 0) ? 0 : LShiftU64 (1, HighBitSet64 (Operand));
+}
+
+UINT32
+EFIAPI
+GetPowerOfTwo32 (
+  IN UINT32  Operand
+  )
+{
+  return (UINT32) GetPowerOfTwo64 (Operand);
+}
+
+UINT32
+EFIAPI
+BitFieldRead32 (
+  IN UINT32  Operand,
+  IN UINTN   StartBit,
+  IN UINTN   EndBit
+  )
+{
+  return (UINT32) BitFieldRead64 (Operand, StartBit, EndBit);
+}
+
+UINT64
+EFIAPI
+BitFieldRead64 (
+  IN UINT64  Operand,
+  IN UINTN   StartBit,
+  IN UINTN   EndBit
+  )
+{
+  return (Operand >> StartBit) & (((EndBit - StartBit == 63) ? 0 : LShiftU64 (2, EndBit - StartBit)) - 1);
+}
+
+UINT64
+EFIAPI
+BitFieldWrite64 (
+  IN UINT64  Operand,
+  IN UINTN   StartBit,
+  IN UINTN   EndBit,
+  IN UINT64  Value
+  )
+{
+  UINT64  Mask;
+
+  Mask = (((EndBit - StartBit == 63) ? 0 : LShiftU64 (2, EndBit - StartBit)) - 1) << StartBit;
+  return (Operand & ~Mask) | ((Value << StartBit) & Mask);
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintLevelEnabled (
+  IN  CONST UINTN  ErrorLevel
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+DebugAssertEnabled (
+  VOID
+  )
+{
+  return TRUE;
+}
+
+BOOLEAN
+EFIAPI
+DebugCodeEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+DebugClearMemoryEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  printf ("ASSERT %s(%u): %s\n", FileName, (unsigned) LineNumber, Description);
+  abort ();
+}
@@ -1,7 +1,7 @@
 /** @file
 SMM MP service implementation
 
-Copyright (c) 2009 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -24,6 +24,7 @@ UINTN                                       mSmmMpSyncDataSize;
 SMM_CPU_SEMAPHORES                          mSmmCpuSemaphores;
 UINTN                                       mSemaphoreSize;
 SPIN_LOCK                                   *mPFLock = NULL;
+SMM_CPU_LATENCY_HISTOGRAM                   mSmiLatencyHistogram;
 
 /**
   Performs an atomic compare exchange operation to get semaphore.
@@ -108,6 +109,27 @@ LockdownSemaphore (
   return Value;
 }
 
+/**
+  Signal the BSP on behalf of an AP.
+
+  The APs signal the BSP through SMM_CPU_ARRIVAL_SEMAPHORE_NUM semaphores
+  selected by their package number, so that the APs of different packages
+  do not contend for the same cache line.
+
+  @param   CpuIndex         AP processor Index
+
+**/
+VOID
+ReleaseBsp (
+  IN      UINTN                     CpuIndex
+  )
+{
+  UINTN                             Semaphore;
+
+  Semaphore = gSmmCpuPrivate->ProcessorInfo[CpuIndex].Location.Package % SMM_CPU_ARRIVAL_SEMAPHORE_NUM;
+  ReleaseSemaphore ((UINT32 *)((UINTN)mSmmMpSyncData->Arrival + mSemaphoreSize * Semaphore));
+}
+
 /**
   Wait all APs to performs an atomic compare exchange operation to release semaphore.
 
@@ -119,18 +141,57 @@ WaitForAllAPs (
   IN      UINTN                     NumberOfAPs
   )
 {
-  UINTN                             BspIndex;
+  UINTN                             Index;
+  volatile UINT32                   *Semaphore;
+  UINT32                            Value;
+  UINT32                            Count;
 
-  BspIndex = mSmmMpSyncData->BspIndex;
-  while (NumberOfAPs-- > 0) {
-    WaitForSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+  while (NumberOfAPs > 0) {
+    for (Index = 0; Index < SMM_CPU_ARRIVAL_SEMAPHORE_NUM && NumberOfAPs > 0; Index++) {
+      Semaphore = (UINT32 *)((UINTN)mSmmMpSyncData->Arrival + mSemaphoreSize * Index);
+      Value = *Semaphore;
+      if (Value == 0) {
+        continue;
+      }
+      //
+      // Take all the signals of this semaphore at once
+      //
+      Count = (UINT32) MIN (Value, NumberOfAPs);
+      if (InterlockedCompareExchange32 ((UINT32 *)Semaphore, Value, Value - Count) == Value) {
+        NumberOfAPs -= Count;
+      }
+    }
   }
 }
 
+/**
+  Release the AP in a slot of the release list, and have it release other APs
+  in turn.
+
+  @param   Slot             The slot of the AP in the release list
+
+**/
+VOID
+ReleaseApInSlot (
+  IN      UINTN                     Slot
+  )
+{
+  SMM_CPU_DATA_BLOCK                *CpuData;
+
+  CpuData = &mSmmMpSyncData->CpuData[mSmmMpSyncData->ReleaseSlots[Slot].CpuIndex];
+  *CpuData->Fanout = TRUE;
+  ReleaseSemaphore (CpuData->Run);
+}
+
 /**
   Performs an atomic compare exchange operation to release semaphore
   for each AP.
 
+  The present APs are listed in processor index order, so that the APs of a
+  package are usually adjacent. The BSP only releases the first AP of each
+  package, and every released AP releases the next SMM_CPU_RELEASE_FANOUT APs
+  of its package in the list, so the wake up spreads as a tree.
+
 **/
 VOID
 ReleaseAllAPs (
@@ -139,11 +200,134 @@ ReleaseAllAPs (
 {
   UINTN                             Index;
   UINTN                             BspIndex;
-
-  BspIndex = mSmmMpSyncData->BspIndex;
-  for (Index = mMaxNumberOfCpus; Index-- > 0;) {
+  SMM_CPU_RELEASE_SLOT              *Slots;
+  UINT32                            SlotCount;
+  UINT32                            SegmentStart;
+  UINT32                            Slot;
+
+  BspIndex     = mSmmMpSyncData->BspIndex;
+  Slots        = mSmmMpSyncData->ReleaseSlots;
+  SlotCount    = 0;
+  SegmentStart = 0;
+  for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
     if (Index != BspIndex && *(mSmmMpSyncData->CpuData[Index].Present)) {
-      ReleaseSemaphore (mSmmMpSyncData->CpuData[Index].Run);
+      if (SlotCount != 0 &&
+          gSmmCpuPrivate->ProcessorInfo[Index].Location.Package !=
+          gSmmCpuPrivate->ProcessorInfo[Slots[SlotCount - 1].CpuIndex].Location.Package) {
+        for (Slot = SegmentStart; Slot < SlotCount; Slot++) {
+          Slots[Slot].SegmentEnd = SlotCount;
+        }
+        SegmentStart = SlotCount;
+      }
+      Slots[SlotCount].CpuIndex     = (UINT32) Index;
+      Slots[SlotCount].SegmentStart = SegmentStart;
+      mSmmMpSyncData->CpuData[Index].ReleaseSlot = SlotCount;
+      SlotCount++;
+    }
+  }
+  for (Slot = SegmentStart; Slot < SlotCount; Slot++) {
+    Slots[Slot].SegmentEnd = SlotCount;
+  }
+
+  //
+  // Release the first AP of each package
+  //
+  for (Slot = 0; Slot < SlotCount; Slot = Slots[Slot].SegmentEnd) {
+    ReleaseApInSlot (Slot);
+  }
+}
+
+/**
+  Wait for the signal from the BSP on an AP.
+
+  If the AP was released by ReleaseAllAPs(), it releases its children in the
+  release list before returning.
+
+  @param   CpuIndex         AP processor Index
+
+**/
+VOID
+WaitForBsp (
+  IN      UINTN                     CpuIndex
+  )
+{
+  SMM_CPU_DATA_BLOCK                *CpuData;
+  SMM_CPU_RELEASE_SLOT              *Slot;
+  UINTN                             Child;
+  UINTN                             FirstChild;
+
+  CpuData = &mSmmMpSyncData->CpuData[CpuIndex];
+  WaitForSemaphore (CpuData->Run);
+
+  if (*CpuData->Fanout) {
+    *CpuData->Fanout = FALSE;
+    Slot = &mSmmMpSyncData->ReleaseSlots[CpuData->ReleaseSlot];
+    FirstChild = Slot->SegmentStart + (CpuData->ReleaseSlot - Slot->SegmentStart) * SMM_CPU_RELEASE_FANOUT + 1;
+    for (Child = FirstChild;
+         Child < FirstChild + SMM_CPU_RELEASE_FANOUT && Child < Slot->SegmentEnd;
+         Child++) {
+      ReleaseApInSlot (Child);
+    }
+  }
+}
+
+/**
+  Get the SMI latency histogram bucket of a duration.
+
+  @param   Time             The duration in nanoseconds
+
+  @return  The bucket index.
+
+**/
+UINTN
+GetSmiLatencyBucket (
+  IN      UINT64                    Time
+  )
+{
+  UINT64                            MicroSeconds;
+
+  MicroSeconds = DivU64x32 (Time, 1000);
+  if (MicroSeconds == 0) {
+    return 0;
+  }
+  return MIN ((UINTN) HighBitSet64 (MicroSeconds) + 1, SMM_CPU_LATENCY_BUCKET_NUM - 1);
+}
+
+/**
+  Record the latency of an SMI in the SMI latency histograms, and print the
+  histograms each time the number of SMIs reaches a power of 2.
+
+  @param   RendezvousTime   The time the BSP spent gathering the APs, in nanoseconds
+  @param   TotalTime        The time the BSP spent handling the SMI, in nanoseconds
+
+**/
+VOID
+RecordSmiLatency (
+  IN      UINT64                    RendezvousTime,
+  IN      UINT64                    TotalTime
+  )
+{
+  UINTN                             Index;
+
+  mSmiLatencyHistogram.Rendezvous[GetSmiLatencyBucket (RendezvousTime)]++;
+  mSmiLatencyHistogram.Total[GetSmiLatencyBucket (TotalTime)]++;
+  mSmiLatencyHistogram.SmiCount++;
+
+  if ((mSmiLatencyHistogram.SmiCount & (mSmiLatencyHistogram.SmiCount - 1)) != 0) {
+    return;
+  }
+
+  DEBUG ((EFI_D_INFO, "SMI latency histograms after %ld SMIs\n", mSmiLatencyHistogram.SmiCount));
+  DEBUG ((EFI_D_INFO, "  Below (us)  Rendezvous       Total\n"));
+  for (Index = 0; Index < SMM_CPU_LATENCY_BUCKET_NUM; Index++) {
+    if (mSmiLatencyHistogram.Rendezvous[Index] != 0 || mSmiLatencyHistogram.Total[Index] != 0) {
+      DEBUG ((
+        EFI_D_INFO,
+        "  %10ld  %10d  %10d\n",
+        LShiftU64 (1, Index),
+        mSmiLatencyHistogram.Rendezvous[Index],
+        mSmiLatencyHistogram.Total[Index]
+        ));
     }
   }
 }
@@ -316,9 +500,19 @@ BSPHandler (
   UINTN                             ApCount;
   BOOLEAN                           ClearTopLevelSmiResult;
   UINTN                             PresentCount;
+  UINT32                            CheckedInCount;
+  UINT64                            SmiStartTime;
+  UINT64                            RendezvousStartTime;
+  UINT64                            RendezvousTime;
 
   ASSERT (CpuIndex == mSmmMpSyncData->BspIndex);
   ApCount = 0;
+  SmiStartTime = 0;
+  RendezvousStartTime = 0;
+  RendezvousTime = 0;
+  if (FeaturePcdGet (PcdCpuSmmLatencyHistogram)) {
+    SmiStartTime = StartSyncTimer ();
+  }
 
   //
   // Flag BSP's presence
@@ -369,6 +563,10 @@ BSPHandler (
     //
     WaitForAllAPs (ApCount);
 
+    if (FeaturePcdGet (PcdCpuSmmLatencyHistogram)) {
+      RendezvousTime = GetSyncTimerElapsedTime (SmiStartTime);
+    }
+
     if (SmmCpuFeaturesNeedConfigureMtrrs()) {
       //
       // Signal all APs it's time for backup MTRRs
@@ -409,6 +607,37 @@ BSPHandler (
     }
   }
 
+  //
+  // If BSP Only Sync Mode: the APs that may have raised the SMI stay in SMM, so that
+  // the SMI handlers can access their save state. Wait for the other APs that checked
+  // in to check out, then lock the counter down and retrieve the number of APs that
+  // stayed. APs which arrive later will run through freely.
+  //
+  if (SyncMode == SmmCpuSyncModeBspOnly) {
+    do {
+      CheckedInCount = *mSmmMpSyncData->Counter;
+      PresentCount = 0;
+      for (Index = mMaxNumberOfCpus; Index-- > 0;) {
+        if (*(mSmmMpSyncData->CpuData[Index].Present)) {
+          PresentCount ++;
+        }
+      }
+    } while (CheckedInCount != PresentCount ||
+             InterlockedCompareExchange32 (
+               (UINT32*)mSmmMpSyncData->Counter,
+               CheckedInCount,
+               (UINT32)-1
+               ) != CheckedInCount);
+    ApCount = CheckedInCount - 1;
+    if (ApCount != 0) {
+      *mSmmMpSyncData->AllCpusInSync = TRUE;
+    }
+
+    if (FeaturePcdGet (PcdCpuSmmLatencyHistogram)) {
+      RendezvousTime = GetSyncTimerElapsedTime (SmiStartTime);
+    }
+  }
+
   //
   // The BUSY lock is initialized to Acquired state
   //
@@ -444,7 +673,11 @@ BSPHandler (
   // make those APs to exit SMI synchronously. APs which arrive later will be excluded and
   // will run through freely.
   //
-  if (SyncMode != SmmCpuSyncModeTradition && !SmmCpuFeaturesNeedConfigureMtrrs()) {
+  if (SyncMode == SmmCpuSyncModeRelaxedAp && !SmmCpuFeaturesNeedConfigureMtrrs()) {
+
+    if (FeaturePcdGet (PcdCpuSmmLatencyHistogram)) {
+      RendezvousStartTime = StartSyncTimer ();
+    }
 
     //
     // Lock the counter down and retrieve the number of APs
@@ -465,6 +698,10 @@ BSPHandler (
         break;
       }
     }
+
+    if (FeaturePcdGet (PcdCpuSmmLatencyHistogram)) {
+      RendezvousTime = GetSyncTimerElapsedTime (RendezvousStartTime);
+    }
   }
 
   //
@@ -523,6 +760,10 @@ BSPHandler (
   //
   WaitForAllAPs (ApCount);
 
+  if (FeaturePcdGet (PcdCpuSmmLatencyHistogram)) {
+    RecordSmiLatency (RendezvousTime, GetSyncTimerElapsedTime (SmiStartTime));
+  }
+
   //
   // Reset BspIndex to -1, meaning BSP has not been elected.
   //
@@ -537,6 +778,33 @@ BSPHandler (
   *mSmmMpSyncData->AllCpusInSync = FALSE;
 }
 
+/**
+  Check if the SMI of a processor was raised by an I/O instruction.
+
+  @param     CpuIndex         Processor Index
+
+  @retval    TRUE             The save state of the processor reports an I/O
+                              instruction, e.g. a write to the software SMI
+                              command port.
+  @retval    FALSE            The SMI was not raised by an I/O instruction of
+                              the processor.
+
+**/
+BOOLEAN
+IsIoSmi (
+  IN      UINTN                     CpuIndex
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_SMM_SAVE_STATE_IO_INFO        IoInfo;
+
+  Status = SmmCpuFeaturesReadSaveStateRegister (CpuIndex, EFI_SMM_SAVE_STATE_REGISTER_IO, sizeof (IoInfo), &IoInfo);
+  if (Status == EFI_UNSUPPORTED) {
+    Status = ReadSaveStateRegister (CpuIndex, EFI_SMM_SAVE_STATE_REGISTER_IO, sizeof (IoInfo), &IoInfo);
+  }
+  return (BOOLEAN) (Status == EFI_SUCCESS);
+}
+
 /**
   SMI handler for AP.
 
@@ -614,6 +882,23 @@ APHandler (
   BspIndex = mSmmMpSyncData->BspIndex;
   ASSERT (CpuIndex != BspIndex);
 
+  if (SyncMode == SmmCpuSyncModeBspOnly) {
+    if (!IsIoSmi (CpuIndex)) {
+      //
+      // BSP handles this SMI alone. Signal the completion of this AP
+      // without marking its presence.
+      //
+      WaitForSemaphore (mSmmMpSyncData->Counter);
+      return;
+    }
+    //
+    // This AP may have raised the SMI, e.g. by writing the software SMI
+    // command port, and the SMI handlers may read or update its save state.
+    // Stay in SMM until the BSP is done, as in Relaxed-AP Sync Mode.
+    //
+    SyncMode = SmmCpuSyncModeRelaxedAp;
+  }
+
   //
   // Mark this processor's presence
   //
@@ -623,14 +908,14 @@ APHandler (
     //
     // Notify BSP of arrival at this point
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    ReleaseBsp (CpuIndex);
   }
 
   if (SmmCpuFeaturesNeedConfigureMtrrs()) {
     //
     // Wait for the signal from BSP to backup MTRRs
     //
-    WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    WaitForBsp (CpuIndex);
 
     //
     // Backup OS MTRRs
@@ -640,12 +925,12 @@ APHandler (
     //
     // Signal BSP the completion of this AP
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    ReleaseBsp (CpuIndex);
 
     //
     // Wait for BSP's signal to program MTRRs
     //
-    WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    WaitForBsp (CpuIndex);
 
     //
     // Replace OS MTRRs with SMI MTRRs
@@ -655,14 +940,14 @@ APHandler (
     //
     // Signal BSP the completion of this AP
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    ReleaseBsp (CpuIndex);
   }
 
   while (TRUE) {
     //
     // Wait for something to happen
     //
-    WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    WaitForBsp (CpuIndex);
 
     //
     // Check if BSP wants to exit SMM
@@ -695,12 +980,12 @@ APHandler (
     //
     // Notify BSP the readiness of this AP to program MTRRs
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    ReleaseBsp (CpuIndex);
 
     //
     // Wait for the signal from BSP to program MTRRs
     //
-    WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+    WaitForBsp (CpuIndex);
 
     //
     // Restore OS MTRRs
@@ -712,12 +997,12 @@ APHandler (
   //
   // Notify BSP the readiness of this AP to Reset states/semaphore for this processor
   //
-  ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+  ReleaseBsp (CpuIndex);
 
   //
   // Wait for the signal from BSP to Reset states/semaphore for this processor
   //
-  WaitForSemaphore (mSmmMpSyncData->CpuData[CpuIndex].Run);
+  WaitForBsp (CpuIndex);
 
   //
   // Reset states/semaphore for this processor
@@ -727,7 +1012,7 @@ APHandler (
   //
   // Notify BSP the readiness of this AP to exit SMM
   //
-  ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+  ReleaseBsp (CpuIndex);
 
 }
 
@@ -1217,7 +1502,7 @@ InitializeSmmCpuSemaphores (
 
   SemaphoreSize   = GetSpinLockProperties ();
   ProcessorCount = gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
-  GlobalSemaphoresSize = (sizeof (SMM_CPU_SEMAPHORE_GLOBAL) / sizeof (VOID *)) * SemaphoreSize;
+  GlobalSemaphoresSize = (sizeof (SMM_CPU_SEMAPHORE_GLOBAL) / sizeof (VOID *) - 1 + SMM_CPU_ARRIVAL_SEMAPHORE_NUM) * SemaphoreSize;
   CpuSemaphoresSize    = (sizeof (SMM_CPU_SEMAPHORE_CPU) / sizeof (VOID *)) * ProcessorCount * SemaphoreSize;
   MsrSemahporeSize     = MSR_SPIN_LOCK_INIT_NUM * SemaphoreSize;
   TotalSize = GlobalSemaphoresSize + CpuSemaphoresSize + MsrSemahporeSize;
@@ -1242,6 +1527,8 @@ InitializeSmmCpuSemaphores (
   SemaphoreAddr += SemaphoreSize;
   mSmmCpuSemaphores.SemaphoreGlobal.MemoryMappedLock
                                                   = (SPIN_LOCK *)SemaphoreAddr;
+  SemaphoreAddr += SemaphoreSize;
+  mSmmCpuSemaphores.SemaphoreGlobal.Arrival       = (UINT32 *)SemaphoreAddr;
 
   SemaphoreAddr = (UINTN)SemaphoreBlock + GlobalSemaphoresSize;
   mSmmCpuSemaphores.SemaphoreCpu.Busy    = (SPIN_LOCK *)SemaphoreAddr;
@@ -1249,6 +1536,8 @@ InitializeSmmCpuSemaphores (
   mSmmCpuSemaphores.SemaphoreCpu.Run     = (UINT32 *)SemaphoreAddr;
   SemaphoreAddr += ProcessorCount * SemaphoreSize;
   mSmmCpuSemaphores.SemaphoreCpu.Present = (BOOLEAN *)SemaphoreAddr;
+  SemaphoreAddr += ProcessorCount * SemaphoreSize;
+  mSmmCpuSemaphores.SemaphoreCpu.Fanout  = (BOOLEAN *)SemaphoreAddr;
 
   SemaphoreAddr = (UINTN)SemaphoreBlock + GlobalSemaphoresSize + CpuSemaphoresSize;
   mSmmCpuSemaphores.SemaphoreMsr.Msr              = (SPIN_LOCK *)SemaphoreAddr;
@@ -1274,15 +1563,18 @@ InitializeMpSyncData (
   )
 {
   UINTN                      CpuIndex;
+  UINTN                      Index;
 
   if (mSmmMpSyncData != NULL) {
     //
     // mSmmMpSyncDataSize includes one structure of SMM_DISPATCHER_MP_SYNC_DATA, one
-    // CpuData array of SMM_CPU_DATA_BLOCK and one CandidateBsp array of BOOLEAN.
+    // CpuData array of SMM_CPU_DATA_BLOCK, one ReleaseSlots array of SMM_CPU_RELEASE_SLOT
+    // and one CandidateBsp array of BOOLEAN.
     //
     ZeroMem (mSmmMpSyncData, mSmmMpSyncDataSize);
     mSmmMpSyncData->CpuData = (SMM_CPU_DATA_BLOCK *)((UINT8 *)mSmmMpSyncData + sizeof (SMM_DISPATCHER_MP_SYNC_DATA));
-    mSmmMpSyncData->CandidateBsp = (BOOLEAN *)(mSmmMpSyncData->CpuData + gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus);
+    mSmmMpSyncData->ReleaseSlots = (SMM_CPU_RELEASE_SLOT *)(mSmmMpSyncData->CpuData + gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus);
+    mSmmMpSyncData->CandidateBsp = (BOOLEAN *)(mSmmMpSyncData->ReleaseSlots + gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus);
     if (FeaturePcdGet (PcdCpuSmmEnableBspElection)) {
       //
       // Enable BSP election by setting BspIndex to -1
@@ -1290,15 +1582,25 @@ InitializeMpSyncData (
       mSmmMpSyncData->BspIndex = (UINT32)-1;
     }
     mSmmMpSyncData->EffectiveSyncMode = (SMM_CPU_SYNC_MODE) PcdGet8 (PcdCpuSmmSyncMode);
+    if (mSmmMpSyncData->EffectiveSyncMode == SmmCpuSyncModeBspOnly && SmmCpuFeaturesNeedConfigureMtrrs ()) {
+      //
+      // All processors have to program the SMM MTRRs, so they must be gathered
+      //
+      mSmmMpSyncData->EffectiveSyncMode = SmmCpuSyncModeTradition;
+    }
 
     mSmmMpSyncData->Counter       = mSmmCpuSemaphores.SemaphoreGlobal.Counter;
     mSmmMpSyncData->InsideSmm     = mSmmCpuSemaphores.SemaphoreGlobal.InsideSmm;
     mSmmMpSyncData->AllCpusInSync = mSmmCpuSemaphores.SemaphoreGlobal.AllCpusInSync;
+    mSmmMpSyncData->Arrival       = mSmmCpuSemaphores.SemaphoreGlobal.Arrival;
     ASSERT (mSmmMpSyncData->Counter != NULL && mSmmMpSyncData->InsideSmm != NULL &&
-            mSmmMpSyncData->AllCpusInSync != NULL);
+            mSmmMpSyncData->AllCpusInSync != NULL && mSmmMpSyncData->Arrival != NULL);
     *mSmmMpSyncData->Counter       = 0;
     *mSmmMpSyncData->InsideSmm     = FALSE;
     *mSmmMpSyncData->AllCpusInSync = FALSE;
+    for (Index = 0; Index < SMM_CPU_ARRIVAL_SEMAPHORE_NUM; Index++) {
+      *(UINT32 *)((UINTN)mSmmMpSyncData->Arrival + mSemaphoreSize * Index) = 0;
+    }
 
     for (CpuIndex = 0; CpuIndex < gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus; CpuIndex ++) {
       mSmmMpSyncData->CpuData[CpuIndex].Busy    =
@@ -1307,6 +1609,8 @@ InitializeMpSyncData (
         (UINT32 *)((UINTN)mSmmCpuSemaphores.SemaphoreCpu.Run + mSemaphoreSize * CpuIndex);
       mSmmMpSyncData->CpuData[CpuIndex].Present =
         (BOOLEAN *)((UINTN)mSmmCpuSemaphores.SemaphoreCpu.Present + mSemaphoreSize * CpuIndex);
+      mSmmMpSyncData->CpuData[CpuIndex].Fanout  =
+        (BOOLEAN *)((UINTN)mSmmCpuSemaphores.SemaphoreCpu.Fanout + mSemaphoreSize * CpuIndex);
     }
   }
 }
@@ -1340,7 +1644,8 @@ InitializeMpServiceData (
   // Initialize mSmmMpSyncData
   //
   mSmmMpSyncDataSize = sizeof (SMM_DISPATCHER_MP_SYNC_DATA) +
-                       (sizeof (SMM_CPU_DATA_BLOCK) + sizeof (BOOLEAN)) * gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
+                       (sizeof (SMM_CPU_DATA_BLOCK) + sizeof (SMM_CPU_RELEASE_SLOT) + sizeof (BOOLEAN)) *
+                       gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
   mSmmMpSyncData = (SMM_DISPATCHER_MP_SYNC_DATA*) AllocatePages (EFI_SIZE_TO_PAGES (mSmmMpSyncDataSize));
   ASSERT (mSmmMpSyncData != NULL);
   InitializeMpSyncData ();
@@ -299,14 +299,55 @@ typedef struct {
   volatile VOID                     *Parameter;
   volatile UINT32                   *Run;
   volatile BOOLEAN                  *Present;
+  //
+  // Set by the processor that releases this AP when the AP has to release
+  // other APs in turn. ReleaseSlot is the index of the AP in the release list.
+  //
+  volatile BOOLEAN                  *Fanout;
+  volatile UINT32                   ReleaseSlot;
 } SMM_CPU_DATA_BLOCK;
 
 typedef enum {
   SmmCpuSyncModeTradition,
   SmmCpuSyncModeRelaxedAp,
+  SmmCpuSyncModeBspOnly,
   SmmCpuSyncModeMax
 } SMM_CPU_SYNC_MODE;
 
+///
+/// The number of semaphores the APs signal their arrival to the BSP with.
+/// Each AP uses the semaphore selected by its package number.
+///
+#define SMM_CPU_ARRIVAL_SEMAPHORE_NUM  8
+
+///
+/// The number of APs each AP releases when the BSP releases all the APs.
+///
+#define SMM_CPU_RELEASE_FANOUT         4
+
+///
+/// An entry of the list of the APs released by ReleaseAllAPs(). The APs of the
+/// same package form a segment of the list, and are released as a tree rooted
+/// at the first AP of the segment.
+///
+typedef struct {
+  UINT32                            CpuIndex;
+  UINT32                            SegmentStart;
+  UINT32                            SegmentEnd;
+} SMM_CPU_RELEASE_SLOT;
+
+///
+/// The number of buckets of the SMI latency histograms. Bucket N counts the
+/// SMIs that took [2^(N-1), 2^N) microseconds.
+///
+#define SMM_CPU_LATENCY_BUCKET_NUM     32
+
+typedef struct {
+  UINT64                            SmiCount;
+  UINT32                            Rendezvous[SMM_CPU_LATENCY_BUCKET_NUM];
+  UINT32                            Total[SMM_CPU_LATENCY_BUCKET_NUM];
+} SMM_CPU_LATENCY_HISTOGRAM;
+
 typedef struct {
   //
   // Pointer to an array. The array should be located immediately after this structure
@@ -320,6 +361,8 @@ typedef struct {
   volatile SMM_CPU_SYNC_MODE    EffectiveSyncMode;
   volatile BOOLEAN              SwitchBsp;
   volatile BOOLEAN              *CandidateBsp;
+  volatile UINT32               *Arrival;
+  SMM_CPU_RELEASE_SLOT          *ReleaseSlots;
 } SMM_DISPATCHER_MP_SYNC_DATA;
 
 #define MSR_SPIN_LOCK_INIT_NUM 15
@@ -366,6 +409,10 @@ typedef struct {
   SPIN_LOCK            *PFLock;
   SPIN_LOCK            *CodeAccessCheckLock;
   SPIN_LOCK            *MemoryMappedLock;
+  //
+  // The first of the SMM_CPU_ARRIVAL_SEMAPHORE_NUM arrival semaphores.
+  //
+  volatile UINT32      *Arrival;
 } SMM_CPU_SEMAPHORE_GLOBAL;
 
 ///
@@ -375,6 +422,7 @@ typedef struct {
   SPIN_LOCK                         *Busy;
   volatile UINT32                   *Run;
   volatile BOOLEAN                  *Present;
+  volatile BOOLEAN                  *Fanout;
 } SMM_CPU_SEMAPHORE_CPU;
 
 ///
@@ -470,6 +518,20 @@ IsSyncTimerTimeout (
   IN      UINT64                    Timer
   );
 
+/**
+  Get the time elapsed since a start timer.
+
+  @param Timer  The start timer from the begin.
+
+  @return The elapsed time in nanoseconds.
+
+**/
+UINT64
+EFIAPI
+GetSyncTimerElapsedTime (
+  IN      UINT64                    Timer
+  );
+
 /**
   Initialize IDT for SMM Stack Guard.
 
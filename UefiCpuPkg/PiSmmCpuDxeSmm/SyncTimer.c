@@ -1,7 +1,7 @@
 /** @file
 SMM Timer feature support
 
-Copyright (c) 2009 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2017, Intel Corporation. All rights reserved.<BR>
 This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
 which accompanies this distribution.  The full text of the license may be found at
@@ -66,14 +66,15 @@ StartSyncTimer (
 
 
 /**
-  Check if the SMM AP Sync timer is timeout.
+  Get the number of performance counter ticks elapsed since a start timer.
 
   @param Timer  The start timer from the begin.
 
+  @return The number of elapsed ticks.
+
 **/
-BOOLEAN
-EFIAPI
-IsSyncTimerTimeout (
+UINT64
+GetSyncTimerElapsedTicks (
   IN      UINT64                    Timer
   )
 {
@@ -112,5 +113,37 @@ IsSyncTimerTimeout (
     }
   }
 
-  return (BOOLEAN) (Delta >= mTimeoutTicker);
+  return Delta;
+}
+
+/**
+  Check if the SMM AP Sync timer is timeout.
+
+  @param Timer  The start timer from the begin.
+
+**/
+BOOLEAN
+EFIAPI
+IsSyncTimerTimeout (
+  IN      UINT64                    Timer
+  )
+{
+  return (BOOLEAN) (GetSyncTimerElapsedTicks (Timer) >= mTimeoutTicker);
+}
+
+/**
+  Get the time elapsed since a start timer.
+
+  @param Timer  The start timer from the begin.
+
+  @return The elapsed time in nanoseconds.
+
+**/
+UINT64
+EFIAPI
+GetSyncTimerElapsedTime (
+  IN      UINT64                    Timer
+  )
+{
+  return GetTimeInNanoSecond (GetSyncTimerElapsedTicks (Timer));
 }
@@ -0,0 +1,34 @@
+/** @file
+  Stand-in for the build tools generated AutoGen.h of PiSmmCpuDxeSmm, used when
+  MpService.c is built with the host compiler for the unit test.
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _SMM_MP_SYNC_UNIT_TEST_AUTOGEN_H_
+#define _SMM_MP_SYNC_UNIT_TEST_AUTOGEN_H_
+
+#include <PiDxe.h>
+#include <Library/PcdLib.h>
+
+#define _PCD_GET_MODE_BOOL_PcdCpuSmmDebug                  0
+#define _PCD_GET_MODE_BOOL_PcdCpuSmmBlockStartupThisAp     0
+#define _PCD_GET_MODE_BOOL_PcdCpuSmmEnableBspElection      1
+#define _PCD_GET_MODE_BOOL_PcdCpuSmmStackGuard             0
+#define _PCD_GET_MODE_BOOL_PcdCpuSmmProfileEnable          0
+#define _PCD_GET_MODE_BOOL_PcdCpuSmmLatencyHistogram       1
+
+//
+// The test sets the effective sync mode of each run
+//
+#define _PCD_GET_MODE_8_PcdCpuSmmSyncMode                  0
+
+#endif
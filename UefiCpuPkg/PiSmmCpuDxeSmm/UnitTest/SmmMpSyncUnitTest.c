@@ -0,0 +1,719 @@
+/** @file
+  Host unit test of the SMI rendezvous of PiSmmCpuDxeSmm.
+
+  MpService.c is built with the host compiler and every simulated processor is
+  a thread that calls SmiRendezvous() for each SMI. The SMM Foundation entry
+  point, the save state, the platform hooks and the libraries are emulated.
+  Each SMI is raised by one random processor with an I/O instruction, which
+  enters SMM before the others, and has a random BSP. The test runs the SMIs in
+  the traditional, relaxed AP and BSP only sync modes, and checks that:
+  - the rendezvous completes, with the arrival semaphores, the counter and the
+    Run semaphores of the hierarchical release back to zero;
+  - in the traditional sync mode, all the processors are present when the SMI
+    handlers run;
+  - in the BSP only sync mode, only the BSP and the processor that raised the
+    SMI are present when the SMI handlers run;
+  - the processor that raised the SMI does not leave SMM before the SMI
+    handlers update its save state.
+
+  Usage: SmmMpSyncUnitTest [SmiCount [Seed]]
+
+  Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#undef NULL
+
+#include "AutoGen.h"
+#include "PiSmmCpuDxeSmm.h"
+
+//
+// Two packages of 7 processors, so that the release trees have more than one
+// level, and a package with 2 processors.
+//
+#define NUMBER_OF_CPUS           16
+#define PACKAGE_OF_CPU(Index)    (((Index) < 14) ? (Index) / 7 : 2)
+
+//
+// Time an AP waits for a late BSP, in nanoseconds
+//
+#define SYNC_TIMEOUT             2000000000ULL
+
+#define SPIN_LOCK_RELEASED       ((UINTN) 1)
+#define SPIN_LOCK_ACQUIRED       ((UINTN) 2)
+
+extern UINTN                     mSmmMpSyncDataSize;
+
+VOID
+EFIAPI
+SmiRendezvous (
+  IN      UINTN                     CpuIndex
+  );
+
+VOID
+InitializeSmmCpuSemaphores (
+  VOID
+  );
+
+SMM_CPU_PRIVATE_DATA             mSmmCpuPrivateData;
+SMM_CPU_PRIVATE_DATA             *gSmmCpuPrivate = &mSmmCpuPrivateData;
+EFI_PROCESSOR_INFORMATION        mProcessorInfo[NUMBER_OF_CPUS];
+UINTN                            mMaxNumberOfCpus = NUMBER_OF_CPUS;
+UINTN                            mNumberOfCpus = NUMBER_OF_CPUS;
+BOOLEAN                          mXdSupported = FALSE;
+CPU_HOT_PLUG_DATA                mCpuHotPlugData;
+SPIN_LOCK                        *mConfigSmmCodeAccessCheckLock;
+SPIN_LOCK                        *mMemoryMappedLock;
+
+//
+// The SMI being simulated
+//
+UINTN                            mSmi;
+UINTN                            mSmiSource;
+UINTN                            mBsp;
+volatile BOOLEAN                 mSmiPending;
+
+//
+// What the SMI handlers and the processors observed
+//
+BOOLEAN                          mPresentInHandlers[NUMBER_OF_CPUS];
+volatile UINTN                   mSaveState[NUMBER_OF_CPUS];
+BOOLEAN                          mSourceSawUpdate;
+UINTN                            mHandlerRuns;
+
+pthread_barrier_t                mSmiStart;
+pthread_barrier_t                mSmiEnd;
+UINTN                            mSmiCount;
+
+//
+// BaseLib, BaseMemoryLib, MemoryAllocationLib and DebugLib
+//
+
+VOID
+EFIAPI
+CpuPause (
+  VOID
+  )
+{
+  sched_yield ();
+}
+
+UINT32
+EFIAPI
+InterlockedCompareExchange32 (
+  IN OUT  UINT32                    *Value,
+  IN      UINT32                    CompareValue,
+  IN      UINT32                    ExchangeValue
+  )
+{
+  return __sync_val_compare_and_swap (Value, CompareValue, ExchangeValue);
+}
+
+UINTN
+EFIAPI
+AsmReadCr2 (
+  VOID
+  )
+{
+  return 0;
+}
+
+UINTN
+EFIAPI
+AsmWriteCr2 (
+  UINTN  Cr2
+  )
+{
+  return Cr2;
+}
+
+UINT64
+EFIAPI
+AsmReadMsr64 (
+  IN      UINT32                    Index
+  )
+{
+  abort ();
+}
+
+UINT64
+EFIAPI
+AsmWriteMsr64 (
+  IN      UINT32                    Index,
+  IN      UINT64                    Value
+  )
+{
+  abort ();
+}
+
+UINT64
+EFIAPI
+DivU64x32 (
+  IN      UINT64                    Dividend,
+  IN      UINT32                    Divisor
+  )
+{
+  return Dividend / Divisor;
+}
+
+UINT64
+EFIAPI
+LShiftU64 (
+  IN      UINT64                    Operand,
+  IN      UINTN                     Count
+  )
+{
+  return Operand << Count;
+}
+
+INTN
+EFIAPI
+HighBitSet64 (
+  IN      UINT64                    Operand
+  )
+{
+  return (Operand == 0) ? -1 : 63 - __builtin_clzll (Operand);
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN UINTN  Length
+  )
+{
+  return memset (Buffer, 0, Length);
+}
+
+VOID *
+EFIAPI
+AllocatePages (
+  IN UINTN  Pages
+  )
+{
+  VOID  *Buffer;
+
+  if (posix_memalign (&Buffer, EFI_PAGE_SIZE, EFI_PAGES_TO_SIZE (Pages)) != 0) {
+    return NULL;
+  }
+  return Buffer;
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  printf ("ASSERT %s(%u): %s\n", FileName, (unsigned) LineNumber, Description);
+  abort ();
+}
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+}
+
+BOOLEAN
+EFIAPI
+DebugAssertEnabled (
+  VOID
+  )
+{
+  return TRUE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+BOOLEAN
+EFIAPI
+DebugPrintLevelEnabled (
+  IN  CONST UINTN        ErrorLevel
+  )
+{
+  return FALSE;
+}
+
+//
+// SynchronizationLib
+//
+
+UINTN
+EFIAPI
+GetSpinLockProperties (
+  VOID
+  )
+{
+  return 64;
+}
+
+SPIN_LOCK *
+EFIAPI
+InitializeSpinLock (
+  OUT      SPIN_LOCK                 *SpinLock
+  )
+{
+  *SpinLock = SPIN_LOCK_RELEASED;
+  return SpinLock;
+}
+
+BOOLEAN
+EFIAPI
+AcquireSpinLockOrFail (
+  IN OUT  SPIN_LOCK                 *SpinLock
+  )
+{
+  return (BOOLEAN) __sync_bool_compare_and_swap (SpinLock, SPIN_LOCK_RELEASED, SPIN_LOCK_ACQUIRED);
+}
+
+SPIN_LOCK *
+EFIAPI
+AcquireSpinLock (
+  IN OUT  SPIN_LOCK                 *SpinLock
+  )
+{
+  while (!AcquireSpinLockOrFail (SpinLock)) {
+    CpuPause ();
+  }
+  return SpinLock;
+}
+
+SPIN_LOCK *
+EFIAPI
+ReleaseSpinLock (
+  IN OUT  SPIN_LOCK                 *SpinLock
+  )
+{
+  __sync_synchronize ();
+  *SpinLock = SPIN_LOCK_RELEASED;
+  return SpinLock;
+}
+
+//
+// SyncTimer.c
+//
+
+UINT64
+EFIAPI
+StartSyncTimer (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  clock_gettime (CLOCK_MONOTONIC, &Time);
+  return (UINT64) Time.tv_sec * 1000000000ULL + Time.tv_nsec;
+}
+
+UINT64
+EFIAPI
+GetSyncTimerElapsedTime (
+  IN      UINT64                    Timer
+  )
+{
+  return StartSyncTimer () - Timer;
+}
+
+BOOLEAN
+EFIAPI
+IsSyncTimerTimeout (
+  IN      UINT64                    Timer
+  )
+{
+  return (BOOLEAN) (GetSyncTimerElapsedTime (Timer) > SYNC_TIMEOUT);
+}
+
+//
+// Platform hooks, CPU features and the other parts of PiSmmCpuDxeSmm
+//
+
+BOOLEAN
+EFIAPI
+PlatformValidSmi (
+  VOID
+  )
+{
+  return mSmiPending;
+}
+
+BOOLEAN
+EFIAPI
+ClearTopLevelSmiStatus (
+  VOID
+  )
+{
+  mSmiPending = FALSE;
+  return TRUE;
+}
+
+EFI_STATUS
+EFIAPI
+PlatformSmmBspElection (
+  OUT BOOLEAN     *IsBsp
+  )
+{
+  pthread_t  Self;
+  UINTN      Index;
+
+  //
+  // The processors are recognized by their ProcessorId, set to the thread
+  //
+  Self = pthread_self ();
+  for (Index = 0; Index < NUMBER_OF_CPUS; Index++) {
+    if (pthread_equal ((pthread_t) mProcessorInfo[Index].ProcessorId, Self)) {
+      break;
+    }
+  }
+  *IsBsp = (BOOLEAN) (Index == mBsp);
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+SendSmiIpi (
+  IN UINT32          ApicId
+  )
+{
+}
+
+VOID
+EFIAPI
+InitializeDebugAgent (
+  IN UINT32                InitFlag,
+  IN VOID                  *Context, OPTIONAL
+  IN DEBUG_AGENT_CONTINUE  Function  OPTIONAL
+  )
+{
+}
+
+MTRR_SETTINGS *
+EFIAPI
+MtrrGetAllMtrrs (
+  OUT MTRR_SETTINGS                *MtrrSetting
+  )
+{
+  abort ();
+}
+
+MTRR_SETTINGS *
+EFIAPI
+MtrrSetAllMtrrs (
+  IN MTRR_SETTINGS                *MtrrSetting
+  )
+{
+  abort ();
+}
+
+BOOLEAN
+EFIAPI
+SmmCpuFeaturesNeedConfigureMtrrs (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+VOID
+EFIAPI
+SmmCpuFeaturesDisableSmrr (
+  VOID
+  )
+{
+}
+
+VOID
+EFIAPI
+SmmCpuFeaturesReenableSmrr (
+  VOID
+  )
+{
+}
+
+VOID
+EFIAPI
+SmmCpuFeaturesRendezvousEntry (
+  IN UINTN  CpuIndex
+  )
+{
+}
+
+VOID
+EFIAPI
+SmmCpuFeaturesRendezvousExit (
+  IN UINTN  CpuIndex
+  )
+{
+}
+
+UINT64
+EFIAPI
+SmmCpuFeaturesGetSmmRegister (
+  IN UINTN         CpuIndex,
+  IN SMM_REG_NAME  RegName
+  )
+{
+  return 0;
+}
+
+EFI_STATUS
+EFIAPI
+SmmCpuFeaturesReadSaveStateRegister (
+  IN  UINTN                        CpuIndex,
+  IN  EFI_SMM_SAVE_STATE_REGISTER  Register,
+  IN  UINTN                        Width,
+  OUT VOID                         *Buffer
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Report an I/O instruction in the save state of the processor that raised
+  the SMI only.
+**/
+EFI_STATUS
+EFIAPI
+ReadSaveStateRegister (
+  IN UINTN                        CpuIndex,
+  IN EFI_SMM_SAVE_STATE_REGISTER  Register,
+  IN UINTN                        Width,
+  OUT VOID                        *Buffer
+  )
+{
+  if (Register != EFI_SMM_SAVE_STATE_REGISTER_IO) {
+    abort ();
+  }
+  if (CpuIndex != mSmiSource) {
+    return EFI_NOT_FOUND;
+  }
+  ZeroMem (Buffer, Width);
+  return EFI_SUCCESS;
+}
+
+VOID
+ActivateXd (
+  VOID
+  )
+{
+}
+
+VOID
+PerformPreTasks (
+  VOID
+  )
+{
+}
+
+VOID
+EFIAPI
+PerformRemainingTasks (
+  VOID
+  )
+{
+}
+
+VOID
+SmmCpuUpdate (
+  VOID
+  )
+{
+}
+
+/**
+  The SMM Foundation entry point, which the BSP runs in the middle of the
+  rendezvous. It records which processors are present and updates the save
+  state of the processor that raised the SMI, as a software SMI handler does.
+**/
+VOID
+EFIAPI
+TestSmmCoreEntry (
+  IN CONST EFI_SMM_ENTRY_CONTEXT  *SmmEntryContext
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < NUMBER_OF_CPUS; Index++) {
+    mPresentInHandlers[Index] = *(mSmmMpSyncData->CpuData[Index].Present);
+  }
+  if (mPresentInHandlers[mSmiSource]) {
+    mSaveState[mSmiSource] = mSmi;
+  }
+  mHandlerRuns++;
+}
+
+/**
+  A simulated processor. For each SMI, the processor that raised it enters SMM
+  at once, the others a little later.
+**/
+VOID *
+ProcessorThread (
+  IN VOID  *Context
+  )
+{
+  UINTN  CpuIndex;
+  UINTN  Delay;
+
+  CpuIndex = (UINTN) Context;
+  mProcessorInfo[CpuIndex].ProcessorId = (UINT64) pthread_self ();
+  pthread_barrier_wait (&mSmiEnd);
+
+  while (TRUE) {
+    pthread_barrier_wait (&mSmiStart);
+    if (mSmi > mSmiCount) {
+      break;
+    }
+    if (CpuIndex != mSmiSource) {
+      for (Delay = 4 + (mSmi * 7 + CpuIndex * 3) % 16; Delay > 0; Delay--) {
+        sched_yield ();
+      }
+    }
+
+    SmiRendezvous (CpuIndex);
+
+    if (CpuIndex == mSmiSource) {
+      mSourceSawUpdate = (BOOLEAN) (mSaveState[CpuIndex] == mSmi);
+    }
+    pthread_barrier_wait (&mSmiEnd);
+  }
+  return NULL;
+}
+
+/**
+  Check the state of the rendezvous after an SMI.
+
+  @retval TRUE   The SMI ran as expected.
+  @retval FALSE  A check failed. The failure has been printed.
+**/
+BOOLEAN
+CheckSmi (
+  IN SMM_CPU_SYNC_MODE  SyncMode
+  )
+{
+  UINTN  Index;
+
+  if (mHandlerRuns != 1) {
+    printf ("SMI %u: the SMI handlers ran %u times\n", (unsigned) mSmi, (unsigned) mHandlerRuns);
+    return FALSE;
+  }
+  if (*mSmmMpSyncData->Counter != 0 || *mSmmMpSyncData->InsideSmm || *mSmmMpSyncData->AllCpusInSync) {
+    printf ("SMI %u: the global semaphores were not reset\n", (unsigned) mSmi);
+    return FALSE;
+  }
+  for (Index = 0; Index < SMM_CPU_ARRIVAL_SEMAPHORE_NUM; Index++) {
+    if (*(UINT32 *)((UINTN)mSmmMpSyncData->Arrival + mSemaphoreSize * Index) != 0) {
+      printf ("SMI %u: arrival semaphore %u not zero\n", (unsigned) mSmi, (unsigned) Index);
+      return FALSE;
+    }
+  }
+  for (Index = 0; Index < NUMBER_OF_CPUS; Index++) {
+    if (*(mSmmMpSyncData->CpuData[Index].Run) != 0 || *(mSmmMpSyncData->CpuData[Index].Present) ||
+        *(mSmmMpSyncData->CpuData[Index].Fanout)) {
+      printf ("SMI %u: the semaphores of processor %u were not reset\n", (unsigned) mSmi, (unsigned) Index);
+      return FALSE;
+    }
+    if (SyncMode == SmmCpuSyncModeTradition && !mPresentInHandlers[Index]) {
+      printf ("SMI %u: processor %u not present in the traditional sync mode\n", (unsigned) mSmi, (unsigned) Index);
+      return FALSE;
+    }
+    if (SyncMode == SmmCpuSyncModeBspOnly &&
+        mPresentInHandlers[Index] != (Index == mBsp || Index == mSmiSource)) {
+      printf ("SMI %u: processor %u %spresent in the BSP only sync mode (BSP %u, source %u)\n",
+        (unsigned) mSmi, (unsigned) Index, mPresentInHandlers[Index] ? "" : "not ",
+        (unsigned) mBsp, (unsigned) mSmiSource);
+      return FALSE;
+    }
+  }
+  if (mPresentInHandlers[mSmiSource] && !mSourceSawUpdate) {
+    printf ("SMI %u: processor %u left SMM before its save state was updated\n", (unsigned) mSmi, (unsigned) mSmiSource);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  pthread_t          Threads[NUMBER_OF_CPUS];
+  UINTN              Index;
+  SMM_CPU_SYNC_MODE  SyncMode;
+  UINTN              Failures;
+
+  mSmiCount = (argc > 1) ? strtoul (argv[1], NULL, 0) : 300;
+  srand ((argc > 2) ? (unsigned) strtoul (argv[2], NULL, 0) : 1);
+
+  for (Index = 0; Index < NUMBER_OF_CPUS; Index++) {
+    mProcessorInfo[Index].Location.Package = PACKAGE_OF_CPU (Index);
+  }
+  gSmmCpuPrivate->ProcessorInfo = mProcessorInfo;
+  gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus = NUMBER_OF_CPUS;
+  gSmmCpuPrivate->SmmCoreEntry = TestSmmCoreEntry;
+
+  InitializeSmmCpuSemaphores ();
+  mSmmMpSyncDataSize = sizeof (SMM_DISPATCHER_MP_SYNC_DATA) +
+                       (sizeof (SMM_CPU_DATA_BLOCK) + sizeof (SMM_CPU_RELEASE_SLOT) + sizeof (BOOLEAN)) * NUMBER_OF_CPUS;
+  mSmmMpSyncData = AllocatePages (EFI_SIZE_TO_PAGES (mSmmMpSyncDataSize));
+  InitializeMpSyncData ();
+
+  pthread_barrier_init (&mSmiStart, NULL, NUMBER_OF_CPUS + 1);
+  pthread_barrier_init (&mSmiEnd, NULL, NUMBER_OF_CPUS + 1);
+  for (Index = 0; Index < NUMBER_OF_CPUS; Index++) {
+    pthread_create (&Threads[Index], NULL, ProcessorThread, (VOID *) Index);
+  }
+  pthread_barrier_wait (&mSmiEnd);
+
+  Failures = 0;
+  for (mSmi = 1; mSmi <= mSmiCount; mSmi++) {
+    SyncMode = (SMM_CPU_SYNC_MODE) (mSmi % SmmCpuSyncModeMax);
+    mSmmMpSyncData->EffectiveSyncMode = SyncMode;
+    mBsp              = (UINTN) rand () % NUMBER_OF_CPUS;
+    mSmiSource        = (rand () % 4 == 0) ? mBsp : (UINTN) rand () % NUMBER_OF_CPUS;
+    mSourceSawUpdate  = FALSE;
+    mHandlerRuns      = 0;
+    mSmiPending       = TRUE;
+    ZeroMem (mPresentInHandlers, sizeof (mPresentInHandlers));
+
+    pthread_barrier_wait (&mSmiStart);
+    pthread_barrier_wait (&mSmiEnd);
+
+    if (!CheckSmi (SyncMode)) {
+      Failures++;
+    }
+  }
+  pthread_barrier_wait (&mSmiStart);
+  for (Index = 0; Index < NUMBER_OF_CPUS; Index++) {
+    pthread_join (Threads[Index], NULL);
+  }
+
+  printf ("SMI rendezvous: %u SMIs on %u processors, %u failed\n", (unsigned) mSmiCount, NUMBER_OF_CPUS, (unsigned) Failures);
+  return (Failures == 0) ? 0 : 1;
+}